@@ -30,6 +30,7 @@ Description: Astrometry Command Line
 **************************************************/
 
 #include "astrometry.hpp"
+#include "image/image.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -44,6 +45,8 @@ Description: Astrometry Command Line
 #include <chrono>
 #include <algorithm>
 #include <ctime>
+#include <array>
+#include <memory>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -313,18 +316,14 @@ namespace OpenAPT::API::Astrometry
         return ss.str();
     }
 
-    json solve(const std::string &image, const std::string &ra, const std::string &dec, const double &radius, const int &downsample,
-               const std::vector<int> &depth, const double &scale_low, const double &scale_high, const int &width, const int &height,
-               const std::string &scale_units, const bool &overwrite, const bool &no_plot, const bool &verify,
-               const bool &debug, const int &timeout, const bool &resort, const bool &_continue, const bool &no_tweak)
+    // 执行命令并把解析结果转换为 JSON
+    json run_solve(const std::string &command, const int &timeout)
     {
         SolveResult result;
         json ret_json;
 
         try
         {
-            auto command = make_command(image, ra, dec, radius, downsample, depth, scale_low, scale_high,
-                                        width, height, scale_units, overwrite, no_plot, verify, debug, resort, _continue, no_tweak);
             std::string output;
             auto status = execute_command(command, timeout, output);
             switch (status)
@@ -373,4 +372,59 @@ namespace OpenAPT::API::Astrometry
         return ret_json;
     }
 
+    json solve(const std::string &image, const std::string &ra, const std::string &dec, const double &radius, const int &downsample,
+               const std::vector<int> &depth, const double &scale_low, const double &scale_high, const int &width, const int &height,
+               const std::string &scale_units, const bool &overwrite, const bool &no_plot, const bool &verify,
+               const bool &debug, const int &timeout, const bool &resort, const bool &_continue, const bool &no_tweak)
+    {
+        std::string command;
+        try
+        {
+            command = make_command(image, ra, dec, radius, downsample, depth, scale_low, scale_high,
+                                   width, height, scale_units, overwrite, no_plot, verify, debug, resort, _continue, no_tweak);
+        }
+        catch (const std::exception &e)
+        {
+            return {{"error_message", e.what()}};
+        }
+        return run_solve(command, timeout);
+    }
+
+    json solve_stars(const std::string &image, const int &max_stars, const std::string &ra, const std::string &dec,
+                     const double &radius, const double &scale_low, const double &scale_high,
+                     const std::string &scale_units, const int &timeout)
+    {
+        std::vector<OpenAPT::StarPoint> stars;
+        int width = 0, height = 0;
+        if (!OpenAPT::StarDetect(image, stars, width, height, max_stars > 0 ? max_stars : 0))
+        {
+            return {{"error_message", "Star detection failed"}};
+        }
+        if (stars.empty())
+        {
+            return {{"error_message", "No stars detected"}};
+        }
+
+        // 星表与图像放在同一目录下，求解器产生的中间文件也会跟随该路径
+        const std::string xylist = image.substr(0, image.find_last_of('.')) + ".xyls";
+        if (!OpenAPT::SaveStarList(xylist, stars, width, height))
+        {
+            return {{"error_message", "Failed to write star list"}};
+        }
+
+        std::string command;
+        try
+        {
+            command = make_command(xylist, ra, dec, radius, 1, {}, scale_low, scale_high, width, height,
+                                   scale_units, true, true, false, false, false, false, false);
+        }
+        catch (const std::exception &e)
+        {
+            return {{"error_message", e.what()}};
+        }
+        // 星表已按流量排序，直接告诉 solve-field 使用哪些列
+        command += " --x-column X --y-column Y --sort-column FLUX";
+        return run_solve(command, timeout);
+    }
+
 } // namespace OpenAPT::API:Astrometry
@@ -35,4 +35,22 @@ namespace OpenAPT::API::Astrometry
                const std::vector<int> &depth = {}, const double &scale_low = -1.0, const double &scale_high = -1.0, const int &width = -1, const int &height = -1,
                const std::string &scale_units = "degwidth", const bool &overwrite = true, const bool &no_plot = true, const bool &verify = false,
                const bool &debug = false, const int &timeout = 30, const bool &resort = false, const bool &_continue = false, const bool &no_tweak = false);
+
+    /**
+     * @brief 先在本地提取星点并写入 XYLS 星表，再交给 solve-field 求解，避免求解器对整幅图像重复提取星点
+     *
+     * @param image 图像文件路径（FITS）
+     * @param max_stars 保留的最亮星点数量
+     * @param ra 目标区域的赤经信息
+     * @param dec 目标区域的赤纬信息
+     * @param radius 搜索半径
+     * @param scale_low 亮度值下限
+     * @param scale_high 亮度值上限
+     * @param scale_units 图像尺寸单位
+     * @param timeout 解析超时时间（秒）
+     * @return json类型的结果，格式与 solve 相同
+     */
+    json solve_stars(const std::string &image, const int &max_stars = 100, const std::string &ra = "", const std::string &dec = "",
+                     const double &radius = -1.0, const double &scale_low = -1.0, const double &scale_high = -1.0,
+                     const std::string &scale_units = "degwidth", const int &timeout = 30);
 } // namespace OpenAPT::API:Astrometry
@@ -0,0 +1,111 @@
+/*
+ * indiblobclient.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-18
+
+Description: Dedicated INDI BLOB Connection
+
+**************************************************/
+
+#include "indiblobclient.hpp"
+
+#include <spdlog/spdlog.h>
+
+OpenAptIndiBlobClient::OpenAptIndiBlobClient(BlobCallback callback, std::function<void()> disconnected)
+    : m_callback(std::move(callback)), m_disconnected(std::move(disconnected))
+{
+}
+
+OpenAptIndiBlobClient::~OpenAptIndiBlobClient()
+{
+    stop();
+}
+
+bool OpenAptIndiBlobClient::start(const std::string &host, int port, const std::string &device, const std::string &blob)
+{
+    if (isRunning())
+    {
+        return true;
+    }
+    m_device = device;
+    m_blob = blob;
+    setServer(host.c_str(), port);
+    // 只关心这一台设备，其余设备的定义不会发送到本连接
+    watchDevice(device.c_str());
+    if (!connectServer())
+    {
+        spdlog::warn("Failed to open BLOB connection for {} on {}:{}", device, host, port);
+        return false;
+    }
+    m_running.store(true, std::memory_order_release);
+    return true;
+}
+
+void OpenAptIndiBlobClient::stop()
+{
+    if (m_running.exchange(false, std::memory_order_acq_rel))
+    {
+        DisconnectIndiServer();
+    }
+}
+
+void OpenAptIndiBlobClient::newProperty(INDI::Property *property)
+{
+    if (property->getType() != INDI_BLOB || m_device != property->getDeviceName() || m_blob != property->getName())
+    {
+        return;
+    }
+    // 本连接只接收 BLOB，数值和开关更新全部走控制连接
+    setBLOBMode(B_ONLY, m_device.c_str(), m_blob.c_str());
+#ifdef INDI_SHARED_BLOB_SUPPORT
+    enableDirectBlobAccess(m_device.c_str(), m_blob.c_str());
+#endif
+    spdlog::debug("BLOB connection for {} subscribed to {}", m_device, m_blob);
+}
+
+void OpenAptIndiBlobClient::newBLOB(IBLOB *bp)
+{
+    m_received.fetch_add(1, std::memory_order_relaxed);
+    if (m_callback)
+    {
+        m_callback(bp);
+    }
+}
+
+void OpenAptIndiBlobClient::IndiServerConnected()
+{
+    spdlog::debug("BLOB connection for {} established", m_device);
+}
+
+void OpenAptIndiBlobClient::IndiServerDisconnected(int exit_code)
+{
+    // stop() 先清除标志，只有意外断开时才通知驱动
+    const bool unexpected = m_running.exchange(false, std::memory_order_acq_rel);
+    spdlog::debug("BLOB connection for {} closed ({})", m_device, exit_code);
+    if (unexpected && m_disconnected)
+    {
+        m_disconnected();
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * indiblobclient.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-18
+
+Description: Dedicated INDI BLOB Connection
+
+**************************************************/
+
+#ifndef _INDI_BLOB_CLIENT_HPP_
+#define _INDI_BLOB_CLIENT_HPP_
+
+#include "indiclient.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @brief 只接收 BLOB 的 INDI 连接
+ *
+ * 图像数据与数值/开关更新共用一个套接字时，下载几 MB 的图像会让温度、电调等更新停顿数秒。
+ * 设备驱动在控制连接上设置 B_NEVER，另开本连接并对指定的 BLOB 属性设置 B_ONLY，
+ * 收到的 BLOB 通过回调交给驱动，与控制连接的事件汇入同一个设备对象。
+ * 回调在本连接的监听线程中调用。连接意外断开（不是 stop() 引起的）时调用 disconnected，
+ * 驱动可以让控制连接重新接收 BLOB。
+ */
+class OpenAptIndiBlobClient : public OpenAptIndiClient
+{
+public:
+    using BlobCallback = std::function<void(IBLOB *)>;
+
+    explicit OpenAptIndiBlobClient(BlobCallback callback, std::function<void()> disconnected = nullptr);
+    ~OpenAptIndiBlobClient();
+
+    /**
+     * @brief 连接服务器并只订阅 device 的 blob 属性
+     *
+     * @return 无法连接服务器时返回 false，调用者应回退到单连接模式
+     */
+    bool start(const std::string &host, int port, const std::string &device, const std::string &blob);
+
+    void stop();
+
+    bool isRunning() const
+    {
+        return m_running.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 已收到的 BLOB 数量
+     */
+    uint64_t received() const
+    {
+        return m_received.load(std::memory_order_relaxed);
+    }
+
+protected:
+    void newDevice(INDI::BaseDevice *dp) override {}
+    void removeDevice(INDI::BaseDevice *dp) override {}
+    void newProperty(INDI::Property *property) override;
+    void removeProperty(INDI::Property *property) override {}
+    void newBLOB(IBLOB *bp) override;
+    void newSwitch(ISwitchVectorProperty *svp) override {}
+    void newNumber(INumberVectorProperty *nvp) override {}
+    void newMessage(INDI::BaseDevice *dp, int messageID) override {}
+    void newText(ITextVectorProperty *tvp) override {}
+    void newLight(ILightVectorProperty *lvp) override {}
+    void IndiServerConnected() override;
+    void IndiServerDisconnected(int exit_code) override;
+
+private:
+    BlobCallback m_callback;
+    std::function<void()> m_disconnected;
+    std::string m_device;
+    std::string m_blob;
+    std::atomic_bool m_running{false};
+    std::atomic_uint64_t m_received{0};
+};
+
+#endif
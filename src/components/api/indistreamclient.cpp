@@ -0,0 +1,696 @@
+/*
+ * indistreamclient.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-19
+
+Description: Native Streaming INDI Client
+
+**************************************************/
+
+#include "indistreamclient.hpp"
+#include "indixmlscanner.hpp"
+
+#include "property/base64.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <optional>
+
+#include <boost/asio.hpp>
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::API
+{
+    namespace
+    {
+        std::string_view Trim(std::string_view text)
+        {
+            const auto space = [](char c)
+            { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; };
+            while (!text.empty() && space(text.front()))
+            {
+                text.remove_prefix(1);
+            }
+            while (!text.empty() && space(text.back()))
+            {
+                text.remove_suffix(1);
+            }
+            return text;
+        }
+
+        size_t ParseSize(std::string_view text)
+        {
+            size_t value = 0;
+            text = Trim(text);
+            std::from_chars(text.data(), text.data() + text.size(), value);
+            return value;
+        }
+
+        // 由 def/set 与 Vector 之间的部分确定属性类型
+        bool ParseVectorTag(std::string_view tag, IndiVectorKind &kind, bool &definition)
+        {
+            constexpr std::string_view suffix = "Vector";
+            if (tag.size() <= 3 + suffix.size() || tag.substr(tag.size() - suffix.size()) != suffix)
+            {
+                return false;
+            }
+            const std::string_view prefix = tag.substr(0, 3);
+            if (prefix != "def" && prefix != "set")
+            {
+                return false;
+            }
+            definition = prefix == "def";
+            const std::string_view type = tag.substr(3, tag.size() - 3 - suffix.size());
+            if (type == "Number")
+            {
+                kind = IndiVectorKind::Number;
+            }
+            else if (type == "Switch")
+            {
+                kind = IndiVectorKind::Switch;
+            }
+            else if (type == "Text")
+            {
+                kind = IndiVectorKind::Text;
+            }
+            else if (type == "Light")
+            {
+                kind = IndiVectorKind::Light;
+            }
+            else if (type == "BLOB")
+            {
+                kind = IndiVectorKind::Blob;
+            }
+            else
+            {
+                return false;
+            }
+            return true;
+        }
+
+        void AppendEscaped(fmt::memory_buffer &out, std::string_view text)
+        {
+            for (const char c : text)
+            {
+                switch (c)
+                {
+                case '<':
+                    out.append(std::string_view("&lt;"));
+                    break;
+                case '>':
+                    out.append(std::string_view("&gt;"));
+                    break;
+                case '&':
+                    out.append(std::string_view("&amp;"));
+                    break;
+                case '"':
+                    out.append(std::string_view("&quot;"));
+                    break;
+                case '\'':
+                    out.append(std::string_view("&apos;"));
+                    break;
+                default:
+                    out.push_back(c);
+                }
+            }
+        }
+
+        const char *BlobModeName(IndiBlobMode mode)
+        {
+            switch (mode)
+            {
+            case IndiBlobMode::Never:
+                return "Never";
+            case IndiBlobMode::Only:
+                return "Only";
+            default:
+                return "Also";
+            }
+        }
+    } // namespace
+
+    size_t IndiBlobInfo::capacity() const
+    {
+        // 压缩格式的 size 是解压后的大小，有 enclen 时以编码长度为准
+        return std::max(size, encoded_length ? Base64::base64DecodedBound(encoded_length) : 0);
+    }
+
+    struct IndiStreamClient::Impl
+    {
+        boost::asio::io_context io_context;
+        boost::asio::ip::tcp::socket socket{io_context};
+        IndiXmlScanner scanner;
+
+        // 解析状态：depth 为当前元素深度，1 为属性，2 为元素
+        int depth = 0;
+        bool in_vector = false;
+        bool parse_elements = false;
+        IndiVectorKind kind = IndiVectorKind::Number;
+        bool definition = false;
+        std::string device, name, label, group, state, perm, rule, timestamp, message;
+
+        // 元素数组只增不减，字符串的容量在消息之间复用
+        std::vector<IndiElement> elements;
+        size_t count = 0;
+        bool in_element = false;
+        std::string raw;
+
+        // 正在接收的 BLOB
+        bool in_blob = false;
+        std::string blob_element, blob_format;
+        size_t blob_size = 0, blob_encoded = 0;
+        std::optional<Base64::StreamDecoder> decoder;
+
+        IndiBlobInfo blobInfo() const
+        {
+            IndiBlobInfo info;
+            info.device = device;
+            info.name = name;
+            info.element = blob_element;
+            info.format = blob_format;
+            info.size = blob_size;
+            info.encoded_length = blob_encoded;
+            return info;
+        }
+
+        void resetState()
+        {
+            depth = 0;
+            in_vector = in_element = in_blob = false;
+            decoder.reset();
+            scanner.reset();
+        }
+
+        void copyAttribute(std::string_view key, std::string &out)
+        {
+            out.clear();
+            IndiXmlScanner::Unescape(scanner.attribute(key), out);
+        }
+
+        void startVector(IndiStreamClient &client, std::string_view tag)
+        {
+            in_vector = ParseVectorTag(tag, kind, definition);
+            if (!in_vector)
+            {
+                return;
+            }
+            // 属性名和设备名几乎不含实体，但仍统一转义，保证和 libindi 一致
+            copyAttribute("device", device);
+            copyAttribute("name", name);
+            copyAttribute("state", state);
+            copyAttribute("timestamp", timestamp);
+            copyAttribute("message", message);
+            if (definition)
+            {
+                copyAttribute("label", label);
+                copyAttribute("group", group);
+                copyAttribute("perm", perm);
+                copyAttribute("rule", rule);
+            }
+            else
+            {
+                label.clear();
+                group.clear();
+                perm.clear();
+                rule.clear();
+            }
+            parse_elements = static_cast<bool>(client.m_handlers.vector);
+            count = 0;
+        }
+
+        void startElement(IndiStreamClient &client, std::string_view tag)
+        {
+            if (kind == IndiVectorKind::Blob)
+            {
+                if (tag != "oneBLOB")
+                {
+                    return;
+                }
+                copyAttribute("name", blob_element);
+                copyAttribute("format", blob_format);
+                blob_size = ParseSize(scanner.attribute("size"));
+                blob_encoded = ParseSize(scanner.attribute("enclen"));
+                in_blob = true;
+                decoder.reset();
+                if (client.m_handlers.blob_begin)
+                {
+                    const std::span<uint8_t> target = client.m_handlers.blob_begin(blobInfo());
+                    if (!target.empty())
+                    {
+                        decoder.emplace(target.data(), target.size());
+                    }
+                }
+                return;
+            }
+            if (!parse_elements)
+            {
+                return;
+            }
+            if (count == elements.size())
+            {
+                elements.emplace_back();
+            }
+            IndiElement &element = elements[count];
+            copyAttribute("name", element.name);
+            element.label.clear();
+            element.value = element.min = element.max = element.step = 0;
+            element.on = false;
+            if (definition)
+            {
+                copyAttribute("label", element.label);
+                if (kind == IndiVectorKind::Number)
+                {
+                    ParseNumber(scanner.attribute("min"), element.min);
+                    ParseNumber(scanner.attribute("max"), element.max);
+                    ParseNumber(scanner.attribute("step"), element.step);
+                }
+            }
+            raw.clear();
+            in_element = true;
+        }
+
+        void endElement()
+        {
+            if (!in_element)
+            {
+                return;
+            }
+            in_element = false;
+            IndiElement &element = elements[count++];
+            element.text.clear();
+            IndiXmlScanner::Unescape(Trim(raw), element.text);
+            switch (kind)
+            {
+            case IndiVectorKind::Number:
+                ParseNumber(element.text, element.value);
+                break;
+            case IndiVectorKind::Switch:
+                element.on = element.text == "On";
+                element.value = element.on ? 1 : 0;
+                break;
+            default:
+                break;
+            }
+        }
+
+        void endBlob(IndiStreamClient &client)
+        {
+            in_blob = false;
+            if (!decoder)
+            {
+                return;
+            }
+            const bool ok = decoder->finish();
+            const size_t size = decoder->size();
+            decoder.reset();
+            client.m_blobs.fetch_add(1, std::memory_order_relaxed);
+            if (!ok)
+            {
+                spdlog::warn("INDI BLOB {}.{} is corrupted or larger than {} bytes", device, name, blob_size);
+            }
+            if (client.m_handlers.blob_end)
+            {
+                client.m_handlers.blob_end(blobInfo(), size, ok);
+            }
+        }
+
+        void endVector(IndiStreamClient &client)
+        {
+            in_vector = false;
+            client.m_vectors.fetch_add(1, std::memory_order_relaxed);
+            if (!message.empty() && client.m_handlers.message)
+            {
+                client.m_handlers.message(device, message);
+            }
+            if (!parse_elements)
+            {
+                return;
+            }
+            IndiVector vector;
+            vector.kind = kind;
+            vector.definition = definition;
+            vector.device = device;
+            vector.name = name;
+            vector.label = label;
+            vector.group = group;
+            vector.state = state;
+            vector.perm = perm;
+            vector.rule = rule;
+            vector.timestamp = timestamp;
+            vector.message = message;
+            vector.elements = std::span<const IndiElement>(elements.data(), count);
+            client.m_handlers.vector(vector);
+        }
+
+        void topLevel(IndiStreamClient &client, std::string_view tag)
+        {
+            if (tag == "delProperty")
+            {
+                copyAttribute("device", device);
+                copyAttribute("name", name);
+                if (client.m_handlers.removed)
+                {
+                    client.m_handlers.removed(device, name);
+                }
+            }
+            else if (tag == "message")
+            {
+                copyAttribute("device", device);
+                copyAttribute("message", message);
+                if (client.m_handlers.message)
+                {
+                    client.m_handlers.message(device, message);
+                }
+            }
+            else
+            {
+                startVector(client, tag);
+            }
+        }
+
+        /**
+         * @brief 处理缓冲区中的所有事件
+         *
+         * @return 流格式错误时返回 false
+         */
+        bool process(IndiStreamClient &client)
+        {
+            while (true)
+            {
+                switch (scanner.next())
+                {
+                case IndiXmlScanner::Event::None:
+                    return true;
+                case IndiXmlScanner::Event::Error:
+                    return false;
+                case IndiXmlScanner::Event::StartElement:
+                    ++depth;
+                    if (depth == 1)
+                    {
+                        topLevel(client, scanner.name());
+                    }
+                    else if (depth == 2 && in_vector)
+                    {
+                        startElement(client, scanner.name());
+                    }
+                    break;
+                case IndiXmlScanner::Event::EndElement:
+                    if (depth == 2 && in_blob)
+                    {
+                        endBlob(client);
+                    }
+                    else if (depth == 2 && in_element)
+                    {
+                        endElement();
+                    }
+                    else if (depth == 1 && in_vector)
+                    {
+                        endVector(client);
+                    }
+                    depth = std::max(depth - 1, 0);
+                    break;
+                case IndiXmlScanner::Event::Text:
+                    if (in_blob)
+                    {
+                        // 已失败的解码器忽略余下的数据，结束时报告
+                        if (decoder)
+                        {
+                            decoder->feed(scanner.text());
+                        }
+                    }
+                    else if (in_element)
+                    {
+                        raw.append(scanner.text());
+                    }
+                    break;
+                }
+            }
+        }
+    };
+
+    IndiStreamClient::IndiStreamClient(Handlers handlers)
+        : m_handlers(std::move(handlers)), m_impl(std::make_unique<Impl>())
+    {
+    }
+
+    IndiStreamClient::~IndiStreamClient()
+    {
+        disconnect();
+    }
+
+    bool IndiStreamClient::connect(const std::string &host, int port)
+    {
+        if (isConnected())
+        {
+            return true;
+        }
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        boost::system::error_code ec;
+        boost::asio::ip::tcp::resolver resolver(m_impl->io_context);
+        const auto endpoints = resolver.resolve(host, std::to_string(port), ec);
+        if (!ec)
+        {
+            boost::asio::connect(m_impl->socket, endpoints, ec);
+        }
+        if (ec)
+        {
+            spdlog::error("Failed to connect to INDI server {}:{}: {}", host, port, ec.message());
+            m_impl->socket.close(ec);
+            return false;
+        }
+        m_impl->socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+        // BLOB 以 MB 计，较大的接收缓冲减少读取次数
+        m_impl->socket.set_option(boost::asio::socket_base::receive_buffer_size(4 << 20), ec);
+        m_impl->resetState();
+        m_stopping.store(false, std::memory_order_release);
+        m_connected.store(true, std::memory_order_release);
+        m_thread = std::thread([this]()
+                               { run(); });
+        spdlog::debug("Connected to INDI server {}:{}", host, port);
+        return true;
+    }
+
+    void IndiStreamClient::disconnect()
+    {
+        m_stopping.store(true, std::memory_order_release);
+        if (m_connected.load(std::memory_order_acquire))
+        {
+            // shutdown 让阻塞的 read_some 返回，套接字在接收线程退出后关闭
+            boost::system::error_code ec;
+            m_impl->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        }
+        if (m_thread.joinable() && m_thread.get_id() != std::this_thread::get_id())
+        {
+            m_thread.join();
+        }
+    }
+
+    void IndiStreamClient::run()
+    {
+        Impl &impl = *m_impl;
+        boost::system::error_code ec;
+        bool corrupted = false;
+        while (!m_stopping.load(std::memory_order_acquire))
+        {
+            const auto [data, capacity] = impl.scanner.prepare();
+            const size_t received = impl.socket.read_some(boost::asio::buffer(data, capacity), ec);
+            if (ec)
+            {
+                break;
+            }
+            impl.scanner.commit(received);
+            m_bytes.fetch_add(received, std::memory_order_relaxed);
+            if (!impl.process(*this))
+            {
+                corrupted = true;
+                break;
+            }
+        }
+        if (impl.in_blob && impl.decoder && m_handlers.blob_end)
+        {
+            // 未接收完的 BLOB 交还给调用者释放
+            m_handlers.blob_end(impl.blobInfo(), 0, false);
+        }
+        impl.resetState();
+        {
+            std::lock_guard<std::mutex> lock(m_write_mutex);
+            impl.socket.close(ec);
+        }
+        m_connected.store(false, std::memory_order_release);
+        if (!m_stopping.load(std::memory_order_acquire))
+        {
+            spdlog::warn("INDI connection closed{}", corrupted ? ": malformed XML stream" : "");
+            if (m_handlers.disconnected)
+            {
+                m_handlers.disconnected();
+            }
+        }
+    }
+
+    bool IndiStreamClient::send(std::string_view xml)
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        if (!m_connected.load(std::memory_order_acquire) || !m_impl->socket.is_open())
+        {
+            return false;
+        }
+        boost::system::error_code ec;
+        boost::asio::write(m_impl->socket, boost::asio::buffer(xml.data(), xml.size()), ec);
+        if (ec)
+        {
+            spdlog::error("Failed to send to INDI server: {}", ec.message());
+            return false;
+        }
+        return true;
+    }
+
+    bool IndiStreamClient::getProperties(std::string_view device, std::string_view property)
+    {
+        fmt::memory_buffer xml;
+        xml.append(std::string_view("<getProperties version=\"1.7\""));
+        if (!device.empty())
+        {
+            xml.append(std::string_view(" device=\""));
+            AppendEscaped(xml, device);
+            xml.push_back('"');
+        }
+        if (!property.empty())
+        {
+            xml.append(std::string_view(" name=\""));
+            AppendEscaped(xml, property);
+            xml.push_back('"');
+        }
+        xml.append(std::string_view("/>\n"));
+        return send(std::string_view(xml.data(), xml.size()));
+    }
+
+    bool IndiStreamClient::enableBlob(std::string_view device, std::string_view property, IndiBlobMode mode)
+    {
+        fmt::memory_buffer xml;
+        xml.append(std::string_view("<enableBLOB device=\""));
+        AppendEscaped(xml, device);
+        xml.push_back('"');
+        if (!property.empty())
+        {
+            xml.append(std::string_view(" name=\""));
+            AppendEscaped(xml, property);
+            xml.push_back('"');
+        }
+        fmt::format_to(std::back_inserter(xml), ">{}</enableBLOB>\n", BlobModeName(mode));
+        return send(std::string_view(xml.data(), xml.size()));
+    }
+
+    bool IndiStreamClient::sendNumber(std::string_view device, std::string_view property,
+                                      std::initializer_list<std::pair<std::string_view, double>> values)
+    {
+        fmt::memory_buffer xml;
+        xml.append(std::string_view("<newNumberVector device=\""));
+        AppendEscaped(xml, device);
+        xml.append(std::string_view("\" name=\""));
+        AppendEscaped(xml, property);
+        xml.append(std::string_view("\">\n"));
+        for (const auto &[element, value] : values)
+        {
+            xml.append(std::string_view("  <oneNumber name=\""));
+            AppendEscaped(xml, element);
+            fmt::format_to(std::back_inserter(xml), "\">{:.10g}</oneNumber>\n", value);
+        }
+        xml.append(std::string_view("</newNumberVector>\n"));
+        return send(std::string_view(xml.data(), xml.size()));
+    }
+
+    bool IndiStreamClient::sendSwitch(std::string_view device, std::string_view property, std::string_view element, bool on)
+    {
+        fmt::memory_buffer xml;
+        xml.append(std::string_view("<newSwitchVector device=\""));
+        AppendEscaped(xml, device);
+        xml.append(std::string_view("\" name=\""));
+        AppendEscaped(xml, property);
+        xml.append(std::string_view("\">\n  <oneSwitch name=\""));
+        AppendEscaped(xml, element);
+        fmt::format_to(std::back_inserter(xml), "\">{}</oneSwitch>\n</newSwitchVector>\n", on ? "On" : "Off");
+        return send(std::string_view(xml.data(), xml.size()));
+    }
+
+    bool IndiStreamClient::sendText(std::string_view device, std::string_view property, std::string_view element, std::string_view text)
+    {
+        fmt::memory_buffer xml;
+        xml.append(std::string_view("<newTextVector device=\""));
+        AppendEscaped(xml, device);
+        xml.append(std::string_view("\" name=\""));
+        AppendEscaped(xml, property);
+        xml.append(std::string_view("\">\n  <oneText name=\""));
+        AppendEscaped(xml, element);
+        xml.append(std::string_view("\">"));
+        AppendEscaped(xml, text);
+        xml.append(std::string_view("</oneText>\n</newTextVector>\n"));
+        return send(std::string_view(xml.data(), xml.size()));
+    }
+
+    bool IndiStreamClient::ParseNumber(std::string_view text, double &value)
+    {
+        text = Trim(text);
+        if (text.empty())
+        {
+            return false;
+        }
+        const char *pos = text.data();
+        const char *end = text.data() + text.size();
+        const bool negative = *pos == '-';
+        if (negative || *pos == '+')
+        {
+            ++pos;
+        }
+        double result = 0;
+        double scale = 1;
+        // 依次解析度、分、秒，分隔符可以是冒号或空格
+        for (int part = 0; part < 3 && pos < end; ++part)
+        {
+            double component = 0;
+            const auto [next, ec] = std::from_chars(pos, end, component);
+            if (ec != std::errc())
+            {
+                return part > 0 ? (value = negative ? -result : result, true) : false;
+            }
+            result += component / scale;
+            scale *= 60;
+            pos = next;
+            if (pos < end && (*pos == ':' || *pos == ' '))
+            {
+                ++pos;
+            }
+            else
+            {
+                break;
+            }
+        }
+        value = negative ? -result : result;
+        return true;
+    }
+} // namespace OpenAPT::API
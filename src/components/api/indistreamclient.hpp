@@ -0,0 +1,229 @@
+/*
+ * indistreamclient.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-19
+
+Description: Native Streaming INDI Client
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace OpenAPT::API
+{
+    enum class IndiVectorKind
+    {
+        Number,
+        Switch,
+        Text,
+        Light,
+        Blob,
+    };
+
+    enum class IndiBlobMode
+    {
+        Never,
+        Also,
+        Only,
+    };
+
+    /**
+     * @brief 属性中的一个元素，字符串在连接内复用，只在回调期间有效
+     */
+    struct IndiElement
+    {
+        std::string name;
+        std::string label;
+        std::string text;  ///< 转义后的原始值，数值属性中为数字文本
+        double value = 0;  ///< 数值；开关为 1/0；灯和文本为 0
+        double min = 0;
+        double max = 0;
+        double step = 0;
+        bool on = false;   ///< 开关是否为 On
+    };
+
+    /**
+     * @brief 一次 def*Vector / set*Vector，视图只在回调期间有效
+     */
+    struct IndiVector
+    {
+        IndiVectorKind kind = IndiVectorKind::Number;
+        bool definition = false; ///< def*Vector 为 true
+        std::string_view device;
+        std::string_view name;
+        std::string_view label;
+        std::string_view group;
+        std::string_view state;
+        std::string_view perm;
+        std::string_view rule;
+        std::string_view timestamp;
+        std::string_view message;
+        std::span<const IndiElement> elements;
+
+        const IndiElement *find(std::string_view element) const
+        {
+            for (const auto &e : elements)
+            {
+                if (e.name == element)
+                {
+                    return &e;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    /**
+     * @brief 正在接收的 BLOB
+     */
+    struct IndiBlobInfo
+    {
+        std::string_view device;
+        std::string_view name;    ///< 属性名
+        std::string_view element; ///< 元素名
+        std::string_view format;
+        size_t size = 0;           ///< size 属性，即解压后的大小
+        size_t encoded_length = 0; ///< enclen 属性，服务器未提供时为 0
+
+        /**
+         * @brief 解码后至多需要的字节数
+         */
+        size_t capacity() const;
+    };
+
+    /**
+     * @brief 不依赖 libindi 的 INDI 客户端
+     *
+     * libindi 的 BaseClient 为每条消息建立 lilxml 树和属性对象，再经虚函数回调，BLOB 在解码前
+     * 还要整体缓存在 XML 树中。本客户端在自己的线程中把套接字数据读入 IndiXmlScanner 的可复用缓冲区，
+     * 逐个事件解析：属性更新以复用的元素数组回调，不产生每条消息的分配；BLOB 正文在到达时
+     * 由流式 Base64 解码器直接写入调用者提供的缓冲区（如帧缓冲的槽位），不经过任何中间副本。
+     *
+     * 所有回调都在接收线程中调用，发送函数可以在任意线程调用。
+     */
+    class IndiStreamClient
+    {
+    public:
+        struct Handlers
+        {
+            // def*Vector 和 set*Vector，为空时不解析元素内容
+            std::function<void(const IndiVector &)> vector;
+            // delProperty，name 为空表示删除整台设备
+            std::function<void(std::string_view device, std::string_view name)> removed;
+            // 设备或服务器消息
+            std::function<void(std::string_view device, std::string_view message)> message;
+            // BLOB 开始到达，返回解码目标缓冲区，返回空则丢弃该 BLOB
+            std::function<std::span<uint8_t>(const IndiBlobInfo &)> blob_begin;
+            // BLOB 接收结束，size 为实际解码的字节数，ok 为 false 时缓冲区内容无效
+            std::function<void(const IndiBlobInfo &, size_t size, bool ok)> blob_end;
+            // 连接被服务器关闭或出错，主动 disconnect() 时不调用
+            std::function<void()> disconnected;
+        };
+
+        explicit IndiStreamClient(Handlers handlers);
+        ~IndiStreamClient();
+
+        IndiStreamClient(const IndiStreamClient &) = delete;
+        IndiStreamClient &operator=(const IndiStreamClient &) = delete;
+
+        /**
+         * @brief 连接服务器并启动接收线程
+         *
+         * @return 无法连接时返回 false
+         */
+        bool connect(const std::string &host, int port);
+
+        void disconnect();
+
+        bool isConnected() const
+        {
+            return m_connected.load(std::memory_order_acquire);
+        }
+
+        bool getProperties(std::string_view device = {}, std::string_view property = {});
+
+        bool enableBlob(std::string_view device, std::string_view property, IndiBlobMode mode);
+
+        bool sendNumber(std::string_view device, std::string_view property,
+                        std::initializer_list<std::pair<std::string_view, double>> values);
+
+        /**
+         * @brief 把开关中的 element 置为 on，单选开关由服务器关闭其余元素
+         */
+        bool sendSwitch(std::string_view device, std::string_view property, std::string_view element, bool on = true);
+
+        bool sendText(std::string_view device, std::string_view property, std::string_view element, std::string_view text);
+
+        uint64_t bytesReceived() const
+        {
+            return m_bytes.load(std::memory_order_relaxed);
+        }
+
+        uint64_t vectorsReceived() const
+        {
+            return m_vectors.load(std::memory_order_relaxed);
+        }
+
+        uint64_t blobsReceived() const
+        {
+            return m_blobs.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief 解析 INDI 数值，支持十进制与 "d:m:s" 六十进制
+         */
+        static bool ParseNumber(std::string_view text, double &value);
+
+    private:
+        struct Impl;
+
+        bool send(std::string_view xml);
+        void run();
+
+        Handlers m_handlers;
+        std::unique_ptr<Impl> m_impl;
+        std::thread m_thread;
+        std::mutex m_write_mutex;
+        std::atomic_bool m_connected{false};
+        std::atomic_bool m_stopping{false};
+
+        std::atomic_uint64_t m_bytes{0};
+        std::atomic_uint64_t m_vectors{0};
+        std::atomic_uint64_t m_blobs{0};
+    };
+} // namespace OpenAPT::API
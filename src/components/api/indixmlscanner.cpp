@@ -0,0 +1,346 @@
+/*
+ * indixmlscanner.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-19
+
+Description: Incremental INDI XML Pull Scanner
+
+**************************************************/
+
+#include "indixmlscanner.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace OpenAPT::API
+{
+    namespace
+    {
+        // 单个标签的长度上限，超出说明流已损坏
+        constexpr size_t kMaxTagSize = 1 << 20;
+
+        inline bool IsSpace(char c)
+        {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        void AppendUtf8(uint32_t code, std::string &out)
+        {
+            if (code < 0x80)
+            {
+                out += static_cast<char>(code);
+            }
+            else if (code < 0x800)
+            {
+                out += static_cast<char>(0xc0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            else if (code < 0x10000)
+            {
+                out += static_cast<char>(0xe0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (code & 0x3f));
+            }
+            else
+            {
+                out += static_cast<char>(0xf0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (code & 0x3f));
+            }
+        }
+    } // namespace
+
+    IndiXmlScanner::IndiXmlScanner(size_t initial_capacity)
+        : m_buffer(std::max<size_t>(initial_capacity, 4096))
+    {
+    }
+
+    std::pair<char *, size_t> IndiXmlScanner::prepare(size_t min_size)
+    {
+        if (m_begin == m_end)
+        {
+            m_begin = m_end = 0;
+        }
+        else if (m_buffer.size() - m_end < min_size && m_begin > 0)
+        {
+            // 只有未处理完的标签会留在缓冲区，搬移的数据很少
+            std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+        }
+        if (m_buffer.size() - m_end < min_size)
+        {
+            m_buffer.resize(std::max(m_buffer.size() * 2, m_end + min_size));
+        }
+        return {m_buffer.data() + m_end, m_buffer.size() - m_end};
+    }
+
+    void IndiXmlScanner::commit(size_t size)
+    {
+        m_end = std::min(m_end + size, m_buffer.size());
+    }
+
+    void IndiXmlScanner::reset()
+    {
+        m_begin = m_end = 0;
+        m_pending_end = false;
+        m_name = {};
+        m_text = {};
+        m_attributes.clear();
+    }
+
+    IndiXmlScanner::Event IndiXmlScanner::next()
+    {
+        if (m_pending_end)
+        {
+            m_pending_end = false;
+            m_attributes.clear();
+            return Event::EndElement;
+        }
+        while (m_begin < m_end)
+        {
+            const char *data = m_buffer.data();
+            if (data[m_begin] != '<')
+            {
+                // 文本直到下一个 '<'，没有则返回全部已到达的部分
+                const void *lt = std::memchr(data + m_begin, '<', m_end - m_begin);
+                const size_t stop = lt ? static_cast<size_t>(static_cast<const char *>(lt) - data) : m_end;
+                m_text = std::string_view(data + m_begin, stop - m_begin);
+                m_begin = stop;
+                return Event::Text;
+            }
+            if (m_end - m_begin < 2)
+            {
+                return Event::None;
+            }
+            // 注释和处理指令直接跳过
+            if (data[m_begin + 1] == '!' || data[m_begin + 1] == '?')
+            {
+                const bool comment = m_end - m_begin >= 4 && std::memcmp(data + m_begin, "<!--", 4) == 0;
+                const std::string_view rest(data + m_begin, m_end - m_begin);
+                const size_t close = comment ? rest.find("-->", 4) : rest.find('>');
+                if (close == std::string_view::npos)
+                {
+                    return rest.size() > kMaxTagSize ? Event::Error : Event::None;
+                }
+                m_begin += close + (comment ? 3 : 1);
+                continue;
+            }
+            // 查找标签结尾，跳过引号中的 '>'
+            char quote = 0;
+            for (size_t i = m_begin + 1; i < m_end; ++i)
+            {
+                const char c = data[i];
+                if (quote)
+                {
+                    if (c == quote)
+                    {
+                        quote = 0;
+                    }
+                }
+                else if (c == '"' || c == '\'')
+                {
+                    quote = c;
+                }
+                else if (c == '>')
+                {
+                    return parseTag(i);
+                }
+            }
+            return m_end - m_begin > kMaxTagSize ? Event::Error : Event::None;
+        }
+        return Event::None;
+    }
+
+    IndiXmlScanner::Event IndiXmlScanner::parseTag(size_t end)
+    {
+        const char *data = m_buffer.data();
+        size_t pos = m_begin + 1;
+        m_begin = end + 1;
+        m_attributes.clear();
+
+        if (data[pos] == '/')
+        {
+            size_t stop = end;
+            while (stop > pos + 1 && IsSpace(data[stop - 1]))
+            {
+                --stop;
+            }
+            m_name = std::string_view(data + pos + 1, stop - pos - 1);
+            return m_name.empty() ? Event::Error : Event::EndElement;
+        }
+
+        size_t stop = end;
+        const bool self_closing = data[end - 1] == '/';
+        if (self_closing)
+        {
+            --stop;
+        }
+        const size_t name_begin = pos;
+        while (pos < stop && !IsSpace(data[pos]))
+        {
+            ++pos;
+        }
+        m_name = std::string_view(data + name_begin, pos - name_begin);
+        if (m_name.empty())
+        {
+            return Event::Error;
+        }
+
+        while (true)
+        {
+            while (pos < stop && IsSpace(data[pos]))
+            {
+                ++pos;
+            }
+            if (pos >= stop)
+            {
+                break;
+            }
+            const size_t key_begin = pos;
+            while (pos < stop && data[pos] != '=' && !IsSpace(data[pos]))
+            {
+                ++pos;
+            }
+            const std::string_view key(data + key_begin, pos - key_begin);
+            while (pos < stop && IsSpace(data[pos]))
+            {
+                ++pos;
+            }
+            if (key.empty() || pos >= stop || data[pos] != '=')
+            {
+                return Event::Error;
+            }
+            ++pos;
+            while (pos < stop && IsSpace(data[pos]))
+            {
+                ++pos;
+            }
+            if (pos >= stop || (data[pos] != '"' && data[pos] != '\''))
+            {
+                return Event::Error;
+            }
+            const char quote = data[pos++];
+            const size_t value_begin = pos;
+            while (pos < stop && data[pos] != quote)
+            {
+                ++pos;
+            }
+            if (pos >= stop)
+            {
+                return Event::Error;
+            }
+            m_attributes.emplace_back(key, std::string_view(data + value_begin, pos - value_begin));
+            ++pos;
+        }
+
+        m_pending_end = self_closing;
+        return Event::StartElement;
+    }
+
+    std::string_view IndiXmlScanner::attribute(std::string_view key) const
+    {
+        for (const auto &[name, value] : m_attributes)
+        {
+            if (name == key)
+            {
+                return value;
+            }
+        }
+        return {};
+    }
+
+    bool IndiXmlScanner::hasAttribute(std::string_view key) const
+    {
+        return std::any_of(m_attributes.begin(), m_attributes.end(), [key](const auto &attribute)
+                           { return attribute.first == key; });
+    }
+
+    void IndiXmlScanner::Unescape(std::string_view raw, std::string &out)
+    {
+        size_t pos = 0;
+        while (pos < raw.size())
+        {
+            const size_t amp = raw.find('&', pos);
+            if (amp == std::string_view::npos)
+            {
+                out.append(raw.substr(pos));
+                return;
+            }
+            out.append(raw.substr(pos, amp - pos));
+            const size_t semi = raw.find(';', amp);
+            if (semi == std::string_view::npos)
+            {
+                out.append(raw.substr(amp));
+                return;
+            }
+            const std::string_view entity = raw.substr(amp + 1, semi - amp - 1);
+            if (entity == "lt")
+            {
+                out += '<';
+            }
+            else if (entity == "gt")
+            {
+                out += '>';
+            }
+            else if (entity == "amp")
+            {
+                out += '&';
+            }
+            else if (entity == "quot")
+            {
+                out += '"';
+            }
+            else if (entity == "apos")
+            {
+                out += '\'';
+            }
+            else if (entity.size() > 1 && entity[0] == '#')
+            {
+                const bool hex = entity[1] == 'x' || entity[1] == 'X';
+                uint32_t code = 0;
+                for (const char c : entity.substr(hex ? 2 : 1))
+                {
+                    if (c >= '0' && c <= '9')
+                    {
+                        code = code * (hex ? 16 : 10) + (c - '0');
+                    }
+                    else if (hex && ((c | 0x20) >= 'a' && (c | 0x20) <= 'f'))
+                    {
+                        code = code * 16 + ((c | 0x20) - 'a' + 10);
+                    }
+                }
+                AppendUtf8(std::min<uint32_t>(code, 0x10ffff), out);
+            }
+            else
+            {
+                // 未知实体原样保留
+                out.append(raw.substr(amp, semi - amp + 1));
+            }
+            pos = semi + 1;
+        }
+    }
+} // namespace OpenAPT::API
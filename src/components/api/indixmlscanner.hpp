@@ -0,0 +1,128 @@
+/*
+ * indixmlscanner.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-19
+
+Description: Incremental INDI XML Pull Scanner
+
+**************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace OpenAPT::API
+{
+    /**
+     * @brief INDI XML 流的增量拉取式扫描器
+     *
+     * INDI 协议是没有根元素的连续 XML 流。套接字数据直接读入 prepare() 返回的可复用缓冲区，
+     * 再反复调用 next() 取出开始标签、结束标签和文本事件，不建立 DOM、不为每个元素分配内存。
+     * 元素之间的文本按已到达的部分分段返回，几 MB 的 BLOB 正文不会在缓冲区中累积，
+     * 调用者可以边接收边解码。返回的名称、属性和文本都指向内部缓冲区，下次 prepare() 后失效；
+     * 文本与属性值保持原样，需要时用 Unescape 处理实体。
+     */
+    class IndiXmlScanner
+    {
+    public:
+        enum class Event
+        {
+            None,         ///< 需要更多数据
+            StartElement, ///< 开始标签，自闭合标签随后产生 EndElement
+            EndElement,
+            Text,         ///< 一段文本，同一元素的文本可能分多次返回
+            Error,        ///< 数据不是合法的 XML 标签，连接应当关闭
+        };
+
+        explicit IndiXmlScanner(size_t initial_capacity = 256 * 1024);
+
+        /**
+         * @brief 取得可写入的缓冲区，至少 min_size 字节
+         *
+         * 已处理的数据在此时被丢弃，之前返回的视图全部失效。
+         */
+        std::pair<char *, size_t> prepare(size_t min_size = 64 * 1024);
+
+        /**
+         * @brief 确认 prepare() 的缓冲区中写入了 size 字节
+         */
+        void commit(size_t size);
+
+        /**
+         * @brief 取出下一个事件
+         */
+        Event next();
+
+        /**
+         * @brief 当前开始或结束标签的元素名
+         */
+        std::string_view name() const
+        {
+            return m_name;
+        }
+
+        /**
+         * @brief 当前开始标签的属性值（未转义），不存在时返回空
+         */
+        std::string_view attribute(std::string_view key) const;
+
+        bool hasAttribute(std::string_view key) const;
+
+        /**
+         * @brief 当前文本事件的内容（未转义）
+         */
+        std::string_view text() const
+        {
+            return m_text;
+        }
+
+        /**
+         * @brief 丢弃所有数据，重新开始扫描
+         */
+        void reset();
+
+        /**
+         * @brief 追加 raw 转义后的内容，处理 XML 预定义实体和数字字符引用
+         */
+        static void Unescape(std::string_view raw, std::string &out);
+
+    private:
+        Event parseTag(size_t end);
+
+        std::vector<char> m_buffer;
+        size_t m_begin = 0; ///< 尚未处理的数据起点
+        size_t m_end = 0;   ///< 已写入的数据终点
+        bool m_pending_end = false; ///< 自闭合标签的 EndElement 尚未返回
+
+        std::string_view m_name;
+        std::string_view m_text;
+        std::vector<std::pair<std::string_view, std::string_view>> m_attributes;
+    };
+} // namespace OpenAPT::API
@@ -0,0 +1,91 @@
+/*
+ * astrotime.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-11
+
+Description: Julian Date and Sidereal Time
+
+**************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+
+namespace OpenAPT::Astro
+{
+    constexpr double kPi = 3.14159265358979323846;
+    constexpr double kDegToRad = kPi / 180.0;
+    constexpr double kRadToDeg = 180.0 / kPi;
+    constexpr double kJ2000 = 2451545.0;     ///< J2000.0 的儒略日
+    constexpr double kUnixEpochJD = 2440587.5; ///< 1970-01-01T00:00:00Z 的儒略日
+
+    /**
+     * @brief 将系统时间转换为儒略日（UTC，忽略 UT1-UTC）
+     */
+    inline double JulianDate(std::chrono::system_clock::time_point time)
+    {
+        const double seconds = std::chrono::duration<double>(time.time_since_epoch()).count();
+        return kUnixEpochJD + seconds / 86400.0;
+    }
+
+    /**
+     * @brief 将儒略日转换为系统时间
+     */
+    inline std::chrono::system_clock::time_point FromJulianDate(double jd)
+    {
+        const auto seconds = std::chrono::duration<double>((jd - kUnixEpochJD) * 86400.0);
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(seconds));
+    }
+
+    /**
+     * @brief 格林尼治平恒星时（IAU 1982），单位弧度，范围 [0, 2π)
+     */
+    inline double GreenwichSiderealTime(double jd)
+    {
+        const double d = jd - kJ2000;
+        const double t = d / 36525.0;
+        double gmst = 280.46061837 + 360.98564736629 * d + t * t * (0.000387933 - t / 38710000.0);
+        gmst = std::fmod(gmst, 360.0);
+        if (gmst < 0)
+        {
+            gmst += 360.0;
+        }
+        return gmst * kDegToRad;
+    }
+
+    /**
+     * @brief 地方平恒星时，单位弧度
+     *
+     * @param jd 儒略日
+     * @param longitude 观测者经度（度，东经为正）
+     */
+    inline double LocalSiderealTime(double jd, double longitude)
+    {
+        double lst = GreenwichSiderealTime(jd) + longitude * kDegToRad;
+        lst = std::fmod(lst, 2 * kPi);
+        return lst < 0 ? lst + 2 * kPi : lst;
+    }
+} // namespace OpenAPT::Astro
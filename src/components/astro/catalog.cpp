@@ -0,0 +1,583 @@
+/*
+ * catalog.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-10
+
+Description: Binary Star and Deep-Sky Catalog
+
+**************************************************/
+
+#include "catalog.hpp"
+#include "astrotime.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <tuple>
+
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace OpenAPT::Astro
+{
+    namespace
+    {
+        constexpr char kCatalogMagic[8] = {'O', 'A', 'P', 'T', 'C', 'A', 'T', '\0'};
+        constexpr uint32_t kCatalogVersion = 1;
+        constexpr uint32_t kEmptySlot = 0xFFFFFFFFu;
+
+        uint32_t HashName(std::string_view name)
+        {
+            // FNV-1a
+            uint32_t hash = 2166136261u;
+            for (unsigned char c : name)
+            {
+                hash ^= c;
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        // float 单位向量的舍入误差约为 1e-7，检索和粗筛时放宽这么多，避免漏掉边界上的天体
+        constexpr float kFloatSlack = 1e-6f;
+
+        template <typename T>
+        void ToUnitVector(double ra, double dec, T *xyz)
+        {
+            const double a = ra * kDegToRad;
+            const double d = dec * kDegToRad;
+            xyz[0] = static_cast<T>(std::cos(d) * std::cos(a));
+            xyz[1] = static_cast<T>(std::cos(d) * std::sin(a));
+            xyz[2] = static_cast<T>(std::sin(d));
+        }
+
+        std::string_view Trim(std::string_view s)
+        {
+            while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front())))
+                s.remove_prefix(1);
+            while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back())))
+                s.remove_suffix(1);
+            return s;
+        }
+
+        std::vector<std::string_view> Split(std::string_view s, char sep)
+        {
+            std::vector<std::string_view> parts;
+            size_t start = 0;
+            while (true)
+            {
+                size_t pos = s.find(sep, start);
+                parts.push_back(Trim(s.substr(start, pos - start)));
+                if (pos == std::string_view::npos)
+                    break;
+                start = pos + 1;
+            }
+            return parts;
+        }
+    }
+
+    struct Catalog::Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_count;
+        uint32_t name_slots; ///< 哈希表槽数量，2 的幂
+        uint32_t pool_size;
+        uint64_t records_offset;
+        uint64_t names_offset;
+        uint64_t pool_offset;
+    };
+
+    struct Catalog::Record
+    {
+        double ra;
+        double dec;
+        float xyz[3];         ///< 单位向量，kd 树按深度轮流使用各分量划分
+        float mag;
+        float subtree_mag;    ///< 以该记录为根的子树中最亮的星等，用于剪枝
+        uint32_t name_offset; ///< 主名称在字符串池中的偏移
+        uint16_t name_length;
+        uint8_t type;
+        uint8_t reserved;
+    };
+
+    struct Catalog::NameEntry
+    {
+        uint32_t hash;
+        uint32_t record; ///< 记录下标，kEmptySlot 表示空槽
+        uint32_t name_offset;
+        uint32_t name_length;
+    };
+
+    std::string NormalizeObjectName(std::string_view name)
+    {
+        std::string normalized;
+        normalized.reserve(name.size());
+        for (unsigned char c : name)
+        {
+            if (!std::isspace(c))
+            {
+                normalized.push_back(static_cast<char>(std::toupper(c)));
+            }
+        }
+        return normalized;
+    }
+
+    ObjectType ParseObjectType(std::string_view type)
+    {
+        const std::string t = NormalizeObjectName(type);
+        if (t == "*")
+            return ObjectType::Star;
+        if (t == "**" || t == "*ASS")
+            return ObjectType::DoubleStar;
+        if (t == "G" || t == "GX" || t == "GALAXY")
+            return ObjectType::Galaxy;
+        if (t == "OC" || t == "OCL")
+            return ObjectType::OpenCluster;
+        if (t == "GC" || t == "GCL")
+            return ObjectType::GlobularCluster;
+        if (t == "NB" || t == "NEB" || t == "EN" || t == "RN" || t == "HII")
+            return ObjectType::Nebula;
+        if (t == "PN")
+            return ObjectType::PlanetaryNebula;
+        if (t == "SNR")
+            return ObjectType::SupernovaRemnant;
+        return ObjectType::Unknown;
+    }
+
+    Catalog::~Catalog()
+    {
+        close();
+    }
+
+    bool Catalog::open(const std::string &path)
+    {
+        close();
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            spdlog::error("Failed to open catalog {}", path);
+            return false;
+        }
+        m_buffer.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        if (!file.read(m_buffer.data(), m_buffer.size()))
+        {
+            spdlog::error("Failed to read catalog {}", path);
+            m_buffer.clear();
+            return false;
+        }
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            spdlog::error("Failed to open catalog {}", path);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+        {
+            spdlog::error("Catalog {} is too small", path);
+            ::close(fd);
+            return false;
+        }
+        void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+        {
+            spdlog::error("Failed to map catalog {}", path);
+            return false;
+        }
+        m_data = static_cast<const char *>(addr);
+        m_size = st.st_size;
+#endif
+        const Header *h = header();
+        const bool valid = m_size >= sizeof(Header) &&
+                           std::memcmp(h->magic, kCatalogMagic, sizeof(kCatalogMagic)) == 0 &&
+                           h->version == kCatalogVersion &&
+                           h->records_offset + uint64_t(h->record_count) * sizeof(Record) <= m_size &&
+                           h->names_offset + uint64_t(h->name_slots) * sizeof(NameEntry) <= m_size &&
+                           h->pool_offset + h->pool_size <= m_size &&
+                           (h->name_slots & (h->name_slots - 1)) == 0;
+        if (!valid)
+        {
+            spdlog::error("{} is not a valid catalog file", path);
+            close();
+            return false;
+        }
+        spdlog::debug("Opened catalog {} with {} objects", path, h->record_count);
+        return true;
+    }
+
+    void Catalog::close()
+    {
+        if (!m_data)
+        {
+            return;
+        }
+#ifdef _WIN32
+        m_buffer.clear();
+        m_buffer.shrink_to_fit();
+#else
+        munmap(const_cast<char *>(m_data), m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    size_t Catalog::size() const
+    {
+        return m_data ? header()->record_count : 0;
+    }
+
+    const Catalog::Header *Catalog::header() const
+    {
+        return reinterpret_cast<const Header *>(m_data);
+    }
+
+    const Catalog::Record *Catalog::records() const
+    {
+        return reinterpret_cast<const Record *>(m_data + header()->records_offset);
+    }
+
+    const Catalog::NameEntry *Catalog::names() const
+    {
+        return reinterpret_cast<const NameEntry *>(m_data + header()->names_offset);
+    }
+
+    const char *Catalog::pool() const
+    {
+        return m_data + header()->pool_offset;
+    }
+
+    CelestialObject Catalog::toObject(const Record &record) const
+    {
+        return {std::string_view(pool() + record.name_offset, record.name_length),
+                record.ra, record.dec, record.mag, static_cast<ObjectType>(record.type)};
+    }
+
+    std::optional<CelestialObject> Catalog::find(std::string_view name) const
+    {
+        if (!m_data || header()->name_slots == 0)
+        {
+            return std::nullopt;
+        }
+        const std::string key = NormalizeObjectName(name);
+        const uint32_t hash = HashName(key);
+        const uint32_t mask = header()->name_slots - 1;
+        const NameEntry *table = names();
+        for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            const NameEntry &entry = table[slot];
+            if (entry.record == kEmptySlot)
+            {
+                return std::nullopt;
+            }
+            if (entry.hash == hash && entry.name_length == key.size() &&
+                std::memcmp(pool() + entry.name_offset, key.data(), key.size()) == 0)
+            {
+                return toObject(records()[entry.record]);
+            }
+        }
+    }
+
+    std::vector<CelestialObject> Catalog::coneSearch(double ra, double dec, double radius, float max_mag) const
+    {
+        std::vector<CelestialObject> result;
+        if (!m_data || radius <= 0)
+        {
+            return result;
+        }
+        double center_exact[3];
+        ToUnitVector(ra, dec, center_exact);
+        const float center[3] = {static_cast<float>(center_exact[0]), static_cast<float>(center_exact[1]),
+                                 static_cast<float>(center_exact[2])};
+        // 以弦长作为 kd 树的检索半径。float 的夹角余弦在小半径时分辨不出差别，只用作粗筛，
+        // 最终用记录中 double 的赤经赤纬按弦长平方判断
+        const double chord_exact = 2.0 * std::sin(std::min(radius, 180.0) * kDegToRad / 2.0);
+        const double max_chord2 = chord_exact * chord_exact;
+        const float chord = static_cast<float>(chord_exact) + kFloatSlack;
+        const float min_dot = static_cast<float>(std::cos(std::min(radius, 180.0) * kDegToRad)) - kFloatSlack;
+        const Record *recs = records();
+
+        std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> stack;
+        stack.emplace_back(0, header()->record_count, 0);
+        while (!stack.empty())
+        {
+            auto [lo, hi, depth] = stack.back();
+            stack.pop_back();
+            if (lo >= hi)
+            {
+                continue;
+            }
+            const uint32_t mid = lo + (hi - lo) / 2;
+            const Record &node = recs[mid];
+            if (node.subtree_mag > max_mag)
+            {
+                continue;
+            }
+            const float dot = node.xyz[0] * center[0] + node.xyz[1] * center[1] + node.xyz[2] * center[2];
+            if (dot >= min_dot && node.mag <= max_mag)
+            {
+                double xyz[3];
+                ToUnitVector(node.ra, node.dec, xyz);
+                const double dx = xyz[0] - center_exact[0];
+                const double dy = xyz[1] - center_exact[1];
+                const double dz = xyz[2] - center_exact[2];
+                if (dx * dx + dy * dy + dz * dz <= max_chord2)
+                {
+                    result.push_back(toObject(node));
+                }
+            }
+            const int axis = depth % 3;
+            const float split = node.xyz[axis];
+            if (center[axis] - chord <= split)
+            {
+                stack.emplace_back(lo, mid, depth + 1);
+            }
+            if (center[axis] + chord >= split)
+            {
+                stack.emplace_back(mid + 1, hi, depth + 1);
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const CelestialObject &a, const CelestialObject &b)
+                  { return a.mag < b.mag; });
+        return result;
+    }
+
+    std::vector<CelestialObject> Catalog::brightest(float max_mag, size_t limit) const
+    {
+        std::vector<CelestialObject> result;
+        if (!m_data)
+        {
+            return result;
+        }
+        const Record *recs = records();
+        std::vector<std::pair<uint32_t, uint32_t>> stack;
+        stack.emplace_back(0, header()->record_count);
+        while (!stack.empty())
+        {
+            auto [lo, hi] = stack.back();
+            stack.pop_back();
+            if (lo >= hi)
+            {
+                continue;
+            }
+            const uint32_t mid = lo + (hi - lo) / 2;
+            if (recs[mid].subtree_mag > max_mag)
+            {
+                continue;
+            }
+            if (recs[mid].mag <= max_mag)
+            {
+                result.push_back(toObject(recs[mid]));
+            }
+            stack.emplace_back(lo, mid);
+            stack.emplace_back(mid + 1, hi);
+        }
+        std::sort(result.begin(), result.end(), [](const CelestialObject &a, const CelestialObject &b)
+                  { return a.mag < b.mag; });
+        if (limit > 0 && result.size() > limit)
+        {
+            result.resize(limit);
+        }
+        return result;
+    }
+
+    bool Catalog::build(const std::string &csv_path, const std::string &out_path)
+    {
+        static_assert(sizeof(Header) == 48 && sizeof(Record) == 48 && sizeof(NameEntry) == 16, "Catalog file layout changed");
+
+        struct Entry
+        {
+            std::vector<std::string> names;
+            Record record;
+        };
+
+        std::ifstream in(csv_path);
+        if (!in)
+        {
+            spdlog::error("Failed to open catalog source {}", csv_path);
+            return false;
+        }
+
+        std::vector<Entry> entries;
+        std::string line;
+        size_t line_no = 0;
+        while (std::getline(in, line))
+        {
+            ++line_no;
+            std::string_view view = Trim(line);
+            if (view.empty() || view.front() == '#')
+            {
+                continue;
+            }
+            auto fields = Split(view, ',');
+            if (fields.size() < 4)
+            {
+                spdlog::warn("{}:{} has too few fields, skipped", csv_path, line_no);
+                continue;
+            }
+            Entry entry{};
+            for (auto alias : Split(fields[0], ';'))
+            {
+                if (!alias.empty())
+                {
+                    entry.names.emplace_back(alias);
+                }
+            }
+            try
+            {
+                entry.record.ra = std::stod(std::string(fields[1]));
+                entry.record.dec = std::stod(std::string(fields[2]));
+                entry.record.mag = fields[3].empty() ? 99.0f : std::stof(std::string(fields[3]));
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::warn("{}:{} is malformed ({}), skipped", csv_path, line_no, e.what());
+                continue;
+            }
+            if (entry.names.empty() || entry.record.dec < -90 || entry.record.dec > 90)
+            {
+                spdlog::warn("{}:{} has no name or an invalid declination, skipped", csv_path, line_no);
+                continue;
+            }
+            entry.record.type = static_cast<uint8_t>(fields.size() > 4 ? ParseObjectType(fields[4]) : ObjectType::Unknown);
+            ToUnitVector(entry.record.ra, entry.record.dec, entry.record.xyz);
+            entries.push_back(std::move(entry));
+        }
+
+        // 原地排列为隐式 kd 树：区间中点为根，左右半区间分别为左右子树
+        std::function<float(size_t, size_t, int)> arrange = [&](size_t lo, size_t hi, int depth) -> float
+        {
+            if (lo >= hi)
+            {
+                return 99.0f;
+            }
+            const size_t mid = lo + (hi - lo) / 2;
+            const int axis = depth % 3;
+            std::nth_element(entries.begin() + lo, entries.begin() + mid, entries.begin() + hi,
+                             [axis](const Entry &a, const Entry &b)
+                             { return a.record.xyz[axis] < b.record.xyz[axis]; });
+            const float left = arrange(lo, mid, depth + 1);
+            const float right = arrange(mid + 1, hi, depth + 1);
+            Record &node = entries[mid].record;
+            node.subtree_mag = std::min({node.mag, left, right});
+            return node.subtree_mag;
+        };
+        arrange(0, entries.size(), 0);
+
+        // 字符串池：主名称（原样，用于显示）+ 所有规范化别名（用于检索）
+        std::string string_pool;
+        std::vector<std::tuple<std::string, uint32_t>> aliases;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            Record &record = entries[i].record;
+            const std::string &primary = entries[i].names.front();
+            record.name_offset = static_cast<uint32_t>(string_pool.size());
+            record.name_length = static_cast<uint16_t>(std::min<size_t>(primary.size(), 0xFFFF));
+            string_pool.append(primary, 0, record.name_length);
+            for (const auto &alias : entries[i].names)
+            {
+                aliases.emplace_back(NormalizeObjectName(alias), static_cast<uint32_t>(i));
+            }
+        }
+
+        uint32_t slots = 1;
+        while (slots < aliases.size() * 2)
+        {
+            slots <<= 1;
+        }
+        std::vector<NameEntry> table(slots, NameEntry{0, kEmptySlot, 0, 0});
+        for (const auto &[alias, index] : aliases)
+        {
+            const uint32_t hash = HashName(alias);
+            uint32_t slot = hash & (slots - 1);
+            bool duplicate = false;
+            while (table[slot].record != kEmptySlot)
+            {
+                if (table[slot].hash == hash && table[slot].name_length == alias.size() &&
+                    string_pool.compare(table[slot].name_offset, alias.size(), alias) == 0)
+                {
+                    duplicate = true;
+                    break;
+                }
+                slot = (slot + 1) & (slots - 1);
+            }
+            if (duplicate)
+            {
+                spdlog::warn("Duplicate catalog name {}, keeping the first one", alias);
+                continue;
+            }
+            table[slot] = {hash, index, static_cast<uint32_t>(string_pool.size()), static_cast<uint32_t>(alias.size())};
+            string_pool += alias;
+        }
+
+        Header h{};
+        std::memcpy(h.magic, kCatalogMagic, sizeof(kCatalogMagic));
+        h.version = kCatalogVersion;
+        h.record_count = static_cast<uint32_t>(entries.size());
+        h.name_slots = slots;
+        h.pool_size = static_cast<uint32_t>(string_pool.size());
+        h.records_offset = sizeof(Header);
+        h.names_offset = h.records_offset + entries.size() * sizeof(Record);
+        h.pool_offset = h.names_offset + table.size() * sizeof(NameEntry);
+
+        std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            spdlog::error("Failed to create catalog {}", out_path);
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        for (const auto &entry : entries)
+        {
+            out.write(reinterpret_cast<const char *>(&entry.record), sizeof(Record));
+        }
+        out.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(NameEntry));
+        out.write(string_pool.data(), string_pool.size());
+        if (!out)
+        {
+            spdlog::error("Failed to write catalog {}", out_path);
+            return false;
+        }
+        spdlog::info("Built catalog {} with {} objects and {} names", out_path, entries.size(), aliases.size());
+        return true;
+    }
+} // namespace OpenAPT::Astro
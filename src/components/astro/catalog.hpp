@@ -0,0 +1,183 @@
+/*
+ * catalog.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-10
+
+Description: Binary Star and Deep-Sky Catalog
+
+**************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace OpenAPT::Astro
+{
+    /**
+     * @brief 天体类型
+     */
+    enum class ObjectType : uint8_t
+    {
+        Unknown = 0,
+        Star,
+        DoubleStar,
+        Galaxy,
+        OpenCluster,
+        GlobularCluster,
+        Nebula,
+        PlanetaryNebula,
+        SupernovaRemnant
+    };
+
+    /**
+     * @brief 星表查询结果，name 指向映射的星表文件，生命周期与 Catalog 相同
+     */
+    struct CelestialObject
+    {
+        std::string_view name; ///< 主名称
+        double ra;             ///< 赤经（度，J2000）
+        double dec;            ///< 赤纬（度，J2000）
+        float mag;             ///< 星等
+        ObjectType type;       ///< 天体类型
+    };
+
+    /**
+     * @brief 只读二进制星表
+     *
+     * 星表文件由 Catalog::build 从 CSV 一次性转换得到，包含以下几部分：
+     * - 按隐式 kd 树顺序排列的定长记录（单位向量 + 赤经赤纬 + 星等），用于锥形检索
+     * - 名称字符串池
+     * - 开放寻址哈希表，以规范化名称（大写、去空格）为键，支持别名
+     *
+     * 打开时直接内存映射文件，不做任何解析。
+     */
+    class Catalog
+    {
+    public:
+        Catalog() = default;
+        ~Catalog();
+
+        Catalog(const Catalog &) = delete;
+        Catalog &operator=(const Catalog &) = delete;
+
+        /**
+         * @brief 打开并映射星表文件
+         *
+         * @param path 星表文件路径
+         * @return 成功返回 true，失败返回 false
+         */
+        bool open(const std::string &path);
+
+        /**
+         * @brief 关闭星表并解除映射
+         */
+        void close();
+
+        /**
+         * @brief 星表是否已打开
+         */
+        bool isOpen() const
+        {
+            return m_data != nullptr;
+        }
+
+        /**
+         * @brief 星表中的天体数量
+         */
+        size_t size() const;
+
+        /**
+         * @brief 按名称查找天体，名称不区分大小写并忽略空格，如 "m 31" 与 "M31" 等价
+         *
+         * @param name 天体名称或别名
+         * @return 找到返回天体信息，否则返回空
+         */
+        std::optional<CelestialObject> find(std::string_view name) const;
+
+        /**
+         * @brief 锥形检索
+         *
+         * @param ra 中心赤经（度）
+         * @param dec 中心赤纬（度）
+         * @param radius 检索半径（度）
+         * @param max_mag 星等上限，只返回不暗于该值的天体
+         * @return 满足条件的天体，按星等从亮到暗排序
+         */
+        std::vector<CelestialObject> coneSearch(double ra, double dec, double radius, float max_mag = 99.0f) const;
+
+        /**
+         * @brief 全天按星等检索
+         *
+         * @param max_mag 星等上限
+         * @param limit 最多返回数量，0 表示不限制
+         * @return 满足条件的天体，按星等从亮到暗排序
+         */
+        std::vector<CelestialObject> brightest(float max_mag, size_t limit = 0) const;
+
+        /**
+         * @brief 将 CSV 星表转换为二进制星表
+         *
+         * CSV 每行格式为 name,ra_deg,dec_deg,mag,type，name 可以用 ';' 分隔多个别名，第一个为主名称。
+         * 以 '#' 开头的行以及无法解析的行会被跳过。
+         *
+         * @param csv_path CSV 文件路径
+         * @param out_path 输出的二进制星表路径
+         * @return 成功返回 true，失败返回 false
+         */
+        static bool build(const std::string &csv_path, const std::string &out_path);
+
+    private:
+        struct Header;
+        struct Record;
+        struct NameEntry;
+
+        CelestialObject toObject(const Record &record) const;
+
+        const Header *header() const;
+        const Record *records() const;
+        const NameEntry *names() const;
+        const char *pool() const;
+
+        const char *m_data = nullptr; ///< 映射的文件内容
+        size_t m_size = 0;            ///< 文件大小
+#ifdef _WIN32
+        std::vector<char> m_buffer; ///< Windows 下直接读入内存
+#endif
+    };
+
+    /**
+     * @brief 规范化天体名称：转为大写并去掉空白字符
+     */
+    std::string NormalizeObjectName(std::string_view name);
+
+    /**
+     * @brief 解析天体类型字符串，如 "Gx"、"OC"、"GC"、"PN"
+     */
+    ObjectType ParseObjectType(std::string_view type);
+} // namespace OpenAPT::Astro
@@ -0,0 +1,308 @@
+/*
+ * coordinates.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-12
+
+Description: Typed Coordinates and Epoch Conversion
+
+**************************************************/
+
+#include "coordinates.hpp"
+#include "astrotime.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace OpenAPT::Astro
+{
+    namespace
+    {
+        constexpr double kArcsecToRad = kDegToRad / 3600.0;
+
+        // 坐标轴旋转矩阵（旋转坐标系而非向量）
+        Matrix3 RotateX(double a)
+        {
+            const double c = std::cos(a), s = std::sin(a);
+            return {{{{1, 0, 0}, {0, c, s}, {0, -s, c}}}};
+        }
+
+        Matrix3 RotateZ(double a)
+        {
+            const double c = std::cos(a), s = std::sin(a);
+            return {{{{c, s, 0}, {-s, c, 0}, {0, 0, 1}}}};
+        }
+
+        Equatorial Apply(const Matrix3 &r, const Equatorial &in)
+        {
+            const double a = in.ra * kDegToRad;
+            const double d = in.dec * kDegToRad;
+            const double cd = std::cos(d);
+            const double v[3] = {cd * std::cos(a), cd * std::sin(a), std::sin(d)};
+            const double x = r.m[0][0] * v[0] + r.m[0][1] * v[1] + r.m[0][2] * v[2];
+            const double y = r.m[1][0] * v[0] + r.m[1][1] * v[1] + r.m[1][2] * v[2];
+            const double z = r.m[2][0] * v[0] + r.m[2][1] * v[1] + r.m[2][2] * v[2];
+            double ra = std::atan2(y, x) * kRadToDeg;
+            if (ra < 0)
+            {
+                ra += 360.0;
+            }
+            return {ra, std::asin(std::clamp(z, -1.0, 1.0)) * kRadToDeg};
+        }
+
+        // 解析 "12:34:56.7"、"12 34 56.7" 或 "12.5823"
+        std::optional<double> ParseSexagesimal(const std::string &text)
+        {
+            const char *p = text.c_str();
+            while (*p == ' ')
+                ++p;
+            bool negative = false;
+            if (*p == '-' || *p == '+')
+            {
+                negative = (*p == '-');
+                ++p;
+            }
+            double parts[3] = {0, 0, 0};
+            int count = 0;
+            while (*p && count < 3)
+            {
+                char *end = nullptr;
+                parts[count] = std::strtod(p, &end);
+                if (end == p)
+                {
+                    return std::nullopt;
+                }
+                ++count;
+                p = end;
+                while (*p == ':' || *p == ' ' || *p == 'h' || *p == 'd' || *p == 'm' || *p == 's' || *p == '\'' || *p == '"')
+                    ++p;
+            }
+            if (count == 0 || *p)
+            {
+                return std::nullopt;
+            }
+            const double value = parts[0] + parts[1] / 60.0 + parts[2] / 3600.0;
+            return negative ? -value : value;
+        }
+
+        // wrap 不为 0 时进位后对其取模，赤经 23:59:59.96 应显示为 00:00:00.0 而不是 24:00:00.0
+        std::string FormatSexagesimal(double value, bool sign, int decimals, int wrap = 0)
+        {
+            const bool negative = value < 0;
+            value = std::fabs(value);
+            int d = static_cast<int>(value);
+            int m = static_cast<int>((value - d) * 60.0);
+            double s = ((value - d) * 60.0 - m) * 60.0;
+            const double limit = 60.0 - 0.5 * std::pow(10.0, -decimals);
+            if (s >= limit)
+            {
+                s = 0;
+                if (++m == 60)
+                {
+                    m = 0;
+                    ++d;
+                }
+            }
+            if (wrap > 0)
+            {
+                d %= wrap;
+            }
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%s%02d:%02d:%0*.*f", sign ? (negative ? "-" : "+") : (negative ? "-" : ""),
+                          d, m, decimals > 0 ? decimals + 3 : 2, decimals, s);
+            return buffer;
+        }
+    }
+
+    std::optional<Equatorial> Equatorial::parse(const std::string &ra, const std::string &dec)
+    {
+        auto ra_hours = ParseSexagesimal(ra);
+        auto dec_deg = ParseSexagesimal(dec);
+        if (!ra_hours || !dec_deg || *dec_deg < -90.0 || *dec_deg > 90.0)
+        {
+            return std::nullopt;
+        }
+        double hours = std::fmod(*ra_hours, 24.0);
+        if (hours < 0)
+        {
+            hours += 24.0;
+        }
+        return fromHours(hours, *dec_deg);
+    }
+
+    std::string Equatorial::raString() const
+    {
+        return FormatSexagesimal(raHours(), false, 1, 24);
+    }
+
+    std::string Equatorial::decString() const
+    {
+        return FormatSexagesimal(dec, true, 0);
+    }
+
+    Matrix3 Matrix3::operator*(const Matrix3 &rhs) const
+    {
+        Matrix3 r{};
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                r.m[i][j] = m[i][0] * rhs.m[0][j] + m[i][1] * rhs.m[1][j] + m[i][2] * rhs.m[2][j];
+        return r;
+    }
+
+    Matrix3 Matrix3::transposed() const
+    {
+        Matrix3 r{};
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                r.m[i][j] = m[j][i];
+        return r;
+    }
+
+    EpochConverter::EpochConverter(double bucket_minutes)
+        : m_bucket_days(std::max(bucket_minutes, 1e-3) / 1440.0)
+    {
+    }
+
+    Matrix3 EpochConverter::computeMatrix(double jd)
+    {
+        const double t = (jd - kJ2000) / 36525.0;
+
+        // IAU 1976 岁差
+        const double zeta = (2306.2181 + (0.30188 + 0.017998 * t) * t) * t * kArcsecToRad;
+        const double z = (2306.2181 + (1.09468 + 0.018203 * t) * t) * t * kArcsecToRad;
+        const double theta = (2004.3109 - (0.42665 + 0.041833 * t) * t) * t * kArcsecToRad;
+        const double cz = std::cos(zeta), sz = std::sin(zeta);
+        const double cZ = std::cos(z), sZ = std::sin(z);
+        const double ct = std::cos(theta), st = std::sin(theta);
+        const Matrix3 precession{{{{cz * ct * cZ - sz * sZ, -sz * ct * cZ - cz * sZ, -st * cZ},
+                                   {cz * ct * sZ + sz * cZ, -sz * ct * sZ + cz * cZ, -st * sZ},
+                                   {cz * st, -sz * st, ct}}}};
+
+        // IAU 1980 章动主项
+        const double omega = (125.04452 - 1934.136261 * t) * kDegToRad;
+        const double l = (280.4665 + 36000.7698 * t) * kDegToRad;
+        const double lp = (218.3165 + 481267.8813 * t) * kDegToRad;
+        const double dpsi = (-17.20 * std::sin(omega) - 1.32 * std::sin(2 * l) - 0.23 * std::sin(2 * lp) + 0.21 * std::sin(2 * omega)) * kArcsecToRad;
+        const double deps = (9.20 * std::cos(omega) + 0.57 * std::cos(2 * l) + 0.10 * std::cos(2 * lp) - 0.09 * std::cos(2 * omega)) * kArcsecToRad;
+        const double eps0 = (84381.448 - (46.8150 + (0.00059 - 0.001813 * t) * t) * t) * kArcsecToRad;
+        const Matrix3 nutation = RotateX(-(eps0 + deps)) * RotateZ(-dpsi) * RotateX(eps0);
+
+        return nutation * precession;
+    }
+
+    const EpochConverter::CacheEntry &EpochConverter::entry(double jd)
+    {
+        const int64_t bucket = static_cast<int64_t>(std::floor(jd / m_bucket_days));
+        CacheEntry &slot = m_cache[static_cast<uint64_t>(bucket) % kCacheSize];
+        if (slot.bucket == bucket)
+        {
+            ++m_hits;
+            return slot;
+        }
+        ++m_misses;
+        slot.bucket = bucket;
+        slot.forward = computeMatrix((bucket + 0.5) * m_bucket_days);
+        slot.inverse = slot.forward.transposed();
+        return slot;
+    }
+
+    const Matrix3 &EpochConverter::matrix(double jd)
+    {
+        return entry(jd).forward;
+    }
+
+    Equatorial EpochConverter::toJNow(const Equatorial &j2000, double jd)
+    {
+        return Apply(entry(jd).forward, j2000);
+    }
+
+    Equatorial EpochConverter::toJ2000(const Equatorial &jnow, double jd)
+    {
+        return Apply(entry(jd).inverse, jnow);
+    }
+
+    void EpochConverter::toJNow(const Equatorial *in, Equatorial *out, size_t count, double jd)
+    {
+        const Matrix3 r = entry(jd).forward;
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = Apply(r, in[i]);
+        }
+    }
+
+    void EpochConverter::toJ2000(const Equatorial *in, Equatorial *out, size_t count, double jd)
+    {
+        const Matrix3 r = entry(jd).inverse;
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = Apply(r, in[i]);
+        }
+    }
+
+    namespace
+    {
+        EpochConverter &ThreadConverter()
+        {
+            thread_local EpochConverter converter;
+            return converter;
+        }
+    }
+
+    Equatorial ToJNow(const Equatorial &j2000, double jd)
+    {
+        return ThreadConverter().toJNow(j2000, jd);
+    }
+
+    Equatorial ToJ2000(const Equatorial &jnow, double jd)
+    {
+        return ThreadConverter().toJ2000(jnow, jd);
+    }
+
+    Horizontal ToHorizontal(const Equatorial &jnow, double jd, const Observer &observer)
+    {
+        const double lat = observer.latitude * kDegToRad;
+        const double ha = LocalSiderealTime(jd, observer.longitude) - jnow.ra * kDegToRad;
+        const double dec = jnow.dec * kDegToRad;
+        const double sin_alt = std::sin(lat) * std::sin(dec) + std::cos(lat) * std::cos(dec) * std::cos(ha);
+        const double y = -std::cos(dec) * std::sin(ha);
+        const double x = std::cos(lat) * std::sin(dec) - std::sin(lat) * std::cos(dec) * std::cos(ha);
+        double az = std::atan2(y, x) * kRadToDeg;
+        return {std::asin(std::clamp(sin_alt, -1.0, 1.0)) * kRadToDeg, az < 0 ? az + 360.0 : az};
+    }
+
+    Equatorial FromHorizontal(const Horizontal &horizontal, double jd, const Observer &observer)
+    {
+        const double lat = observer.latitude * kDegToRad;
+        const double alt = horizontal.alt * kDegToRad;
+        const double az = horizontal.az * kDegToRad;
+        const double sin_dec = std::sin(lat) * std::sin(alt) + std::cos(lat) * std::cos(alt) * std::cos(az);
+        const double y = -std::cos(alt) * std::sin(az);
+        const double x = std::cos(lat) * std::sin(alt) - std::sin(lat) * std::cos(alt) * std::cos(az);
+        double ra = (LocalSiderealTime(jd, observer.longitude) - std::atan2(y, x)) * kRadToDeg;
+        ra = std::fmod(ra, 360.0);
+        return {ra < 0 ? ra + 360.0 : ra, std::asin(std::clamp(sin_dec, -1.0, 1.0)) * kRadToDeg};
+    }
+} // namespace OpenAPT::Astro
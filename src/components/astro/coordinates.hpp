@@ -0,0 +1,208 @@
+/*
+ * coordinates.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-12
+
+Description: Typed Coordinates and Epoch Conversion
+
+**************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace OpenAPT::Astro
+{
+    /**
+     * @brief 观测地点
+     */
+    struct Observer
+    {
+        double latitude;      ///< 纬度（度，北纬为正）
+        double longitude;     ///< 经度（度，东经为正）
+        double elevation = 0; ///< 海拔（米）
+    };
+
+    /**
+     * @brief 赤道坐标，单位为度
+     */
+    struct Equatorial
+    {
+        double ra;  ///< 赤经（度，0~360）
+        double dec; ///< 赤纬（度，-90~90）
+
+        /**
+         * @brief 赤经（小时），INDI 的 EQUATORIAL_*_COORD 使用该单位
+         */
+        double raHours() const
+        {
+            return ra / 15.0;
+        }
+
+        static Equatorial fromHours(double ra_hours, double dec)
+        {
+            return {ra_hours * 15.0, dec};
+        }
+
+        /**
+         * @brief 解析 "HH:MM:SS"/"DD:MM:SS" 或十进制字符串，只应在边界（用户输入、配置）处使用
+         *
+         * @param ra 赤经字符串，十进制时单位为小时
+         * @param dec 赤纬字符串，十进制时单位为度
+         * @return 解析失败返回空
+         */
+        static std::optional<Equatorial> parse(const std::string &ra, const std::string &dec);
+
+        /**
+         * @brief 格式化为 "HH:MM:SS.s"
+         */
+        std::string raString() const;
+
+        /**
+         * @brief 格式化为 "+DD:MM:SS"
+         */
+        std::string decString() const;
+    };
+
+    /**
+     * @brief 地平坐标，单位为度
+     */
+    struct Horizontal
+    {
+        double alt; ///< 高度
+        double az;  ///< 方位角（北为 0，向东增加）
+    };
+
+    /**
+     * @brief 3x3 旋转矩阵
+     */
+    struct Matrix3
+    {
+        std::array<std::array<double, 3>, 3> m;
+
+        Matrix3 operator*(const Matrix3 &rhs) const;
+        Matrix3 transposed() const;
+    };
+
+    /**
+     * @brief J2000 与 JNow（真赤道、真春分点）之间的转换
+     *
+     * 岁差采用 IAU 1976 模型，章动采用 IAU 1980 主项（精度约 0.5 角秒），不含光行差。
+     * 旋转矩阵按时间分桶缓存，同一时间桶内的转换只需一次矩阵乘法。
+     * 实例不是线程安全的，多线程下每个线程使用自己的实例，或使用 ToJNow/ToJ2000 等自由函数。
+     */
+    class EpochConverter
+    {
+    public:
+        /**
+         * @param bucket_minutes 缓存时间桶长度（分钟），岁差章动在此时间内的变化远小于指向精度
+         */
+        explicit EpochConverter(double bucket_minutes = 60.0);
+
+        /**
+         * @brief J2000 转 JNow
+         */
+        Equatorial toJNow(const Equatorial &j2000, double jd);
+
+        /**
+         * @brief JNow 转 J2000
+         */
+        Equatorial toJ2000(const Equatorial &jnow, double jd);
+
+        /**
+         * @brief 批量 J2000 转 JNow，所有坐标共用同一时刻的矩阵
+         */
+        void toJNow(const Equatorial *in, Equatorial *out, size_t count, double jd);
+
+        /**
+         * @brief 批量 JNow 转 J2000
+         */
+        void toJ2000(const Equatorial *in, Equatorial *out, size_t count, double jd);
+
+        /**
+         * @brief 获取（必要时计算并缓存）某时刻的岁差章动矩阵，J2000 -> JNow
+         */
+        const Matrix3 &matrix(double jd);
+
+        /**
+         * @brief 计算某时刻的岁差章动矩阵，不使用缓存
+         */
+        static Matrix3 computeMatrix(double jd);
+
+        /**
+         * @brief 矩阵缓存的命中/未命中次数
+         */
+        uint64_t hits() const
+        {
+            return m_hits;
+        }
+
+        uint64_t misses() const
+        {
+            return m_misses;
+        }
+
+    private:
+        struct CacheEntry
+        {
+            int64_t bucket = INT64_MIN;
+            Matrix3 forward;
+            Matrix3 inverse;
+        };
+
+        const CacheEntry &entry(double jd);
+
+        static constexpr size_t kCacheSize = 4;
+
+        double m_bucket_days;
+        std::array<CacheEntry, kCacheSize> m_cache;
+        uint64_t m_hits = 0;
+        uint64_t m_misses = 0;
+    };
+
+    /**
+     * @brief 使用线程内共享的 EpochConverter 做 J2000 -> JNow 转换
+     */
+    Equatorial ToJNow(const Equatorial &j2000, double jd);
+
+    /**
+     * @brief 使用线程内共享的 EpochConverter 做 JNow -> J2000 转换
+     */
+    Equatorial ToJ2000(const Equatorial &jnow, double jd);
+
+    /**
+     * @brief 赤道坐标（JNow）转地平坐标，不含大气折射
+     */
+    Horizontal ToHorizontal(const Equatorial &jnow, double jd, const Observer &observer);
+
+    /**
+     * @brief 地平坐标转赤道坐标（JNow）
+     */
+    Equatorial FromHorizontal(const Horizontal &horizontal, double jd, const Observer &observer);
+} // namespace OpenAPT::Astro
@@ -0,0 +1,252 @@
+/*
+ * planner.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-11
+
+Description: Batch Ephemeris and Visibility Planner
+
+**************************************************/
+
+#include "planner.hpp"
+#include "astrotime.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::Astro
+{
+    namespace
+    {
+        // 标准大气折射下的地平高度
+        constexpr double kHorizonAltitude = -0.5667;
+        // 恒星时相对于太阳时的速率（弧度/天）
+        constexpr double kSiderealRate = 2 * kPi * 1.00273790935;
+
+        double Interpolate(double t0, double step, double v0, double v1, double threshold)
+        {
+            return t0 + step * (v0 - threshold) / (v0 - v1);
+        }
+    }
+
+    NightPlanner::NightPlanner(const Observer &observer)
+        : m_observer(observer),
+          m_sin_lat(std::sin(observer.latitude * kDegToRad)),
+          m_cos_lat(std::cos(observer.latitude * kDegToRad))
+    {
+    }
+
+    size_t NightPlanner::addTarget(const std::string &name, double ra, double dec)
+    {
+        const double a = ra * kDegToRad;
+        const double d = dec * kDegToRad;
+        m_names.push_back(name);
+        m_ra.push_back(a);
+        m_sin_ra.push_back(std::sin(a));
+        m_cos_ra.push_back(std::cos(a));
+        m_sin_dec.push_back(std::sin(d));
+        m_cos_dec.push_back(std::cos(d));
+        return m_names.size() - 1;
+    }
+
+    void NightPlanner::clearTargets()
+    {
+        m_names.clear();
+        m_ra.clear();
+        m_sin_ra.clear();
+        m_cos_ra.clear();
+        m_sin_dec.clear();
+        m_cos_dec.clear();
+    }
+
+    void NightPlanner::altAz(double jd, std::vector<double> &altitude, std::vector<double> &azimuth) const
+    {
+        const size_t n = size();
+        altitude.resize(n);
+        azimuth.resize(n);
+        const double lst = LocalSiderealTime(jd, m_observer.longitude);
+        const double cl = std::cos(lst);
+        const double sl = std::sin(lst);
+        for (size_t i = 0; i < n; ++i)
+        {
+            // cos(H) 与 sin(H) 由恒星时和赤经的和差角公式得到，H = LST - RA
+            const double cos_ha = cl * m_cos_ra[i] + sl * m_sin_ra[i];
+            const double sin_ha = sl * m_cos_ra[i] - cl * m_sin_ra[i];
+            const double sin_alt = m_sin_lat * m_sin_dec[i] + m_cos_lat * m_cos_dec[i] * cos_ha;
+            const double y = -m_cos_dec[i] * sin_ha;
+            const double x = m_cos_lat * m_sin_dec[i] - m_sin_lat * m_cos_dec[i] * cos_ha;
+            double az = std::atan2(y, x) * kRadToDeg;
+            altitude[i] = std::asin(std::clamp(sin_alt, -1.0, 1.0)) * kRadToDeg;
+            azimuth[i] = az < 0 ? az + 360.0 : az;
+        }
+    }
+
+    std::vector<TargetPlan> NightPlanner::plan(double jd_start, double jd_end, double step_minutes, double min_altitude) const
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const size_t n = size();
+        std::vector<TargetPlan> plans(n);
+        if (n == 0 || jd_end <= jd_start || step_minutes <= 0)
+        {
+            return plans;
+        }
+
+        const double step = step_minutes / 1440.0;
+        const size_t steps = static_cast<size_t>(std::ceil((jd_end - jd_start) / step)) + 1;
+        const double horizon = std::sin(kHorizonAltitude * kDegToRad);
+        const double threshold = std::sin(min_altitude * kDegToRad);
+
+        // sin(alt) = A + B * cos(H)，A、B 与时间无关
+        std::vector<double> a(n), b(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            a[i] = m_sin_lat * m_sin_dec[i];
+            b[i] = m_cos_lat * m_cos_dec[i];
+        }
+
+        std::vector<double> prev(n), cur(n), best(n, -2.0), best_time(n, jd_start);
+        std::vector<double> window_start(n, nan);
+        const double *cos_ra = m_cos_ra.data();
+        const double *sin_ra = m_sin_ra.data();
+
+        for (auto &plan : plans)
+        {
+            plan.rise = plan.set = plan.transit = nan;
+            plan.visible_minutes = 0;
+        }
+
+        double t0 = jd_start;
+        for (size_t k = 0; k < steps; ++k)
+        {
+            const double jd = std::min(jd_start + k * step, jd_end);
+            const double lst = LocalSiderealTime(jd, m_observer.longitude);
+            const double cl = std::cos(lst);
+            const double sl = std::sin(lst);
+
+            double *out = cur.data();
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = a[i] + b[i] * (cl * cos_ra[i] + sl * sin_ra[i]);
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                const double s = cur[i];
+                if (s > best[i])
+                {
+                    best[i] = s;
+                    best_time[i] = jd;
+                }
+                if (k == 0)
+                {
+                    if (s >= threshold)
+                    {
+                        window_start[i] = jd;
+                    }
+                    continue;
+                }
+                const double p = prev[i];
+                if (p < horizon && s >= horizon && std::isnan(plans[i].rise))
+                {
+                    plans[i].rise = Interpolate(t0, jd - t0, p, s, horizon);
+                }
+                else if (p >= horizon && s < horizon && std::isnan(plans[i].set))
+                {
+                    plans[i].set = Interpolate(t0, jd - t0, p, s, horizon);
+                }
+                if (p < threshold && s >= threshold)
+                {
+                    window_start[i] = Interpolate(t0, jd - t0, p, s, threshold);
+                }
+                else if (p >= threshold && s < threshold)
+                {
+                    plans[i].windows.push_back({window_start[i], Interpolate(t0, jd - t0, p, s, threshold)});
+                    window_start[i] = nan;
+                }
+            }
+            std::swap(prev, cur);
+            t0 = jd;
+        }
+
+        const double lst_start = LocalSiderealTime(jd_start, m_observer.longitude);
+        for (size_t i = 0; i < n; ++i)
+        {
+            TargetPlan &plan = plans[i];
+            plan.name = m_names[i];
+            if (!std::isnan(window_start[i]))
+            {
+                plan.windows.push_back({window_start[i], jd_end});
+            }
+            for (const auto &window : plan.windows)
+            {
+                plan.visible_minutes += (window.end - window.start) * 1440.0;
+            }
+            plan.max_altitude = std::asin(std::clamp(best[i], -1.0, 1.0)) * kRadToDeg;
+            plan.max_altitude_time = best_time[i];
+
+            // 上中天：LST == RA 的第一个时刻
+            double dh = std::fmod(m_ra[i] - lst_start, 2 * kPi);
+            if (dh < 0)
+            {
+                dh += 2 * kPi;
+            }
+            const double transit = jd_start + dh / kSiderealRate;
+            if (transit <= jd_end)
+            {
+                plan.transit = transit;
+            }
+        }
+        spdlog::debug("Planned {} targets over {} steps", n, steps);
+        return plans;
+    }
+
+    nlohmann::json NightPlanner::toJson(const std::vector<TargetPlan> &plans)
+    {
+        auto time = [](double jd) -> nlohmann::json
+        {
+            return std::isnan(jd) ? nlohmann::json(nullptr) : nlohmann::json(jd);
+        };
+        nlohmann::json result = nlohmann::json::array();
+        for (const auto &plan : plans)
+        {
+            nlohmann::json windows = nlohmann::json::array();
+            for (const auto &window : plan.windows)
+            {
+                windows.push_back({{"start", window.start}, {"end", window.end}});
+            }
+            result.push_back({{"name", plan.name},
+                              {"rise", time(plan.rise)},
+                              {"set", time(plan.set)},
+                              {"transit", time(plan.transit)},
+                              {"max_altitude", plan.max_altitude},
+                              {"max_altitude_time", plan.max_altitude_time},
+                              {"visible_minutes", plan.visible_minutes},
+                              {"windows", windows}});
+        }
+        return result;
+    }
+} // namespace OpenAPT::Astro
@@ -0,0 +1,139 @@
+/*
+ * planner.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-11
+
+Description: Batch Ephemeris and Visibility Planner
+
+**************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "coordinates.hpp"
+
+namespace OpenAPT::Astro
+{
+    /**
+     * @brief 可见时间窗口，时间为儒略日
+     */
+    struct VisibilityWindow
+    {
+        double start;
+        double end;
+    };
+
+    /**
+     * @brief 单个目标在规划时段内的可见性，缺失的时刻为 NaN
+     */
+    struct TargetPlan
+    {
+        std::string name;
+        double rise;               ///< 升起时刻（地平高度 -0.5667°）
+        double set;                ///< 落下时刻
+        double transit;            ///< 上中天时刻
+        double max_altitude;       ///< 时段内最大高度（度）
+        double max_altitude_time;  ///< 最大高度对应时刻
+        double visible_minutes;    ///< 高于最低高度的总分钟数
+        std::vector<VisibilityWindow> windows; ///< 高于最低高度的时间窗口
+    };
+
+    /**
+     * @brief 批量星历与夜间可见性规划
+     *
+     * 目标以结构数组的形式保存（sin/cos 预先计算），每个时间步只计算一次恒星时，
+     * 然后在无分支的连续循环中求出所有目标的高度，循环只包含乘加运算，可由编译器自动向量化。
+     * 坐标按 J2000 处理，不做岁差章动修正，对规划精度（分钟级）足够。
+     */
+    class NightPlanner
+    {
+    public:
+        explicit NightPlanner(const Observer &observer);
+
+        /**
+         * @brief 添加目标
+         *
+         * @param name 目标名称
+         * @param ra 赤经（度）
+         * @param dec 赤纬（度）
+         * @return 目标下标
+         */
+        size_t addTarget(const std::string &name, double ra, double dec);
+
+        /**
+         * @brief 清空所有目标
+         */
+        void clearTargets();
+
+        /**
+         * @brief 目标数量
+         */
+        size_t size() const
+        {
+            return m_names.size();
+        }
+
+        /**
+         * @brief 计算所有目标在某一时刻的高度和方位角
+         *
+         * @param jd 儒略日
+         * @param altitude 输出高度（度），与目标下标一一对应
+         * @param azimuth 输出方位角（度，北为 0，向东增加）
+         */
+        void altAz(double jd, std::vector<double> &altitude, std::vector<double> &azimuth) const;
+
+        /**
+         * @brief 生成整段时间的可见性规划
+         *
+         * @param jd_start 开始时刻（儒略日）
+         * @param jd_end 结束时刻（儒略日）
+         * @param step_minutes 时间步长（分钟）
+         * @param min_altitude 最低可用高度（度）
+         * @return 每个目标的规划结果，顺序与添加顺序一致
+         */
+        std::vector<TargetPlan> plan(double jd_start, double jd_end, double step_minutes = 1.0, double min_altitude = 30.0) const;
+
+        /**
+         * @brief 将规划结果转换为 JSON，缺失的时刻输出为 null
+         */
+        static nlohmann::json toJson(const std::vector<TargetPlan> &plans);
+
+    private:
+        Observer m_observer;
+        double m_sin_lat;
+        double m_cos_lat;
+
+        std::vector<std::string> m_names;
+        std::vector<double> m_ra;      ///< 赤经（弧度）
+        std::vector<double> m_sin_ra;
+        std::vector<double> m_cos_ra;
+        std::vector<double> m_sin_dec;
+        std::vector<double> m_cos_dec;
+    };
+} // namespace OpenAPT::Astro
@@ -0,0 +1,136 @@
+/*
+ * camera_state.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-17
+
+Description: Typed Camera State
+
+**************************************************/
+
+#include "camera_state.hpp"
+
+#include <cmath>
+
+namespace OpenAPT
+{
+    namespace
+    {
+        const char *ToString(FrameType type)
+        {
+            switch (type)
+            {
+            case FrameType::Light:
+                return "Light";
+            case FrameType::Dark:
+                return "Dark";
+            case FrameType::Flat:
+                return "Flat";
+            case FrameType::Bias:
+                return "Bias";
+            default:
+                return "";
+            }
+        }
+
+        const char *ToString(TransferFormat format)
+        {
+            switch (format)
+            {
+            case TransferFormat::Fits:
+                return "Fits";
+            case TransferFormat::Raw:
+                return "Raw";
+            case TransferFormat::Xisf:
+                return "Xisf";
+            default:
+                return "";
+            }
+        }
+
+        const char *ToString(UploadMode mode)
+        {
+            switch (mode)
+            {
+            case UploadMode::Client:
+                return "Client";
+            case UploadMode::Local:
+                return "Local";
+            case UploadMode::Both:
+                return "Both";
+            default:
+                return "";
+            }
+        }
+
+        // 未知的数值输出为 null
+        nlohmann::json Number(double value)
+        {
+            return std::isnan(value) ? nlohmann::json() : nlohmann::json(value);
+        }
+    }
+
+    nlohmann::json CameraStateToJson(const CameraState &state)
+    {
+        return {{"connected", state.connected},
+                {"debug", state.debug},
+                {"exposure", {{"current", state.exposure.current},
+                              {"duration", state.exposure.duration},
+                              {"exposing", state.exposure.exposing},
+                              {"abort", state.exposure.aborted},
+                              {"gain", Number(state.exposure.gain)},
+                              {"offset", Number(state.exposure.offset)},
+                              {"binning_x", state.exposure.binning_x},
+                              {"binning_y", state.exposure.binning_y}}},
+                {"frame", {{"type", ToString(state.frame.type)},
+                           {"format", ToString(state.frame.format)},
+                           {"fast_read", state.frame.fast_read},
+                           {"x", state.frame.x},
+                           {"y", state.frame.y},
+                           {"width", state.frame.width},
+                           {"height", state.frame.height},
+                           {"pixel", state.frame.pixel},
+                           {"pixel_x", state.frame.pixel_x},
+                           {"pixel_y", state.frame.pixel_y},
+                           {"pixel_depth", state.frame.pixel_depth},
+                           {"max_frame_x", state.frame.max_frame_x},
+                           {"max_frame_y", state.frame.max_frame_y}}},
+                {"temperature", {{"current", Number(state.temperature.current)}}},
+                {"video", {{"is_video", state.video.is_video},
+                           {"delay", state.video.delay},
+                           {"exposure", state.video.exposure},
+                           {"division", state.video.division},
+                           {"fps", state.video.fps},
+                           {"avgfps", state.video.avgfps}}},
+                {"network", {{"mode", ToString(state.network.mode)},
+                             {"period", state.network.period},
+                             {"port", state.network.port.view()}}},
+                {"limits", {{"maxbuffer", state.limits.maxbuffer},
+                            {"maxfps", state.limits.maxfps}}},
+                {"driver", {{"name", state.driver.name.view()},
+                            {"exec", state.driver.exec.view()},
+                            {"version", state.driver.version.view()},
+                            {"interfaces", state.driver.interfaces.view()}}}};
+    }
+} // namespace OpenAPT
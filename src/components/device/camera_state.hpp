@@ -0,0 +1,172 @@
+/*
+ * camera_state.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-17
+
+Description: Typed Camera State
+
+**************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#include "nlohmann/json.hpp"
+
+namespace OpenAPT
+{
+    /**
+     * @brief 定长字符串，使状态结构保持可平凡复制
+     */
+    template <size_t N>
+    struct FixedString
+    {
+        std::array<char, N> data{};
+
+        void assign(std::string_view value)
+        {
+            const size_t size = std::min(value.size(), N - 1);
+            std::memcpy(data.data(), value.data(), size);
+            data[size] = '\0';
+        }
+
+        std::string_view view() const
+        {
+            return {data.data(), strnlen(data.data(), N)};
+        }
+    };
+
+    enum class FrameType : uint8_t
+    {
+        Unknown,
+        Light,
+        Dark,
+        Flat,
+        Bias
+    };
+
+    enum class TransferFormat : uint8_t
+    {
+        Unknown,
+        Fits,
+        Raw,
+        Xisf
+    };
+
+    enum class UploadMode : uint8_t
+    {
+        Unknown,
+        Client,
+        Local,
+        Both
+    };
+
+    /**
+     * @brief 相机状态快照
+     *
+     * 由驱动线程在收到属性更新时写入，读者通过 SeqLock 取得一致的副本，
+     * JSON 只在客户端请求时由 CameraStateToJson 生成。未知的数值为 NaN。
+     */
+    struct CameraState
+    {
+        bool connected = false;
+        bool debug = false;
+
+        struct
+        {
+            double current = 0;  ///< 剩余曝光时间
+            double duration = 0; ///< 本次曝光时长
+            bool exposing = false;
+            bool aborted = false;
+            double gain = std::numeric_limits<double>::quiet_NaN();
+            double offset = std::numeric_limits<double>::quiet_NaN();
+            int binning_x = 1;
+            int binning_y = 1;
+        } exposure;
+
+        struct
+        {
+            FrameType type = FrameType::Unknown;
+            TransferFormat format = TransferFormat::Unknown;
+            bool fast_read = false;
+            int x = 0;
+            int y = 0;
+            int width = 0;
+            int height = 0;
+            double pixel = 0;
+            double pixel_x = 0;
+            double pixel_y = 0;
+            int pixel_depth = 0;
+            int max_frame_x = 0;
+            int max_frame_y = 0;
+        } frame;
+
+        struct
+        {
+            double current = std::numeric_limits<double>::quiet_NaN();
+        } temperature;
+
+        struct
+        {
+            bool is_video = false;
+            double delay = 0;
+            double exposure = 0;
+            double division = 0;
+            double fps = 0;
+            double avgfps = 0;
+        } video;
+
+        struct
+        {
+            UploadMode mode = UploadMode::Unknown;
+            double period = 0;
+            FixedString<128> port;
+        } network;
+
+        struct
+        {
+            double maxbuffer = 0;
+            double maxfps = 0;
+        } limits;
+
+        struct
+        {
+            FixedString<64> name;
+            FixedString<128> exec;
+            FixedString<32> version;
+            FixedString<32> interfaces;
+        } driver;
+    };
+
+    /**
+     * @brief 生成与原 camera_info 相同结构的 JSON
+     */
+    nlohmann::json CameraStateToJson(const CameraState &state);
+} // namespace OpenAPT
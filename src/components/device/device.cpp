@@ -8,80 +8,101 @@ Device::Device(const std::string &name)
     _uuid = generator.generateUUIDWithFormat();
 }
 
-auto Device::IAFindMessage(const std::string &identifier)
+Device::MessageInfo *Device::IAFindMessage(const std::string &identifier)
 {
-    return std::find_if(device_messages.begin(), device_messages.end(), [&](const MessageInfo &msg)
-                        { return msg.message.GetMessageUUID() == identifier || msg.message.GetName() == identifier; });
+    std::lock_guard<std::mutex> lock(message_mutex);
+    return device_messages.find(identifier);
 }
 
 void Device::IAInsertMessage(const OpenAPT::Property::IMessage &message, std::shared_ptr<OpenAPT::SimpleTask> task)
 {
-    MessageInfo info;
-    info.message = message;
-    info.task = task;
-
-    device_messages.push_back(info);
-    IANotifyObservers(message);
+    {
+        std::lock_guard<std::mutex> lock(message_mutex);
+        device_messages.insert(MessageInfo{message, task});
+    }
+    IANotifyObservers(OpenAPT::DeviceEvent::Kind::Inserted, message);
 }
 
-OpenAPT::Property::IMessage Device::IACreateMessage(const std::string &message_name, std::any message_value)
+OpenAPT::Property::IMessage Device::IACreateMessage(const std::string &message_name, OpenAPT::Property::MessageValue message_value)
 {
     OpenAPT::Property::IMessage message;
     message.name = message_name;
     message.device_name = _name;
     message.device_uuid = _uuid;
-    message.value = message_value;
+    message.value = std::move(message_value);
     return message;
 }
 
 void Device::IAUpdateMessage(const std::string &identifier, const OpenAPT::Property::IMessage &newMessage)
 {
-    auto it = IAFindMessage(identifier);
-
-    if (it != device_messages.end())
+    // 旧值由事件总线保存，这里不再复制
+    bool updated;
+    {
+        std::lock_guard<std::mutex> lock(message_mutex);
+        updated = device_messages.update(identifier, newMessage) != nullptr;
+    }
+    if (updated)
     {
-        OpenAPT::Property::IMessage oldMessage = it->message;
-        it->message = newMessage;
-        IANotifyObservers(newMessage, oldMessage);
+        IANotifyObservers(OpenAPT::DeviceEvent::Kind::Updated, newMessage);
     }
 }
 
 void Device::IARemoveMessage(const std::string &identifier)
 {
-    auto it = IAFindMessage(identifier);
-
-    if (it != device_messages.end())
+    OpenAPT::Property::IMessage removed;
+    bool found;
     {
-        OpenAPT::Property::IMessage removedMessage = it->message;
-        device_messages.erase(it);
-        IANotifyObservers(removedMessage);
+        std::lock_guard<std::mutex> lock(message_mutex);
+        found = device_messages.remove(identifier, &removed);
+    }
+    if (found)
+    {
+        IANotifyObservers(OpenAPT::DeviceEvent::Kind::Removed, removed);
     }
 }
 
 OpenAPT::Property::IMessage *Device::IAGetMessage(const std::string &identifier)
 {
-    auto it = IAFindMessage(identifier);
+    std::lock_guard<std::mutex> lock(message_mutex);
+    MessageInfo *info = device_messages.find(identifier);
+    return info ? &info->message : nullptr;
+}
+
+std::vector<OpenAPT::Property::IMessage> Device::IASnapshotMessages() const
+{
+    std::vector<OpenAPT::Property::IMessage> messages;
+    std::lock_guard<std::mutex> lock(message_mutex);
+    messages.reserve(device_messages.size());
+    device_messages.forEach([&](const MessageInfo &info)
+                            { messages.push_back(info.message); });
+    return messages;
+}
 
-    if (it != device_messages.end())
-    {
-        return &(it->message);
-    }
+void Device::IANotifyObservers(OpenAPT::DeviceEvent::Kind kind, const OpenAPT::Property::IMessage &message)
+{
+    event_bus.publish(kind, message);
+}
 
-    return nullptr;
+uint64_t Device::IAAddObserver(Observer observer, OpenAPT::DeviceEventBus::Executor executor)
+{
+    return event_bus.subscribe([observer = std::move(observer)](std::span<const OpenAPT::DeviceEvent> events)
+                               {
+        for (const auto &event : events)
+        {
+            observer(*event.value, *event.old_value);
+        } },
+                               std::move(executor));
 }
 
-void Device::IANotifyObservers(const OpenAPT::Property::IMessage &newMessage, const OpenAPT::Property::IMessage &oldMessage)
+void Device::IARemoveObserver(uint64_t id)
 {
-    for (const auto &observer : observers)
-    {
-        observer(newMessage, oldMessage);
-    }
+    event_bus.unsubscribe(id);
 }
 
-void Device::IANotifyObservers(const OpenAPT::Property::IMessage &removedMessage)
+void Device::IARecordTelemetry(const std::string &channel, double value)
 {
-    for (const auto &observer : observers)
+    if (const auto store = telemetry.load(std::memory_order_acquire))
     {
-        observer(removedMessage, removedMessage);
+        store->record(_name + "." + channel, value);
     }
 }
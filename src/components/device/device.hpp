@@ -31,6 +31,8 @@ Description: Basic Device Defination
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <functional>
@@ -39,6 +41,9 @@ Description: Basic Device Defination
 
 #include "nlohmann/json.hpp"
 #include "property/imessage.hpp"
+#include "event_bus.hpp"
+#include "message_store.hpp"
+#include "telemetry_store.hpp"
 
 /**
  * @brief 设备基类
@@ -180,11 +185,18 @@ public:
     virtual void setId(int id) = 0;
 
 public:
-    auto IAFindMessage(const std::string &identifier);
+    using MessageInfo = OpenAPT::DeviceMessageInfo;
+
+    /**
+     * @brief 按消息名或消息 UUID 查找，O(1)
+     *
+     * 返回的指针只能在修改消息的线程（驱动线程）上使用
+     */
+    MessageInfo *IAFindMessage(const std::string &identifier);
 
     void IAInsertMessage(const OpenAPT::Property::IMessage &message,std::shared_ptr<OpenAPT::SimpleTask> task);
 
-    OpenAPT::Property::IMessage IACreateMessage(const std::string &message_name, std::any message_value);
+    OpenAPT::Property::IMessage IACreateMessage(const std::string &message_name, OpenAPT::Property::MessageValue message_value);
 
     void IAUpdateMessage(const std::string &identifier, const OpenAPT::Property::IMessage &newMessage);
 
@@ -192,19 +204,42 @@ public:
 
     OpenAPT::Property::IMessage *IAGetMessage(const std::string &identifier);
 
-    void IANotifyObservers(const OpenAPT::Property::IMessage &newMessage, const OpenAPT::Property::IMessage &oldMessage);
+    /**
+     * @brief 复制当前全部消息，可以在驱动线程之外调用
+     */
+    std::vector<OpenAPT::Property::IMessage> IASnapshotMessages() const;
 
-    void IANotifyObservers(const OpenAPT::Property::IMessage &removedMessage);
+    /**
+     * @brief 发布消息的变化，观察者在各自的执行器上异步收到合并后的结果
+     */
+    void IANotifyObservers(OpenAPT::DeviceEvent::Kind kind, const OpenAPT::Property::IMessage &message);
 
-    struct MessageInfo
-    {
-        OpenAPT::Property::IMessage message;
-        std::shared_ptr<OpenAPT::SimpleTask> task;
-    };
+    using Observer = std::function<void(const OpenAPT::Property::IMessage &, const OpenAPT::Property::IMessage &)>;
 
-    std::vector<MessageInfo> device_messages;
+    /**
+     * @brief 添加观察者，以 (新值, 旧值) 逐条回调；插入和删除时两者相同
+     *
+     * @param executor 运行回调的执行器，为空时使用事件总线的线程池
+     * @return 订阅编号
+     */
+    uint64_t IAAddObserver(Observer observer, OpenAPT::DeviceEventBus::Executor executor = nullptr);
+
+    void IARemoveObserver(uint64_t id);
+
+    // 设备消息，按名称和 UUID 索引，支持按代数的增量查询，修改和跨线程读取时持有 message_mutex
+    OpenAPT::DeviceMessageStore device_messages;
+    mutable std::mutex message_mutex;
+
+    // 消息变化的事件总线，发布者不等待观察者
+    OpenAPT::DeviceEventBus event_bus;
+
+    /**
+     * @brief 把传感器读数写入遥测存储，通道名为 "设备名.channel"，未设置存储时忽略
+     */
+    void IARecordTelemetry(const std::string &channel, double value);
 
-    std::vector<std::function<void(const OpenAPT::Property::IMessage &, const OpenAPT::Property::IMessage &)>> observers;
+    // 遥测存储，由设备管理器在添加设备时设置、删除设备时清空，可以为空；驱动线程并发读取
+    std::atomic<std::shared_ptr<OpenAPT::TelemetryStore>> telemetry;
 
 public:
     std::string _name;                  ///< 设备名称
@@ -214,6 +249,6 @@ public:
     std::string configPath;             ///< 配置文件路径
     std::string hostname = "127.0.0.1"; ///< 主机名
     int port = 7624;                    ///< 端口号
-    bool is_connected;                  ///< 是否已连接
+    std::atomic_bool is_connected{false}; ///< 是否已连接，驱动线程写入，启动编排器轮询
     bool is_debug;                      ///< 调试模式
 };
\ No newline at end of file
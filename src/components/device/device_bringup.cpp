@@ -0,0 +1,276 @@
+/*
+ * device_bringup.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Parallel Device Bring-up
+
+**************************************************/
+
+#include "device_bringup.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+#include "property/message_writer.hpp"
+
+namespace OpenAPT
+{
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief connect() 线程与编排器共享的状态，超时后线程被分离时仍然有效
+     */
+    struct DeviceBringup::Attempt
+    {
+        mutable std::mutex mutex;
+        std::condition_variable *wake = nullptr; ///< 编排器的唤醒条件，与 mutex 无关，只用于提前结束等待
+        bool returned = false;
+        bool ok = false;
+        std::string error;
+        Clock::time_point returned_at;
+        bool abandoned = false; ///< 编排器已判定超时，connect() 返回后由线程断开设备
+        bool discarded = false; ///< 超时后建立的连接已被断开
+    };
+
+    namespace
+    {
+        std::chrono::milliseconds Since(Clock::time_point start, Clock::time_point now)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+        }
+
+        // 驱动线程可能仍在修改消息，先在设备锁内复制，再在锁外序列化
+        nlohmann::json Snapshot(const Device &device)
+        {
+            nlohmann::json properties = nlohmann::json::array();
+            Property::MessageWriter writer;
+            for (const auto &message : device.IASnapshotMessages())
+            {
+                properties.push_back(nlohmann::json::parse(writer.json(message)));
+            }
+            return properties;
+        }
+    } // namespace
+
+    DeviceBringup::DeviceBringup(std::chrono::milliseconds poll_interval)
+        : m_poll_interval(poll_interval)
+    {
+    }
+
+    void DeviceBringup::add(std::shared_ptr<Device> device, const std::string &name, std::chrono::milliseconds timeout)
+    {
+        m_targets.push_back({std::move(device), name, timeout});
+    }
+
+    bool DeviceBringup::run()
+    {
+        const auto start = Clock::now();
+        m_start = start;
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+
+        std::vector<std::shared_ptr<Attempt>> &attempts = m_attempts;
+        attempts.clear();
+        std::vector<std::thread> threads;
+        m_reports.assign(m_targets.size(), Report());
+        for (size_t i = 0; i < m_targets.size(); ++i)
+        {
+            m_reports[i].device = m_targets[i].device->getName();
+            m_reports[i].status = Status::Connecting;
+            auto attempt = std::make_shared<Attempt>();
+            attempt->wake = &wake;
+            attempts.push_back(attempt);
+            threads.emplace_back([attempt, &wake_mutex, device = m_targets[i].device, name = m_targets[i].name]()
+                                 {
+                bool ok = false;
+                std::string error;
+                try
+                {
+                    ok = device->connect(name);
+                }
+                catch (const std::exception &e)
+                {
+                    error = e.what();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(attempt->mutex);
+                    attempt->returned = true;
+                    attempt->ok = ok;
+                    attempt->error = std::move(error);
+                    attempt->returned_at = Clock::now();
+                    // 超时后编排器已经返回，不再通知它
+                    if (!attempt->abandoned)
+                    {
+                        std::lock_guard<std::mutex> wake_lock(wake_mutex);
+                        attempt->wake->notify_one();
+                        return;
+                    }
+                }
+                // 报告已经是超时，迟到的连接不能留在已连接状态
+                spdlog::warn("Device {} connected after its bring-up timeout, disconnecting", device->getName());
+                device->disconnect();
+                std::lock_guard<std::mutex> lock(attempt->mutex);
+                attempt->discarded = true; });
+        }
+
+        size_t pending = m_targets.size();
+        while (pending > 0)
+        {
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex);
+                wake.wait_for(lock, m_poll_interval);
+            }
+            const auto now = Clock::now();
+            for (size_t i = 0; i < m_targets.size(); ++i)
+            {
+                Report &report = m_reports[i];
+                if (report.status != Status::Connecting && report.status != Status::Waiting)
+                {
+                    continue;
+                }
+                const Target &target = m_targets[i];
+                {
+                    std::lock_guard<std::mutex> lock(attempts[i]->mutex);
+                    if (attempts[i]->returned && report.status == Status::Connecting)
+                    {
+                        report.connected = Since(start, attempts[i]->returned_at);
+                        report.status = Status::Waiting;
+                        // 驱动可能在 connect() 返回前就已经报告连接成功
+                        if (!attempts[i]->ok && !target.device->is_connected)
+                        {
+                            report.status = Status::Failed;
+                            report.error = attempts[i]->error.empty() ? "connect() returned false" : attempts[i]->error;
+                        }
+                    }
+                }
+                if (report.status == Status::Waiting && target.device->is_connected)
+                {
+                    report.status = Status::Ready;
+                    report.properties = Snapshot(*target.device);
+                }
+                else if (report.status != Status::Failed && Since(start, now) >= target.timeout)
+                {
+                    report.status = Status::TimedOut;
+                    report.error = report.connected.count() < 0 ? "connect() did not return" : "device did not report connected";
+                }
+                if (report.status != Status::Connecting && report.status != Status::Waiting)
+                {
+                    report.ready = Since(start, now);
+                    --pending;
+                    spdlog::info("Device {} {} after {} ms", report.device, StatusName(report.status), report.ready.count());
+                }
+            }
+        }
+
+        for (size_t i = 0; i < threads.size(); ++i)
+        {
+            std::unique_lock<std::mutex> lock(attempts[i]->mutex);
+            if (attempts[i]->returned)
+            {
+                lock.unlock();
+                threads[i].join();
+                // connect() 已返回但驱动没有按时报告连接，同样断开
+                if (m_reports[i].status == Status::TimedOut)
+                {
+                    m_targets[i].device->disconnect();
+                    lock.lock();
+                    attempts[i]->discarded = true;
+                }
+            }
+            else
+            {
+                // connect() 仍然阻塞，让它在后台结束并断开
+                attempts[i]->abandoned = true;
+                threads[i].detach();
+            }
+        }
+        m_elapsed = Since(start, Clock::now());
+        return std::all_of(m_reports.begin(), m_reports.end(), [](const Report &report)
+                           { return report.status == Status::Ready; });
+    }
+
+    nlohmann::json DeviceBringup::timeline() const
+    {
+        std::vector<const Report *> sorted;
+        for (const auto &report : m_reports)
+        {
+            sorted.push_back(&report);
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Report *a, const Report *b)
+                         { return a->ready < b->ready; });
+        nlohmann::json devices = nlohmann::json::array();
+        for (const Report *report : sorted)
+        {
+            nlohmann::json entry = {
+                {"device", report->device},
+                {"status", StatusName(report->status)},
+                {"connect_ms", report->connected.count()},
+                {"ready_ms", report->ready.count()},
+                {"properties", report->properties.size()},
+            };
+            if (!report->error.empty())
+            {
+                entry["error"] = report->error;
+            }
+            const Attempt &attempt = *m_attempts[report - m_reports.data()];
+            std::lock_guard<std::mutex> lock(attempt.mutex);
+            if (attempt.discarded)
+            {
+                entry["discarded"] = true;
+                if (report->connected.count() < 0)
+                {
+                    entry["late_connect_ms"] = Since(m_start, attempt.returned_at).count();
+                }
+            }
+            devices.push_back(std::move(entry));
+        }
+        return {{"elapsed_ms", m_elapsed.count()}, {"devices", std::move(devices)}};
+    }
+
+    const char *DeviceBringup::StatusName(Status status)
+    {
+        switch (status)
+        {
+        case Status::Pending:
+            return "pending";
+        case Status::Connecting:
+            return "connecting";
+        case Status::Waiting:
+            return "waiting";
+        case Status::Ready:
+            return "ready";
+        case Status::Failed:
+            return "failed";
+        case Status::TimedOut:
+            return "timeout";
+        }
+        return "unknown";
+    }
+} // namespace OpenAPT
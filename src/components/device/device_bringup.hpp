@@ -0,0 +1,134 @@
+/*
+ * device_bringup.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Parallel Device Bring-up
+
+**************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "device.hpp"
+
+namespace OpenAPT
+{
+    /**
+     * @brief 并行连接一组设备
+     *
+     * 每台设备在自己的线程中调用 connect()，编排器等待它们的 is_connected 变为真，
+     * 总耗时取决于最慢的一台设备而不是所有设备之和。每台设备有独立的超时，超时后不再等待，
+     * 仍在阻塞的 connect() 线程被分离，由它持有的 shared_ptr 保证设备存活。超时的设备即使之后
+     * 连接成功也会被断开（在分离的线程中），报告保持 TimedOut，时间线中标记为 discarded。
+     * 设备就绪时采集它的消息快照，run() 结束后可以取得带时间线的报告。
+     */
+    class DeviceBringup
+    {
+    public:
+        enum class Status
+        {
+            Pending,
+            Connecting, ///< connect() 还没有返回
+            Waiting,    ///< connect() 已返回，等待驱动报告已连接
+            Ready,
+            Failed,
+            TimedOut,
+        };
+
+        /**
+         * @brief 单台设备的结果，时间相对于 run() 开始
+         */
+        struct Report
+        {
+            std::string device;
+            Status status = Status::Pending;
+            std::chrono::milliseconds connected{-1}; ///< connect() 返回的时间，未返回时为 -1
+            std::chrono::milliseconds ready{-1};     ///< 就绪、失败或超时的时间
+            std::string error;
+            nlohmann::json properties = nlohmann::json::array(); ///< 就绪时的消息快照
+        };
+
+        explicit DeviceBringup(std::chrono::milliseconds poll_interval = std::chrono::milliseconds(20));
+
+        /**
+         * @brief 添加一台设备
+         *
+         * @param name 传给 connect() 的驱动端设备名
+         * @param timeout 从 run() 开始到就绪的最长时间
+         */
+        void add(std::shared_ptr<Device> device, const std::string &name,
+                 std::chrono::milliseconds timeout = std::chrono::seconds(30));
+
+        /**
+         * @brief 并行连接全部设备，所有设备就绪、失败或超时后返回
+         *
+         * @return 是否全部就绪
+         */
+        bool run();
+
+        const std::vector<Report> &reports() const
+        {
+            return m_reports;
+        }
+
+        std::chrono::milliseconds elapsed() const
+        {
+            return m_elapsed;
+        }
+
+        /**
+         * @brief 按就绪时间排序的时间线
+         *
+         * 超时后才返回的 connect() 在调用时已经结束的，条目带有 discarded 和 late_connect_ms
+         */
+        nlohmann::json timeline() const;
+
+        static const char *StatusName(Status status);
+
+    private:
+        struct Target
+        {
+            std::shared_ptr<Device> device;
+            std::string name;
+            std::chrono::milliseconds timeout;
+        };
+
+        struct Attempt;
+
+        std::chrono::milliseconds m_poll_interval;
+        std::vector<Target> m_targets;
+        std::vector<Report> m_reports;
+        std::vector<std::shared_ptr<Attempt>> m_attempts; ///< 与 m_reports 对应，分离的线程结束后仍可查询
+        std::chrono::steady_clock::time_point m_start;
+        std::chrono::milliseconds m_elapsed{0};
+    };
+} // namespace OpenAPT
@@ -31,6 +31,8 @@ Description: Device Manager
 
 #include "device_manager.hpp"
 
+#include <algorithm>
+
 #include "nlohmann/json.hpp"
 #include <spdlog/spdlog.h>
 
@@ -44,45 +46,56 @@ namespace OpenAPT
 
     // Constructor
     DeviceManager::DeviceManager()
+        : m_telemetry(std::make_shared<TelemetryStore>()), m_registry(std::make_shared<const Registry>())
+    {
+    }
+
+    DeviceManager::~DeviceManager()
     {
-        for (auto &devices : m_devices)
+        for (const auto &devices : snapshot()->devices)
         {
-            devices.emplace_back();
+            for (const auto &device : devices)
+            {
+                device->disconnect();
+            }
         }
     }
 
-    DeviceManager::~DeviceManager()
+    const DeviceManager::Entry *DeviceManager::Find(const std::unordered_map<std::string, Entry> &index, const std::string &key)
+    {
+        auto it = index.find(key);
+        return it != index.end() ? &it->second : nullptr;
+    }
+
+    void DeviceManager::publish(std::shared_ptr<Registry> registry)
     {
-        for (auto &devices : m_devices)
+        // 索引由设备列表重建，删除和重命名不会留下失效的项
+        registry->by_name.clear();
+        registry->by_uuid.clear();
+        for (int type = 0; type < static_cast<int>(DeviceType::NumDeviceTypes); ++type)
         {
-            for (auto &device : devices)
+            for (const auto &device : registry->devices[type])
             {
-                if (device)
-                {
-                    device->disconnect();
-                }
+                const Entry entry{device, static_cast<DeviceType>(type)};
+                registry->by_name.emplace(device->getName(), entry);
+                registry->by_uuid.emplace(device->getId(), entry);
             }
         }
+        m_registry.store(std::move(registry), std::memory_order_release);
     }
 
     std::vector<std::string> DeviceManager::getDeviceList(DeviceType type)
     {
         std::vector<std::string> deviceList;
-        auto &devices = m_devices[static_cast<int>(type)];
-        for (const auto &device : devices)
+        for (const auto &device : snapshot()->devices[static_cast<int>(type)])
         {
-            if (device)
-            {
-                deviceList.emplace_back(device->getName());
-            }
+            deviceList.emplace_back(device->getName());
         }
         return deviceList;
     }
 
     void DeviceManager::addDevice(DeviceType type, const std::string &name)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-
         // Check if device type is valid
         if (type < DeviceType::Camera || type > DeviceType::Guider)
         {
@@ -90,141 +103,171 @@ namespace OpenAPT
         }
 
         // Check if device name already exists
-        if (findDeviceByName(name))
+        if (Find(snapshot()->by_name, name))
         {
             //spdlog::warn("A device with name {} already exists, please choose a different name", name);
             return;
         }
 
-        std::string newName = name;
-        int index = 1;
-        while (findDevice(type, newName) != -1)
-        {
-            newName = fmt::format("{}-{}", name, index++);
-        }
-
-        // Create new device and add it to the device list
+        std::shared_ptr<Device> device;
         switch (type)
         {
         case DeviceType::Camera:
         {
-            //spdlog::debug("Trying to add a new camera instance : {}", newName);
-            m_devices[static_cast<int>(type)].emplace_back(std::make_shared<Camera>(newName));
-            //spdlog::debug("Added new camera instance successfully");
+            //spdlog::debug("Trying to add a new camera instance : {}", name);
+            device = std::make_shared<Camera>(name);
             break;
         }
         case DeviceType::Telescope:
         {
-            //spdlog::debug("Trying to add a new telescope instance : {}", newName);
-            m_devices[static_cast<int>(type)].emplace_back(std::make_shared<Telescope>(newName));
-            //spdlog::debug("Added new telescope instance successfully");
+            //spdlog::debug("Trying to add a new telescope instance : {}", name);
+            device = std::make_shared<Telescope>(name);
             break;
         }
         case DeviceType::Focuser:
         {
-            //spdlog::debug("Trying to add a new Focuser instance : {}", newName);
-            m_devices[static_cast<int>(type)].emplace_back(std::make_shared<Focuser>(newName));
-            //spdlog::debug("Added new focuser instance successfully");
+            //spdlog::debug("Trying to add a new Focuser instance : {}", name);
+            device = std::make_shared<Focuser>(name);
             break;
         }
         case DeviceType::FilterWheel:
         {
-            //spdlog::debug("Trying to add a new filterwheel instance : {}", newName);
-            m_devices[static_cast<int>(type)].emplace_back(std::make_shared<Filterwheel>(newName));
-            //spdlog::debug("Added new filterwheel instance successfully");
+            //spdlog::debug("Trying to add a new filterwheel instance : {}", name);
+            device = std::make_shared<Filterwheel>(name);
             break;
         }
         case DeviceType::Solver:
-            // m_devices[static_cast<int>(type)].emplace_back(std::make_shared<Solver>(newName));
+            // device = std::make_shared<Solver>(name);
             break;
         case DeviceType::Guider:
-            // m_devices[static_cast<int>(type)].emplace_back(std::make_shared<Guider>(newName));
+            // device = std::make_shared<Guider>(name);
             break;
         default:
             //spdlog::error("Invalid device type");
             break;
         }
+        if (!device)
+        {
+            return;
+        }
+        addDevice(type, std::move(device));
     }
 
-    void DeviceManager::removeDevice(DeviceType type, const std::string &name)
+    bool DeviceManager::addDevice(DeviceType type, std::shared_ptr<Device> device)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!device || type < DeviceType::Camera || type >= DeviceType::NumDeviceTypes)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        const auto current = snapshot();
+        // 同名检查必须在写锁内，按名称添加时的预检查只用于避免无谓地构造设备
+        if (Find(current->by_name, device->getName()))
+        {
+            return false;
+        }
 
-        auto &devices = m_devices[static_cast<int>(type)];
-        for (auto it = devices.begin(); it != devices.end(); ++it)
+        device->telemetry.store(m_telemetry);
+
+        // 复制当前快照，加入新设备后整体发布
+        auto registry = std::make_shared<Registry>(*current);
+        registry->devices[static_cast<int>(type)].push_back(std::move(device));
+        publish(std::move(registry));
+        return true;
+    }
+
+    void DeviceManager::removeDevice(DeviceType type, const std::string &name)
+    {
+        std::shared_ptr<Device> removed;
         {
-            if (*it && (*it)->getName() == name)
+            std::lock_guard<std::mutex> lock(m_write_mutex);
+            const auto current = snapshot();
+            const Entry *entry = Find(current->by_name, name);
+            if (!entry || entry->type != type)
             {
-                (*it)->disconnect();
-                devices.erase(it);
+                //spdlog::warn("Could not find device {} of type {}", name, static_cast<int>(type));
                 return;
             }
+            removed = entry->device;
+            auto registry = std::make_shared<Registry>(*current);
+            auto &devices = registry->devices[static_cast<int>(type)];
+            devices.erase(std::find(devices.begin(), devices.end(), removed));
+            publish(std::move(registry));
         }
-        //spdlog::warn("Could not find device {} of type {}", name, static_cast<int>(type));
+        // 断开连接可能很慢，不占用写锁
+        removed->disconnect();
+        removed->telemetry.store(nullptr);
     }
 
     void DeviceManager::removeDevicesByName(const std::string &name)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-
-        for (auto &devices : m_devices)
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        const auto current = snapshot();
+        if (!Find(current->by_name, name))
+        {
+            return;
+        }
+        auto registry = std::make_shared<Registry>(*current);
+        for (auto &devices : registry->devices)
         {
             devices.erase(std::remove_if(devices.begin(), devices.end(),
                                          [&](const std::shared_ptr<Device> &device)
-                                         { return device && device->getName() == name; }),
+                                         {
+                                             if (device->getName() != name)
+                                             {
+                                                 return false;
+                                             }
+                                             device->telemetry.store(nullptr);
+                                             return true;
+                                         }),
                           devices.end());
         }
+        publish(std::move(registry));
     }
 
     std::shared_ptr<Device> DeviceManager::getDevice(DeviceType type, const std::string &name)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-
-        size_t index = findDevice(type, name);
-        if (index != -1)
+        const auto registry = snapshot();
+        const Entry *entry = Find(registry->by_name, name);
+        if (entry && entry->type == type)
         {
-            return m_devices[static_cast<int>(type)][index];
-        }
-        else
-        {
-            //spdlog::warn("Could not find device {} of type {}", name, static_cast<int>(type));
-            return nullptr;
+            return entry->device;
         }
+        //spdlog::warn("Could not find device {} of type {}", name, static_cast<int>(type));
+        return nullptr;
     }
 
     size_t DeviceManager::findDevice(DeviceType type, const std::string &name)
     {
-        auto &devices = m_devices[static_cast<int>(type)];
-        for (size_t i = 0; i < devices.size(); ++i)
+        const auto registry = snapshot();
+        const Entry *entry = Find(registry->by_name, name);
+        if (!entry || entry->type != type)
         {
-            if (devices[i] && devices[i]->getName() == name)
-            {
-                return i;
-            }
+            return -1;
         }
-        return -1;
+        const auto &devices = registry->devices[static_cast<int>(type)];
+        return std::find(devices.begin(), devices.end(), entry->device) - devices.begin();
     }
 
     std::shared_ptr<Device> DeviceManager::findDeviceByName(const std::string &name) const
     {
-        for (const auto &devices : m_devices)
-        {
-            for (const auto &device : devices)
-            {
-                if (device && device->getName() == name)
-                {
-                    return device;
-                }
-            }
-        }
-        return nullptr;
+        const auto registry = snapshot();
+        const Entry *entry = Find(registry->by_name, name);
+        return entry ? entry->device : nullptr;
+    }
+
+    std::shared_ptr<Device> DeviceManager::findDeviceById(const std::string &uuid) const
+    {
+        const auto registry = snapshot();
+        const Entry *entry = Find(registry->by_uuid, uuid);
+        return entry ? entry->device : nullptr;
     }
 
     std::shared_ptr<SimpleTask> DeviceManager::getSimpleTask(DeviceType type, const std::string &device_type, const std::string &device_name, const std::string &task_name, const nlohmann::json &params)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
         //spdlog::debug("Trying to find {} and get {} task", device_name, task_name);
-        auto device = findDeviceByName(device_name);
+        auto device = getDevice(type, device_name);
         if (device != nullptr)
         {
             switch (type)
@@ -306,9 +349,8 @@ namespace OpenAPT
 
     std::shared_ptr<ConditionalTask> DeviceManager::getConditionalTask(DeviceType type, const std::string &device_type, const std::string &device_name, const std::string &task_name, const nlohmann::json &params)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
         //spdlog::debug("Trying to find {} and get {} task", device_name, task_name);
-        auto device = findDeviceByName(device_name);
+        auto device = getDevice(type, device_name);
         if (device != nullptr)
         {
             switch (type)
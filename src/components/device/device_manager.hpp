@@ -33,7 +33,10 @@ Description: Device Manager
 
 #include "device.hpp"
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <mutex>
 #include <functional>
@@ -51,6 +54,13 @@ namespace OpenAPT
         NumDeviceTypes
     };
 
+    /**
+     * @brief 设备管理器
+     *
+     * 设备表是不可变的快照，通过 std::atomic<std::shared_ptr> 发布。查找（每条 WebSocket 命令都要做）
+     * 只原子地取得当前快照再查哈希索引，不与其他读者竞争锁；添加和删除设备很少发生，
+     * 由写锁串行化，复制一份快照修改后整体替换。旧快照由仍在使用它的读者持有，最后一个读者释放。
+     */
     class DeviceManager
     {
     public:
@@ -62,6 +72,13 @@ namespace OpenAPT
 
         void addDevice(DeviceType type, const std::string &name);
 
+        /**
+         * @brief 添加已经构造好的设备（例如具体的驱动实例）
+         *
+         * @return 设备为空、类型非法或同名设备已存在时返回 false
+         */
+        bool addDevice(DeviceType type, std::shared_ptr<Device> device);
+
         void removeDevice(DeviceType type, const std::string &name);
 
         void removeDevicesByName(const std::string &name);
@@ -72,6 +89,27 @@ namespace OpenAPT
 
         std::shared_ptr<Device> findDeviceByName(const std::string &name) const;
 
+        /**
+         * @brief 按设备 UUID 查找
+         */
+        std::shared_ptr<Device> findDeviceById(const std::string &uuid) const;
+
+        /**
+         * @brief 所有设备共用的遥测存储
+         */
+        TelemetryStore &telemetry()
+        {
+            return *m_telemetry;
+        }
+
+        /**
+         * @brief 共享的遥测存储，交给 WebSocketServer::setTelemetryStore() 以便客户端查询
+         */
+        std::shared_ptr<TelemetryStore> telemetryStore() const
+        {
+            return m_telemetry;
+        }
+
         std::shared_ptr<SimpleTask> getSimpleTask(DeviceType type, const std::string &device_type, const std::string &device_name, const std::string &task_name, const nlohmann::json &params);
 
         std::shared_ptr<ConditionalTask> getConditionalTask(DeviceType type, const std::string &device_type, const std::string &device_name, const std::string &task_name, const nlohmann::json &params);
@@ -79,9 +117,38 @@ namespace OpenAPT
         std::shared_ptr<LoopTask> getLoopTask(DeviceType type, const std::string &device_type, const std::string &device_name, const std::string &task_name, const nlohmann::json &params);
 
     private:
-        std::vector<std::shared_ptr<Device>> m_devices[6]; ///< An array of vectors of shared pointers to Device objects, one for each DeviceType.
-
-        std::mutex m_mutex;
+        struct Entry
+        {
+            std::shared_ptr<Device> device;
+            DeviceType type;
+        };
+
+        /**
+         * @brief 一份设备表快照，发布后不再修改
+         */
+        struct Registry
+        {
+            std::vector<std::shared_ptr<Device>> devices[static_cast<int>(DeviceType::NumDeviceTypes)]; ///< 按类型分组，保持添加顺序
+            std::unordered_map<std::string, Entry> by_name;
+            std::unordered_map<std::string, Entry> by_uuid;
+        };
+
+        std::shared_ptr<const Registry> snapshot() const
+        {
+            return m_registry.load(std::memory_order_acquire);
+        }
+
+        // 调用方持有 m_write_mutex
+        void publish(std::shared_ptr<Registry> registry);
+
+        static const Entry *Find(const std::unordered_map<std::string, Entry> &index, const std::string &key);
+
+        // 设备共享遥测存储，声明在设备表之前，设备析构和断开连接时存储仍然有效
+        std::shared_ptr<TelemetryStore> m_telemetry;
+
+        std::atomic<std::shared_ptr<const Registry>> m_registry;
+
+        std::mutex m_write_mutex; ///< 只串行化写者
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,306 @@
+/*
+ * event_bus.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Asynchronous Device Event Bus
+
+**************************************************/
+
+#include "event_bus.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT
+{
+    namespace
+    {
+        // 同一消息的两次变化合并为一次：保留最新值和最早的旧值
+        void Merge(DeviceEvent &into, DeviceEvent &&event)
+        {
+            // 插入后又更新仍是插入；删除或重新插入以最新的为准
+            if (!(into.kind == DeviceEvent::Kind::Inserted && event.kind == DeviceEvent::Kind::Updated))
+            {
+                into.kind = event.kind;
+            }
+            into.value = std::move(event.value);
+            into.sequence = event.sequence;
+        }
+    } // namespace
+
+    DeviceEventBus::DeviceEventBus(size_t capacity, std::chrono::milliseconds tick)
+        : m_capacity(std::max<size_t>(capacity, 1)), m_tick(tick)
+    {
+    }
+
+    DeviceEventBus::~DeviceEventBus()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wake_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        // 线程池析构时执行完已提交的批次
+        m_pool.reset();
+    }
+
+    void DeviceEventBus::start()
+    {
+        // 调用方持有 m_subscribers_mutex，第一次订阅时才创建线程
+        if (m_thread.joinable())
+        {
+            return;
+        }
+        m_pool = std::make_unique<Thread::ThreadPool>(2);
+        m_thread = std::thread([this]()
+                               { run(); });
+    }
+
+    void DeviceEventBus::publish(DeviceEvent::Kind kind, const Property::IMessage &message)
+    {
+        if (!hasSubscribers())
+        {
+            return;
+        }
+        DeviceEvent event;
+        event.kind = kind;
+        event.key = message.name;
+        // 复制消息在锁外完成，临界区内只做一次查找和合并
+        event.value = std::make_shared<const Property::IMessage>(message);
+
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            event.sequence = ++m_sequence;
+            auto [it, inserted] = m_pending_index.try_emplace(event.key, m_pending.size());
+            if (inserted)
+            {
+                m_pending.push_back(std::move(event));
+                wake = m_pending.size() == m_capacity;
+            }
+            else
+            {
+                Merge(m_pending[it->second], std::move(event));
+                m_coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        m_published.fetch_add(1, std::memory_order_relaxed);
+        if (wake)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_wake_mutex);
+                m_wake_requested = true;
+            }
+            m_wake.notify_all();
+        }
+    }
+
+    uint64_t DeviceEventBus::subscribe(Callback callback, Executor executor)
+    {
+        auto subscriber = std::make_shared<Subscriber>();
+        subscriber->callback = std::move(callback);
+        subscriber->delivered = m_delivered;
+        std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+        start();
+        if (!executor)
+        {
+            Thread::ThreadPool *pool = m_pool.get();
+            executor = [pool](std::function<void()> task)
+            {
+                pool->enqueue(std::move(task));
+            };
+        }
+        subscriber->executor = std::move(executor);
+        subscriber->id = m_next_id++;
+        m_subscribers.push_back(subscriber);
+        m_subscriber_count.store(m_subscribers.size(), std::memory_order_release);
+        return subscriber->id;
+    }
+
+    void DeviceEventBus::unsubscribe(uint64_t id)
+    {
+        std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+        auto it = std::find_if(m_subscribers.begin(), m_subscribers.end(), [id](const auto &subscriber)
+                               { return subscriber->id == id; });
+        if (it == m_subscribers.end())
+        {
+            return;
+        }
+        (*it)->active.store(false, std::memory_order_release);
+        m_subscribers.erase(it);
+        m_subscriber_count.store(m_subscribers.size(), std::memory_order_release);
+    }
+
+    void DeviceEventBus::flush()
+    {
+        dispatch();
+    }
+
+    void DeviceEventBus::run()
+    {
+        std::unique_lock<std::mutex> lock(m_wake_mutex);
+        while (!m_stop)
+        {
+            m_wake.wait_for(lock, m_tick, [this]()
+                            { return m_stop || m_wake_requested; });
+            m_wake_requested = false;
+            lock.unlock();
+            dispatch();
+            lock.lock();
+        }
+    }
+
+    void DeviceEventBus::dispatch()
+    {
+        std::lock_guard<std::mutex> dispatch_lock(m_dispatch_mutex);
+
+        // 换出本周期的全部事件，发布时已按消息合并
+        std::vector<DeviceEvent> batch;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            batch.swap(m_pending);
+            m_pending_index.clear();
+        }
+        if (batch.empty())
+        {
+            return;
+        }
+
+        for (auto &event : batch)
+        {
+            auto latest = m_latest.find(event.key);
+            event.old_value = latest != m_latest.end() ? latest->second : event.value;
+            if (event.kind == DeviceEvent::Kind::Removed)
+            {
+                if (latest != m_latest.end())
+                {
+                    m_latest.erase(latest);
+                }
+            }
+            else
+            {
+                m_latest[event.key] = event.value;
+            }
+        }
+
+        std::vector<std::shared_ptr<Subscriber>> subscribers;
+        {
+            std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+            subscribers = m_subscribers;
+        }
+        for (const auto &subscriber : subscribers)
+        {
+            m_coalesced.fetch_add(offer(*subscriber, batch), std::memory_order_relaxed);
+            schedule(subscriber);
+        }
+    }
+
+    size_t DeviceEventBus::offer(Subscriber &subscriber, const std::vector<DeviceEvent> &events)
+    {
+        // 订阅者上一批还没执行完时，新事件与等待中的事件合并
+        size_t coalesced = 0;
+        std::lock_guard<std::mutex> lock(subscriber.mutex);
+        for (const auto &event : events)
+        {
+            auto [it, inserted] = subscriber.index.try_emplace(event.key, subscriber.pending.size());
+            if (inserted)
+            {
+                subscriber.pending.push_back(event);
+            }
+            else
+            {
+                DeviceEvent copy = event;
+                Merge(subscriber.pending[it->second], std::move(copy));
+                ++coalesced;
+            }
+        }
+        return coalesced;
+    }
+
+    void DeviceEventBus::schedule(const std::shared_ptr<Subscriber> &subscriber)
+    {
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mutex);
+            if (subscriber->scheduled || subscriber->pending.empty())
+            {
+                return;
+            }
+            subscriber->scheduled = true;
+        }
+        // 执行器可能同步运行任务，不能持有锁
+        subscriber->executor([subscriber]()
+                             { drain(subscriber); });
+    }
+
+    void DeviceEventBus::drain(const std::shared_ptr<Subscriber> &subscriber)
+    {
+        std::vector<DeviceEvent> events;
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mutex);
+            events.swap(subscriber->pending);
+            subscriber->index.clear();
+        }
+        if (!events.empty() && subscriber->active.load(std::memory_order_acquire))
+        {
+            try
+            {
+                subscriber->callback(std::span<const DeviceEvent>(events));
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::error("Device event subscriber {} failed: {}", subscriber->id, e.what());
+            }
+            subscriber->delivered->fetch_add(events.size(), std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mutex);
+            subscriber->scheduled = false;
+        }
+        // 执行期间又有新事件，重新提交而不是占住执行器的线程
+        schedule(subscriber);
+    }
+
+    nlohmann::json DeviceEventBus::stats() const
+    {
+        size_t queued;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            queued = m_pending.size();
+        }
+        return {
+            {"published", published()},
+            {"delivered", delivered()},
+            {"coalesced", coalesced()},
+            {"queued", queued},
+            {"subscribers", m_subscriber_count.load(std::memory_order_relaxed)},
+        };
+    }
+} // namespace OpenAPT
@@ -0,0 +1,197 @@
+/*
+ * event_bus.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Asynchronous Device Event Bus
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "property/imessage.hpp"
+#include "thread/threadpool.hpp"
+
+#include "nlohmann/json.hpp"
+
+namespace OpenAPT
+{
+    /**
+     * @brief 设备消息的一次变化
+     *
+     * 新旧值以只读共享指针传递，所有订阅者共享同一份数据。
+     */
+    struct DeviceEvent
+    {
+        enum class Kind
+        {
+            Inserted,
+            Updated,
+            Removed,
+        };
+
+        Kind kind = Kind::Updated;
+        std::string key;                                      ///< 消息名称
+        std::shared_ptr<const Property::IMessage> value;      ///< 新值，删除时为被删除的值
+        std::shared_ptr<const Property::IMessage> old_value;  ///< 订阅者上次看到的值，没有时与 value 相同
+        uint64_t sequence = 0;                                ///< 发布序号
+    };
+
+    /**
+     * @brief 设备事件总线
+     *
+     * 发布者（如 INDI 回调线程）在一个很短的临界区内把事件按消息合并到待分发表中，不会被订阅者阻塞。
+     * 分发线程每个周期换出整张表，再交给各订阅者指定的执行器。每个订阅者同一时刻最多只有
+     * 一批事件在执行，正在执行时到达的更新继续按消息合并，慢订阅者只会看到更少、更新的值，
+     * 而不会积压。待分发表的大小受消息数量限制，不丢弃事件，每条消息的最新值（包括删除）总会送达。
+     */
+    class DeviceEventBus
+    {
+    public:
+        // 执行器：接收一个任务并在某个线程上运行，如线程池或 asio strand
+        using Executor = std::function<void(std::function<void()>)>;
+        using Callback = std::function<void(std::span<const DeviceEvent>)>;
+
+        /**
+         * @param capacity 待分发的消息数达到该值时不等周期结束，立即唤醒分发线程
+         * @param tick 合并周期
+         */
+        explicit DeviceEventBus(size_t capacity = 4096, std::chrono::milliseconds tick = std::chrono::milliseconds(20));
+        ~DeviceEventBus();
+
+        DeviceEventBus(const DeviceEventBus &) = delete;
+        DeviceEventBus &operator=(const DeviceEventBus &) = delete;
+
+        /**
+         * @brief 发布一次变化，只在合并时短暂持锁，不等待订阅者
+         *
+         * 没有订阅者时直接返回，不复制消息。
+         */
+        void publish(DeviceEvent::Kind kind, const Property::IMessage &message);
+
+        /**
+         * @brief 订阅事件
+         *
+         * @param callback 每批合并后的事件调用一次
+         * @param executor 运行回调的执行器，为空时使用总线自带的线程池
+         * @return 订阅编号，用于取消订阅
+         */
+        uint64_t subscribe(Callback callback, Executor executor = nullptr);
+
+        /**
+         * @brief 取消订阅，已经开始执行的一批仍会执行完
+         */
+        void unsubscribe(uint64_t id);
+
+        /**
+         * @brief 立即分发队列中的事件，不等待下一个周期
+         */
+        void flush();
+
+        bool hasSubscribers() const
+        {
+            return m_subscriber_count.load(std::memory_order_acquire) > 0;
+        }
+
+        uint64_t published() const
+        {
+            return m_published.load(std::memory_order_relaxed);
+        }
+
+        uint64_t coalesced() const
+        {
+            return m_coalesced.load(std::memory_order_relaxed);
+        }
+
+        uint64_t delivered() const
+        {
+            return m_delivered->load(std::memory_order_relaxed);
+        }
+
+        nlohmann::json stats() const;
+
+    private:
+        struct Subscriber
+        {
+            uint64_t id = 0;
+            Callback callback;
+            Executor executor;
+            std::mutex mutex;
+            std::vector<DeviceEvent> pending;              ///< 等待投递的事件，按消息合并
+            std::unordered_map<std::string, size_t> index; ///< 消息名到 pending 下标
+            bool scheduled = false;                        ///< 已有一批交给执行器
+            std::atomic_bool active{true};
+            std::shared_ptr<std::atomic_uint64_t> delivered;
+        };
+
+        void run();
+        void dispatch();
+        size_t offer(Subscriber &subscriber, const std::vector<DeviceEvent> &events);
+        static void schedule(const std::shared_ptr<Subscriber> &subscriber);
+        static void drain(const std::shared_ptr<Subscriber> &subscriber);
+        void start();
+
+        // 发布端按消息合并的待分发事件，分发线程每个周期整体换出
+        mutable std::mutex m_pending_mutex;
+        std::vector<DeviceEvent> m_pending;
+        std::unordered_map<std::string, size_t> m_pending_index; ///< 消息名到 m_pending 下标
+        size_t m_capacity;
+        std::chrono::milliseconds m_tick;
+
+        std::mutex m_subscribers_mutex;
+        std::vector<std::shared_ptr<Subscriber>> m_subscribers;
+        std::atomic_size_t m_subscriber_count{0};
+        uint64_t m_next_id = 1;
+
+        // 分发线程独占：每条消息最后一次分发的值，作为下一次的旧值
+        std::unordered_map<std::string, std::shared_ptr<const Property::IMessage>> m_latest;
+        std::mutex m_dispatch_mutex;
+
+        std::unique_ptr<Thread::ThreadPool> m_pool;
+        std::thread m_thread;
+        std::mutex m_wake_mutex;
+        std::condition_variable m_wake;
+        bool m_stop = false;
+        bool m_wake_requested = false;
+
+        uint64_t m_sequence = 0; ///< 由 m_pending_mutex 保护
+        std::atomic_uint64_t m_published{0};
+        std::atomic_uint64_t m_coalesced{0};
+        std::shared_ptr<std::atomic_uint64_t> m_delivered = std::make_shared<std::atomic_uint64_t>(0);
+    };
+} // namespace OpenAPT
@@ -0,0 +1,330 @@
+/*
+ * message_store.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Indexed Device Message Store
+
+**************************************************/
+
+#include "message_store.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace OpenAPT
+{
+    uint64_t DeviceMessageStore::Hash(std::string_view key)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (const char c : key)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    template <typename KeyOf>
+    DeviceMessageStore::Id DeviceMessageStore::Index::find(std::string_view key, uint64_t hash, KeyOf &&key_of) const
+    {
+        if (m_slots.empty())
+        {
+            return kInvalidId;
+        }
+        const size_t mask = m_slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            const Slot &slot = m_slots[i];
+            if (slot.id == kInvalidId)
+            {
+                return kInvalidId;
+            }
+            if (slot.hash == hash && key_of(slot.id) == key)
+            {
+                return slot.id;
+            }
+        }
+    }
+
+    void DeviceMessageStore::Index::insert(uint64_t hash, Id id)
+    {
+        // 负载因子不超过 1/2
+        if ((m_used + 1) * 2 > m_slots.size())
+        {
+            grow();
+        }
+        const size_t mask = m_slots.size() - 1;
+        size_t i = hash & mask;
+        while (m_slots[i].id != kInvalidId)
+        {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = {hash, id};
+        ++m_used;
+    }
+
+    void DeviceMessageStore::Index::erase(uint64_t hash, Id id)
+    {
+        if (m_slots.empty())
+        {
+            return;
+        }
+        const size_t mask = m_slots.size() - 1;
+        size_t i = hash & mask;
+        while (m_slots[i].id != id)
+        {
+            if (m_slots[i].id == kInvalidId)
+            {
+                return;
+            }
+            i = (i + 1) & mask;
+        }
+        // 把探测链上应当位于空位之前的槽位前移
+        for (size_t j = (i + 1) & mask; m_slots[j].id != kInvalidId; j = (j + 1) & mask)
+        {
+            const size_t home = m_slots[j].hash & mask;
+            const bool movable = i <= j ? (home <= i || home > j) : (home <= i && home > j);
+            if (movable)
+            {
+                m_slots[i] = m_slots[j];
+                i = j;
+            }
+        }
+        m_slots[i] = Slot();
+        --m_used;
+    }
+
+    void DeviceMessageStore::Index::grow()
+    {
+        std::vector<Slot> old = std::move(m_slots);
+        m_slots.assign(std::max<size_t>(16, old.size() * 2), Slot());
+        m_used = 0;
+        for (const Slot &slot : old)
+        {
+            if (slot.id != kInvalidId)
+            {
+                insert(slot.hash, slot.id);
+            }
+        }
+    }
+
+    DeviceMessageStore::Id DeviceMessageStore::findByName(std::string_view name) const
+    {
+        return m_names.find(name, Hash(name), [this](Id id) -> std::string_view
+                            { return m_entries[id].key; });
+    }
+
+    DeviceMessageStore::Id DeviceMessageStore::findByUuid(std::string_view uuid) const
+    {
+        return m_uuids.find(uuid, Hash(uuid), [this](Id id) -> std::string_view
+                            { return m_entries[id].info.message.message_uuid; });
+    }
+
+    DeviceMessageStore::Id DeviceMessageStore::lookup(std::string_view identifier) const
+    {
+        // 名称索引包含已删除的条目，UUID 索引只包含现存的
+        Id id = findByName(identifier);
+        if (id != kInvalidId && m_entries[id].alive)
+        {
+            return id;
+        }
+        return findByUuid(identifier);
+    }
+
+    void DeviceMessageStore::indexUuid(Id id)
+    {
+        const std::string &uuid = m_entries[id].info.message.message_uuid;
+        if (!uuid.empty())
+        {
+            m_uuids.insert(Hash(uuid), id);
+        }
+    }
+
+    void DeviceMessageStore::unindexUuid(Id id)
+    {
+        const std::string &uuid = m_entries[id].info.message.message_uuid;
+        if (!uuid.empty())
+        {
+            m_uuids.erase(Hash(uuid), id);
+        }
+    }
+
+    void DeviceMessageStore::touch(Id id)
+    {
+        Entry &entry = m_entries[id];
+        // 从修改链表中摘下（新条目不在链表中），再接到末尾
+        if (entry.prev != kInvalidId)
+        {
+            m_entries[entry.prev].next = entry.next;
+        }
+        else if (m_head == id)
+        {
+            m_head = entry.next;
+        }
+        if (entry.next != kInvalidId)
+        {
+            m_entries[entry.next].prev = entry.prev;
+        }
+        else if (m_tail == id)
+        {
+            m_tail = entry.prev;
+        }
+        entry.prev = m_tail;
+        entry.next = kInvalidId;
+        if (m_tail != kInvalidId)
+        {
+            m_entries[m_tail].next = id;
+        }
+        else
+        {
+            m_head = id;
+        }
+        m_tail = id;
+        entry.generation = ++m_generation;
+    }
+
+    DeviceMessageStore::Id DeviceMessageStore::insert(DeviceMessageInfo info)
+    {
+        const std::string name = info.message.name;
+        Id id = findByName(name);
+        if (id == kInvalidId)
+        {
+            id = static_cast<Id>(m_entries.size());
+            m_entries.emplace_back();
+            m_entries.back().key = name;
+            m_names.insert(Hash(name), id);
+        }
+        Entry &entry = m_entries[id];
+        if (entry.alive)
+        {
+            unindexUuid(id);
+        }
+        else
+        {
+            entry.alive = true;
+            ++m_size;
+        }
+        entry.info = std::move(info);
+        indexUuid(id);
+        touch(id);
+        return id;
+    }
+
+    DeviceMessageInfo *DeviceMessageStore::update(std::string_view identifier, const Property::IMessage &message)
+    {
+        const Id id = lookup(identifier);
+        if (id == kInvalidId)
+        {
+            return nullptr;
+        }
+        Entry &entry = m_entries[id];
+        if (message.name != entry.key)
+        {
+            // 改名相当于删除旧消息再以新名称插入
+            DeviceMessageInfo info{message, entry.info.task};
+            remove(identifier);
+            return get(insert(std::move(info)));
+        }
+        unindexUuid(id);
+        entry.info.message = message;
+        indexUuid(id);
+        touch(id);
+        return &entry.info;
+    }
+
+    bool DeviceMessageStore::remove(std::string_view identifier, Property::IMessage *removed)
+    {
+        const Id id = lookup(identifier);
+        if (id == kInvalidId)
+        {
+            return false;
+        }
+        Entry &entry = m_entries[id];
+        unindexUuid(id);
+        if (removed)
+        {
+            *removed = std::move(entry.info.message);
+        }
+        // 保留墓碑：名称、ID 和修改代数，释放消息和任务
+        entry.info = DeviceMessageInfo();
+        entry.alive = false;
+        --m_size;
+        touch(id);
+        return true;
+    }
+
+    DeviceMessageInfo *DeviceMessageStore::find(std::string_view identifier)
+    {
+        return get(lookup(identifier));
+    }
+
+    const DeviceMessageInfo *DeviceMessageStore::find(std::string_view identifier) const
+    {
+        return get(lookup(identifier));
+    }
+
+    DeviceMessageStore::Id DeviceMessageStore::id(std::string_view identifier) const
+    {
+        return lookup(identifier);
+    }
+
+    DeviceMessageInfo *DeviceMessageStore::get(Id id)
+    {
+        return id < m_entries.size() && m_entries[id].alive ? &m_entries[id].info : nullptr;
+    }
+
+    const DeviceMessageInfo *DeviceMessageStore::get(Id id) const
+    {
+        return id < m_entries.size() && m_entries[id].alive ? &m_entries[id].info : nullptr;
+    }
+
+    uint64_t DeviceMessageStore::generationOf(Id id) const
+    {
+        return id < m_entries.size() ? m_entries[id].generation : 0;
+    }
+
+    DeviceMessageStore::Delta DeviceMessageStore::changedSince(uint64_t generation) const
+    {
+        Delta delta;
+        delta.generation = m_generation;
+        for (Id id = m_tail; id != kInvalidId && m_entries[id].generation > generation; id = m_entries[id].prev)
+        {
+            const Entry &entry = m_entries[id];
+            if (entry.alive)
+            {
+                delta.changed.push_back(&entry.info);
+            }
+            else
+            {
+                delta.removed.push_back(entry.key);
+            }
+        }
+        std::reverse(delta.changed.begin(), delta.changed.end());
+        std::reverse(delta.removed.begin(), delta.removed.end());
+        return delta;
+    }
+} // namespace OpenAPT
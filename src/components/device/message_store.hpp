@@ -0,0 +1,219 @@
+/*
+ * message_store.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Indexed Device Message Store
+
+**************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "property/imessage.hpp"
+#include "task/task.hpp"
+
+namespace OpenAPT
+{
+    /**
+     * @brief 设备消息及其关联的任务
+     */
+    struct DeviceMessageInfo
+    {
+        Property::IMessage message;
+        std::shared_ptr<SimpleTask> task;
+    };
+
+    /**
+     * @brief 按 ID 索引的设备消息存储
+     *
+     * 消息名在第一次插入时驻留为一个小整数 ID，此后不变；同名消息删除后再插入得到同一个 ID。
+     * 条目保存在 deque 中，地址稳定，名称和消息 UUID 各有一个开放寻址哈希索引，查找为 O(1)。
+     * 每次修改递增全局代数并把条目移到修改链表的末尾，changedSince(G) 从链表末尾倒序遍历，
+     * 只访问 G 之后修改过的条目；删除的条目保留为墓碑，增量查询同样可以报告删除。
+     *
+     * 与原来的 vector 一样不是线程安全的，由调用者保证串行访问。
+     */
+    class DeviceMessageStore
+    {
+    public:
+        using Id = uint32_t;
+        static constexpr Id kInvalidId = UINT32_MAX;
+
+        /**
+         * @brief 某一代数之后的变化
+         */
+        struct Delta
+        {
+            uint64_t generation = 0;                    ///< 查询时的代数，作为下一次查询的起点
+            std::vector<const DeviceMessageInfo *> changed; ///< 插入或更新的消息，按修改顺序
+            std::vector<std::string_view> removed;      ///< 被删除的消息名
+        };
+
+        /**
+         * @brief 插入消息，同名消息已存在时替换
+         *
+         * @return 消息的 ID
+         */
+        Id insert(DeviceMessageInfo info);
+
+        /**
+         * @brief 替换消息的值，任务保持不变
+         *
+         * @param identifier 消息名或消息 UUID
+         * @return 消息不存在时返回 nullptr
+         */
+        DeviceMessageInfo *update(std::string_view identifier, const Property::IMessage &message);
+
+        /**
+         * @brief 删除消息
+         *
+         * @param removed 不为空时写入被删除的消息
+         * @return 消息不存在时返回 false
+         */
+        bool remove(std::string_view identifier, Property::IMessage *removed = nullptr);
+
+        /**
+         * @brief 按消息名或消息 UUID 查找
+         */
+        DeviceMessageInfo *find(std::string_view identifier);
+        const DeviceMessageInfo *find(std::string_view identifier) const;
+
+        /**
+         * @brief 按消息名或 UUID 取得 ID，不存在时返回 kInvalidId
+         */
+        Id id(std::string_view identifier) const;
+
+        /**
+         * @brief 按 ID 查找，已删除时返回 nullptr
+         */
+        DeviceMessageInfo *get(Id id);
+        const DeviceMessageInfo *get(Id id) const;
+
+        /**
+         * @brief 某条消息最后一次修改时的代数
+         */
+        uint64_t generationOf(Id id) const;
+
+        /**
+         * @brief 当前代数，每次插入、更新或删除加一
+         */
+        uint64_t generation() const
+        {
+            return m_generation;
+        }
+
+        /**
+         * @brief generation 之后的全部变化，复杂度与变化数量成正比
+         */
+        Delta changedSince(uint64_t generation) const;
+
+        /**
+         * @brief 按 ID 顺序遍历现存的消息，用于完整状态导出
+         */
+        template <typename F>
+        void forEach(F &&visit) const
+        {
+            for (const auto &entry : m_entries)
+            {
+                if (entry.alive)
+                {
+                    visit(entry.info);
+                }
+            }
+        }
+
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+    private:
+        struct Entry
+        {
+            std::string key;      ///< 驻留的消息名
+            DeviceMessageInfo info;
+            uint64_t generation = 0;
+            Id prev = kInvalidId; ///< 修改链表，按代数递增
+            Id next = kInvalidId;
+            bool alive = false;
+        };
+
+        /**
+         * @brief 只保存 (哈希, ID) 的线性探测索引，键从条目中取出比较
+         */
+        class Index
+        {
+        public:
+            template <typename KeyOf>
+            Id find(std::string_view key, uint64_t hash, KeyOf &&key_of) const;
+
+            void insert(uint64_t hash, Id id);
+
+            // 删除时向前移动后续槽位，不留墓碑
+            void erase(uint64_t hash, Id id);
+
+        private:
+            struct Slot
+            {
+                uint64_t hash = 0;
+                Id id = kInvalidId;
+            };
+
+            void grow();
+
+            std::vector<Slot> m_slots;
+            size_t m_used = 0;
+        };
+
+        static uint64_t Hash(std::string_view key);
+
+        Id findByName(std::string_view name) const;
+        Id findByUuid(std::string_view uuid) const;
+        Id lookup(std::string_view identifier) const;
+        void touch(Id id);
+        void indexUuid(Id id);
+        void unindexUuid(Id id);
+
+        std::deque<Entry> m_entries;
+        Index m_names;
+        Index m_uuids;
+        Id m_head = kInvalidId; ///< 最早修改的条目
+        Id m_tail = kInvalidId; ///< 最近修改的条目
+        uint64_t m_generation = 0;
+        size_t m_size = 0;
+    };
+} // namespace OpenAPT
@@ -0,0 +1,357 @@
+/*
+ * telemetry_store.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Telemetry Time-Series Store
+
+**************************************************/
+
+#include "telemetry_store.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace OpenAPT
+{
+    namespace
+    {
+        constexpr int64_t kPeriods[3] = {0, 10000, 60000};
+
+        int64_t ToMillis(TelemetryStore::Clock::time_point time)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+        }
+
+        void Merge(TelemetryPoint &into, const TelemetryPoint &point)
+        {
+            const uint32_t count = into.count + point.count;
+            into.mean += (point.mean - into.mean) * point.count / count;
+            into.min = std::min(into.min, point.min);
+            into.max = std::max(into.max, point.max);
+            into.count = count;
+        }
+    } // namespace
+
+    struct TelemetryStore::Channel
+    {
+        /**
+         * @brief 按时间顺序写入的环形缓冲区，写满后覆盖最旧的点
+         */
+        struct Ring
+        {
+            std::vector<TelemetryPoint> buffer;
+            size_t capacity = 0;
+            size_t head = 0; ///< 最旧的点
+            size_t size = 0;
+
+            void push(const TelemetryPoint &point)
+            {
+                // 逐步增长到容量上限，空通道不占内存
+                if (buffer.size() < capacity)
+                {
+                    if (buffer.size() == buffer.capacity())
+                    {
+                        buffer.reserve(std::min(capacity, std::max<size_t>(64, buffer.size() * 2)));
+                    }
+                    buffer.push_back(point);
+                    ++size;
+                    return;
+                }
+                buffer[head] = point;
+                head = (head + 1) % capacity;
+            }
+
+            const TelemetryPoint &at(size_t i) const
+            {
+                return buffer[(head + i) % buffer.size()];
+            }
+
+            bool full() const
+            {
+                return size == capacity;
+            }
+
+            // 第一个 time >= t 的逻辑下标
+            size_t lowerBound(int64_t t) const
+            {
+                size_t lo = 0;
+                size_t hi = size;
+                while (lo < hi)
+                {
+                    const size_t mid = (lo + hi) / 2;
+                    if (at(mid).time < t)
+                    {
+                        lo = mid + 1;
+                    }
+                    else
+                    {
+                        hi = mid;
+                    }
+                }
+                return lo;
+            }
+        };
+
+        /**
+         * @brief 一层数据：已经封闭的桶和正在累积的桶
+         */
+        struct Tier
+        {
+            int64_t period = 0;
+            Ring ring;
+            TelemetryPoint open;
+            bool has_open = false;
+
+            void add(int64_t time, double value)
+            {
+                const TelemetryPoint point{time, value, value, value, 1};
+                if (period == 0)
+                {
+                    ring.push(point);
+                    return;
+                }
+                const int64_t start = time - ((time % period) + period) % period;
+                if (has_open && open.time == start)
+                {
+                    Merge(open, point);
+                    return;
+                }
+                if (has_open)
+                {
+                    ring.push(open);
+                }
+                open = point;
+                open.time = start;
+                has_open = true;
+            }
+
+            // 没有淘汰过数据，或最旧的点不晚于 from
+            bool covers(int64_t from) const
+            {
+                if (!ring.full())
+                {
+                    return true;
+                }
+                return ring.at(0).time <= from;
+            }
+
+            void collect(int64_t from, int64_t to, std::vector<TelemetryPoint> &points) const
+            {
+                // 桶的结束时间晚于 from 就有一部分落在范围内
+                for (size_t i = ring.lowerBound(from - period + (period ? 1 : 0)); i < ring.size; ++i)
+                {
+                    const TelemetryPoint &point = ring.at(i);
+                    if (point.time > to)
+                    {
+                        return;
+                    }
+                    points.push_back(point);
+                }
+                if (has_open && open.time + period > from && open.time <= to)
+                {
+                    points.push_back(open);
+                }
+            }
+        };
+
+        mutable std::mutex mutex;
+        Tier tiers[3];
+        int64_t last_time = std::numeric_limits<int64_t>::min();
+        TelemetryPoint latest;
+    };
+
+    TelemetryStore::TelemetryStore(size_t raw_capacity, size_t ten_second_capacity, size_t minute_capacity)
+        : m_capacity{std::max<size_t>(1, raw_capacity), std::max<size_t>(1, ten_second_capacity), std::max<size_t>(1, minute_capacity)}
+    {
+    }
+
+    std::shared_ptr<TelemetryStore::Channel> TelemetryStore::find(const std::string &channel) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_channels.find(channel);
+        return it != m_channels.end() ? it->second : nullptr;
+    }
+
+    void TelemetryStore::record(const std::string &channel, double value, Clock::time_point time)
+    {
+        auto entry = find(channel);
+        if (!entry)
+        {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            auto &slot = m_channels[channel];
+            if (!slot)
+            {
+                slot = std::make_shared<Channel>();
+                for (int i = 0; i < 3; ++i)
+                {
+                    slot->tiers[i].period = kPeriods[i];
+                    slot->tiers[i].ring.capacity = m_capacity[i];
+                }
+            }
+            entry = slot;
+        }
+
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        const int64_t t = std::max(ToMillis(time), entry->last_time);
+        entry->last_time = t;
+        for (auto &tier : entry->tiers)
+        {
+            tier.add(t, value);
+        }
+        entry->latest = {t, value, value, value, 1};
+    }
+
+    TelemetrySeries TelemetryStore::query(const std::string &channel, Clock::time_point from_time, Clock::time_point to_time,
+                                          size_t max_points, Resolution resolution) const
+    {
+        TelemetrySeries series;
+        series.channel = channel;
+        const auto entry = find(channel);
+        if (!entry)
+        {
+            return series;
+        }
+        const int64_t from = ToMillis(from_time);
+        const int64_t to = ToMillis(to_time);
+
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (resolution != Resolution::Auto)
+        {
+            const auto &tier = entry->tiers[static_cast<int>(resolution) - 1];
+            tier.collect(from, to, series.points);
+            series.resolution = tier.period;
+        }
+        else
+        {
+            // 最细的、覆盖起始时间且点数不超过上限的一层，都不满足时用最粗的一层
+            for (int i = 0; i < 3; ++i)
+            {
+                const auto &tier = entry->tiers[i];
+                if (i < 2 && !tier.covers(from))
+                {
+                    continue;
+                }
+                series.points.clear();
+                tier.collect(from, to, series.points);
+                series.resolution = tier.period;
+                if (max_points == 0 || series.points.size() <= max_points)
+                {
+                    break;
+                }
+            }
+        }
+
+        // 仍然超过上限时把相邻的点合并
+        if (max_points > 0 && series.points.size() > max_points)
+        {
+            const size_t group = (series.points.size() + max_points - 1) / max_points;
+            std::vector<TelemetryPoint> merged;
+            merged.reserve(max_points);
+            for (size_t i = 0; i < series.points.size(); i += group)
+            {
+                TelemetryPoint point = series.points[i];
+                for (size_t j = i + 1; j < std::min(i + group, series.points.size()); ++j)
+                {
+                    Merge(point, series.points[j]);
+                }
+                merged.push_back(point);
+            }
+            series.resolution = series.resolution ? series.resolution * static_cast<int64_t>(group)
+                                                  : (series.points.back().time - series.points.front().time) / static_cast<int64_t>(merged.size());
+            series.points = std::move(merged);
+        }
+        return series;
+    }
+
+    TelemetrySeries TelemetryStore::recent(const std::string &channel, std::chrono::milliseconds duration, size_t max_points) const
+    {
+        const auto now = Clock::now();
+        return query(channel, now - duration, now, max_points);
+    }
+
+    TelemetryPoint TelemetryStore::latest(const std::string &channel) const
+    {
+        const auto entry = find(channel);
+        if (!entry)
+        {
+            return {};
+        }
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        return entry->latest;
+    }
+
+    std::vector<std::string> TelemetryStore::channels() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::vector<std::string> names;
+        names.reserve(m_channels.size());
+        for (const auto &[name, channel] : m_channels)
+        {
+            names.push_back(name);
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    size_t TelemetryStore::memoryUsage() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        size_t bytes = 0;
+        for (const auto &[name, channel] : m_channels)
+        {
+            std::lock_guard<std::mutex> channel_lock(channel->mutex);
+            for (const auto &tier : channel->tiers)
+            {
+                bytes += tier.ring.buffer.capacity() * sizeof(TelemetryPoint);
+            }
+        }
+        return bytes;
+    }
+
+    nlohmann::json TelemetrySeries::toJson() const
+    {
+        // 列式输出，比逐点的对象小得多
+        nlohmann::json time = nlohmann::json::array();
+        nlohmann::json mean = nlohmann::json::array();
+        nlohmann::json min = nlohmann::json::array();
+        nlohmann::json max = nlohmann::json::array();
+        for (const auto &point : points)
+        {
+            time.push_back(point.time);
+            mean.push_back(point.mean);
+            min.push_back(point.min);
+            max.push_back(point.max);
+        }
+        return {
+            {"channel", channel},
+            {"resolution", resolution},
+            {"time", std::move(time)},
+            {"mean", std::move(mean)},
+            {"min", std::move(min)},
+            {"max", std::move(max)},
+        };
+    }
+} // namespace OpenAPT
@@ -0,0 +1,136 @@
+/*
+ * telemetry_store.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Telemetry Time-Series Store
+
+**************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+namespace OpenAPT
+{
+    /**
+     * @brief 一个时间点上的聚合值，原始样本的 min、max、mean 相同
+     */
+    struct TelemetryPoint
+    {
+        int64_t time = 0; ///< 毫秒级 Unix 时间，聚合点为桶的起始时间
+        double mean = 0;
+        double min = 0;
+        double max = 0;
+        uint32_t count = 0;
+    };
+
+    /**
+     * @brief 范围查询的结果
+     */
+    struct TelemetrySeries
+    {
+        std::string channel;
+        int64_t resolution = 0; ///< 每个点覆盖的毫秒数，原始数据为 0
+        std::vector<TelemetryPoint> points;
+
+        nlohmann::json toJson() const;
+    };
+
+    /**
+     * @brief 设备遥测的时间序列存储
+     *
+     * 每个通道（例如 "CCD Simulator.temperature"）有三层固定大小的环形缓冲区：原始样本、10 秒和 1 分钟
+     * 聚合（min / max / mean），写入时同时更新三层，内存占用与运行时间无关。默认容量下原始样本约
+     * 覆盖最近一小时（1 Hz），10 秒层覆盖 12 小时，1 分钟层覆盖 24 小时。
+     *
+     * 查询时自动选择覆盖起始时间、且点数不超过上限的最细一层，仍然超过时把相邻的点合并。
+     * 每个通道有自己的锁，驱动线程写入和客户端查询只在同一通道上竞争。
+     */
+    class TelemetryStore
+    {
+    public:
+        using Clock = std::chrono::system_clock;
+
+        enum class Resolution
+        {
+            Auto,
+            Raw,
+            TenSeconds,
+            OneMinute,
+        };
+
+        explicit TelemetryStore(size_t raw_capacity = 4096, size_t ten_second_capacity = 4320, size_t minute_capacity = 1440);
+
+        /**
+         * @brief 写入一个样本，时间早于通道最后一个样本时按最后一个样本的时间处理
+         */
+        void record(const std::string &channel, double value, Clock::time_point time = Clock::now());
+
+        /**
+         * @brief 查询 [from, to] 之间的数据
+         *
+         * @param max_points 返回点数的上限，0 表示不限制
+         */
+        TelemetrySeries query(const std::string &channel, Clock::time_point from, Clock::time_point to,
+                              size_t max_points = 500, Resolution resolution = Resolution::Auto) const;
+
+        /**
+         * @brief 最近 duration 时间内的数据
+         */
+        TelemetrySeries recent(const std::string &channel, std::chrono::milliseconds duration, size_t max_points = 500) const;
+
+        /**
+         * @brief 通道最后一个样本，通道不存在时 count 为 0
+         */
+        TelemetryPoint latest(const std::string &channel) const;
+
+        std::vector<std::string> channels() const;
+
+        /**
+         * @brief 全部通道已分配的字节数
+         */
+        size_t memoryUsage() const;
+
+    private:
+        struct Channel;
+
+        std::shared_ptr<Channel> find(const std::string &channel) const;
+
+        size_t m_capacity[3];
+
+        mutable std::shared_mutex m_mutex; ///< 保护通道表，通道内部有自己的锁
+        std::unordered_map<std::string, std::shared_ptr<Channel>> m_channels;
+    };
+} // namespace OpenAPT
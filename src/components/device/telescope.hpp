@@ -33,6 +33,8 @@ Description: Basic Telescope Defination
 
 #include "device.hpp"
 
+#include "astro/coordinates.hpp"
+
 class Telescope : public virtual Device
 {
 public:
@@ -57,6 +59,14 @@ protected:
      */
     virtual bool SlewTo(const nlohmann::json &params) = 0;
 
+    /**
+     * @brief 指向新目标（类型化坐标）
+     * @param target 目标坐标（度）
+     * @param j2000 坐标是否为 J2000，为 true 时在发送前转换为 JNow
+     * @return 是否成功指向新目标
+     */
+    virtual bool SlewTo(const OpenAPT::Astro::Equatorial &target, const bool j2000 = false) = 0;
+
     /**
      * @brief 中止望远镜的指向
      * @return 是否成功中止指向
@@ -70,16 +80,11 @@ protected:
     virtual bool isSlewing(const nlohmann::json &params) = 0;
 
     /**
-     * @brief 获取当前赤经位置
-     * @return 当前赤经位置
-     */
-    virtual std::string getCurrentRA(const nlohmann::json &params) = 0;
-
-    /**
-     * @brief 获取当前赤纬位置
-     * @return 当前赤纬位置
+     * @brief 获取当前指向位置
+     * @param j2000 是否返回 J2000 坐标，默认返回 JNow
+     * @return 当前赤经赤纬（度），需要字符串时使用 raString()/decString()
      */
-    virtual std::string getCurrentDec(const nlohmann::json &params) = 0;
+    virtual OpenAPT::Astro::Equatorial getCurrentCoordinates(const bool j2000 = false) = 0;
 
     /**
      * @brief 开始跟踪运动目标
@@ -0,0 +1,1088 @@
+/*
+ * indi_simulator.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-18
+
+Description: Lightweight INDI Protocol Simulator
+
+**************************************************/
+
+#include "indi_simulator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <set>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "pugixml/pugixml.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT
+{
+    using boost::asio::ip::tcp;
+
+    namespace
+    {
+        enum class Kind
+        {
+            Number,
+            Switch,
+            Text,
+            Blob
+        };
+
+        enum class BlobMode
+        {
+            Never,
+            Also,
+            Only
+        };
+
+        struct Element
+        {
+            std::string name;
+            double value = 0;
+            double min = 0;
+            double max = 0;
+            bool on = false;
+            std::string text{};
+        };
+
+        struct Property
+        {
+            std::string device;
+            std::string name;
+            std::string group;
+            Kind kind = Kind::Number;
+            std::string state = "Idle";
+            std::string perm = "rw";
+            std::string rule = "OneOfMany";
+            std::vector<Element> elements;
+
+            Element *find(std::string_view element)
+            {
+                for (auto &e : elements)
+                {
+                    if (e.name == element)
+                    {
+                        return &e;
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        const char *KindName(Kind kind)
+        {
+            switch (kind)
+            {
+            case Kind::Number:
+                return "Number";
+            case Kind::Switch:
+                return "Switch";
+            case Kind::Text:
+                return "Text";
+            default:
+                return "BLOB";
+            }
+        }
+
+        std::string Timestamp()
+        {
+            const std::time_t now = std::time(nullptr);
+            std::tm utc{};
+            gmtime_r(&now, &utc);
+            char text[32];
+            std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &utc);
+            return text;
+        }
+
+        void AppendEscaped(fmt::memory_buffer &out, std::string_view text)
+        {
+            for (const char c : text)
+            {
+                switch (c)
+                {
+                case '&':
+                    out.append(std::string_view("&amp;"));
+                    break;
+                case '<':
+                    out.append(std::string_view("&lt;"));
+                    break;
+                case '>':
+                    out.append(std::string_view("&gt;"));
+                    break;
+                case '"':
+                    out.append(std::string_view("&quot;"));
+                    break;
+                default:
+                    out.push_back(c);
+                }
+            }
+        }
+
+        std::string DefineXml(const Property &p)
+        {
+            fmt::memory_buffer out;
+            auto it = std::back_inserter(out);
+            const char *kind = KindName(p.kind);
+            fmt::format_to(it, "<def{}Vector device=\"{}\" name=\"{}\" label=\"{}\" group=\"{}\" state=\"{}\" perm=\"{}\"",
+                           kind, p.device, p.name, p.name, p.group, p.state, p.perm);
+            if (p.kind == Kind::Switch)
+            {
+                fmt::format_to(it, " rule=\"{}\"", p.rule);
+            }
+            fmt::format_to(it, " timeout=\"60\" timestamp=\"{}\">\n", Timestamp());
+            for (const auto &e : p.elements)
+            {
+                switch (p.kind)
+                {
+                case Kind::Number:
+                    fmt::format_to(it, "  <defNumber name=\"{0}\" label=\"{0}\" format=\"%g\" min=\"{1}\" max=\"{2}\" step=\"0\">{3}</defNumber>\n",
+                                   e.name, e.min, e.max, e.value);
+                    break;
+                case Kind::Switch:
+                    fmt::format_to(it, "  <defSwitch name=\"{0}\" label=\"{0}\">{1}</defSwitch>\n", e.name, e.on ? "On" : "Off");
+                    break;
+                case Kind::Text:
+                    fmt::format_to(it, "  <defText name=\"{0}\" label=\"{0}\">", e.name);
+                    AppendEscaped(out, e.text);
+                    out.append(std::string_view("</defText>\n"));
+                    break;
+                case Kind::Blob:
+                    fmt::format_to(it, "  <defBLOB name=\"{0}\" label=\"{0}\"/>\n", e.name);
+                    break;
+                }
+            }
+            fmt::format_to(it, "</def{}Vector>\n", kind);
+            return fmt::to_string(out);
+        }
+
+        std::string SetXml(const Property &p)
+        {
+            fmt::memory_buffer out;
+            auto it = std::back_inserter(out);
+            const char *kind = KindName(p.kind);
+            fmt::format_to(it, "<set{}Vector device=\"{}\" name=\"{}\" state=\"{}\" timeout=\"60\" timestamp=\"{}\">\n",
+                           kind, p.device, p.name, p.state, Timestamp());
+            for (const auto &e : p.elements)
+            {
+                switch (p.kind)
+                {
+                case Kind::Number:
+                    fmt::format_to(it, "  <oneNumber name=\"{}\">{}</oneNumber>\n", e.name, e.value);
+                    break;
+                case Kind::Switch:
+                    fmt::format_to(it, "  <oneSwitch name=\"{}\">{}</oneSwitch>\n", e.name, e.on ? "On" : "Off");
+                    break;
+                case Kind::Text:
+                    fmt::format_to(it, "  <oneText name=\"{}\">", e.name);
+                    AppendEscaped(out, e.text);
+                    out.append(std::string_view("</oneText>\n"));
+                    break;
+                case Kind::Blob:
+                    break;
+                }
+            }
+            fmt::format_to(it, "</set{}Vector>\n", kind);
+            return fmt::to_string(out);
+        }
+
+        constexpr char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        void Base64Encode(const uint8_t *in, size_t size, std::string &out)
+        {
+            out.resize((size + 2) / 3 * 4);
+            char *dst = out.data();
+            size_t i = 0;
+            for (; i + 3 <= size; i += 3)
+            {
+                const uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+                *dst++ = kBase64[(v >> 18) & 63];
+                *dst++ = kBase64[(v >> 12) & 63];
+                *dst++ = kBase64[(v >> 6) & 63];
+                *dst++ = kBase64[v & 63];
+            }
+            if (i < size)
+            {
+                const uint32_t v = (in[i] << 16) | (i + 1 < size ? in[i + 1] << 8 : 0);
+                *dst++ = kBase64[(v >> 18) & 63];
+                *dst++ = kBase64[(v >> 12) & 63];
+                *dst++ = i + 1 < size ? kBase64[(v >> 6) & 63] : '=';
+                *dst++ = '=';
+            }
+        }
+
+        // 前 9 字节（8 字节时间戳 + 1 字节像素）恰好编码为 12 个字符
+        constexpr size_t kStampBytes = 9;
+        constexpr size_t kStampChars = 12;
+
+        /**
+         * @brief 从缓冲区开头取出一个完整的顶层元素
+         *
+         * 客户端消息之间没有根元素，也不会嵌套同名元素，找到匹配的结束标签即可。
+         */
+        bool NextElement(const std::string &inbox, size_t from, size_t &begin, size_t &end)
+        {
+            size_t pos = from;
+            while (true)
+            {
+                pos = inbox.find('<', pos);
+                if (pos == std::string::npos || pos + 1 >= inbox.size())
+                {
+                    return false;
+                }
+                if (inbox[pos + 1] == '?' || inbox[pos + 1] == '!')
+                {
+                    const size_t close = inbox.find('>', pos);
+                    if (close == std::string::npos)
+                    {
+                        return false;
+                    }
+                    pos = close + 1;
+                    continue;
+                }
+                break;
+            }
+            const size_t name_end = inbox.find_first_of(" \t\r\n/>", pos + 1);
+            const size_t tag_end = inbox.find('>', pos);
+            if (name_end == std::string::npos || tag_end == std::string::npos)
+            {
+                return false;
+            }
+            begin = pos;
+            if (inbox[tag_end - 1] == '/')
+            {
+                end = tag_end + 1;
+                return true;
+            }
+            const std::string closing = "</" + inbox.substr(pos + 1, name_end - pos - 1);
+            const size_t close = inbox.find(closing, tag_end);
+            if (close == std::string::npos)
+            {
+                return false;
+            }
+            const size_t close_end = inbox.find('>', close);
+            if (close_end == std::string::npos)
+            {
+                return false;
+            }
+            end = close_end + 1;
+            return true;
+        }
+    } // namespace
+
+    struct IndiSimulator::Impl
+    {
+        struct Outgoing
+        {
+            std::string head;
+            std::shared_ptr<const std::string> body{}; ///< BLOB 正文，各帧共享
+            size_t offset = 0;
+            std::string tail{};
+
+            size_t size() const
+            {
+                return head.size() + (body ? body->size() - offset : 0) + tail.size();
+            }
+        };
+
+        struct Session : std::enable_shared_from_this<Session>
+        {
+            Session(Impl &owner, tcp::socket socket) : owner(owner), socket(std::move(socket)) {}
+
+            Impl &owner;
+            tcp::socket socket;
+            std::array<char, 8192> buffer;
+            std::string inbox;
+            std::deque<Outgoing> queue;
+            size_t queued_bytes = 0;
+            bool writing = false;
+            bool closed = false;
+            std::set<std::string> devices; ///< getProperties 指定的设备，空表示全部
+            std::map<std::string, BlobMode> blob_modes;
+
+            bool watches(const std::string &device) const
+            {
+                return devices.empty() || devices.count(device);
+            }
+
+            BlobMode blobMode(const std::string &device) const
+            {
+                auto it = blob_modes.find(device);
+                return it == blob_modes.end() ? BlobMode::Never : it->second;
+            }
+
+            void read()
+            {
+                socket.async_read_some(boost::asio::buffer(buffer), [self = shared_from_this()](boost::system::error_code ec, size_t n)
+                                       {
+                    if (ec)
+                    {
+                        self->close();
+                        return;
+                    }
+                    self->inbox.append(self->buffer.data(), n);
+                    self->owner.consume(*self);
+                    if (!self->closed)
+                    {
+                        self->read();
+                    } });
+            }
+
+            void send(Outgoing message)
+            {
+                if (closed)
+                {
+                    return;
+                }
+                queued_bytes += message.size();
+                queue.push_back(std::move(message));
+                if (!writing)
+                {
+                    write();
+                }
+            }
+
+            void write()
+            {
+                writing = true;
+                const Outgoing &front = queue.front();
+                std::array<boost::asio::const_buffer, 3> buffers{
+                    boost::asio::buffer(front.head),
+                    front.body ? boost::asio::buffer(front.body->data() + front.offset, front.body->size() - front.offset)
+                               : boost::asio::const_buffer(),
+                    boost::asio::buffer(front.tail)};
+                boost::asio::async_write(socket, buffers, [self = shared_from_this()](boost::system::error_code ec, size_t n)
+                                         {
+                    if (ec)
+                    {
+                        self->close();
+                        return;
+                    }
+                    self->owner.bytes_sent.fetch_add(n, std::memory_order_relaxed);
+                    self->queued_bytes -= self->queue.front().size();
+                    self->queue.pop_front();
+                    if (self->queue.empty())
+                    {
+                        self->writing = false;
+                    }
+                    else
+                    {
+                        self->write();
+                    } });
+            }
+
+            void close()
+            {
+                if (closed)
+                {
+                    return;
+                }
+                closed = true;
+                boost::system::error_code ignored;
+                socket.shutdown(tcp::socket::shutdown_both, ignored);
+                socket.close(ignored);
+                owner.removeSession(this);
+            }
+        };
+
+        explicit Impl(IndiSimulatorSettings settings)
+            : settings(std::move(settings)), acceptor(io), storm_timer(io), video_timer(io), exposure_timer(io),
+              focuser_timer(io), telescope_timer(io)
+        {
+            buildDevices();
+            buildPayload();
+        }
+
+        IndiSimulatorSettings settings;
+        boost::asio::io_context io;
+        tcp::acceptor acceptor;
+        std::thread thread;
+        std::vector<std::shared_ptr<Session>> sessions;
+        std::map<std::pair<std::string, std::string>, Property> properties;
+        std::vector<std::pair<std::string, std::string>> order; ///< 定义顺序，getProperties 按此发送
+
+        boost::asio::steady_timer storm_timer;
+        boost::asio::steady_timer video_timer;
+        boost::asio::steady_timer exposure_timer;
+        boost::asio::steady_timer focuser_timer;
+        boost::asio::steady_timer telescope_timer;
+
+        std::vector<uint8_t> payload;
+        std::shared_ptr<const std::string> payload_base64;
+
+        // 定时器取消时已在队列中的回调仍会以成功状态执行，用代数区分新旧定时链
+        uint64_t storm_generation = 0;
+        uint64_t video_generation = 0;
+
+        double storm_rate = 0;
+        uint64_t storm_sent = 0;
+        std::chrono::steady_clock::time_point storm_started;
+        bool video_running = false;
+        std::chrono::steady_clock::time_point exposure_end;
+        double focuser_target = 0;
+        double ra_target = 0;
+        double dec_target = 0;
+
+        std::atomic_int bound_port{0};
+        std::atomic_uint64_t connections{0};
+        std::atomic_uint64_t blobs_sent{0};
+        std::atomic_uint64_t blobs_dropped{0};
+        std::atomic_uint64_t updates_sent{0};
+        std::atomic_uint64_t updates_dropped{0};
+        std::atomic_uint64_t bytes_sent{0};
+
+        Property &add(const std::string &device, const std::string &name, const std::string &group, Kind kind,
+                      std::vector<Element> elements, const std::string &perm = "rw")
+        {
+            Property p;
+            p.device = device;
+            p.name = name;
+            p.group = group;
+            p.kind = kind;
+            p.perm = perm;
+            p.elements = std::move(elements);
+            order.emplace_back(device, name);
+            return properties[{device, name}] = std::move(p);
+        }
+
+        Property *find(const std::string &device, const std::string &name)
+        {
+            auto it = properties.find({device, name});
+            return it == properties.end() ? nullptr : &it->second;
+        }
+
+        void addCommon(const std::string &device, const std::string &exec, int interface)
+        {
+            add(device, "CONNECTION", "Main Control", Kind::Switch, {{"CONNECT"}, {"DISCONNECT", 0, 0, 0, true}});
+            add(device, "DRIVER_INFO", "General Info", Kind::Text,
+                {{"DRIVER_NAME", 0, 0, 0, false, device}, {"DRIVER_EXEC", 0, 0, 0, false, exec}, {"DRIVER_VERSION", 0, 0, 0, false, "1.0"}, {"DRIVER_INTERFACE", 0, 0, 0, false, std::to_string(interface)}},
+                "ro");
+            add(device, "DEVICE_PORT", "Options", Kind::Text, {{"PORT", 0, 0, 0, false, "/dev/null"}});
+        }
+
+        void buildDevices()
+        {
+            const auto &cam = settings.camera;
+            addCommon(cam, "indi_simulator_ccd", 2);
+            add(cam, "CCD_EXPOSURE", "Main Control", Kind::Number, {{"CCD_EXPOSURE_VALUE", 1, 0, 3600}});
+            add(cam, "CCD_ABORT_EXPOSURE", "Main Control", Kind::Switch, {{"ABORT"}});
+            add(cam, "CCD_FRAME", "Image Settings", Kind::Number,
+                {{"X", 0, 0, double(settings.width)}, {"Y", 0, 0, double(settings.height)}, {"WIDTH", double(settings.width), 1, double(settings.width)}, {"HEIGHT", double(settings.height), 1, double(settings.height)}});
+            add(cam, "CCD_BINNING", "Image Settings", Kind::Number, {{"HOR_BIN", 1, 1, 4}, {"VER_BIN", 1, 1, 4}});
+            add(cam, "CCD_INFO", "Image Info", Kind::Number,
+                {{"CCD_MAX_X", double(settings.width), 0, 16000}, {"CCD_MAX_Y", double(settings.height), 0, 16000}, {"CCD_PIXEL_SIZE", 3.76, 0, 40}, {"CCD_PIXEL_SIZE_X", 3.76, 0, 40}, {"CCD_PIXEL_SIZE_Y", 3.76, 0, 40}, {"CCD_BITSPERPIXEL", double(settings.bit_depth), 8, 64}},
+                "ro");
+            add(cam, "CCD_TEMPERATURE", "Main Control", Kind::Number, {{"CCD_TEMPERATURE_VALUE", -10, -50, 50}});
+            add(cam, "CCD_VIDEO_STREAM", "Streaming", Kind::Switch, {{"STREAM_ON"}, {"STREAM_OFF", 0, 0, 0, true}});
+            add(cam, "CCD1", "Image Info", Kind::Blob, {{"CCD1"}}, "ro");
+
+            const auto &foc = settings.focuser;
+            addCommon(foc, "indi_simulator_focus", 8);
+            add(foc, "ABS_FOCUS_POSITION", "Main Control", Kind::Number, {{"FOCUS_ABSOLUTE_POSITION", 50000, 0, 100000}});
+            add(foc, "FOCUS_MOTION", "Main Control", Kind::Switch, {{"FOCUS_INWARD", 0, 0, 0, true}, {"FOCUS_OUTWARD"}});
+            add(foc, "FOCUS_SPEED", "Main Control", Kind::Number, {{"FOCUS_SPEED_VALUE", 1, 0, 10}});
+            add(foc, "FOCUS_MAX", "Main Control", Kind::Number, {{"FOCUS_MAX_VALUE", 100000, 0, 100000}});
+            add(foc, "FOCUS_TEMPERATURE", "Main Control", Kind::Number, {{"TEMPERATURE", 10, -50, 70}}, "ro");
+            add(foc, "FOCUS_ABORT_MOTION", "Main Control", Kind::Switch, {{"ABORT"}});
+
+            const auto &tel = settings.telescope;
+            addCommon(tel, "indi_simulator_telescope", 5);
+            add(tel, "EQUATORIAL_EOD_COORD", "Main Control", Kind::Number, {{"RA", 0, 0, 24}, {"DEC", 90, -90, 90}});
+            add(tel, "ON_COORD_SET", "Main Control", Kind::Switch, {{"TRACK", 0, 0, 0, true}, {"SLEW"}, {"SYNC"}});
+            add(tel, "TELESCOPE_ABORT_MOTION", "Main Control", Kind::Switch, {{"ABORT"}});
+        }
+
+        void buildPayload()
+        {
+            const size_t size = std::max<size_t>(kStampBytes, size_t(settings.width) * settings.height * settings.bit_depth / 8);
+            payload.resize(size);
+            // 带渐变的噪声，接近真实图像的熵，避免压缩或缓存使结果失真
+            uint32_t state = 2463534242u;
+            for (size_t i = 0; i < size; ++i)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                payload[i] = static_cast<uint8_t>((state & 0x1f) + (i * 97 / size));
+            }
+            auto encoded = std::make_shared<std::string>();
+            Base64Encode(payload.data(), payload.size(), *encoded);
+            payload_base64 = std::move(encoded);
+        }
+
+        void accept()
+        {
+            acceptor.async_accept([this](boost::system::error_code ec, tcp::socket socket)
+                                  {
+                if (ec)
+                {
+                    return;
+                }
+                socket.set_option(tcp::no_delay(true));
+                auto session = std::make_shared<Session>(*this, std::move(socket));
+                sessions.push_back(session);
+                connections.fetch_add(1, std::memory_order_relaxed);
+                session->read();
+                accept(); });
+        }
+
+        void removeSession(Session *session)
+        {
+            sessions.erase(std::remove_if(sessions.begin(), sessions.end(), [session](const auto &s)
+                                          { return s.get() == session; }),
+                           sessions.end());
+        }
+
+        void consume(Session &session)
+        {
+            size_t from = 0, begin = 0, end = 0;
+            while (!session.closed && NextElement(session.inbox, from, begin, end))
+            {
+                pugi::xml_document doc;
+                if (doc.load_buffer(session.inbox.data() + begin, end - begin))
+                {
+                    handle(session, doc.first_child());
+                }
+                else
+                {
+                    spdlog::warn("INDI simulator ignored malformed message");
+                }
+                from = end;
+            }
+            session.inbox.erase(0, from);
+            if (session.inbox.size() > (1 << 20))
+            {
+                spdlog::warn("INDI simulator dropped a client sending an unterminated element");
+                session.close();
+            }
+        }
+
+        void handle(Session &session, const pugi::xml_node &node)
+        {
+            const std::string_view tag = node.name();
+            const std::string device = node.attribute("device").as_string();
+            const std::string name = node.attribute("name").as_string();
+            if (tag == "getProperties")
+            {
+                if (!device.empty())
+                {
+                    session.devices.insert(device);
+                }
+                for (const auto &key : order)
+                {
+                    if ((device.empty() || key.first == device) && (name.empty() || key.second == name))
+                    {
+                        session.send({DefineXml(properties[key])});
+                    }
+                }
+            }
+            else if (tag == "enableBLOB")
+            {
+                const std::string_view mode = node.child_value();
+                session.blob_modes[device] = mode.find("Only") != std::string_view::npos   ? BlobMode::Only
+                                             : mode.find("Also") != std::string_view::npos ? BlobMode::Also
+                                                                                           : BlobMode::Never;
+            }
+            else if (tag == "newNumberVector" || tag == "newSwitchVector" || tag == "newTextVector")
+            {
+                Property *property = find(device, name);
+                if (!property)
+                {
+                    return;
+                }
+                if (property->kind == Kind::Switch)
+                {
+                    newSwitch(*property, node);
+                }
+                else if (property->kind == Kind::Number)
+                {
+                    newNumber(*property, node);
+                }
+                else
+                {
+                    for (auto one : node.children())
+                    {
+                        if (Element *e = property->find(one.attribute("name").as_string()))
+                        {
+                            e->text = one.child_value();
+                        }
+                    }
+                    property->state = "Ok";
+                    broadcast(*property);
+                }
+            }
+        }
+
+        void newSwitch(Property &property, const pugi::xml_node &node)
+        {
+            for (auto one : node.children())
+            {
+                Element *e = property.find(one.attribute("name").as_string());
+                if (!e)
+                {
+                    continue;
+                }
+                const bool on = std::string_view(one.child_value()).find("On") != std::string_view::npos;
+                if (on && property.rule == "OneOfMany")
+                {
+                    for (auto &other : property.elements)
+                    {
+                        other.on = false;
+                    }
+                }
+                e->on = on;
+            }
+            property.state = "Ok";
+
+            const bool camera = property.device == settings.camera;
+            if (camera && property.name == "CCD_VIDEO_STREAM")
+            {
+                property.find("STREAM_ON")->on ? startVideo() : stopVideo();
+            }
+            else if (camera && property.name == "CCD_ABORT_EXPOSURE")
+            {
+                exposure_timer.cancel();
+                Property &exposure = properties[{settings.camera, "CCD_EXPOSURE"}];
+                exposure.state = "Alert";
+                broadcast(exposure);
+            }
+            else if (property.name == "FOCUS_ABORT_MOTION")
+            {
+                focuser_timer.cancel();
+            }
+            else if (property.name == "TELESCOPE_ABORT_MOTION")
+            {
+                telescope_timer.cancel();
+            }
+            broadcast(property);
+        }
+
+        void newNumber(Property &property, const pugi::xml_node &node)
+        {
+            std::map<std::string, double> values;
+            for (auto one : node.children())
+            {
+                values[one.attribute("name").as_string()] = std::atof(one.child_value());
+            }
+            const auto value = [&values](const char *name, double fallback)
+            {
+                auto it = values.find(name);
+                return it == values.end() ? fallback : it->second;
+            };
+
+            if (property.device == settings.camera && property.name == "CCD_EXPOSURE")
+            {
+                startExposure(value("CCD_EXPOSURE_VALUE", 1));
+                return;
+            }
+            if (property.device == settings.focuser && property.name == "ABS_FOCUS_POSITION")
+            {
+                focuser_target = value("FOCUS_ABSOLUTE_POSITION", property.elements[0].value);
+                property.state = "Busy";
+                broadcast(property);
+                moveFocuser();
+                return;
+            }
+            if (property.device == settings.telescope && property.name == "EQUATORIAL_EOD_COORD")
+            {
+                ra_target = value("RA", property.elements[0].value);
+                dec_target = value("DEC", property.elements[1].value);
+                Property *coord_set = find(settings.telescope, "ON_COORD_SET");
+                if (coord_set && coord_set->find("SYNC")->on)
+                {
+                    property.elements[0].value = ra_target;
+                    property.elements[1].value = dec_target;
+                    property.state = "Ok";
+                    broadcast(property);
+                    return;
+                }
+                property.state = "Busy";
+                broadcast(property);
+                slewTelescope();
+                return;
+            }
+            for (auto &e : property.elements)
+            {
+                e.value = value(e.name.c_str(), e.value);
+            }
+            property.state = "Ok";
+            broadcast(property);
+        }
+
+        void startExposure(double duration)
+        {
+            Property &exposure = properties[{settings.camera, "CCD_EXPOSURE"}];
+            exposure.elements[0].value = duration;
+            exposure.state = "Busy";
+            broadcast(exposure);
+            exposure_end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(duration));
+            tickExposure();
+        }
+
+        void tickExposure()
+        {
+            const auto now = std::chrono::steady_clock::now();
+            Property &exposure = properties[{settings.camera, "CCD_EXPOSURE"}];
+            if (now >= exposure_end)
+            {
+                exposure.elements[0].value = 0;
+                exposure.state = "Ok";
+                broadcast(exposure);
+                emitBlob();
+                return;
+            }
+            // 与 INDI 模拟器相同，曝光中约每 0.1 秒上报剩余时间
+            const double remaining = std::chrono::duration<double>(exposure_end - now).count();
+            if (exposure.elements[0].value - remaining >= 0.1)
+            {
+                exposure.elements[0].value = remaining;
+                broadcast(exposure);
+            }
+            exposure_timer.expires_at(std::min(exposure_end, now + std::chrono::milliseconds(100)));
+            exposure_timer.async_wait([this](boost::system::error_code ec)
+                                      {
+                if (!ec)
+                {
+                    tickExposure();
+                } });
+        }
+
+        void startVideo()
+        {
+            if (video_running || settings.video_fps <= 0)
+            {
+                return;
+            }
+            video_running = true;
+            video_timer.expires_after(std::chrono::seconds(0));
+            tickVideo(++video_generation);
+        }
+
+        void stopVideo()
+        {
+            video_running = false;
+            ++video_generation;
+            video_timer.cancel();
+        }
+
+        void tickVideo(uint64_t generation)
+        {
+            // 按绝对时刻递推，帧率不受发送耗时影响
+            const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / settings.video_fps));
+            video_timer.expires_at(video_timer.expiry() + period);
+            video_timer.async_wait([this, generation](boost::system::error_code ec)
+                                   {
+                if (ec || generation != video_generation)
+                {
+                    return;
+                }
+                emitBlob();
+                tickVideo(generation); });
+        }
+
+        void moveFocuser()
+        {
+            Property &position = properties[{settings.focuser, "ABS_FOCUS_POSITION"}];
+            double &current = position.elements[0].value;
+            const double step = settings.focuser_speed * settings.motion_interval;
+            if (std::abs(focuser_target - current) <= step)
+            {
+                current = focuser_target;
+                position.state = "Ok";
+                broadcast(position);
+                return;
+            }
+            current += focuser_target > current ? step : -step;
+            broadcast(position);
+            focuser_timer.expires_after(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(settings.motion_interval)));
+            focuser_timer.async_wait([this](boost::system::error_code ec)
+                                     {
+                if (!ec)
+                {
+                    moveFocuser();
+                } });
+        }
+
+        void slewTelescope()
+        {
+            Property &coord = properties[{settings.telescope, "EQUATORIAL_EOD_COORD"}];
+            double &ra = coord.elements[0].value;
+            double &dec = coord.elements[1].value;
+            const double step = settings.slew_rate * settings.motion_interval;
+            // 赤经以小时为单位，按最短方向转动
+            double dra = std::remainder(ra_target - ra, 24.0) * 15.0;
+            double ddec = dec_target - dec;
+            const bool done = std::abs(dra) <= step && std::abs(ddec) <= step;
+            if (done)
+            {
+                ra = ra_target;
+                dec = dec_target;
+                coord.state = "Ok";
+                broadcast(coord);
+                return;
+            }
+            dra = std::clamp(dra, -step, step);
+            ddec = std::clamp(ddec, -step, step);
+            ra = std::fmod(ra + dra / 15.0 + 24.0, 24.0);
+            dec += ddec;
+            broadcast(coord);
+            telescope_timer.expires_after(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(settings.motion_interval)));
+            telescope_timer.async_wait([this](boost::system::error_code ec)
+                                       {
+                if (!ec)
+                {
+                    slewTelescope();
+                } });
+        }
+
+        void setStormRate(double rate)
+        {
+            storm_rate = rate;
+            storm_sent = 0;
+            storm_started = std::chrono::steady_clock::now();
+            storm_timer.cancel();
+            if (rate > 0)
+            {
+                tickStorm(++storm_generation);
+            }
+            else
+            {
+                ++storm_generation;
+            }
+        }
+
+        void tickStorm(uint64_t generation)
+        {
+            static const std::array<std::pair<const char *, bool>, 2> kTargets{{{"CCD_TEMPERATURE", true}, {"FOCUS_TEMPERATURE", false}}};
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - storm_started).count();
+            const uint64_t due = static_cast<uint64_t>(elapsed * storm_rate);
+            for (; storm_sent < due; ++storm_sent)
+            {
+                const auto &target = kTargets[storm_sent % kTargets.size()];
+                Property &p = properties[{target.second ? settings.camera : settings.focuser, target.first}];
+                p.elements[0].value = std::round((p.elements[0].value + ((storm_sent & 1) ? 0.01 : -0.01)) * 100) / 100;
+                p.state = "Ok";
+                broadcast(p, true);
+            }
+            storm_timer.expires_after(std::chrono::milliseconds(1));
+            storm_timer.async_wait([this, generation](boost::system::error_code ec)
+                                   {
+                if (!ec && generation == storm_generation)
+                {
+                    tickStorm(generation);
+                } });
+        }
+
+        /**
+         * @brief 向关注该设备且未设置 B_ONLY 的客户端发送属性更新
+         *
+         * @param droppable 风暴消息在客户端积压超过上限时丢弃
+         */
+        void broadcast(const Property &property, bool droppable = false)
+        {
+            const std::string xml = SetXml(property);
+            for (const auto &session : std::vector<std::shared_ptr<Session>>(sessions))
+            {
+                if (!session->watches(property.device) || session->blobMode(property.device) == BlobMode::Only)
+                {
+                    continue;
+                }
+                if (droppable && session->queued_bytes > settings.max_queue_bytes)
+                {
+                    updates_dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                session->send({xml});
+                updates_sent.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void emitBlob()
+        {
+            const auto &device = settings.camera;
+            // 把发送时刻写入前 8 字节，只重新编码开头的 12 个字符
+            uint8_t stamp[kStampBytes];
+            const uint64_t now = IndiSimulator::Now();
+            for (int i = 0; i < 8; ++i)
+            {
+                stamp[i] = static_cast<uint8_t>(now >> (8 * i));
+            }
+            stamp[8] = payload[8];
+            std::string stamp_chars;
+            Base64Encode(stamp, kStampBytes, stamp_chars);
+
+            const std::string head = fmt::format("<setBLOBVector device=\"{0}\" name=\"CCD1\" state=\"Ok\" timeout=\"60\" timestamp=\"{1}\">\n"
+                                                 "  <oneBLOB name=\"CCD1\" size=\"{2}\" enclen=\"{3}\" format=\"{4}\">\n{5}",
+                                                 device, Timestamp(), payload.size(), payload_base64->size(), settings.blob_format, stamp_chars);
+            static const std::string tail = "\n  </oneBLOB>\n</setBLOBVector>\n";
+            for (const auto &session : std::vector<std::shared_ptr<Session>>(sessions))
+            {
+                if (!session->watches(device) || session->blobMode(device) == BlobMode::Never)
+                {
+                    continue;
+                }
+                // 客户端跟不上时丢帧，与 indiserver 的行为一致而不是无限积压
+                if (session->queued_bytes + payload_base64->size() > settings.max_queue_bytes)
+                {
+                    blobs_dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                session->send({head, payload_base64, kStampChars, tail});
+                blobs_sent.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    IndiSimulator::IndiSimulator(IndiSimulatorSettings settings)
+        : m_impl(std::make_unique<Impl>(std::move(settings)))
+    {
+    }
+
+    IndiSimulator::~IndiSimulator()
+    {
+        stop();
+    }
+
+    bool IndiSimulator::start()
+    {
+        if (m_impl->thread.joinable())
+        {
+            return true;
+        }
+        try
+        {
+            const tcp::endpoint endpoint(boost::asio::ip::make_address(m_impl->settings.host), static_cast<unsigned short>(m_impl->settings.port));
+            m_impl->acceptor.open(endpoint.protocol());
+            m_impl->acceptor.set_option(tcp::acceptor::reuse_address(true));
+            m_impl->acceptor.bind(endpoint);
+            m_impl->acceptor.listen();
+            m_impl->bound_port = m_impl->acceptor.local_endpoint().port();
+        }
+        catch (const boost::system::system_error &e)
+        {
+            spdlog::error("INDI simulator failed to listen on {}:{}: {}", m_impl->settings.host, m_impl->settings.port, e.what());
+            boost::system::error_code ignored;
+            m_impl->acceptor.close(ignored);
+            return false;
+        }
+        m_impl->io.restart();
+        m_impl->accept();
+        if (m_impl->settings.storm_rate > 0)
+        {
+            m_impl->setStormRate(m_impl->settings.storm_rate);
+        }
+        m_impl->thread = std::thread([this]()
+                                     { m_impl->io.run(); });
+        spdlog::info("INDI simulator listening on {}:{}", m_impl->settings.host, port());
+        return true;
+    }
+
+    void IndiSimulator::stop()
+    {
+        if (!m_impl->thread.joinable())
+        {
+            return;
+        }
+        boost::asio::post(m_impl->io, [impl = m_impl.get()]()
+                          {
+            boost::system::error_code ignored;
+            impl->acceptor.close(ignored);
+            impl->storm_rate = 0;
+            impl->video_running = false;
+            ++impl->storm_generation;
+            ++impl->video_generation;
+            impl->storm_timer.cancel();
+            impl->video_timer.cancel();
+            impl->exposure_timer.cancel();
+            impl->focuser_timer.cancel();
+            impl->telescope_timer.cancel();
+            for (const auto &session : std::vector<std::shared_ptr<Impl::Session>>(impl->sessions))
+            {
+                session->close();
+            } });
+        m_impl->thread.join();
+    }
+
+    int IndiSimulator::port() const
+    {
+        return m_impl->bound_port.load();
+    }
+
+    void IndiSimulator::setStormRate(double rate)
+    {
+        boost::asio::post(m_impl->io, [impl = m_impl.get(), rate]()
+                          { impl->setStormRate(rate); });
+    }
+
+    void IndiSimulator::emitBlob()
+    {
+        boost::asio::post(m_impl->io, [impl = m_impl.get()]()
+                          { impl->emitBlob(); });
+    }
+
+    nlohmann::json IndiSimulator::stats() const
+    {
+        return {
+            {"port", port()},
+            {"connections", m_impl->connections.load()},
+            {"blob_size", m_impl->payload.size()},
+            {"blobs_sent", m_impl->blobs_sent.load()},
+            {"blobs_dropped", m_impl->blobs_dropped.load()},
+            {"updates_sent", m_impl->updates_sent.load()},
+            {"updates_dropped", m_impl->updates_dropped.load()},
+            {"bytes_sent", m_impl->bytes_sent.load()}};
+    }
+
+    uint64_t IndiSimulator::BlobTimestamp(const void *data, size_t size)
+    {
+        if (size < 8)
+        {
+            return 0;
+        }
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i)
+        {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    uint64_t IndiSimulator::Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+} // namespace OpenAPT
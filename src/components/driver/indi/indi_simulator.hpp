@@ -0,0 +1,129 @@
+/*
+ * indi_simulator.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-18
+
+Description: Lightweight INDI Protocol Simulator
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "nlohmann/json.hpp"
+
+namespace OpenAPT
+{
+    struct IndiSimulatorSettings
+    {
+        std::string host = "127.0.0.1";
+        int port = 0; ///< 0 表示由系统分配，start() 后通过 port() 取得
+
+        std::string camera = "CCD Simulator";
+        std::string focuser = "Focuser Simulator";
+        std::string telescope = "Telescope Simulator";
+
+        // 相机 BLOB 为原始像素，大小 = width * height * bit_depth / 8
+        int width = 2048;
+        int height = 1024;
+        int bit_depth = 16;
+        std::string blob_format = ".stream";
+        double video_fps = 30; ///< CCD_VIDEO_STREAM 开启后的帧率
+
+        double storm_rate = 0;          ///< 属性风暴每秒发送的 setNumberVector 数量，0 为关闭
+        double focuser_speed = 2000;    ///< 电调每秒移动的步数
+        double slew_rate = 3;           ///< 赤道仪每秒转动的角度
+        double motion_interval = 0.05;  ///< 运动中的位置更新间隔（秒）
+        size_t max_queue_bytes = 64 << 20; ///< 单个客户端的发送队列上限，超出时丢弃 BLOB
+    };
+
+    /**
+     * @brief 进程内的 INDI 协议模拟服务器
+     *
+     * 在本地 TCP 端口上使用 INDI XML 协议，提供相机、电调和赤道仪三个设备，
+     * 驱动无需 indiserver 或真实硬件即可连接。支持 getProperties、enableBLOB（Never/Also/Only）
+     * 以及 newNumberVector/newSwitchVector/newTextVector：曝光结束和视频流按设定的大小与帧率发送 BLOB，
+     * 电调和赤道仪按设定速度运动并持续上报位置，属性风暴以固定速率发送数值更新。
+     *
+     * 每个 BLOB 的前 8 字节为发送时刻的 steady_clock 纳秒数（小端），用 BlobTimestamp 取出即可计算端到端延迟。
+     * BLOB 的 base64 正文只编码一次，各帧只重新编码开头的时间戳，发送时以分散写共享同一块正文。
+     */
+    class IndiSimulator
+    {
+    public:
+        explicit IndiSimulator(IndiSimulatorSettings settings = {});
+        ~IndiSimulator();
+
+        IndiSimulator(const IndiSimulator &) = delete;
+        IndiSimulator &operator=(const IndiSimulator &) = delete;
+
+        /**
+         * @brief 绑定端口并启动 IO 线程
+         *
+         * @return 端口无法绑定时返回 false
+         */
+        bool start();
+
+        void stop();
+
+        /**
+         * @brief 实际监听的端口
+         */
+        int port() const;
+
+        /**
+         * @brief 修改属性风暴速率，运行中立即生效
+         */
+        void setStormRate(double rate);
+
+        /**
+         * @brief 不经过曝光直接向订阅了 BLOB 的客户端发送一帧
+         */
+        void emitBlob();
+
+        nlohmann::json stats() const;
+
+        /**
+         * @brief 取出模拟器写入 BLOB 开头的发送时刻
+         *
+         * @return 数据不足 8 字节时返回 0
+         */
+        static uint64_t BlobTimestamp(const void *data, size_t size);
+
+        /**
+         * @brief 与 BlobTimestamp 使用同一时钟的当前时刻
+         */
+        static uint64_t Now();
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> m_impl;
+    };
+} // namespace OpenAPT
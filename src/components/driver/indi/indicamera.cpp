@@ -35,10 +35,19 @@ Description: INDI Camera
 
 #include "indicamera.hpp"
 
+#ifdef INDI_SHARED_BLOB_SUPPORT
+#include <libindi/sharedblob.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+
 #include <spdlog/spdlog.h>
 
 namespace OpenAPT
 {
+    // FITS 等格式的文件头，预分配帧缓冲时在像素数据之外预留
+    constexpr size_t kFrameHeaderReserve = 64 * 1024;
 
     void INDICamera::newDevice(INDI::BaseDevice *dp)
     {
@@ -50,126 +59,8 @@ namespace OpenAPT
 
     void INDICamera::newSwitch(ISwitchVectorProperty *svp)
     {
-        std::string name = svp->name;
-
-        spdlog::debug("{} Received Switch: {}", _name, name);
-
-        if (name == "CONNECTION")
-        {
-            if (auto connectswitch = IUFindSwitch(svp, "CONNECT"); connectswitch->s == ISS_ON)
-            {
-                is_connected = true;
-                camera_info["connected"] = true;
-                spdlog::info("{} is connected", _name);
-            }
-            else
-            {
-                if (is_ready)
-                {
-                    ClearStatus();
-                    camera_info["connected"] = false;
-                    spdlog::info("{} is disconnected", _name);
-                }
-            }
-        }
-        else if (name == "DEBUG")
-        {
-            if (auto debugswitch = IUFindSwitch(svp, "ENABLE"); debugswitch->s == ISS_ON)
-            {
-                is_debug = true;
-                camera_info["debug"] = true;
-                spdlog::info("DEBUG mode of {} is enabled", _name);
-            }
-            else
-            {
-                is_debug = false;
-                camera_info["debug"] = false;
-                spdlog::info("DEBUG mode of {} is disabled", _name);
-            }
-        }
-        else if (name == "CCD_FRAME_TYPE")
-        {
-            std::string_view type;
-
-            if (auto lightswitch = IUFindSwitch(svp, "FRAME_LIGHT"); lightswitch->s == ISS_ON)
-                type = "Light";
-            else if (auto darkswitch = IUFindSwitch(svp, "FRAME_DARK"); darkswitch->s == ISS_ON)
-                type = "Dark";
-            else if (auto flatswitch = IUFindSwitch(svp, "FRAME_FLAT"); flatswitch->s == ISS_ON)
-                type = "Flat";
-            else if (auto biasswitch = IUFindSwitch(svp, "FRAME_BIAS"); biasswitch->s == ISS_ON)
-                type = "Bias";
-
-            camera_info["frame"]["type"] = type;
-            spdlog::debug("Current frame type of {} is {}", _name, camera_info["frame"]["type"].dump());
-        }
-        else if (name == "CCD_TRANSFER_FORMAT")
-        {
-            std::string_view format;
-
-            if (auto fitsswitch = IUFindSwitch(svp, "FORMAT_FITS"); fitsswitch->s == ISS_ON)
-                format = "Fits";
-            else if (auto natswitch = IUFindSwitch(svp, "FORMAT_NATIVE"); natswitch->s == ISS_ON)
-                format = "Raw";
-            else if (auto xisfswitch = IUFindSwitch(svp, "FORMAT_XISF"); xisfswitch->s == ISS_ON)
-                format = "Xisf";
-
-            camera_info["frame"]["format"] = format;
-            spdlog::debug("Current frame format of {} is {}", _name, camera_info["frame"]["format"].dump());
-        }
-        else if (name == "CCD_ABORT_EXPOSURE")
-        {
-            if (auto abortswitch = IUFindSwitch(svp, "ABORT_EXPOSURE"); abortswitch->s == ISS_ON)
-            {
-                camera_info["exposure"]["abort"] = true;
-                spdlog::debug("{} is stopped", _name);
-                is_exposuring = false;
-            }
-        }
-        else if (name == "UPLOAD_MODE")
-        {
-            std::string_view mode;
-
-            if (auto clientswitch = IUFindSwitch(svp, "UPLOAD_CLIENT"); clientswitch->s == ISS_ON)
-                mode = "Client";
-            else if (auto localswitch = IUFindSwitch(svp, "UPLOAD_LOCAL"); localswitch->s == ISS_ON)
-                mode = "Local";
-            else if (auto bothswitch = IUFindSwitch(svp, "UPLOAD_BOTH"); bothswitch->s == ISS_ON)
-                mode = "Both";
-
-            camera_info["network"]["mode"] = mode;
-            spdlog::debug("Current upload mode of {} is {}", _name, camera_info["network"]["mode"].dump());
-        }
-        else if (name == "CCD_FAST_TOGGLE")
-        {
-            bool mode;
-
-            if (auto enabledswitch = IUFindSwitch(svp, "INDI_ENABLED"); enabledswitch->s == ISS_ON)
-                mode = true;
-            else if (auto disabledswitch = IUFindSwitch(svp, "INDI_DISABLED"); disabledswitch->s == ISS_ON)
-                mode = false;
-
-            camera_info["frame"]["fast_read"] = mode;
-            spdlog::debug("Current readout mode of {} is {}", _name, camera_info["frame"]["fast_read"].dump());
-        }
-        else if (name == "CCD_VIDEO_STREAM")
-        {
-            if (auto onswitch = IUFindSwitch(svp, "STREAM_ON"); onswitch->s == ISS_ON)
-            {
-                camera_info["video"]["is_video"] = true;
-                is_video = true;
-                spdlog::debug("{} start video capture", _name);
-            }
-            else if (auto offswitch = IUFindSwitch(svp, "STREAM_OFF"); offswitch->s == ISS_ON)
-            {
-                camera_info["video"]["is_video"] = false;
-                is_video = false;
-                spdlog::debug("{} stop video capture", _name);
-            }
-        }
-        else if (name == "FLIP")
-        {
-        }
+        spdlog::debug("{} Received Switch: {}", _name, svp->name);
+        property_router.dispatch(*this, svp);
     }
 
     void INDICamera::newMessage(INDI::BaseDevice *dp, int messageID)
@@ -195,108 +86,13 @@ namespace OpenAPT
 
     void INDICamera::newNumber(INumberVectorProperty *nvp)
     {
-        using namespace std::string_literals;
-        const std::string name = nvp->name;
-        if (name == "CCD_EXPOSURE")
-        {
-            const double exposure = nvp->np->value;
-            camera_info["exposure"]["current"] = exposure;
-            spdlog::debug("Current CCD_EXPOSURE for {} is {}", _name, exposure);
-        }
-        else if (name == "CCD_INFO")
-        {
-            pixel = IUFindNumber(ccdinfo_prop, "CCD_PIXEL_SIZE")->value;
-            pixel_x = IUFindNumber(ccdinfo_prop, "CCD_PIXEL_SIZE_X")->value;
-            pixel_y = IUFindNumber(ccdinfo_prop, "CCD_PIXEL_SIZE_Y")->value;
-            max_frame_x = IUFindNumber(ccdinfo_prop, "CCD_MAX_X")->value;
-            max_frame_y = IUFindNumber(ccdinfo_prop, "CCD_MAX_Y")->value;
-            pixel_depth = IUFindNumber(ccdinfo_prop, "CCD_BITSPERPIXEL")->value;
-
-            camera_info["frame"] = {
-                {"pixel_x", pixel_x},
-                {"pixel_y", pixel_y},
-                {"pixel_depth", pixel_depth},
-                {"max_frame_x", max_frame_x},
-                {"max_frame_y", max_frame_y}};
-            spdlog::debug("{} pixel {} pixel_x {} pixel_y {} max_frame_x {} max_frame_y {} pixel_depth {}", _name, pixel, pixel_x, pixel_y, max_frame_x, max_frame_y, pixel_depth);
-        }
-        else if (name == "BINNING")
-        {
-            indi_binning_x = IUFindNumber(nvp, "HOR_BIN");
-            indi_binning_y = IUFindNumber(nvp, "VER_BIN");
-            camera_info["exposure"] = {
-                {"binning_x", indi_binning_x->value},
-                {"binning_y", indi_binning_y->value}};
-            spdlog::debug("Current binning_x and y of {} are {} {}", _name, indi_binning_x->value, indi_binning_y->value);
-        }
-        else if (name == "FRAME")
-        {
-            indi_frame_x = IUFindNumber(nvp, "X");
-            indi_frame_y = IUFindNumber(nvp, "Y");
-            indi_frame_width = IUFindNumber(nvp, "WIDTH");
-            indi_frame_height = IUFindNumber(nvp, "HEIGHT");
-
-            camera_info["frame"] = {
-                {"x", indi_frame_x->value},
-                {"y", indi_frame_y->value},
-                {"width", indi_frame_width->value},
-                {"height", indi_frame_height->value}};
-            spdlog::debug("Current frame of {} are {} {} {} {}", _name, indi_frame_width->value, indi_frame_y->value, indi_frame_width->value, indi_frame_height->value);
-        }
-        else if (name == "CCD_TEMPERATURE")
-        {
-            current_temperature = IUFindNumber(nvp, "CCD_TEMPERATURE_VALUE")->value;
-            camera_info["temperature"]["current"] = current_temperature;
-            spdlog::debug("Current temperature of {} is {}", _name, current_temperature);
-        }
-        else if (name == "CCD_GAIN")
-        {
-            gain = IUFindNumber(nvp, "GAIN")->value;
-            camera_info["exposure"]["gain"] = gain;
-            spdlog::debug("Current camera gain of {} is {}", _name, gain);
-        }
-        else if (name == "CCD_OFFSET")
-        {
-            offset = IUFindNumber(nvp, "OFFSET")->value;
-            camera_info["exposure"]["offset"] = offset;
-            spdlog::debug("Current camera offset of {} is {}", _name, offset);
-        }
-        else if (name == "POLLING_PERIOD")
-        {
-            camera_info["network"]["period"] = IUFindNumber(nvp, "PERIOD_MS")->value;
-            spdlog::debug("Current period of {} is {}", _name, camera_info["network"]["period"].dump());
-        }
-        else if (name == "LIMITS")
-        {
-            camera_info["limits"]["maxbuffer"] = IUFindNumber(nvp, "LIMITS_BUFFER_MAX")->value;
-            spdlog::debug("Current max buffer of {} is {}", _name, camera_info["limits"]["maxbuffer"].dump());
-            camera_info["limits"]["maxfps"] = IUFindNumber(nvp, "LIMITS_PREVIEW_FPS")->value;
-            spdlog::debug("Current max fps of {} is {}", _name, camera_info["limits"]["maxfps"].dump());
-        }
-        else if (name == "STREAM_DELAY")
-        {
-            camera_info["video"]["delay"] = IUFindNumber(nvp, "STREAM_DELAY_TIME")->value;
-            spdlog::debug("Current stream delay of {} is {}", _name, camera_info["video"]["delay"].dump());
-        }
-        else if (name == "STREAMING_EXPOSURE")
-        {
-            camera_info["video"]["exposure"] = IUFindNumber(nvp, "STREAMING_EXPOSURE_VALUE")->value;
-            spdlog::debug("Current streaming exposure of {} is {}", _name, camera_info["video"]["exposure"].dump());
-            camera_info["video"]["division"] = IUFindNumber(nvp, "STREAMING_DIVISOR_VALUE")->value;
-            spdlog::debug("Current streaming division of {} is {}", _name, camera_info["video"]["division"].dump());
-        }
-        else if (name == "FPS")
-        {
-            camera_info["video"]["fps"] = IUFindNumber(nvp, "EST_FPS")->value;
-            spdlog::debug("Current fps of {} is {}", _name, camera_info["video"]["fps"].dump());
-            camera_info["video"]["avgfps"] = IUFindNumber(nvp, "AVG_FPS")->value;
-            spdlog::debug("Current average fps of {} is {}", _name, camera_info["video"]["avgfps"].dump());
-        }
+        property_router.dispatch(*this, nvp);
     }
 
     void INDICamera::newText(ITextVectorProperty *tvp)
     {
         spdlog::debug("{} Received Text: {} = {}", _name, tvp->name, tvp->tp->text);
+        property_router.dispatch(*this, tvp);
     }
 
     void INDICamera::newBLOB(IBLOB *bp)
@@ -306,213 +102,547 @@ namespace OpenAPT
 
         spdlog::debug("{} Received BLOB {} len = {} size = {}", _name, bp->name, bp->bloblen, bp->size);
 
-        if (expose_prop)
+        if (indi_blob_name != bp->name || !bp->blob)
         {
-            if (bp->name == indi_blob_name.c_str())
-            {
-                // updateLastFrame(bp);
-            }
+            return;
         }
-        else if (video_prop)
+
+        // 分离连接模式下此处运行在 BLOB 连接的线程，数据只交给帧缓冲，保存和分析由消费者线程完成
+        Image::FrameMeta meta = makeFrameMeta(bp->format);
+        const bool video = meta.video;
+
+#ifdef INDI_SHARED_BLOB_SUPPORT
+        // 直接访问模式下 blob 指向共享内存，取走所有权避免复制，槽位复用时再释放
+        void *data = bp->blob;
+        const size_t size = bp->bloblen;
+        bp->blob = nullptr;
+        bp->bloblen = 0;
+        bp->size = 0;
+        const bool published = frame_ring.publishExternal(data, size, std::move(meta), [data]()
+                                                          { IDSharedBlobFree(data); });
+#else
+        const bool published = frame_ring.publishCopy(bp->blob, bp->bloblen, std::move(meta));
+#endif
+        if (published)
         {
+            forwardToLiveView(video);
         }
     }
 
-    void INDICamera::newProperty(INDI::Property *property)
+    Image::FrameMeta INDICamera::makeFrameMeta(const std::string &format) const
     {
-        std::string PropName(property->getName());
-        INDI_PROPERTY_TYPE Proptype = property->getType();
-
-        // spdlog::debug("{} Property: {}", _name, property->getName());
+        // 帧信息取自状态快照而不是属性指针，BLOB 连接的线程也可以安全调用
+        const CameraState state = camera_state.load();
+        Image::FrameMeta meta;
+        meta.device = _name;
+        meta.format = format;
+        meta.exposure = state.exposure.duration;
+        meta.video = state.video.is_video;
+        meta.width = state.frame.width;
+        meta.height = state.frame.height;
+        meta.binning = state.exposure.binning_x;
+        meta.bit_depth = state.frame.pixel_depth;
+        meta.timestamp = std::chrono::system_clock::now();
+        return meta;
+    }
 
-        if (Proptype == INDI_BLOB)
+    void INDICamera::forwardToLiveView(bool video)
+    {
+        // 视频帧交给预览流水线，只做一次无锁入队
+        if (video && live_view.isRunning())
         {
+            live_view.push(frame_ring.latest());
+        }
+    }
 
-            if (PropName == indi_blob_name.c_str())
+    API::IndiStreamClient::Handlers INDICamera::makeStreamHandlers()
+    {
+        API::IndiStreamClient::Handlers handlers;
+        // 只处理 BLOB，属性定义不解析
+        handlers.blob_begin = [this](const API::IndiBlobInfo &info) -> std::span<uint8_t>
+        {
+            if (info.name != indi_blob_name)
             {
-                has_blob = 1;
-                // set option to receive blob and messages for the selected CCD
-                setBLOBMode(B_ALSO, device_name.c_str(), indi_blob_name.c_str());
-
-#ifdef INDI_SHARED_BLOB_SUPPORT
-                // Allow faster mode provided we don't modify the blob content or free/realloc it
-                enableDirectBlobAccess(device_name.c_str(), indi_blob_name.c_str());
-#endif
+                return {};
             }
-        }
-        else if (PropName == indi_camera_cmd + "EXPOSURE" && Proptype == INDI_NUMBER)
-        {
-            expose_prop = property->getNumber();
-            newNumber(expose_prop);
-        }
-        else if (PropName == indi_camera_cmd + "FRAME" && Proptype == INDI_NUMBER)
-        {
-            frame_prop = property->getNumber();
-            newNumber(frame_prop);
-        }
-        else if (PropName == indi_camera_cmd + "FRAME_TYPE" && Proptype == INDI_SWITCH)
-        {
-            frame_type_prop = property->getSwitch();
-            newSwitch(frame_type_prop);
-        }
-        else if (PropName == indi_camera_cmd + "BINNING" && Proptype == INDI_NUMBER)
-        {
-            binning_prop = property->getNumber();
-            newNumber(binning_prop);
-        }
-        else if (PropName == indi_camera_cmd + "CFA" && Proptype == INDI_TEXT)
-        {
-            ITextVectorProperty *cfa_prop = property->getText();
-            IText *cfa_type = IUFindText(cfa_prop, "CFA_TYPE");
-            if (cfa_type && cfa_type->text && *cfa_type->text)
+            blob_reservation = frame_ring.reserve(info.capacity());
+            if (!blob_reservation)
             {
-                spdlog::debug("{} CFA_TYPE is {}", _name, cfa_type->text);
-                is_color = true;
+                return {};
             }
-        }
-        else if (PropName == indi_camera_cmd + "VIDEO_STREAM" && Proptype == INDI_SWITCH)
-        {
-            video_prop = property->getSwitch();
-            newSwitch(video_prop);
-        }
-        else if (PropName == "STREAM_DELAY" && Proptype == INDI_NUMBER)
-        {
-            video_delay_prop = property->getNumber();
-            newNumber(video_delay_prop);
-        }
-        else if (PropName == "STREAMING_EXPOSURE" && Proptype == INDI_NUMBER)
+            return {blob_reservation.data(), blob_reservation.capacity()};
+        };
+        handlers.blob_end = [this](const API::IndiBlobInfo &info, size_t size, bool ok)
         {
-            video_exposure_prop = property->getNumber();
-            newNumber(video_exposure_prop);
-        }
-        else if (PropName == "FPS" && Proptype == INDI_NUMBER)
-        {
-            video_fps_prop = property->getNumber();
-            newNumber(video_fps_prop);
-        }
-        else if (PropName == "DEVICE_PORT" && Proptype == INDI_TEXT)
-        {
-            camera_port = property->getText();
-            camera_info["network"]["port"] = camera_port->tp->text;
-            spdlog::debug("Current device port of {} is {}", _name, camera_port->tp->text);
-        }
-        else if (PropName == "CONNECTION" && Proptype == INDI_SWITCH)
-        {
-            connection_prop = property->getSwitch();
-            ISwitch *connectswitch = IUFindSwitch(connection_prop, "CONNECT");
-            is_connected = (connectswitch->s == ISS_ON);
-            if (!is_connected)
+            if (!ok)
             {
-                connection_prop->sp->s = ISS_ON;
-                sendNewSwitch(connection_prop);
+                frame_ring.cancel(blob_reservation);
+                return;
             }
-            spdlog::debug("{} Connected {}", _name, is_connected);
-        }
-        else if (PropName == "DRIVER_INFO" && Proptype == INDI_TEXT)
-        {
-            device_name = IUFindText(property->getText(), "DRIVER_NAME")->text;
-            indi_camera_exec = IUFindText(property->getText(), "DRIVER_EXEC")->text;
-            indi_camera_version = IUFindText(property->getText(), "DRIVER_VERSION")->text;
-            indi_camera_interface = IUFindText(property->getText(), "DRIVER_INTERFACE")->text;
-            camera_info["driver"]["name"] = device_name;
-            camera_info["driver"]["exec"] = indi_camera_exec;
-            camera_info["driver"]["version"] = indi_camera_version;
-            camera_info["driver"]["interfaces"] = indi_camera_interface;
-            spdlog::debug("Camera Name : {} connected exec {}", _name, device_name, indi_camera_exec);
-        }
-        else if (PropName == indi_camera_cmd + "INFO" && Proptype == INDI_NUMBER)
-        {
-            ccdinfo_prop = property->getNumber();
-            newNumber(ccdinfo_prop);
-        }
-        else if (PropName == "DEBUG" && Proptype == INDI_SWITCH)
-        {
-            debug_prop = property->getSwitch();
-            newSwitch(debug_prop);
-        }
-        else if (PropName == "POLLING_PERIOD" && Proptype == INDI_NUMBER)
-        {
-            polling_prop = property->getNumber();
-            newNumber(polling_prop);
-        }
-        else if (PropName == "ACTIVE_DEVICES" && Proptype == INDI_TEXT)
-        {
-            active_device_prop = property->getText();
-            newText(active_device_prop);
-        }
-        else if (PropName == "CCD_COMPRESSION" && Proptype == INDI_SWITCH)
-        {
-            compression_prop = property->getSwitch();
-            newSwitch(compression_prop);
-        }
-        else if (PropName == "UPLOAD_MODE" && Proptype == INDI_SWITCH)
+            spdlog::debug("{} Received BLOB {} size = {}", _name, info.name, size);
+            Image::FrameMeta meta = makeFrameMeta(std::string(info.format));
+            const bool video = meta.video;
+            if (frame_ring.commit(blob_reservation, size, std::move(meta)))
+            {
+                forwardToLiveView(video);
+            }
+        };
+        handlers.disconnected = [this]()
         {
-            image_upload_mode_prop = property->getSwitch();
-            newSwitch(image_upload_mode_prop);
-        }
-        else if (PropName == "CCD_FAST_TOGGLE" && Proptype == INDI_SWITCH)
+            // 未完成的 BLOB 已由 blob_end 取消
+            onBlobConnectionLost();
+        };
+        return handlers;
+    }
+
+    bool INDICamera::startStreamConnection(const std::string &name)
+    {
+        if (!stream_client.connect(hostname, port))
         {
-            fast_read_out_prop = property->getSwitch();
-            newSwitch(fast_read_out_prop);
+            return false;
         }
-        else if (PropName == "LIMITS" && Proptype == INDI_NUMBER)
+        // 本连接只接收 BLOB，数值和开关更新全部走控制连接
+        if (!stream_client.getProperties(name, indi_blob_name) ||
+            !stream_client.enableBlob(name, indi_blob_name, API::IndiBlobMode::Only))
         {
-            camera_limit_prop = property->getNumber();
-            newNumber(camera_limit_prop);
+            stream_client.disconnect();
+            return false;
         }
+        return true;
+    }
+
+    void INDICamera::newProperty(INDI::Property *property)
+    {
+        // spdlog::debug("{} Property: {}", _name, property->getName());
+        property_router.dispatchProperty(*this, property);
+    }
+
+    void INDICamera::BuildPropertyRoutes()
+    {
+        const auto cmd = [this](const char *name)
+        {
+            return PropertyName::runtime(indi_camera_cmd + name);
+        };
+
+        property_router
+            .onProperty(PropertyName::runtime(indi_blob_name), INDI_BLOB, &INDICamera::onBlobProperty)
+            .bind(cmd("EXPOSURE"), &INDICamera::expose_prop, &INDICamera::onExposure)
+            .bind(cmd("FRAME"), &INDICamera::frame_prop, &INDICamera::onFrame)
+            .bind(cmd("FRAME_TYPE"), &INDICamera::frame_type_prop, &INDICamera::onFrameType)
+            .bind(cmd("BINNING"), &INDICamera::binning_prop, &INDICamera::onBinning)
+            .bind(cmd("INFO"), &INDICamera::ccdinfo_prop, &INDICamera::onInfo)
+            .bind(cmd("VIDEO_STREAM"), &INDICamera::video_prop, &INDICamera::onVideoStream)
+            .onProperty(cmd("CFA"), INDI_TEXT, &INDICamera::onCfaProperty)
+            .bind("CCD_TEMPERATURE", &INDICamera::temperature_prop, &INDICamera::onTemperature)
+            .bind("CCD_COOLER_POWER", &INDICamera::cooler_power_prop, &INDICamera::onCoolerPower)
+            .bind("CCD_GAIN", &INDICamera::gain_prop, &INDICamera::onGain)
+            .bind("CCD_OFFSET", &INDICamera::offset_prop, &INDICamera::onOffset)
+            .on("CCD_TRANSFER_FORMAT", &INDICamera::onTransferFormat)
+            .on("CCD_ABORT_EXPOSURE", &INDICamera::onAbortExposure)
+            .bind("STREAM_DELAY", &INDICamera::video_delay_prop, &INDICamera::onStreamDelay)
+            .bind("STREAMING_EXPOSURE", &INDICamera::video_exposure_prop, &INDICamera::onStreamingExposure)
+            .bind("FPS", &INDICamera::video_fps_prop, &INDICamera::onFps)
+            .bind("DEVICE_PORT", &INDICamera::camera_port)
+            .onProperty("DEVICE_PORT", INDI_TEXT, &INDICamera::onPortProperty)
+            .bind("CONNECTION", &INDICamera::connection_prop, &INDICamera::onConnection)
+            .onProperty("CONNECTION", INDI_SWITCH, &INDICamera::onConnectionProperty)
+            .onProperty("DRIVER_INFO", INDI_TEXT, &INDICamera::onDriverInfoProperty)
+            .bind("DEBUG", &INDICamera::debug_prop, &INDICamera::onDebug)
+            .bind("POLLING_PERIOD", &INDICamera::polling_prop, &INDICamera::onPolling)
+            .bind("ACTIVE_DEVICES", &INDICamera::active_device_prop)
+            .bind("CCD_COMPRESSION", &INDICamera::compression_prop)
+            .bind("UPLOAD_MODE", &INDICamera::image_upload_mode_prop, &INDICamera::onUploadMode)
+            .bind("CCD_FAST_TOGGLE", &INDICamera::fast_read_out_prop, &INDICamera::onFastToggle)
+            .bind("LIMITS", &INDICamera::camera_limit_prop, &INDICamera::onLimits);
+
         // The following properties are for ASI Camera
-        else if (PropName == "FLIP" && Proptype == INDI_SWITCH)
-        {
-            asi_image_flip_prop = property->getSwitch();
-            newSwitch(asi_image_flip_prop);
-        }
-        else if (PropName == "CCD_CONTROLS" && Proptype == INDI_SWITCH)
-        {
-        }
-        else if (PropName == "CCD_CONTROLS_MODE" && Proptype == INDI_SWITCH)
-        {
-        }
+        property_router
+            .bind("FLIP", &INDICamera::asi_image_flip_prop)
+            .ignore("CCD_CONTROLS", INDI_SWITCH)
+            .ignore("CCD_CONTROLS_MODE", INDI_SWITCH);
+
         // The following properties are for Toup Camera
-        else if (PropName == "TC_FAN_CONTROL" && Proptype == INDI_SWITCH)
+        property_router
+            .ignore("TC_FAN_CONTROL", INDI_SWITCH)
+            .ignore("TC_FAN_Speed", INDI_SWITCH)
+            .ignore("TC_AUTO_WB", INDI_SWITCH)
+            .ignore("TC_HEAT_CONTROL", INDI_SWITCH)
+            .ignore("TC_HCG_CONTROL", INDI_SWITCH)
+            .ignore("TC_HGC_SET", INDI_NUMBER)
+            .ignore("TC_LOW_NOISE_CONTROL", INDI_SWITCH)
+            .bind("SIMULATION", &INDICamera::toupcam_simulation_prop)
+            .ignore("CCD_LEVEL_RANGE", INDI_NUMBER)
+            .ignore("CCD_BINNING_MODE", INDI_SWITCH)
+            .ignore("CCD_BLACK_BALANCE", INDI_NUMBER)
+            .ignore("Firmware", INDI_NUMBER);
+    }
+
+    void INDICamera::onBlobProperty(INDI::Property *property)
+    {
+        has_blob = true;
+        if (blob_client.isRunning() || stream_client.isConnected())
         {
+            // 图像由 BLOB 连接接收，控制连接只收属性更新
+            setBLOBMode(B_NEVER, device_name.c_str(), indi_blob_name.c_str());
+            spdlog::debug("{} receives {} on a dedicated connection", _name, indi_blob_name);
+            return;
         }
-        else if (PropName == "TC_FAN_Speed" && Proptype == INDI_SWITCH)
+        enableSharedBlob();
+    }
+
+    void INDICamera::enableSharedBlob()
+    {
+        // set option to receive blob and messages for the selected CCD
+        setBLOBMode(B_ALSO, device_name.c_str(), indi_blob_name.c_str());
+
+#ifdef INDI_SHARED_BLOB_SUPPORT
+        // Allow faster mode provided we don't modify the blob content or free/realloc it
+        enableDirectBlobAccess(device_name.c_str(), indi_blob_name.c_str());
+#endif
+    }
+
+    void INDICamera::onBlobConnectionLost()
+    {
+        // 控制连接已设置 B_NEVER，不切换回来的话之后的图像都会丢失；
+        // 属性还没定义时 onBlobProperty 会发现 BLOB 连接已断开，自行选择 B_ALSO
+        spdlog::warn("{} lost the BLOB connection, receiving images on the control connection", _name);
+        if (has_blob)
         {
+            enableSharedBlob();
         }
-        else if (PropName == "TC_AUTO_WB" && Proptype == INDI_SWITCH)
+    }
+
+    void INDICamera::onCfaProperty(INDI::Property *property)
+    {
+        ITextVectorProperty *cfa_prop = property->getText();
+        IText *cfa_type = IUFindText(cfa_prop, "CFA_TYPE");
+        if (cfa_type && cfa_type->text && *cfa_type->text)
         {
+            spdlog::debug("{} CFA_TYPE is {}", _name, cfa_type->text);
+            is_color = true;
         }
-        else if (PropName == "TC_HEAT_CONTROL" && Proptype == INDI_SWITCH)
+    }
+
+    void INDICamera::onPortProperty(INDI::Property *property)
+    {
+        camera_state.update([this](CameraState &state)
+                            { state.network.port.assign(camera_port->tp->text); });
+        spdlog::debug("Current device port of {} is {}", _name, camera_port->tp->text);
+    }
+
+    void INDICamera::onConnectionProperty(INDI::Property *property)
+    {
+        ISwitch *connectswitch = IUFindSwitch(connection_prop, "CONNECT");
+        is_connected = (connectswitch->s == ISS_ON);
+        if (!is_connected)
         {
+            connection_prop->sp->s = ISS_ON;
+            sendNewSwitch(connection_prop);
         }
-        else if (PropName == "TC_HCG_CONTROL" && Proptype == INDI_SWITCH)
+        spdlog::debug("{} Connected {}", _name, is_connected.load());
+    }
+
+    void INDICamera::onDriverInfoProperty(INDI::Property *property)
+    {
+        device_name = IUFindText(property->getText(), "DRIVER_NAME")->text;
+        indi_camera_exec = IUFindText(property->getText(), "DRIVER_EXEC")->text;
+        indi_camera_version = IUFindText(property->getText(), "DRIVER_VERSION")->text;
+        indi_camera_interface = IUFindText(property->getText(), "DRIVER_INTERFACE")->text;
+        camera_state.update([this](CameraState &state)
+                            {
+            state.driver.name.assign(device_name);
+            state.driver.exec.assign(indi_camera_exec);
+            state.driver.version.assign(indi_camera_version);
+            state.driver.interfaces.assign(indi_camera_interface); });
+        spdlog::debug("Camera Name : {} connected exec {}", _name, device_name, indi_camera_exec);
+    }
+
+    void INDICamera::onConnection(ISwitchVectorProperty *svp)
+    {
+        if (auto connectswitch = IUFindSwitch(svp, "CONNECT"); connectswitch->s == ISS_ON)
         {
+            is_connected = true;
+            camera_state.update([](CameraState &state)
+                                { state.connected = true; });
+            spdlog::info("{} is connected", _name);
         }
-        else if (PropName == "TC_HGC_SET" && Proptype == INDI_NUMBER)
+        else
         {
+            if (is_ready)
+            {
+                ClearStatus();
+                camera_state.update([](CameraState &state)
+                                    { state.connected = false; });
+                spdlog::info("{} is disconnected", _name);
+            }
         }
-        else if (PropName == "TC_LOW_NOISE_CONTROL" && Proptype == INDI_SWITCH)
+    }
+
+    void INDICamera::onDebug(ISwitchVectorProperty *svp)
+    {
+        if (auto debugswitch = IUFindSwitch(svp, "ENABLE"); debugswitch->s == ISS_ON)
         {
+            is_debug = true;
+            spdlog::info("DEBUG mode of {} is enabled", _name);
         }
-        else if (PropName == "SIMULATION" && Proptype == INDI_SWITCH)
+        else
         {
-            toupcam_simulation_prop = property->getSwitch();
-            newSwitch(toupcam_simulation_prop);
+            is_debug = false;
+            spdlog::info("DEBUG mode of {} is disabled", _name);
         }
-        else if (PropName == "CCD_LEVEL_RANGE" && Proptype == INDI_NUMBER)
+        camera_state.update([this](CameraState &state)
+                            { state.debug = is_debug; });
+    }
+
+    void INDICamera::onFrameType(ISwitchVectorProperty *svp)
+    {
+        FrameType type = FrameType::Unknown;
+
+        if (auto lightswitch = IUFindSwitch(svp, "FRAME_LIGHT"); lightswitch->s == ISS_ON)
+            type = FrameType::Light;
+        else if (auto darkswitch = IUFindSwitch(svp, "FRAME_DARK"); darkswitch->s == ISS_ON)
+            type = FrameType::Dark;
+        else if (auto flatswitch = IUFindSwitch(svp, "FRAME_FLAT"); flatswitch->s == ISS_ON)
+            type = FrameType::Flat;
+        else if (auto biasswitch = IUFindSwitch(svp, "FRAME_BIAS"); biasswitch->s == ISS_ON)
+            type = FrameType::Bias;
+
+        camera_state.update([type](CameraState &state)
+                            { state.frame.type = type; });
+        spdlog::debug("Current frame type of {} is {}", _name, static_cast<int>(type));
+    }
+
+    void INDICamera::onTransferFormat(ISwitchVectorProperty *svp)
+    {
+        TransferFormat format = TransferFormat::Unknown;
+
+        if (auto fitsswitch = IUFindSwitch(svp, "FORMAT_FITS"); fitsswitch->s == ISS_ON)
+            format = TransferFormat::Fits;
+        else if (auto natswitch = IUFindSwitch(svp, "FORMAT_NATIVE"); natswitch->s == ISS_ON)
+            format = TransferFormat::Raw;
+        else if (auto xisfswitch = IUFindSwitch(svp, "FORMAT_XISF"); xisfswitch->s == ISS_ON)
+            format = TransferFormat::Xisf;
+
+        camera_state.update([format](CameraState &state)
+                            { state.frame.format = format; });
+        spdlog::debug("Current frame format of {} is {}", _name, static_cast<int>(format));
+    }
+
+    void INDICamera::onAbortExposure(ISwitchVectorProperty *svp)
+    {
+        if (auto abortswitch = IUFindSwitch(svp, "ABORT"); abortswitch && abortswitch->s == ISS_ON)
         {
+            spdlog::debug("{} is stopped", _name);
+            is_exposuring = false;
+            camera_state.update([](CameraState &state)
+                                {
+                state.exposure.aborted = true;
+                state.exposure.exposing = false; });
         }
-        else if (PropName == "CCD_BINNING_MODE" && Proptype == INDI_SWITCH)
+    }
+
+    void INDICamera::onUploadMode(ISwitchVectorProperty *svp)
+    {
+        UploadMode mode = UploadMode::Unknown;
+
+        if (auto clientswitch = IUFindSwitch(svp, "UPLOAD_CLIENT"); clientswitch->s == ISS_ON)
+            mode = UploadMode::Client;
+        else if (auto localswitch = IUFindSwitch(svp, "UPLOAD_LOCAL"); localswitch->s == ISS_ON)
+            mode = UploadMode::Local;
+        else if (auto bothswitch = IUFindSwitch(svp, "UPLOAD_BOTH"); bothswitch->s == ISS_ON)
+            mode = UploadMode::Both;
+
+        camera_state.update([mode](CameraState &state)
+                            { state.network.mode = mode; });
+        spdlog::debug("Current upload mode of {} is {}", _name, static_cast<int>(mode));
+    }
+
+    void INDICamera::onFastToggle(ISwitchVectorProperty *svp)
+    {
+        bool mode = false;
+
+        if (auto enabledswitch = IUFindSwitch(svp, "INDI_ENABLED"); enabledswitch->s == ISS_ON)
+            mode = true;
+        else if (auto disabledswitch = IUFindSwitch(svp, "INDI_DISABLED"); disabledswitch->s == ISS_ON)
+            mode = false;
+
+        camera_state.update([mode](CameraState &state)
+                            { state.frame.fast_read = mode; });
+        spdlog::debug("Current readout mode of {} is {}", _name, mode);
+    }
+
+    void INDICamera::onVideoStream(ISwitchVectorProperty *svp)
+    {
+        if (auto onswitch = IUFindSwitch(svp, "STREAM_ON"); onswitch->s == ISS_ON)
         {
+            is_video = true;
+            camera_state.update([](CameraState &state)
+                                { state.video.is_video = true; });
+            spdlog::debug("{} start video capture", _name);
         }
-        else if (PropName == "CCD_BLACK_BALANCE" && Proptype == INDI_NUMBER)
+        else if (auto offswitch = IUFindSwitch(svp, "STREAM_OFF"); offswitch->s == ISS_ON)
         {
+            is_video = false;
+            camera_state.update([](CameraState &state)
+                                { state.video.is_video = false; });
+            spdlog::debug("{} stop video capture", _name);
         }
-        else if (PropName == "Firmware" && Proptype == INDI_NUMBER)
-        {
+    }
+
+    void INDICamera::onExposure(INumberVectorProperty *nvp)
+    {
+        const double exposure = nvp->np->value;
+        camera_state.update([&](CameraState &state)
+                            {
+            // 曝光过程中剩余时间递减，进入 BUSY 时的值即本次曝光时长
+            if (nvp->s == IPS_BUSY && (!state.exposure.exposing || exposure > exposure_duration.load()))
+            {
+                exposure_duration = exposure;
+            }
+            state.exposure.current = exposure;
+            state.exposure.duration = exposure_duration.load();
+            state.exposure.exposing = nvp->s == IPS_BUSY; });
+        spdlog::debug("Current CCD_EXPOSURE for {} is {}", _name, exposure);
+    }
+
+    void INDICamera::onInfo(INumberVectorProperty *nvp)
+    {
+        pixel = IUFindNumber(nvp, "CCD_PIXEL_SIZE")->value;
+        pixel_x = IUFindNumber(nvp, "CCD_PIXEL_SIZE_X")->value;
+        pixel_y = IUFindNumber(nvp, "CCD_PIXEL_SIZE_Y")->value;
+        max_frame_x = IUFindNumber(nvp, "CCD_MAX_X")->value;
+        max_frame_y = IUFindNumber(nvp, "CCD_MAX_Y")->value;
+        pixel_depth = IUFindNumber(nvp, "CCD_BITSPERPIXEL")->value;
+
+        camera_state.update([this](CameraState &state)
+                            {
+            state.frame.pixel = pixel;
+            state.frame.pixel_x = pixel_x;
+            state.frame.pixel_y = pixel_y;
+            state.frame.pixel_depth = static_cast<int>(pixel_depth);
+            state.frame.max_frame_x = static_cast<int>(max_frame_x);
+            state.frame.max_frame_y = static_cast<int>(max_frame_y); });
+        spdlog::debug("{} pixel {} pixel_x {} pixel_y {} max_frame_x {} max_frame_y {} pixel_depth {}", _name, pixel, pixel_x, pixel_y, max_frame_x, max_frame_y, pixel_depth);
+
+        // 连接时按最大画幅一次性分配帧缓冲槽位，之后的图像不在接收线程上分配内存
+        const int width = static_cast<int>(max_frame_x);
+        const int height = static_cast<int>(max_frame_y);
+        const int bytes = (static_cast<int>(pixel_depth) + 7) / 8;
+        if (width > 0 && height > 0 && bytes > 0)
+        {
+            frame_ring.preallocate(static_cast<size_t>(width) * height * bytes + kFrameHeaderReserve);
         }
     }
 
+    void INDICamera::onBinning(INumberVectorProperty *nvp)
+    {
+        indi_binning_x = IUFindNumber(nvp, "HOR_BIN");
+        indi_binning_y = IUFindNumber(nvp, "VER_BIN");
+        camera_state.update([this](CameraState &state)
+                            {
+            state.exposure.binning_x = static_cast<int>(indi_binning_x->value);
+            state.exposure.binning_y = static_cast<int>(indi_binning_y->value); });
+        spdlog::debug("Current binning_x and y of {} are {} {}", _name, indi_binning_x->value, indi_binning_y->value);
+    }
+
+    void INDICamera::onFrame(INumberVectorProperty *nvp)
+    {
+        indi_frame_x = IUFindNumber(nvp, "X");
+        indi_frame_y = IUFindNumber(nvp, "Y");
+        indi_frame_width = IUFindNumber(nvp, "WIDTH");
+        indi_frame_height = IUFindNumber(nvp, "HEIGHT");
+
+        camera_state.update([this](CameraState &state)
+                            {
+            state.frame.x = static_cast<int>(indi_frame_x->value);
+            state.frame.y = static_cast<int>(indi_frame_y->value);
+            state.frame.width = static_cast<int>(indi_frame_width->value);
+            state.frame.height = static_cast<int>(indi_frame_height->value); });
+        spdlog::debug("Current frame of {} are {} {} {} {}", _name, indi_frame_x->value, indi_frame_y->value, indi_frame_width->value, indi_frame_height->value);
+    }
+
+    void INDICamera::onTemperature(INumberVectorProperty *nvp)
+    {
+        current_temperature = IUFindNumber(nvp, "CCD_TEMPERATURE_VALUE")->value;
+        camera_state.update([this](CameraState &state)
+                            { state.temperature.current = current_temperature; });
+        IARecordTelemetry("temperature", current_temperature);
+        spdlog::debug("Current temperature of {} is {}", _name, current_temperature);
+    }
+
+    void INDICamera::onCoolerPower(INumberVectorProperty *nvp)
+    {
+        IARecordTelemetry("cooler_power", nvp->np[0].value);
+    }
+
+    void INDICamera::onGain(INumberVectorProperty *nvp)
+    {
+        gain = IUFindNumber(nvp, "GAIN")->value;
+        camera_state.update([this](CameraState &state)
+                            { state.exposure.gain = gain; });
+        spdlog::debug("Current camera gain of {} is {}", _name, gain);
+    }
+
+    void INDICamera::onOffset(INumberVectorProperty *nvp)
+    {
+        offset = IUFindNumber(nvp, "OFFSET")->value;
+        camera_state.update([this](CameraState &state)
+                            { state.exposure.offset = offset; });
+        spdlog::debug("Current camera offset of {} is {}", _name, offset);
+    }
+
+    void INDICamera::onPolling(INumberVectorProperty *nvp)
+    {
+        const double period = IUFindNumber(nvp, "PERIOD_MS")->value;
+        camera_state.update([period](CameraState &state)
+                            { state.network.period = period; });
+        spdlog::debug("Current period of {} is {}", _name, period);
+    }
+
+    void INDICamera::onLimits(INumberVectorProperty *nvp)
+    {
+        const double maxbuffer = IUFindNumber(nvp, "LIMITS_BUFFER_MAX")->value;
+        const double maxfps = IUFindNumber(nvp, "LIMITS_PREVIEW_FPS")->value;
+        camera_state.update([=](CameraState &state)
+                            {
+            state.limits.maxbuffer = maxbuffer;
+            state.limits.maxfps = maxfps; });
+        spdlog::debug("Current max buffer of {} is {}", _name, maxbuffer);
+        spdlog::debug("Current max fps of {} is {}", _name, maxfps);
+    }
+
+    void INDICamera::onStreamDelay(INumberVectorProperty *nvp)
+    {
+        const double delay = IUFindNumber(nvp, "STREAM_DELAY_TIME")->value;
+        camera_state.update([delay](CameraState &state)
+                            { state.video.delay = delay; });
+        spdlog::debug("Current stream delay of {} is {}", _name, delay);
+    }
+
+    void INDICamera::onStreamingExposure(INumberVectorProperty *nvp)
+    {
+        const double exposure = IUFindNumber(nvp, "STREAMING_EXPOSURE_VALUE")->value;
+        const double division = IUFindNumber(nvp, "STREAMING_DIVISOR_VALUE")->value;
+        camera_state.update([=](CameraState &state)
+                            {
+            state.video.exposure = exposure;
+            state.video.division = division; });
+        spdlog::debug("Current streaming exposure of {} is {}", _name, exposure);
+        spdlog::debug("Current streaming division of {} is {}", _name, division);
+    }
+
+    void INDICamera::onFps(INumberVectorProperty *nvp)
+    {
+        const double fps = IUFindNumber(nvp, "EST_FPS")->value;
+        const double avgfps = IUFindNumber(nvp, "AVG_FPS")->value;
+        camera_state.update([=](CameraState &state)
+                            {
+            state.video.fps = fps;
+            state.video.avgfps = avgfps; });
+        spdlog::debug("Current fps of {} is {}", _name, fps);
+        spdlog::debug("Current average fps of {} is {}", _name, avgfps);
+    }
+
     void INDICamera::IndiServerConnected()
     {
         spdlog::debug("{} connection succeeded", _name);
@@ -537,31 +667,25 @@ namespace OpenAPT
 
     void INDICamera::ClearStatus()
     {
-        connection_prop = nullptr;
-        expose_prop = nullptr;
-        frame_prop = nullptr;
-        frame_type_prop = nullptr;
-        ccdinfo_prop = nullptr;
-        binning_prop = nullptr;
-        video_prop = nullptr;
-        camera_port = nullptr;
+        // 路由表绑定的属性指针
+        property_router.clear(*this);
+
         camera_device = nullptr;
-        debug_prop = nullptr;
-        polling_prop = nullptr;
-        active_device_prop = nullptr;
-        compression_prop = nullptr;
-        image_upload_mode_prop = nullptr;
-        fast_read_out_prop = nullptr;
-        camera_limit_prop = nullptr;
+        has_blob = false;
+        image_type_prop = nullptr;
+        indi_frame_x = nullptr;
+        indi_frame_y = nullptr;
+        indi_frame_width = nullptr;
+        indi_frame_height = nullptr;
+        indi_binning_x = nullptr;
+        indi_binning_y = nullptr;
 
         toupcam_fan_control_prop = nullptr;
         toupcam_heat_control_prop = nullptr;
         toupcam_hcg_control_prop = nullptr;
         toupcam_low_noise_control_prop = nullptr;
-        toupcam_simulation_prop = nullptr;
         toupcam_binning_mode_prop = nullptr;
 
-        asi_image_flip_prop = nullptr;
         asi_image_flip_hor_prop = nullptr;
         asi_image_flip_ver_prop = nullptr;
         asi_controls_prop = nullptr;
@@ -570,15 +694,46 @@ namespace OpenAPT
 
     INDICamera::INDICamera(const std::string &name) : Camera(name)
     {
+        BuildPropertyRoutes();
+        ClearStatus();
+
+        // 序列的第一个处理步骤：指定了文件名前缀时保存原始数据
+        exposure_sequencer.addHandler([this](const Image::Frame &frame, SequenceFrame &record)
+                                      {
+            if (sequence_prefix.empty())
+            {
+                return true;
+            }
+            record.filename = sequence_prefix + "_" + std::to_string(record.index + 1) + frame.meta.format;
+            std::ofstream file(record.filename, std::ios::binary);
+            file.write(reinterpret_cast<const char *>(frame.data), static_cast<std::streamsize>(frame.size));
+            return static_cast<bool>(file); });
     }
 
     INDICamera::~INDICamera()
     {
+        // 先停止 BLOB 连接，其回调会访问帧缓冲和预览
+        stream_client.disconnect();
+        blob_client.stop();
     }
 
     bool INDICamera::connect(std::string name)
     {
         spdlog::debug("Trying to connect to {}", name);
+        // BLOB 连接先于控制连接建立，控制连接收到 BLOB 属性时据此选择 B_NEVER 或 B_ALSO
+        bool blob_started = true;
+        if (blob_connection == BlobConnection::Stream)
+        {
+            blob_started = startStreamConnection(name);
+        }
+        else if (blob_connection == BlobConnection::Split)
+        {
+            blob_started = blob_client.start(hostname, port, name, indi_blob_name);
+        }
+        if (!blob_started)
+        {
+            spdlog::warn("{} falls back to a single connection for images", _name);
+        }
         setServer(hostname.c_str(), port);
         // Receive messages only for our camera.
         watchDevice(name.c_str());
@@ -594,6 +749,8 @@ namespace OpenAPT
 
     bool INDICamera::disconnect()
     {
+        stream_client.disconnect();
+        blob_client.stop();
         return true;
     }
 
@@ -625,37 +782,186 @@ namespace OpenAPT
             return false;
             ;
         }
+        if (paramName == "blob_connection")
+        {
+            // 下次连接时生效
+            if (paramValue == "stream")
+            {
+                blob_connection = BlobConnection::Stream;
+            }
+            else if (paramValue == "split")
+            {
+                blob_connection = BlobConnection::Split;
+            }
+            else if (paramValue == "shared")
+            {
+                blob_connection = BlobConnection::Shared;
+            }
+            else
+            {
+                spdlog::error("INDICamera::setParameter : blob_connection must be stream, split or shared");
+                return false;
+            }
+            return true;
+        }
         return false;
     }
 
-    bool INDICamera::startExposure(int duration_ms)
+    bool INDICamera::startExposure(double seconds)
     {
+        if (!expose_prop)
+        {
+            spdlog::error("{} does not provide CCD_EXPOSURE", _name);
+            return false;
+        }
+        // 记录当前帧序号，waitForExposureComplete 等待之后到达的帧
+        exposure_sequence = frame_ring.published();
+        exposure_duration = seconds;
+        expose_prop->np->value = seconds;
+        sendNewNumber(expose_prop);
+        is_exposuring = true;
+        camera_state.update([seconds](CameraState &state)
+                            {
+            state.exposure.duration = seconds;
+            state.exposure.exposing = true;
+            state.exposure.aborted = false; });
+        spdlog::debug("{} started {}s exposure", _name, seconds);
         return true;
     }
 
     bool INDICamera::stopExposure()
     {
+        if (!camera_device)
+        {
+            return false;
+        }
+        ISwitchVectorProperty *abort_prop = camera_device->getSwitch("CCD_ABORT_EXPOSURE");
+        if (!abort_prop)
+        {
+            spdlog::error("{} does not provide CCD_ABORT_EXPOSURE", _name);
+            return false;
+        }
+        ISwitch *abort_switch = IUFindSwitch(abort_prop, "ABORT");
+        if (!abort_switch)
+        {
+            return false;
+        }
+        IUResetSwitch(abort_prop);
+        abort_switch->s = ISS_ON;
+        sendNewSwitch(abort_prop);
+        is_exposuring = false;
         return true;
     }
 
     bool INDICamera::waitForExposureComplete()
     {
+        const auto deadline = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(static_cast<int64_t>(exposure_duration.load() * 1000)) + std::chrono::seconds(60);
+        uint64_t after = exposure_sequence.load();
+        Image::FrameRef frame;
+        while (true)
+        {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            frame = frame_ring.waitNext(after, std::max(remaining, std::chrono::milliseconds(0)));
+            // 视频流的帧不是本次曝光的结果，跳过
+            if (!frame || !frame->meta.video)
+            {
+                break;
+            }
+            after = frame->meta.sequence;
+        }
+        is_exposuring = false;
+        if (!frame)
+        {
+            spdlog::error("{} timed out waiting for exposure", _name);
+            return false;
+        }
+        exposure_sequence = frame->meta.sequence;
         return true;
     }
 
     // bool readImage(Image& image);
 
+    bool INDICamera::sendVideoStream(bool on)
+    {
+        if (!video_prop)
+        {
+            spdlog::error("{} does not provide {}VIDEO_STREAM", _name, indi_camera_cmd);
+            return false;
+        }
+        ISwitch *target = IUFindSwitch(video_prop, on ? "STREAM_ON" : "STREAM_OFF");
+        if (!target)
+        {
+            return false;
+        }
+        IUResetSwitch(video_prop);
+        target->s = ISS_ON;
+        sendNewSwitch(video_prop);
+        return true;
+    }
+
     bool INDICamera::startLiveView()
     {
+        if (!video_prop)
+        {
+            spdlog::error("{} does not provide {}VIDEO_STREAM", _name, indi_camera_cmd);
+            return false;
+        }
+        live_view.start();
+        if (!sendVideoStream(true))
+        {
+            live_view.stop();
+            return false;
+        }
+        spdlog::debug("{} started live view", _name);
         return true;
     }
 
     bool INDICamera::stopLiveView()
     {
+        // 录制仍在使用视频流时只停止预览
+        if (!ser_recorder.isRecording())
+        {
+            sendVideoStream(false);
+            recording_stream = false;
+        }
+        live_view.stop();
+        spdlog::debug("{} stopped live view", _name);
         return true;
     }
     // bool readLiveView(Image& image);
 
+    bool INDICamera::startRecording(const Image::SerSettings &settings)
+    {
+        if (!ser_recorder.start(settings))
+        {
+            return false;
+        }
+        // 直接开启视频流而不启动实时预览，预览编码会占用帧缓冲槽位，导致录制丢帧
+        if (!is_video)
+        {
+            if (!sendVideoStream(true))
+            {
+                ser_recorder.stop();
+                return false;
+            }
+            recording_stream = true;
+        }
+        return true;
+    }
+
+    bool INDICamera::stopRecording()
+    {
+        const bool ok = ser_recorder.stop();
+        // 只关闭为录制而开启、且没有被预览使用的视频流
+        if (recording_stream && !live_view.isRunning())
+        {
+            sendVideoStream(false);
+        }
+        recording_stream = false;
+        return ok;
+    }
+
     bool INDICamera::setCoolingOn(bool on)
     {
         return true;
@@ -715,7 +1021,7 @@ namespace OpenAPT
              }},
             {"Disconnect", [this](const nlohmann::json &tparams)
              {
-                 if (!this->is_connected && !this->camera_info["connected"].empty())
+                 if (!this->is_connected)
                  {
                      spdlog::warn("Camera is not connected, please do not execute disconnect command");
                      return;
@@ -727,7 +1033,7 @@ namespace OpenAPT
              }},
             {"Reconnect", [this](const nlohmann::json &tparams)
              {
-                 if (!this->is_connected && !this->camera_info["connected"].empty())
+                 if (!this->is_connected)
                  {
                      spdlog::warn("Camera is not connected, please do not execute reconnect command");
                      return;
@@ -776,6 +1082,66 @@ namespace OpenAPT
              {
                  this->stopLiveView();
              }},
+            {"StartRecording", [this](const nlohmann::json &tparams)
+             {
+                 Image::SerSettings settings;
+                 settings.filename = tparams.value("filename", "");
+                 if (settings.filename.empty())
+                 {
+                     spdlog::error("No SER file name specified for camera {}", _name);
+                     return;
+                 }
+                 settings.max_frames = tparams.value("frames", 0);
+                 settings.observer = tparams.value("observer", "");
+                 settings.telescope = tparams.value("telescope", "");
+                 settings.instrument = _name;
+                 if (!this->startRecording(settings))
+                 {
+                     spdlog::error("Failed to start recording on camera {}", _name);
+                 }
+             }},
+            {"StopRecording", [this](const nlohmann::json &tparams)
+             {
+                 if (!this->stopRecording())
+                 {
+                     spdlog::error("Failed to stop recording on camera {}", _name);
+                 }
+             }},
+            {"RunSequence", [this](const nlohmann::json &tparams)
+             {
+                 SequenceSettings settings;
+                 settings.count = tparams.value("count", 1);
+                 settings.exposure = tparams.value("exposure", 1.0);
+                 settings.workers = tparams.value("workers", 2);
+                 // 处理中的帧会占用帧缓冲槽位，留出至少两个给新帧
+                 settings.max_pending = std::min<size_t>(tparams.value("max_pending", 2), std::max<size_t>(frame_ring.slots(), 3) - 2);
+                 // 在 run 之前写入，处理线程在序列中只读取
+                 sequence_prefix = tparams.value("prefix", "");
+                 const auto frames = this->exposure_sequencer.run(settings);
+                 spdlog::info("{} sequence: {}", _name, ExposureSequencer::toJson(frames).dump());
+             }},
+            {"AbortSequence", [this](const nlohmann::json &tparams)
+             {
+                 this->exposure_sequencer.abort();
+             }},
+            {"StartLuckyRanking", [this](const nlohmann::json &tparams)
+             {
+                 Image::LuckySettings settings;
+                 const std::string metric = tparams.value("metric", "laplacian");
+                 settings.metric = metric == "psf"        ? Image::SharpnessMetric::PsfWidth
+                                   : metric == "gradient" ? Image::SharpnessMetric::GradientEnergy
+                                                          : Image::SharpnessMetric::LaplacianVariance;
+                 settings.keep_fraction = tparams.value("keep", 0.1);
+                 settings.roi = {tparams.value("x", 0), tparams.value("y", 0), tparams.value("width", 0), tparams.value("height", 0)};
+                 if (!this->lucky_ranker.start(settings))
+                 {
+                     spdlog::error("Failed to start lucky imaging ranking on camera {}", _name);
+                 }
+             }},
+            {"StopLuckyRanking", [this](const nlohmann::json &tparams)
+             {
+                 this->lucky_ranker.stop();
+             }},
             {"Cooling", [this](const nlohmann::json &tparams)
              {
                  if (!this->can_cooling)
@@ -32,12 +32,23 @@ Description: INDI Camera
 #pragma once
 
 #include "api/indiclient.hpp"
+#include "api/indiblobclient.hpp"
+#include "api/indistreamclient.hpp"
 #include "device/basic_device.hpp"
 #include "task/camera_task.hpp"
+#include "device/camera_state.hpp"
+#include "image/frame_ring.hpp"
+#include "image/live_view.hpp"
+#include "image/ser_recorder.hpp"
+#include "image/lucky_ranker.hpp"
+#include "task/exposure_sequencer.hpp"
+#include "thread/seqlock.hpp"
+#include "property_router.hpp"
 
 #include <libindi/basedevice.h>
 #include <libindi/indiproperty.h>
 
+#include <atomic>
 #include <string>
 
 #include <spdlog/spdlog.h>
@@ -57,6 +68,8 @@ namespace OpenAPT
         INumberVectorProperty *frame_prop;
         // 温度属性
         INumberVectorProperty *temperature_prop;
+        // 制冷功率属性
+        INumberVectorProperty *cooler_power_prop = nullptr;
         // 增益属性
         INumberVectorProperty *gain_prop;
         // 偏移属性
@@ -107,16 +120,58 @@ namespace OpenAPT
 
         // 标志位
         bool is_ready; // 是否就绪
-        bool has_blob; // 是否有 BLOB 数据
+        std::atomic_bool has_blob{false}; // 控制连接上是否已定义 BLOB 属性
 
         // INDI 指令
         std::string indi_camera_cmd = "CCD_"; // INDI 控制命令前缀
-        std::string indi_blob_name;           // BLOB 文件名
+        std::string indi_blob_name = "CCD1";  // BLOB 文件名
         std::string indi_camera_exec = "";    // INDI 执行命令
         std::string indi_camera_version;
         std::string indi_camera_interface;
 
-        nlohmann::json camera_info;
+        // 图像的接收方式，下次连接时生效
+        enum class BlobConnection
+        {
+            Shared, // 与属性更新共用控制连接
+            Split,  // 基于 libindi 的独立 BLOB 连接
+            Stream, // 原生流式 BLOB 连接，边接收边解码到帧缓冲
+        };
+        BlobConnection blob_connection = BlobConnection::Stream;
+        // 只接收 BLOB 的第二条连接，收到的图像交给 newBLOB
+        OpenAptIndiBlobClient blob_client{[this](IBLOB *bp)
+                                          { newBLOB(bp); },
+                                          [this]()
+                                          { onBlobConnectionLost(); }};
+        // 原生流式 BLOB 连接，正在接收的 BLOB 解码到预留的帧缓冲槽位
+        API::IndiStreamClient stream_client{makeStreamHandlers()};
+        Image::FrameRing::Reservation blob_reservation;
+
+        // 相机状态，INDI 线程写入，读者无锁读取一致的快照
+        Thread::SeqLock<CameraState> camera_state;
+
+        // 接收到的图像帧，INDI 线程只负责写入，保存、分析与预览从中读取
+        // 槽位在收到 CCD_INFO 时按最大画幅分配
+        Image::FrameRing frame_ring{4, 0};
+        // 实时预览流水线，视频帧到达时提交，队列深度小于帧缓冲槽位数
+        Image::LiveView live_view;
+        // SER 视频录制，从帧缓冲读取视频帧
+        Image::SerRecorder ser_recorder{frame_ring};
+        // 视频流是否由录制开启，停止录制时据此关闭
+        bool recording_stream = false;
+        // 幸运成像帧评分，使用独立的线程池
+        Image::LuckyRanker lucky_ranker{frame_ring};
+        // 流水线式曝光序列，通过 startExposure 发起每一帧
+        ExposureSequencer exposure_sequencer{frame_ring, [this](double seconds)
+                                             { return startExposure(seconds); }};
+        // 序列保存文件的前缀，为空时不保存
+        std::string sequence_prefix;
+        // 当前曝光时长（秒），由 CCD_EXPOSURE 的 BUSY 状态记录；INDI 线程和发起曝光的线程都会读写
+        std::atomic<double> exposure_duration{0};
+        // 发起曝光时帧缓冲的最新序号
+        std::atomic_uint64_t exposure_sequence{0};
+
+        // 属性名到成员字段与处理函数的路由表，构造时建立
+        PropertyRouter<INDICamera> property_router;
 
     private:
 
@@ -168,8 +223,8 @@ namespace OpenAPT
 
         bool setParameter(const std::string &paramName, const std::string &paramValue) override;
 
-        // 开始曝光
-        bool startExposure(int duration_ms) override;
+        // 开始曝光，以秒为单位，保留幸运成像所需的亚毫秒精度
+        bool startExposure(double seconds) override;
         // 停止曝光
         bool stopExposure() override;
         // 等待曝光完成
@@ -180,6 +235,11 @@ namespace OpenAPT
         // 停止实时预览
         bool stopLiveView() override;
 
+        // 开始录制 SER 视频，未开启视频流时自动开启（不启动实时预览）
+        bool startRecording(const Image::SerSettings &settings);
+        // 停止录制并写入文件尾，关闭为录制开启的视频流
+        bool stopRecording();
+
         // 设置制冷
         bool setCoolingOn(bool on) override;
         // 设置温度
@@ -205,6 +265,48 @@ namespace OpenAPT
         // 设置帧区域
         bool setROIFrame(int start_x, int start_y, int frame_x, int frame_y) override;
 
+        // 获取相机状态快照，不会阻塞 INDI 线程
+        CameraState getState() const
+        {
+            return camera_state.load();
+        }
+
+        // 相机状态的写入次数，可用于判断状态是否变化
+        uint64_t getStateVersion() const
+        {
+            return camera_state.version();
+        }
+
+        // 按需生成相机状态的 JSON
+        nlohmann::json getCameraInfo() const
+        {
+            return CameraStateToJson(camera_state.load());
+        }
+
+        // 获取帧缓冲，消费者通过 waitNext/latest 读取新帧
+        Image::FrameRing &getFrameRing()
+        {
+            return frame_ring;
+        }
+
+        // 获取实时预览，客户端通过 addClient 订阅预览帧
+        Image::LiveView &getLiveView()
+        {
+            return live_view;
+        }
+
+        // 获取幸运成像帧评分，录制时可用 best() 得到最清晰的帧
+        Image::LuckyRanker &getLuckyRanker()
+        {
+            return lucky_ranker;
+        }
+
+        // 获取曝光序列，addHandler 添加保存与分析步骤后用 run 执行
+        ExposureSequencer &getSequencer()
+        {
+            return exposure_sequencer;
+        }
+
         // 获取简单任务
         std::shared_ptr<OpenAPT::SimpleTask> getSimpleTask(const std::string &task_name, const nlohmann::json &params) override;
         // 获取条件任务
@@ -216,6 +318,57 @@ namespace OpenAPT
         // 清空状态
         void ClearStatus();
 
+        // 建立属性路由表
+        void BuildPropertyRoutes();
+
+        // 流式 BLOB 连接的回调
+        API::IndiStreamClient::Handlers makeStreamHandlers();
+        // 连接流式 BLOB 连接并只订阅相机的 BLOB
+        bool startStreamConnection(const std::string &name);
+        // 由相机状态快照生成帧信息，可在任意接收线程调用
+        Image::FrameMeta makeFrameMeta(const std::string &format) const;
+        // 视频帧发布后交给实时预览
+        void forwardToLiveView(bool video);
+        // 发送 VIDEO_STREAM 的 STREAM_ON / STREAM_OFF
+        bool sendVideoStream(bool on);
+
+        // 让控制连接接收 BLOB（B_ALSO），单连接模式或 BLOB 连接断开后使用
+        void enableSharedBlob();
+        // BLOB 连接意外断开，在该连接的线程中调用
+        void onBlobConnectionLost();
+
+        // 属性出现时的处理
+        void onBlobProperty(INDI::Property *property);
+        void onCfaProperty(INDI::Property *property);
+        void onPortProperty(INDI::Property *property);
+        void onConnectionProperty(INDI::Property *property);
+        void onDriverInfoProperty(INDI::Property *property);
+
+        // 开关属性更新
+        void onConnection(ISwitchVectorProperty *svp);
+        void onDebug(ISwitchVectorProperty *svp);
+        void onFrameType(ISwitchVectorProperty *svp);
+        void onTransferFormat(ISwitchVectorProperty *svp);
+        void onAbortExposure(ISwitchVectorProperty *svp);
+        void onUploadMode(ISwitchVectorProperty *svp);
+        void onFastToggle(ISwitchVectorProperty *svp);
+        void onVideoStream(ISwitchVectorProperty *svp);
+
+        // 数值属性更新
+        void onExposure(INumberVectorProperty *nvp);
+        void onInfo(INumberVectorProperty *nvp);
+        void onBinning(INumberVectorProperty *nvp);
+        void onFrame(INumberVectorProperty *nvp);
+        void onTemperature(INumberVectorProperty *nvp);
+        void onCoolerPower(INumberVectorProperty *nvp);
+        void onGain(INumberVectorProperty *nvp);
+        void onOffset(INumberVectorProperty *nvp);
+        void onPolling(INumberVectorProperty *nvp);
+        void onLimits(INumberVectorProperty *nvp);
+        void onStreamDelay(INumberVectorProperty *nvp);
+        void onStreamingExposure(INumberVectorProperty *nvp);
+        void onFps(INumberVectorProperty *nvp);
+
         // INDI Client API
     protected:
         // 新设备
@@ -45,50 +45,7 @@ namespace OpenAPT
 
     void INDIFilterwheel::newSwitch(ISwitchVectorProperty *svp)
     {
-        std::string const connection_str{"CONNECTION"};
-        std::string const baud_rate_str{"DEVICE_BAUD_RATE"};
-
-        if (svp->name == connection_str)
-        {
-            ISwitch *connectswitch = IUFindSwitch(svp, "CONNECT");
-            if (connectswitch->s == ISS_ON)
-            {
-                is_connected = true;
-                spdlog::info("{} is connected", _name);
-            }
-            else
-            {
-                if (is_ready)
-                {
-                    ClearStatus();
-                    spdlog::info("{} is disconnected", _name);
-                }
-            }
-        }
-        else if (svp->name == baud_rate_str)
-        {
-            std::string const baud_9600{"9600"};
-            std::string const baud_19200{"19200"};
-            std::string const baud_38400{"38400"};
-            std::string const baud_57600{"57600"};
-            std::string const baud_115200{"115200"};
-            std::string const baud_230400{"230400"};
-
-            if (IUFindSwitch(svp, "9600")->s == ISS_ON)
-                indi_filter_rate = baud_9600;
-            else if (IUFindSwitch(svp, "19200")->s == ISS_ON)
-                indi_filter_rate = baud_19200;
-            else if (IUFindSwitch(svp, "38400")->s == ISS_ON)
-                indi_filter_rate = baud_38400;
-            else if (IUFindSwitch(svp, "57600")->s == ISS_ON)
-                indi_filter_rate = baud_57600;
-            else if (IUFindSwitch(svp, "115200")->s == ISS_ON)
-                indi_filter_rate = baud_115200;
-            else if (IUFindSwitch(svp, "230400")->s == ISS_ON)
-                indi_filter_rate = baud_230400;
-
-            spdlog::debug("{} baud rate : {}", _name, indi_filter_rate);
-        }
+        property_router.dispatch(*this, svp);
     }
 
     void INDIFilterwheel::newMessage(INDI::BaseDevice *dp, int messageID)
@@ -123,10 +80,7 @@ namespace OpenAPT
         }
         spdlog::debug("{} Received Number: {} = {} state = {}", _name, nvp->name, os.str().c_str(), StateStr(nvp->s));
 
-        if (nvp == filterinfo_prop)
-        {
-            // do nothing
-        }
+        property_router.dispatch(*this, nvp);
     }
 
     void INDIFilterwheel::newText(ITextVectorProperty *tvp)
@@ -141,64 +95,84 @@ namespace OpenAPT
 
     void INDIFilterwheel::newProperty(INDI::Property *property)
     {
-        std::string PropName(property->getName());
-        INDI_PROPERTY_TYPE Proptype = property->getType();
-
         spdlog::debug("{} Property: {}", _name, property->getName());
+        property_router.dispatchProperty(*this, property);
+    }
 
-        if (PropName == "DEVICE_PORT" && Proptype == INDI_TEXT)
+    void INDIFilterwheel::BuildPropertyRoutes()
+    {
+        const auto cmd = [this](const char *name)
         {
-            spdlog::debug("{} Found device port for {} ", _name, property->getDeviceName());
-            filter_port = property->getText();
-        }
-        else if (PropName == "CONNECTION" && Proptype == INDI_SWITCH)
+            return PropertyName::runtime(indi_filter_cmd + name);
+        };
+
+        property_router
+            .bind("CONNECTION", &INDIFilterwheel::connection_prop, &INDIFilterwheel::onConnection)
+            .onProperty("CONNECTION", INDI_SWITCH, &INDIFilterwheel::onConnectionProperty)
+            .bind("DEVICE_PORT", &INDIFilterwheel::filter_port)
+            .onProperty("DEVICE_PORT", INDI_TEXT, &INDIFilterwheel::onPortProperty)
+            .onProperty("DRIVER_INFO", INDI_TEXT, &INDIFilterwheel::onDriverInfoProperty)
+            .bind(cmd("INFO"), &INDIFilterwheel::filterinfo_prop)
+            .bind(cmd("DEVICE_BAUD_RATE"), &INDIFilterwheel::rate_prop, &INDIFilterwheel::onBaudRate);
+    }
+
+    void INDIFilterwheel::onConnectionProperty(INDI::Property *property)
+    {
+        spdlog::debug("{} Found CONNECTION for {}", _name, property->getDeviceName());
+        ISwitch *connectswitch = IUFindSwitch(connection_prop, "CONNECT");
+        is_connected = (connectswitch->s == ISS_ON);
+        if (!is_connected)
         {
-            spdlog::debug("{} Found CONNECTION for {} {}", _name, property->getDeviceName(), PropName);
-            connection_prop = property->getSwitch();
-            ISwitch *connectswitch = IUFindSwitch(connection_prop, "CONNECT");
-            is_connected = (connectswitch->s == ISS_ON);
-            if (!is_connected)
-            {
-                connection_prop->sp->s = ISS_ON;
-                sendNewSwitch(connection_prop);
-            }
-            spdlog::debug("{} Connected {}", _name, is_connected);
+            connection_prop->sp->s = ISS_ON;
+            sendNewSwitch(connection_prop);
         }
-        else if (PropName == "DRIVER_INFO" && Proptype == INDI_TEXT)
+        spdlog::debug("{} Connected {}", _name, is_connected.load());
+    }
+
+    void INDIFilterwheel::onPortProperty(INDI::Property *property)
+    {
+        spdlog::debug("{} Found device port for {} ", _name, property->getDeviceName());
+        if (IText *port = IUFindText(filter_port, "PORT"); port && port->text)
         {
-            device_name = IUFindText(property->getText(), "DRIVER_NAME")->text;
-            indi_filter_exec = IUFindText(property->getText(), "DRIVER_EXEC")->text;
-            indi_filter_version = IUFindText(property->getText(), "DRIVER_VERSION")->text;
-            indi_filter_interface = IUFindText(property->getText(), "DRIVER_INTERFACE")->text;
-            spdlog::debug("{} Name : {} connected exec {}", _name, device_name, indi_filter_exec);
+            indi_filter_port = port->text;
+            spdlog::debug("{} USB Port : {}", _name, indi_filter_port);
         }
-        else if (PropName == indi_filter_cmd + "INFO" && Proptype == INDI_NUMBER)
+    }
+
+    void INDIFilterwheel::onDriverInfoProperty(INDI::Property *property)
+    {
+        device_name = IUFindText(property->getText(), "DRIVER_NAME")->text;
+        indi_filter_exec = IUFindText(property->getText(), "DRIVER_EXEC")->text;
+        indi_filter_version = IUFindText(property->getText(), "DRIVER_VERSION")->text;
+        indi_filter_interface = IUFindText(property->getText(), "DRIVER_INTERFACE")->text;
+        spdlog::debug("{} Name : {} connected exec {}", _name, device_name, indi_filter_exec);
+    }
+
+    void INDIFilterwheel::onConnection(ISwitchVectorProperty *svp)
+    {
+        ISwitch *connectswitch = IUFindSwitch(svp, "CONNECT");
+        if (connectswitch->s == ISS_ON)
         {
-            filterinfo_prop = property->getNumber();
-            newNumber(filterinfo_prop);
+            is_connected = true;
+            spdlog::info("{} is connected", _name);
         }
-        else if (PropName == indi_filter_cmd + "DEVICE_BAUD_RATE" && Proptype == INDI_SWITCH)
+        else
         {
-            rate_prop = property->getSwitch();
-            if (IUFindSwitch(rate_prop, "9600")->s == ISS_ON)
-                indi_filter_rate = "9600";
-            else if (IUFindSwitch(rate_prop, "19200")->s == ISS_ON)
-                indi_filter_rate = "19200";
-            else if (IUFindSwitch(rate_prop, "38400")->s == ISS_ON)
-                indi_filter_rate = "38400";
-            else if (IUFindSwitch(rate_prop, "57600")->s == ISS_ON)
-                indi_filter_rate = "57600";
-            else if (IUFindSwitch(rate_prop, "115200")->s == ISS_ON)
-                indi_filter_rate = "115200";
-            else if (IUFindSwitch(rate_prop, "230400")->s == ISS_ON)
-                indi_filter_rate = "230400";
-            spdlog::debug("{} baud rate : {}", _name, indi_filter_rate);
+            if (is_ready)
+            {
+                ClearStatus();
+                spdlog::info("{} is disconnected", _name);
+            }
         }
-        else if (PropName == indi_filter_cmd + "DEVICE_PORT" && Proptype == INDI_TEXT)
+    }
+
+    void INDIFilterwheel::onBaudRate(ISwitchVectorProperty *svp)
+    {
+        if (ISwitch *rate = IUFindOnSwitch(svp))
         {
-            indi_filter_port = IUFindText(property->getText(), "PORT")->text;
-            spdlog::debug("{} USB Port : {}", _name, indi_filter_port);
+            indi_filter_rate = rate->name;
         }
+        spdlog::debug("{} baud rate : {}", _name, indi_filter_rate);
     }
 
     void INDIFilterwheel::IndiServerConnected()
@@ -225,18 +199,16 @@ namespace OpenAPT
 
     void INDIFilterwheel::ClearStatus()
     {
-        connection_prop = nullptr;
-        filter_port = nullptr;
-        filter_device = nullptr;
-        connection_prop = nullptr;
-        rate_prop = nullptr;
-        filterinfo_prop = nullptr;
-        filter_port = nullptr;
+        // 路由表绑定的属性指针
+        property_router.clear(*this);
+
         filter_device = nullptr;
     }
 
     INDIFilterwheel::INDIFilterwheel(const std::string &name) : Filterwheel(name)
     {
+        BuildPropertyRoutes();
+        ClearStatus();
         spdlog::debug("INDI filterwheel {} init successfully", name);
     }
 
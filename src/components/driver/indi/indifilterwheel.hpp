@@ -33,6 +33,7 @@ Description: INDI Filterwheel
 
 #include "api/indiclient.hpp"
 #include "device/basic_device.hpp"
+#include "property_router.hpp"
 
 #include <libindi/basedevice.h>
 #include <libindi/indiproperty.h>
@@ -64,6 +65,9 @@ namespace OpenAPT
         std::string indi_filter_version = "";
         std::string indi_filter_interface = "";
 
+        // 属性路由表，构造时建立
+        PropertyRouter<INDIFilterwheel> property_router;
+
     public:
         INDIFilterwheel(const std::string &name);
         ~INDIFilterwheel();
@@ -83,6 +87,16 @@ namespace OpenAPT
     protected:
         void ClearStatus();
 
+        // 建立属性路由表
+        void BuildPropertyRoutes();
+
+        void onConnectionProperty(INDI::Property *property);
+        void onPortProperty(INDI::Property *property);
+        void onDriverInfoProperty(INDI::Property *property);
+
+        void onConnection(ISwitchVectorProperty *svp);
+        void onBaudRate(ISwitchVectorProperty *svp);
+
     protected:
         void newDevice(INDI::BaseDevice *dp) override;
         void removeDevice(INDI::BaseDevice *dp) override;
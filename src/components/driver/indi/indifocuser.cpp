@@ -45,74 +45,7 @@ namespace OpenAPT
 
     void INDIFocuser::newSwitch(ISwitchVectorProperty *svp)
     {
-        std::string const connection_str{"CONNECTION"};
-        std::string const mode_str{"Mode"};
-        std::string const baud_rate_str{"DEVICE_BAUD_RATE"};
-
-        if (svp->name == connection_str)
-        {
-            ISwitch *connectswitch = IUFindSwitch(svp, "CONNECT");
-            if (connectswitch->s == ISS_ON)
-            {
-                is_connected = true;
-                spdlog::info("{} is connected", _name);
-            }
-            else
-            {
-                if (is_ready)
-                {
-                    ClearStatus();
-                    spdlog::info("{} is disconnected", _name);
-                }
-            }
-        }
-        else if (svp->name == mode_str)
-        {
-            ISwitch *modeswitch = IUFindSwitch(svp, "All");
-            if (modeswitch->s == ISS_ON)
-            {
-                can_absolute_move = true;
-                current_mode = 0;
-            }
-            else
-            {
-                modeswitch = IUFindSwitch(svp, "Absolute");
-                if (modeswitch->s == ISS_ON)
-                {
-                    can_absolute_move = true;
-                    current_mode = 1;
-                }
-                else
-                {
-                    can_absolute_move = false;
-                    current_mode = 2;
-                }
-            }
-        }
-        else if (svp->name == baud_rate_str)
-        {
-            std::string const baud_9600{"9600"};
-            std::string const baud_19200{"19200"};
-            std::string const baud_38400{"38400"};
-            std::string const baud_57600{"57600"};
-            std::string const baud_115200{"115200"};
-            std::string const baud_230400{"230400"};
-
-            if (IUFindSwitch(svp, "9600")->s == ISS_ON)
-                indi_focuser_rate = baud_9600;
-            else if (IUFindSwitch(svp, "19200")->s == ISS_ON)
-                indi_focuser_rate = baud_19200;
-            else if (IUFindSwitch(svp, "38400")->s == ISS_ON)
-                indi_focuser_rate = baud_38400;
-            else if (IUFindSwitch(svp, "57600")->s == ISS_ON)
-                indi_focuser_rate = baud_57600;
-            else if (IUFindSwitch(svp, "115200")->s == ISS_ON)
-                indi_focuser_rate = baud_115200;
-            else if (IUFindSwitch(svp, "230400")->s == ISS_ON)
-                indi_focuser_rate = baud_230400;
-
-            spdlog::debug("{} baud rate : {}", _name, indi_focuser_rate);
-        }
+        property_router.dispatch(*this, svp);
     }
 
     void INDIFocuser::newMessage(INDI::BaseDevice *dp, int messageID)
@@ -147,14 +80,7 @@ namespace OpenAPT
         }
         spdlog::debug("{} Received Number: {} = {} state = {}", _name, nvp->name, os.str().c_str(), StateStr(nvp->s));
 
-        if (nvp == focuserinfo_prop)
-        {
-            // do nothing
-        }
-        else if (nvp == temperature_prop)
-        {
-            current_temperature = IUFindNumber(temperature_prop, "CCD_TEMPERATURE_VALUE")->value;
-        }
+        property_router.dispatch(*this, nvp);
     }
 
     void INDIFocuser::newText(ITextVectorProperty *tvp)
@@ -171,173 +97,166 @@ namespace OpenAPT
 
     void INDIFocuser::newProperty(INDI::Property *property)
     {
-        std::string PropName(property->getName());
-        INDI_PROPERTY_TYPE Proptype = property->getType();
-
-        if (Proptype != INDI_TEXT && Proptype != INDI_SWITCH && Proptype != INDI_NUMBER)
+        if (!property_router.dispatchProperty(*this, property))
         {
-            spdlog::warn("{} Unknown property type: {}", _name, Proptype);
-            return;
+            spdlog::debug("{} Unhandled property: {}", _name, property->getName());
         }
+    }
 
-        if (PropName.empty())
+    void INDIFocuser::BuildPropertyRoutes()
+    {
+        const auto cmd = [this](const char *name)
         {
-            spdlog::warn("{} Property name is empty", _name);
-            return;
-        }
+            return PropertyName::runtime(indi_focuser_cmd + name);
+        };
+
+        property_router
+            .bind("CONNECTION", &INDIFocuser::connection_prop, &INDIFocuser::onConnection)
+            .onProperty("CONNECTION", INDI_SWITCH, &INDIFocuser::onConnectionProperty)
+            .bind("DEVICE_PORT", &INDIFocuser::focuser_port)
+            .onProperty("DEVICE_PORT", INDI_TEXT, &INDIFocuser::onPortProperty)
+            .onProperty("DRIVER_INFO", INDI_TEXT, &INDIFocuser::onDriverInfoProperty)
+            .bind(cmd("Mode"), &INDIFocuser::mode_prop, &INDIFocuser::onMode)
+            .bind(cmd("DEVICE_BAUD_RATE"), &INDIFocuser::rate_prop, &INDIFocuser::onBaudRate)
+            .bind(cmd("FOCUS_MOTION"), &INDIFocuser::motion_prop, &INDIFocuser::onMotion)
+            .bind(cmd("FOCUS_BACKLASH_TOGGLE"), &INDIFocuser::backlash_prop, &INDIFocuser::onBacklash)
+            .bind(cmd("INFO"), &INDIFocuser::focuserinfo_prop)
+            .bind(cmd("FOCUS_SPEED"), &INDIFocuser::speed_prop, &INDIFocuser::onSpeed)
+            .bind(cmd("ABS_FOCUS_POSITION"), &INDIFocuser::absolute_position_prop, &INDIFocuser::onAbsolutePosition)
+            .bind(cmd("DELAY"), &INDIFocuser::delay_prop, &INDIFocuser::onDelay)
+            .bind(cmd("FOCUS_TEMPERATURE"), &INDIFocuser::temperature_prop, &INDIFocuser::onTemperature)
+            .bind(cmd("FOCUS_MAX"), &INDIFocuser::max_position_prop, &INDIFocuser::onMaxPosition);
+    }
 
-        bool switch_on = false;
-        if (Proptype == INDI_SWITCH)
+    void INDIFocuser::onConnectionProperty(INDI::Property *property)
+    {
+        spdlog::debug("{} Found CONNECTION for {}", _name, property->getDeviceName());
+        ISwitch *connectswitch = IUFindSwitch(connection_prop, "CONNECT");
+        is_connected = connectswitch && connectswitch->s == ISS_ON;
+        if (!is_connected)
         {
-            ISwitchVectorProperty *switch_prop = property->getSwitch();
-            ISwitch *switch_connect = IUFindSwitch(switch_prop, "CONNECT");
-            if (switch_connect)
-            {
-                switch_on = (switch_connect->s == ISS_ON);
-            }
+            connection_prop->sp->s = ISS_ON;
+            sendNewSwitch(connection_prop);
         }
+        spdlog::debug("{} Connected {}", _name, is_connected.load());
+    }
 
-        double prop_value = 0;
-        if (Proptype == INDI_NUMBER)
+    void INDIFocuser::onPortProperty(INDI::Property *property)
+    {
+        spdlog::debug("{} Found device port for {}", _name, property->getDeviceName());
+        if (IText *port = IUFindText(focuser_port, "PORT"); port && port->text)
         {
-            INumberVectorProperty *num_prop = property->getNumber();
-            INumber *num_value = IUFindNumber(num_prop, "FOCUS_ABSOLUTE_POSITION");
-            if (num_value)
-            {
-                prop_value = num_value->value;
-            }
-            else
-            {
-                spdlog::warn("{} Unknown number property: {}", _name, PropName);
-                return;
-            }
+            indi_focuser_port = port->text;
+            spdlog::debug("{} USB Port : {}", _name, indi_focuser_port);
         }
+    }
 
-        switch (property->getType())
+    void INDIFocuser::onDriverInfoProperty(INDI::Property *property)
+    {
+        device_name = IUFindText(property->getText(), "DRIVER_NAME")->text;
+        indi_focuser_exec = IUFindText(property->getText(), "DRIVER_EXEC")->text;
+        indi_focuser_version = IUFindText(property->getText(), "DRIVER_VERSION")->text;
+        indi_focuser_interface = IUFindText(property->getText(), "DRIVER_INTERFACE")->text;
+        focuser_info["driver"]["name"] = device_name;
+        focuser_info["driver"]["exec"] = indi_focuser_exec;
+        focuser_info["driver"]["version"] = indi_focuser_version;
+        focuser_info["driver"]["interfaces"] = indi_focuser_interface;
+        spdlog::debug("{} Name : {} connected exec {}", _name, device_name, indi_focuser_exec);
+    }
+
+    void INDIFocuser::onConnection(ISwitchVectorProperty *svp)
+    {
+        ISwitch *connectswitch = IUFindSwitch(svp, "CONNECT");
+        if (connectswitch->s == ISS_ON)
         {
-        case INDI_TEXT:
+            is_connected = true;
+            spdlog::info("{} is connected", _name);
+        }
+        else
         {
-            if (PropName == "DEVICE_PORT")
-            {
-                spdlog::debug("{} Found device port for {}", _name, property->getDeviceName());
-                focuser_port = property->getText();
-            }
-            else if (PropName == "DRIVER_INFO")
+            if (is_ready)
             {
-                device_name = IUFindText(property->getText(), "DRIVER_NAME")->text;
-                indi_focuser_exec = IUFindText(property->getText(), "DRIVER_EXEC")->text;
-                indi_focuser_version = IUFindText(property->getText(), "DRIVER_VERSION")->text;
-                indi_focuser_interface = IUFindText(property->getText(), "DRIVER_INTERFACE")->text;
-                focuser_info["driver"]["name"] = device_name;
-                focuser_info["driver"]["exec"] = indi_focuser_exec;
-                focuser_info["driver"]["version"] = indi_focuser_version;
-                focuser_info["driver"]["interfaces"] = indi_focuser_interface;
-                spdlog::debug("{} Name : {} connected exec {}", _name, device_name, indi_focuser_exec);
+                ClearStatus();
+                spdlog::info("{} is disconnected", _name);
             }
-            else if (PropName == indi_focuser_cmd + "DEVICE_PORT")
-            {
-                indi_focuser_port = IUFindText(property->getText(), "PORT")->text;
-                spdlog::debug("{} USB Port : {}", _name, indi_focuser_port);
-            }
-            break;
         }
-        case INDI_SWITCH:
+    }
+
+    void INDIFocuser::onMode(ISwitchVectorProperty *svp)
+    {
+        ISwitch *modeswitch = IUFindSwitch(svp, "All");
+        if (modeswitch->s == ISS_ON)
         {
-            if (PropName == "CONNECTION")
-            {
-                spdlog::debug("{} Found CONNECTION for {} {}", _name, property->getDeviceName(), PropName);
-                connection_prop = property->getSwitch();
-                is_connected = switch_on;
-                if (!is_connected)
-                {
-                    connection_prop->sp->s = ISS_ON;
-                    sendNewSwitch(connection_prop);
-                }
-                spdlog::debug("{} Connected {}", _name, is_connected);
-            }
-            else if (PropName == indi_focuser_cmd + "Mode")
-            {
-                mode_prop = property->getSwitch();
-                newSwitch(mode_prop);
-            }
-            else if (PropName == indi_focuser_cmd + "DEVICE_BAUD_RATE")
-            {
-                rate_prop = property->getSwitch();
-                if (IUFindSwitch(rate_prop, "9600")->s == ISS_ON)
-                    indi_focuser_rate = "9600";
-                else if (IUFindSwitch(rate_prop, "19200")->s == ISS_ON)
-                    indi_focuser_rate = "19200";
-                else if (IUFindSwitch(rate_prop, "38400")->s == ISS_ON)
-                    indi_focuser_rate = "38400";
-                else if (IUFindSwitch(rate_prop, "57600")->s == ISS_ON)
-                    indi_focuser_rate = "57600";
-                else if (IUFindSwitch(rate_prop, "115200")->s == ISS_ON)
-                    indi_focuser_rate = "115200";
-                else if (IUFindSwitch(rate_prop, "230400")->s == ISS_ON)
-                    indi_focuser_rate = "230400";
-                spdlog::debug("{} baud rate : {}", _name, indi_focuser_rate);
-            }
-            else if (PropName == indi_focuser_cmd + "FOCUS_MOTION")
-            {
-                current_motion = (IUFindSwitch(motion_prop, "FOCUS_INWARD")->s == ISS_ON) ? 0 : 1;
-                spdlog::debug("{} is moving {}", _name, current_motion ? "outward" : "inward");
-            }
-            else if (PropName == indi_focuser_cmd + "FOCUS_BACKLASH_TOGGLE")
-            {
-                has_backlash = (IUFindSwitch(backlash_prop, "INDI_ENABLED")->s == ISS_ON);
-                spdlog::debug("{} Has Backlash : {}", _name, has_backlash);
-            }
-            break;
+            can_absolute_move = true;
+            current_mode = 0;
         }
-        case INDI_NUMBER:
+        else
         {
-            if (PropName == indi_focuser_cmd + "INFO")
-            {
-                focuserinfo_prop = property->getNumber();
-                newNumber(focuserinfo_prop);
-            }
-            else if (PropName == indi_focuser_cmd + "FOCUS_SPEED")
-            {
-                speed_prop = property->getNumber();
-                current_speed = prop_value;
-                spdlog::debug("{} Current Speed : {}", _name, current_speed);
-            }
-            else if (PropName == indi_focuser_cmd + "ABS_FOCUS_POSITION")
-            {
-                absolute_position_prop = property->getNumber();
-                current_position = prop_value;
-                spdlog::debug("{} Current Absolute Position : {}", _name, current_position);
-            }
-            else if (PropName == indi_focuser_cmd + "DELAY")
-            {
-                delay_prop = property->getNumber();
-                delay = prop_value;
-                spdlog::debug("{} Current Delay : {}", _name, delay);
-            }
-            else if (PropName == indi_focuser_cmd + "FOCUS_TEMPERATURE")
-            {
-                temperature_prop = property->getNumber();
-                current_temperature = prop_value;
-                spdlog::debug("{} Current Temperature : {}", _name, current_temperature);
-            }
-            else if (PropName == indi_focuser_cmd + "FOCUS_MAX")
+            modeswitch = IUFindSwitch(svp, "Absolute");
+            if (modeswitch->s == ISS_ON)
             {
-                max_position_prop = property->getNumber();
-                max_position = prop_value;
-                spdlog::debug("{} Max Position : {}", _name, max_position);
+                can_absolute_move = true;
+                current_mode = 1;
             }
             else
             {
-                spdlog::warn("{} Unknown number property: {}", _name, PropName);
+                can_absolute_move = false;
+                current_mode = 2;
             }
-            break;
         }
-        default:
+    }
+
+    void INDIFocuser::onBaudRate(ISwitchVectorProperty *svp)
+    {
+        if (ISwitch *rate = IUFindOnSwitch(svp))
         {
-            spdlog::warn("{} Unknown property type: {}", _name, Proptype);
-            break;
-        }
+            indi_focuser_rate = rate->name;
         }
+        spdlog::debug("{} baud rate : {}", _name, indi_focuser_rate);
+    }
+
+    void INDIFocuser::onMotion(ISwitchVectorProperty *svp)
+    {
+        current_motion = (IUFindSwitch(svp, "FOCUS_INWARD")->s == ISS_ON) ? 0 : 1;
+        spdlog::debug("{} is moving {}", _name, current_motion ? "outward" : "inward");
+    }
+
+    void INDIFocuser::onBacklash(ISwitchVectorProperty *svp)
+    {
+        has_backlash = (IUFindSwitch(svp, "INDI_ENABLED")->s == ISS_ON);
+        spdlog::debug("{} Has Backlash : {}", _name, has_backlash);
+    }
+
+    void INDIFocuser::onSpeed(INumberVectorProperty *nvp)
+    {
+        current_speed = nvp->np[0].value;
+        spdlog::debug("{} Current Speed : {}", _name, current_speed);
+    }
+
+    void INDIFocuser::onAbsolutePosition(INumberVectorProperty *nvp)
+    {
+        current_position = nvp->np[0].value;
+        IARecordTelemetry("position", current_position);
+        spdlog::debug("{} Current Absolute Position : {}", _name, current_position);
+    }
+
+    void INDIFocuser::onDelay(INumberVectorProperty *nvp)
+    {
+        delay = nvp->np[0].value;
+        spdlog::debug("{} Current Delay : {}", _name, delay);
+    }
+
+    void INDIFocuser::onTemperature(INumberVectorProperty *nvp)
+    {
+        current_temperature = nvp->np[0].value;
+        IARecordTelemetry("temperature", current_temperature);
+        spdlog::debug("{} Current Temperature : {}", _name, current_temperature);
+    }
+
+    void INDIFocuser::onMaxPosition(INumberVectorProperty *nvp)
+    {
+        max_position = nvp->np[0].value;
+        spdlog::debug("{} Max Position : {}", _name, max_position);
     }
 
     void INDIFocuser::IndiServerConnected()
@@ -364,29 +283,19 @@ namespace OpenAPT
 
     void INDIFocuser::ClearStatus()
     {
-        connection_prop = nullptr;
-        focuser_port = nullptr;
+        // 路由表绑定的属性指针
+        property_router.clear(*this);
+
         focuser_device = nullptr;
-        connection_prop = nullptr;
-        mode_prop = nullptr;              // Focuser mode , absolute or relative
-        motion_prop = nullptr;            // Focuser motion , inward or outward
-        speed_prop = nullptr;             // Focuser speed , default is 1
-        absolute_position_prop = nullptr; // Focuser absolute position
         relative_position_prop = nullptr; // Focuser relative position
-        max_position_prop = nullptr;      // Focuser max position
-        temperature_prop = nullptr;       // Focuser temperature
-        rate_prop = nullptr;
-        delay_prop = nullptr;
-        backlash_prop = nullptr;
         indi_max_position = nullptr;
         indi_focuser_temperature = nullptr;
-        focuserinfo_prop = nullptr;
-        focuser_port = nullptr;
-        focuser_device = nullptr;
     }
 
     INDIFocuser::INDIFocuser(const std::string &name) : Focuser(name)
     {
+        BuildPropertyRoutes();
+        ClearStatus();
         spdlog::debug("INDI Focuser {} init successfully", name);
     }
 
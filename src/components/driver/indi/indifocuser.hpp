@@ -33,6 +33,7 @@ Description: INDI Focuser
 
 #include "api/indiclient.hpp"
 #include "device/basic_device.hpp"
+#include "property_router.hpp"
 
 #include <libindi/basedevice.h>
 #include <libindi/indiproperty.h>
@@ -76,6 +77,8 @@ namespace OpenAPT
 
         nlohmann::json focuser_json;
 
+        PropertyRouter<INDIFocuser> property_router; // 属性路由表，构造时建立
+
     public:
         /**
          * @brief 构造函数，初始化 INDIFocuser 类
@@ -234,6 +237,28 @@ namespace OpenAPT
          */
         void ClearStatus();
 
+        /**
+         * @brief 建立属性名到成员字段与处理函数的路由表
+         *
+         */
+        void BuildPropertyRoutes();
+
+        void onConnectionProperty(INDI::Property *property);
+        void onPortProperty(INDI::Property *property);
+        void onDriverInfoProperty(INDI::Property *property);
+
+        void onConnection(ISwitchVectorProperty *svp);
+        void onMode(ISwitchVectorProperty *svp);
+        void onBaudRate(ISwitchVectorProperty *svp);
+        void onMotion(ISwitchVectorProperty *svp);
+        void onBacklash(ISwitchVectorProperty *svp);
+
+        void onSpeed(INumberVectorProperty *nvp);
+        void onAbsolutePosition(INumberVectorProperty *nvp);
+        void onDelay(INumberVectorProperty *nvp);
+        void onTemperature(INumberVectorProperty *nvp);
+        void onMaxPosition(INumberVectorProperty *nvp);
+
     protected:
         void newDevice(INDI::BaseDevice *dp) override;
         void removeDevice(INDI::BaseDevice *dp) override;
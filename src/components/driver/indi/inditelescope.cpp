@@ -30,6 +30,9 @@ Description: INDI Telescope
 **************************************************/
 
 #include "inditelescope.hpp"
+#include "astro/astrotime.hpp"
+
+#include <chrono>
 
 #include <spdlog/spdlog.h>
 
@@ -45,50 +48,7 @@ namespace OpenAPT
 
     void INDITelescope::newSwitch(ISwitchVectorProperty *svp)
     {
-        std::string const connection_str{"CONNECTION"};
-        std::string const baud_rate_str{"DEVICE_BAUD_RATE"};
-
-        if (svp->name == connection_str)
-        {
-            ISwitch *connectswitch = IUFindSwitch(svp, "CONNECT");
-            if (connectswitch->s == ISS_ON)
-            {
-                is_connected = true;
-                spdlog::info("{} is connected", _name);
-            }
-            else
-            {
-                if (is_ready)
-                {
-                    ClearStatus();
-                    spdlog::info("{} is disconnected", _name);
-                }
-            }
-        }
-        else if (svp->name == baud_rate_str)
-        {
-            std::string const baud_9600{"9600"};
-            std::string const baud_19200{"19200"};
-            std::string const baud_38400{"38400"};
-            std::string const baud_57600{"57600"};
-            std::string const baud_115200{"115200"};
-            std::string const baud_230400{"230400"};
-
-            if (IUFindSwitch(svp, "9600")->s == ISS_ON)
-                indi_telescope_rate = baud_9600;
-            else if (IUFindSwitch(svp, "19200")->s == ISS_ON)
-                indi_telescope_rate = baud_19200;
-            else if (IUFindSwitch(svp, "38400")->s == ISS_ON)
-                indi_telescope_rate = baud_38400;
-            else if (IUFindSwitch(svp, "57600")->s == ISS_ON)
-                indi_telescope_rate = baud_57600;
-            else if (IUFindSwitch(svp, "115200")->s == ISS_ON)
-                indi_telescope_rate = baud_115200;
-            else if (IUFindSwitch(svp, "230400")->s == ISS_ON)
-                indi_telescope_rate = baud_230400;
-
-            spdlog::debug("{} baud rate : {}", _name, indi_telescope_rate);
-        }
+        property_router.dispatch(*this, svp);
     }
 
     void INDITelescope::newMessage(INDI::BaseDevice *dp, int messageID)
@@ -123,10 +83,7 @@ namespace OpenAPT
         }
         spdlog::debug("{} Received Number: {} = {} state = {}", _name, nvp->name, os.str().c_str(), StateStr(nvp->s));
 
-        if (nvp == telescopeinfo_prop)
-        {
-            // do nothing
-        }
+        property_router.dispatch(*this, nvp);
     }
 
     void INDITelescope::newText(ITextVectorProperty *tvp)
@@ -141,63 +98,100 @@ namespace OpenAPT
 
     void INDITelescope::newProperty(INDI::Property *property)
     {
-        std::string PropName(property->getName());
-        INDI_PROPERTY_TYPE Proptype = property->getType();
-
         spdlog::debug("{} Property: {}", _name, property->getName());
+        property_router.dispatchProperty(*this, property);
+    }
 
-        if (PropName == "DEVICE_PORT" && Proptype == INDI_TEXT)
+    void INDITelescope::BuildPropertyRoutes()
+    {
+        const auto cmd = [this](const char *name)
+        {
+            return PropertyName::runtime(indi_telescope_cmd + name);
+        };
+
+        property_router
+            .bind("CONNECTION", &INDITelescope::connection_prop, &INDITelescope::onConnection)
+            .onProperty("CONNECTION", INDI_SWITCH, &INDITelescope::onConnectionProperty)
+            .bind("DEVICE_PORT", &INDITelescope::telescope_port)
+            .onProperty("DEVICE_PORT", INDI_TEXT, &INDITelescope::onPortProperty)
+            .onProperty("DRIVER_INFO", INDI_TEXT, &INDITelescope::onDriverInfoProperty)
+            .bind(cmd("INFO"), &INDITelescope::telescopeinfo_prop)
+            .bind(cmd("DEVICE_BAUD_RATE"), &INDITelescope::rate_prop, &INDITelescope::onBaudRate)
+            .bind(cmd("EQUATORIAL_EOD_COORD"), &INDITelescope::eq_coord_prop, &INDITelescope::onEquatorialCoord)
+            .bind(cmd("ON_COORD_SET"), &INDITelescope::coord_set_prop);
+    }
+
+    void INDITelescope::onConnectionProperty(INDI::Property *property)
+    {
+        spdlog::debug("{} Found CONNECTION for {}", _name, property->getDeviceName());
+        ISwitch *connectswitch = IUFindSwitch(connection_prop, "CONNECT");
+        is_connected = (connectswitch->s == ISS_ON);
+        if (!is_connected)
         {
-            spdlog::debug("{} Found device port for {} ", _name, property->getDeviceName());
-            telescope_port = property->getText();
+            connection_prop->sp->s = ISS_ON;
+            sendNewSwitch(connection_prop);
         }
-        else if (PropName == "CONNECTION" && Proptype == INDI_SWITCH)
+        spdlog::debug("{} Connected {}", _name, is_connected.load());
+    }
+
+    void INDITelescope::onPortProperty(INDI::Property *property)
+    {
+        spdlog::debug("{} Found device port for {} ", _name, property->getDeviceName());
+        if (IText *port = IUFindText(telescope_port, "PORT"); port && port->text)
         {
-            spdlog::debug("{} Found CONNECTION for {} {}", _name, property->getDeviceName(), PropName);
-            connection_prop = property->getSwitch();
-            ISwitch *connectswitch = IUFindSwitch(connection_prop, "CONNECT");
-            is_connected = (connectswitch->s == ISS_ON);
-            if (!is_connected)
-            {
-                connection_prop->sp->s = ISS_ON;
-                sendNewSwitch(connection_prop);
-            }
-            spdlog::debug("{} Connected {}", _name, is_connected);
+            indi_telescope_port = port->text;
+            spdlog::debug("{} USB Port : {}", _name, indi_telescope_port);
         }
-        else if (PropName == "DRIVER_INFO" && Proptype == INDI_TEXT)
+    }
+
+    void INDITelescope::onDriverInfoProperty(INDI::Property *property)
+    {
+        device_name = IUFindText(property->getText(), "DRIVER_NAME")->text;
+        indi_telescope_exec = IUFindText(property->getText(), "DRIVER_EXEC")->text;
+        indi_telescope_version = IUFindText(property->getText(), "DRIVER_VERSION")->text;
+        indi_telescope_interface = IUFindText(property->getText(), "DRIVER_INTERFACE")->text;
+        spdlog::debug("{} Name : {} connected exec {}", _name, device_name, indi_telescope_exec);
+    }
+
+    void INDITelescope::onConnection(ISwitchVectorProperty *svp)
+    {
+        ISwitch *connectswitch = IUFindSwitch(svp, "CONNECT");
+        if (connectswitch->s == ISS_ON)
         {
-            device_name = IUFindText(property->getText(), "DRIVER_NAME")->text;
-            indi_telescope_exec = IUFindText(property->getText(), "DRIVER_EXEC")->text;
-            indi_telescope_version = IUFindText(property->getText(), "DRIVER_VERSION")->text;
-            indi_telescope_interface = IUFindText(property->getText(), "DRIVER_INTERFACE")->text;
-            spdlog::debug("{} Name : {} connected exec {}", _name, device_name, indi_telescope_exec);
+            is_connected = true;
+            spdlog::info("{} is connected", _name);
         }
-        else if (PropName == indi_telescope_cmd + "INFO" && Proptype == INDI_NUMBER)
+        else
         {
-            telescopeinfo_prop = property->getNumber();
-            newNumber(telescopeinfo_prop);
+            if (is_ready)
+            {
+                ClearStatus();
+                spdlog::info("{} is disconnected", _name);
+            }
         }
-        else if (PropName == indi_telescope_cmd + "DEVICE_BAUD_RATE" && Proptype == INDI_SWITCH)
+    }
+
+    void INDITelescope::onBaudRate(ISwitchVectorProperty *svp)
+    {
+        if (ISwitch *rate = IUFindOnSwitch(svp))
         {
-            rate_prop = property->getSwitch();
-            if (IUFindSwitch(rate_prop, "9600")->s == ISS_ON)
-                indi_telescope_rate = "9600";
-            else if (IUFindSwitch(rate_prop, "19200")->s == ISS_ON)
-                indi_telescope_rate = "19200";
-            else if (IUFindSwitch(rate_prop, "38400")->s == ISS_ON)
-                indi_telescope_rate = "38400";
-            else if (IUFindSwitch(rate_prop, "57600")->s == ISS_ON)
-                indi_telescope_rate = "57600";
-            else if (IUFindSwitch(rate_prop, "115200")->s == ISS_ON)
-                indi_telescope_rate = "115200";
-            else if (IUFindSwitch(rate_prop, "230400")->s == ISS_ON)
-                indi_telescope_rate = "230400";
-            spdlog::debug("{} baud rate : {}", _name, indi_telescope_rate);
+            indi_telescope_rate = rate->name;
         }
-        else if (PropName == indi_telescope_cmd + "DEVICE_PORT" && Proptype == INDI_TEXT)
+        spdlog::debug("{} baud rate : {}", _name, indi_telescope_rate);
+    }
+
+    void INDITelescope::onEquatorialCoord(INumberVectorProperty *nvp)
+    {
+        INumber *ra = IUFindNumber(nvp, "RA");
+        INumber *dec = IUFindNumber(nvp, "DEC");
+        if (ra && dec)
         {
-            indi_telescope_port = IUFindText(property->getText(), "PORT")->text;
-            spdlog::debug("{} USB Port : {}", _name, indi_telescope_port);
+            {
+                std::lock_guard<std::mutex> lock(coord_mutex);
+                current_jnow = Astro::Equatorial::fromHours(ra->value, dec->value);
+            }
+            IARecordTelemetry("ra", ra->value);
+            IARecordTelemetry("dec", dec->value);
         }
     }
 
@@ -225,18 +219,16 @@ namespace OpenAPT
 
     void INDITelescope::ClearStatus()
     {
-        connection_prop = nullptr;
-        telescope_port = nullptr;
-        telescope_device = nullptr;
-        connection_prop = nullptr;
-        rate_prop = nullptr;
-        telescopeinfo_prop = nullptr;
-        telescope_port = nullptr;
+        // 路由表绑定的属性指针
+        property_router.clear(*this);
+
         telescope_device = nullptr;
     }
 
     INDITelescope::INDITelescope(const std::string &name) : Telescope(name)
     {
+        BuildPropertyRoutes();
+        ClearStatus();
         spdlog::debug("INDI telescope {} init successfully", name);
     }
 
@@ -293,7 +285,61 @@ namespace OpenAPT
 
     bool INDITelescope::SlewTo(const std::string &ra, const std::string &dec, const bool j2000)
     {
-        throw std::runtime_error("SlewTo function not implemented");
+        auto target = Astro::Equatorial::parse(ra, dec);
+        if (!target)
+        {
+            spdlog::error("{} invalid coordinates RA {} DEC {}", _name, ra, dec);
+            return false;
+        }
+        return SlewTo(*target, j2000);
+    }
+
+    bool INDITelescope::SlewTo(const Astro::Equatorial &target, const bool j2000)
+    {
+        if (!is_connected)
+        {
+            spdlog::warn("{} is not connected", _name);
+            return false;
+        }
+        if (!eq_coord_prop)
+        {
+            spdlog::error("{} does not provide EQUATORIAL_EOD_COORD", _name);
+            return false;
+        }
+        INumber *ra = IUFindNumber(eq_coord_prop, "RA");
+        INumber *dec = IUFindNumber(eq_coord_prop, "DEC");
+        if (!ra || !dec)
+        {
+            spdlog::error("{} EQUATORIAL_EOD_COORD has no RA/DEC member", _name);
+            return false;
+        }
+        const Astro::Equatorial jnow = j2000 ? Astro::ToJNow(target, Astro::JulianDate(std::chrono::system_clock::now())) : target;
+
+        if (coord_set_prop)
+        {
+            ISwitch *track = IUFindSwitch(coord_set_prop, "TRACK");
+            if (track && track->s != ISS_ON)
+            {
+                IUResetSwitch(coord_set_prop);
+                track->s = ISS_ON;
+                sendNewSwitch(coord_set_prop);
+            }
+        }
+        ra->value = jnow.raHours();
+        dec->value = jnow.dec;
+        sendNewNumber(eq_coord_prop);
+        spdlog::info("{} slewing to RA {} DEC {} (JNow)", _name, jnow.raString(), jnow.decString());
+        return true;
+    }
+
+    Astro::Equatorial INDITelescope::getCurrentCoordinates(const bool j2000)
+    {
+        Astro::Equatorial jnow;
+        {
+            std::lock_guard<std::mutex> lock(coord_mutex);
+            jnow = current_jnow;
+        }
+        return j2000 ? Astro::ToJ2000(jnow, Astro::JulianDate(std::chrono::system_clock::now())) : jnow;
     }
 
     bool INDITelescope::Abort()
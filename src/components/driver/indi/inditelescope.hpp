@@ -33,10 +33,13 @@ Description: INDI Telescope
 
 #include "api/indiclient.hpp"
 #include "device/basic_device.hpp"
+#include "astro/coordinates.hpp"
+#include "property_router.hpp"
 
 #include <libindi/basedevice.h>
 #include <libindi/indiproperty.h>
 
+#include <mutex>
 #include <string>
 
 #include <spdlog/spdlog.h>
@@ -52,6 +55,11 @@ namespace OpenAPT
         ITextVectorProperty *telescope_port;       // 望远镜端口属性指针
         ISwitchVectorProperty *rate_prop;          // 望远镜速率属性指针
         INDI::BaseDevice *telescope_device;        // 望远镜设备指针
+        INumberVectorProperty *eq_coord_prop = nullptr;  // EQUATORIAL_EOD_COORD 属性指针
+        ISwitchVectorProperty *coord_set_prop = nullptr; // ON_COORD_SET 属性指针
+
+        std::mutex coord_mutex;                  // 保护当前坐标
+        Astro::Equatorial current_jnow{0.0, 0.0}; // 望远镜上报的当前坐标（JNow）
 
         bool is_ready; // 是否连接成功标志
         bool has_blob; // 是否接收 blob 数据标志
@@ -64,6 +72,8 @@ namespace OpenAPT
         std::string indi_telescope_version = "";   // INDI 设备固件版本
         std::string indi_telescope_interface = ""; // INDI 接口版本
 
+        PropertyRouter<INDITelescope> property_router; // 属性路由表，构造时建立
+
     public:
         /**
          * @brief 构造函数
@@ -122,6 +132,24 @@ namespace OpenAPT
          */
         bool SlewTo(const std::string &ra, const std::string &dec, const bool j2000 = false) override;
 
+        /**
+         * @brief 将望远镜移动到指定位置，坐标直接以数值写入 EQUATORIAL_EOD_COORD
+         *
+         * @param target 目标坐标（度）
+         * @param j2000 是否为 J2000 坐标，为 true 时使用缓存的岁差章动矩阵转换为 JNow
+         * @return true 移动成功
+         * @return false 移动失败
+         */
+        bool SlewTo(const Astro::Equatorial &target, const bool j2000 = false) override;
+
+        /**
+         * @brief 获取望远镜当前坐标
+         *
+         * @param j2000 是否返回 J2000 坐标
+         * @return Astro::Equatorial 当前坐标（度）
+         */
+        Astro::Equatorial getCurrentCoordinates(const bool j2000 = false) override;
+
         /**
          * @brief 中止望远镜命令
          *
@@ -256,6 +284,21 @@ namespace OpenAPT
          */
         void ClearStatus();
 
+        /**
+         * @brief 建立属性名到成员字段与处理函数的路由表
+         *
+         */
+        void BuildPropertyRoutes();
+
+        void onConnectionProperty(INDI::Property *property);
+        void onPortProperty(INDI::Property *property);
+        void onDriverInfoProperty(INDI::Property *property);
+
+        void onConnection(ISwitchVectorProperty *svp);
+        void onBaudRate(ISwitchVectorProperty *svp);
+
+        void onEquatorialCoord(INumberVectorProperty *nvp);
+
     protected:
         // INDI 回调函数
         void newDevice(INDI::BaseDevice *dp) override;
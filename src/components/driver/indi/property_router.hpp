@@ -0,0 +1,383 @@
+/*
+ * property_router.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-17
+
+Description: Hashed INDI Property Dispatch
+
+**************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <libindi/indiproperty.h>
+
+namespace OpenAPT
+{
+    /**
+     * @brief 属性名的 FNV-1a 哈希，可在编译期计算
+     */
+    constexpr uint64_t HashPropertyName(std::string_view name)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (const char c : name)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief 带哈希的属性名
+     *
+     * 字面量在编译期求哈希；带前缀的名称（如 indi_camera_cmd + "EXPOSURE"）用 runtime 构造。
+     */
+    struct PropertyName
+    {
+        std::string_view name;
+        uint64_t hash;
+
+        consteval PropertyName(const char *literal)
+            : name(literal), hash(HashPropertyName(literal)) {}
+
+        static PropertyName runtime(std::string_view name)
+        {
+            return PropertyName(name, HashPropertyName(name));
+        }
+
+    private:
+        constexpr PropertyName(std::string_view name, uint64_t hash) : name(name), hash(hash) {}
+    };
+
+    /**
+     * @brief 以属性名为键的开放寻址哈希表，注册后只读
+     */
+    template <typename Value>
+    class PropertyTable
+    {
+    public:
+        /**
+         * @brief 插入或替换
+         */
+        Value &insert(const PropertyName &key, Value value)
+        {
+            if (Value *existing = find(key.name, key.hash))
+            {
+                *existing = std::move(value);
+                return *existing;
+            }
+            m_entries.push_back({key.hash, std::string(key.name), std::move(value)});
+            rehash();
+            return m_entries.back().value;
+        }
+
+        Value *find(std::string_view name, uint64_t hash)
+        {
+            return const_cast<Value *>(std::as_const(*this).find(name, hash));
+        }
+
+        const Value *find(std::string_view name, uint64_t hash) const
+        {
+            if (m_index.empty())
+            {
+                return nullptr;
+            }
+            for (size_t slot = hash & m_mask;; slot = (slot + 1) & m_mask)
+            {
+                const uint32_t index = m_index[slot];
+                if (index == kEmpty)
+                {
+                    return nullptr;
+                }
+                const Entry &entry = m_entries[index];
+                if (entry.hash == hash && entry.name == name)
+                {
+                    return &entry.value;
+                }
+            }
+        }
+
+        const Value *find(std::string_view name) const
+        {
+            return find(name, HashPropertyName(name));
+        }
+
+        size_t size() const
+        {
+            return m_entries.size();
+        }
+
+        template <typename F>
+        void forEach(F &&visit)
+        {
+            for (auto &entry : m_entries)
+            {
+                visit(entry.name, entry.value);
+            }
+        }
+
+    private:
+        static constexpr uint32_t kEmpty = UINT32_MAX;
+
+        struct Entry
+        {
+            uint64_t hash;
+            std::string name;
+            Value value;
+        };
+
+        // 负载因子不超过 1/2，查找平均一次探测
+        void rehash()
+        {
+            size_t size = 8;
+            while (size < m_entries.size() * 2)
+            {
+                size <<= 1;
+            }
+            m_index.assign(size, kEmpty);
+            m_mask = size - 1;
+            for (uint32_t i = 0; i < m_entries.size(); ++i)
+            {
+                size_t slot = m_entries[i].hash & m_mask;
+                while (m_index[slot] != kEmpty)
+                {
+                    slot = (slot + 1) & m_mask;
+                }
+                m_index[slot] = i;
+            }
+        }
+
+        std::vector<Entry> m_entries;
+        std::vector<uint32_t> m_index;
+        size_t m_mask = 0;
+    };
+
+    /**
+     * @brief INDI 属性路由表
+     *
+     * 每个驱动在构造时声明属性名到成员字段与处理函数的映射：
+     * newProperty 时把属性指针写入绑定的字段并调用处理函数，newNumber/newSwitch/newText
+     * 按名称哈希一次查表分发，取代逐个比较字符串的 if-else 链。
+     * 驱动特有的属性（如 ASI、Toupcam）同样以声明方式注册。
+     */
+    template <typename Owner>
+    class PropertyRouter
+    {
+    public:
+        using NumberHandler = void (Owner::*)(INumberVectorProperty *);
+        using SwitchHandler = void (Owner::*)(ISwitchVectorProperty *);
+        using TextHandler = void (Owner::*)(ITextVectorProperty *);
+        using PropertyHandler = void (Owner::*)(INDI::Property *);
+
+        /**
+         * @brief 绑定数值属性到成员字段，可选的处理函数在属性出现和每次更新时调用
+         */
+        PropertyRouter &bind(const PropertyName &name, INumberVectorProperty *Owner::*field, NumberHandler handler = nullptr)
+        {
+            m_routes.insert(name, Route{INDI_NUMBER, field, handler});
+            return *this;
+        }
+
+        PropertyRouter &bind(const PropertyName &name, ISwitchVectorProperty *Owner::*field, SwitchHandler handler = nullptr)
+        {
+            m_routes.insert(name, Route{INDI_SWITCH, field, handler});
+            return *this;
+        }
+
+        PropertyRouter &bind(const PropertyName &name, ITextVectorProperty *Owner::*field, TextHandler handler = nullptr)
+        {
+            m_routes.insert(name, Route{INDI_TEXT, field, handler});
+            return *this;
+        }
+
+        /**
+         * @brief 只注册处理函数，不保存属性指针
+         */
+        PropertyRouter &on(const PropertyName &name, NumberHandler handler)
+        {
+            m_routes.insert(name, Route{INDI_NUMBER, std::monostate{}, handler});
+            return *this;
+        }
+
+        PropertyRouter &on(const PropertyName &name, SwitchHandler handler)
+        {
+            m_routes.insert(name, Route{INDI_SWITCH, std::monostate{}, handler});
+            return *this;
+        }
+
+        PropertyRouter &on(const PropertyName &name, TextHandler handler)
+        {
+            m_routes.insert(name, Route{INDI_TEXT, std::monostate{}, handler});
+            return *this;
+        }
+
+        /**
+         * @brief 属性出现时的自定义处理
+         *
+         * 同名属性已注册时只追加该处理：newProperty 先绑定字段，再调用它代替更新处理函数。
+         */
+        PropertyRouter &onProperty(const PropertyName &name, INDI_PROPERTY_TYPE type, PropertyHandler handler)
+        {
+            if (Route *route = m_routes.find(name.name, name.hash); route && route->type == type)
+            {
+                route->on_property = handler;
+                return *this;
+            }
+            Route route{type, std::monostate{}, std::monostate{}};
+            route.on_property = handler;
+            m_routes.insert(name, route);
+            return *this;
+        }
+
+        /**
+         * @brief 已知但暂不处理的属性，避免被当作未知属性
+         */
+        PropertyRouter &ignore(const PropertyName &name, INDI_PROPERTY_TYPE type)
+        {
+            m_routes.insert(name, Route{type, std::monostate{}, std::monostate{}});
+            return *this;
+        }
+
+        /**
+         * @brief 分发 newProperty
+         *
+         * @return 属性名或类型未注册时返回 false
+         */
+        bool dispatchProperty(Owner &owner, INDI::Property *property) const
+        {
+            const Route *route = m_routes.find(property->getName());
+            if (!route || route->type != property->getType())
+            {
+                return false;
+            }
+            switch (route->type)
+            {
+            case INDI_NUMBER:
+                attach(owner, *route, property->getNumber());
+                break;
+            case INDI_SWITCH:
+                attach(owner, *route, property->getSwitch());
+                break;
+            case INDI_TEXT:
+                attach(owner, *route, property->getText());
+                break;
+            default:
+                break;
+            }
+            if (route->on_property)
+            {
+                (owner.*route->on_property)(property);
+            }
+            return true;
+        }
+
+        bool dispatch(Owner &owner, INumberVectorProperty *vector) const
+        {
+            return invoke(owner, vector);
+        }
+
+        bool dispatch(Owner &owner, ISwitchVectorProperty *vector) const
+        {
+            return invoke(owner, vector);
+        }
+
+        bool dispatch(Owner &owner, ITextVectorProperty *vector) const
+        {
+            return invoke(owner, vector);
+        }
+
+        /**
+         * @brief 清空所有绑定的属性指针，设备断开时调用
+         */
+        void clear(Owner &owner)
+        {
+            m_routes.forEach([&owner](const std::string &, Route &route)
+                             { std::visit([&owner](auto field)
+                                          {
+                    if constexpr (!std::is_same_v<decltype(field), std::monostate>)
+                    {
+                        owner.*field = nullptr;
+                    } }, route.field); });
+        }
+
+        size_t size() const
+        {
+            return m_routes.size();
+        }
+
+    private:
+        struct Route
+        {
+            INDI_PROPERTY_TYPE type;
+            std::variant<std::monostate, INumberVectorProperty *Owner::*, ISwitchVectorProperty *Owner::*, ITextVectorProperty *Owner::*> field;
+            std::variant<std::monostate, NumberHandler, SwitchHandler, TextHandler> handler;
+            PropertyHandler on_property = nullptr;
+        };
+
+        template <typename Vector>
+        static void attach(Owner &owner, const Route &route, Vector *vector)
+        {
+            if (auto field = std::get_if<Vector *Owner::*>(&route.field))
+            {
+                owner.**field = vector;
+            }
+            if (route.on_property)
+            {
+                return;
+            }
+            if (auto handler = std::get_if<void (Owner::*)(Vector *)>(&route.handler); handler && *handler)
+            {
+                (owner.**handler)(vector);
+            }
+        }
+
+        template <typename Vector>
+        bool invoke(Owner &owner, Vector *vector) const
+        {
+            const Route *route = m_routes.find(vector->name);
+            if (!route)
+            {
+                return false;
+            }
+            auto handler = std::get_if<void (Owner::*)(Vector *)>(&route->handler);
+            if (!handler || !*handler)
+            {
+                return false;
+            }
+            (owner.**handler)(vector);
+            return true;
+        }
+
+        PropertyTable<Route> m_routes;
+    };
+} // namespace OpenAPT
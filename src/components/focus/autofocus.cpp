@@ -0,0 +1,387 @@
+/*
+ * autofocus.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-13
+
+Description: Pipelined Autofocus Engine
+
+**************************************************/
+
+#include "autofocus.hpp"
+
+#include "image/image.hpp"
+#include "thread/threadpool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <memory>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::Focus
+{
+    namespace
+    {
+        // 高斯消元求解 3x3 线性方程组
+        bool Solve3(double m[3][4], double out[3])
+        {
+            for (int col = 0; col < 3; ++col)
+            {
+                int pivot = col;
+                for (int row = col + 1; row < 3; ++row)
+                {
+                    if (std::fabs(m[row][col]) > std::fabs(m[pivot][col]))
+                        pivot = row;
+                }
+                if (std::fabs(m[pivot][col]) < 1e-12)
+                {
+                    return false;
+                }
+                if (pivot != col)
+                {
+                    for (int k = 0; k < 4; ++k)
+                        std::swap(m[pivot][k], m[col][k]);
+                }
+                for (int row = 0; row < 3; ++row)
+                {
+                    if (row == col)
+                        continue;
+                    const double f = m[row][col] / m[col][col];
+                    for (int k = col; k < 4; ++k)
+                        m[row][k] -= f * m[col][k];
+                }
+            }
+            for (int i = 0; i < 3; ++i)
+            {
+                out[i] = m[i][3] / m[i][i];
+            }
+            return true;
+        }
+
+        const char *ModelName(FitModel model)
+        {
+            return model == FitModel::Hyperbola ? "hyperbola" : "parabola";
+        }
+    }
+
+    FocusSample MeasureFrame(const std::string &filename)
+    {
+        FocusSample sample;
+        sample.filename = filename;
+        std::vector<StarPoint> stars;
+        int width = 0, height = 0;
+        if (!StarDetect(filename, stars, width, height, 50))
+        {
+            spdlog::warn("Failed to detect stars in {}", filename);
+            return sample;
+        }
+        std::vector<float> hfds;
+        hfds.reserve(stars.size());
+        for (const auto &star : stars)
+        {
+            if (star.hfd > 0)
+            {
+                hfds.push_back(star.hfd);
+            }
+        }
+        if (hfds.empty())
+        {
+            return sample;
+        }
+        auto middle = hfds.begin() + hfds.size() / 2;
+        std::nth_element(hfds.begin(), middle, hfds.end());
+        sample.hfd = *middle;
+        sample.stars = static_cast<int>(hfds.size());
+        return sample;
+    }
+
+    AutoFocus::AutoFocus(AutoFocusDevices devices)
+        : m_devices(std::move(devices))
+    {
+        if (!m_devices.measure)
+        {
+            m_devices.measure = MeasureFrame;
+        }
+    }
+
+    void AutoFocus::abort()
+    {
+        m_abort = true;
+    }
+
+    bool AutoFocus::fitCurve(const std::vector<FocusSample> &samples, FitModel model, CurveFit &fit)
+    {
+        std::vector<const FocusSample *> valid;
+        for (const auto &sample : samples)
+        {
+            if (sample.hfd > 0)
+            {
+                valid.push_back(&sample);
+            }
+        }
+        if (valid.size() < 3)
+        {
+            spdlog::warn("Only {} valid focus samples, at least 3 required", valid.size());
+            return false;
+        }
+
+        // 对位置做归一化，避免大步数下正规方程病态
+        double mean = 0, min_pos = valid.front()->position, max_pos = min_pos;
+        for (const auto *s : valid)
+        {
+            mean += s->position;
+            min_pos = std::min<double>(min_pos, s->position);
+            max_pos = std::max<double>(max_pos, s->position);
+        }
+        mean /= valid.size();
+        const double scale = std::max(max_pos - min_pos, 1.0) / 2.0;
+
+        // 双曲线拟合 HFD²，按 1/HFD² 加权使各点相对误差相当
+        double m[3][4] = {};
+        for (const auto *s : valid)
+        {
+            const double u = (s->position - mean) / scale;
+            const double y = model == FitModel::Hyperbola ? s->hfd * s->hfd : s->hfd;
+            const double w = model == FitModel::Hyperbola ? 1.0 / y : 1.0;
+            const double basis[3] = {u * u, u, 1.0};
+            for (int i = 0; i < 3; ++i)
+            {
+                for (int j = 0; j < 3; ++j)
+                    m[i][j] += w * basis[i] * basis[j];
+                m[i][3] += w * basis[i] * y;
+            }
+        }
+        double coef[3];
+        if (!Solve3(m, coef) || coef[0] <= 0)
+        {
+            spdlog::warn("Focus curve is not V-shaped");
+            return false;
+        }
+        const double vertex_u = -coef[1] / (2 * coef[0]);
+        const double vertex_y = coef[2] - coef[1] * coef[1] / (4 * coef[0]);
+
+        fit.model = model;
+        fit.position = mean + vertex_u * scale;
+        if (model == FitModel::Hyperbola)
+        {
+            if (vertex_y <= 0)
+            {
+                spdlog::warn("Hyperbola fit produced a non-positive minimum");
+                return false;
+            }
+            fit.a = std::sqrt(vertex_y);
+            fit.b = fit.a / std::sqrt(coef[0]) * scale;
+            fit.c = fit.position;
+            fit.hfd = fit.a;
+        }
+        else
+        {
+            // 换算回原始位置单位下的系数
+            const double s2 = scale * scale;
+            fit.a = coef[0] / s2;
+            fit.b = coef[1] / scale - 2 * coef[0] * mean / s2;
+            fit.c = coef[0] * mean * mean / s2 - coef[1] * mean / scale + coef[2];
+            fit.hfd = vertex_y;
+        }
+
+        // 以 HFD 计算拟合优度
+        double sum = 0, ss_tot = 0, ss_res = 0;
+        for (const auto *s : valid)
+            sum += s->hfd;
+        const double avg = sum / valid.size();
+        for (const auto *s : valid)
+        {
+            const double u = (s->position - mean) / scale;
+            const double y = coef[0] * u * u + coef[1] * u + coef[2];
+            const double predicted = model == FitModel::Hyperbola ? std::sqrt(std::max(y, 0.0)) : y;
+            ss_res += (s->hfd - predicted) * (s->hfd - predicted);
+            ss_tot += (s->hfd - avg) * (s->hfd - avg);
+        }
+        fit.r_squared = ss_tot > 0 ? 1.0 - ss_res / ss_tot : 1.0;
+
+        const double margin = (max_pos - min_pos) / (valid.size() - 1);
+        if (fit.position < min_pos - margin || fit.position > max_pos + margin)
+        {
+            spdlog::warn("Best focus {:.0f} is outside the scanned range [{:.0f}, {:.0f}]", fit.position, min_pos, max_pos);
+            return false;
+        }
+        return true;
+    }
+
+    AutoFocusResult AutoFocus::run(const AutoFocusSettings &settings)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        AutoFocusResult result;
+        result.temperature = m_devices.temperature ? m_devices.temperature() : std::numeric_limits<double>::quiet_NaN();
+        auto finish = [&](const std::string &message) -> AutoFocusResult &
+        {
+            result.message = message;
+            result.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            if (result.success)
+                spdlog::info("Autofocus finished in {:.1f}s: {}", result.elapsed, message);
+            else
+                spdlog::error("Autofocus failed after {:.1f}s: {}", result.elapsed, message);
+            return result;
+        };
+
+        if (!m_devices.moveTo || !m_devices.expose || !m_devices.readout)
+        {
+            return finish("focuser or camera callbacks are not set");
+        }
+        if (settings.steps < 3 || settings.step_size <= 0)
+        {
+            return finish("at least 3 steps with a positive step size are required");
+        }
+        m_abort = false;
+
+        std::vector<int> positions(settings.steps);
+        const int start = settings.center - (settings.steps - 1) / 2 * settings.step_size;
+        for (int i = 0; i < settings.steps; ++i)
+        {
+            positions[i] = start + i * settings.step_size;
+        }
+        spdlog::info("Autofocus: {} points from {} to {}, {}s exposures", settings.steps, positions.front(), positions.back(), settings.exposure);
+
+        if (settings.backlash > 0 && !m_devices.moveTo(start - settings.backlash))
+        {
+            return finish("failed to move focuser for backlash compensation");
+        }
+        if (!m_devices.moveTo(start))
+        {
+            return finish("failed to move focuser to start position");
+        }
+
+        Thread::ThreadPool pool(std::max<size_t>(settings.workers, 1));
+        std::vector<std::future<FocusSample>> analyses;
+        std::string error;
+
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            if (m_abort)
+            {
+                error = "aborted";
+                break;
+            }
+            if (!m_devices.expose(settings.exposure))
+            {
+                error = "exposure failed at position " + std::to_string(positions[i]);
+                break;
+            }
+
+            // 积分结束后立即开始下一次移动，与读出、分析并行
+            std::future<bool> next_move;
+            if (i + 1 < positions.size())
+            {
+                next_move = std::async(std::launch::async, [this, target = positions[i + 1]]
+                                       { return m_devices.moveTo(target); });
+            }
+
+            const std::string filename = m_devices.readout();
+            if (filename.empty())
+            {
+                spdlog::warn("Autofocus: readout failed at position {}", positions[i]);
+            }
+            else
+            {
+                auto promise = std::make_shared<std::promise<FocusSample>>();
+                analyses.push_back(promise->get_future());
+                pool.enqueue([this, promise, filename, position = positions[i]]
+                             {
+                    FocusSample sample;
+                    try
+                    {
+                        sample = m_devices.measure(filename);
+                    }
+                    catch (const std::exception &e)
+                    {
+                        spdlog::error("Autofocus: failed to analyse {}: {}", filename, e.what());
+                    }
+                    sample.position = position;
+                    sample.filename = filename;
+                    promise->set_value(sample); });
+            }
+
+            if (next_move.valid() && !next_move.get())
+            {
+                error = "failed to move focuser to " + std::to_string(positions[i + 1]);
+                break;
+            }
+        }
+
+        for (auto &analysis : analyses)
+        {
+            FocusSample sample = analysis.get();
+            spdlog::debug("Autofocus: position {} HFD {:.2f} stars {}", sample.position, sample.hfd, sample.stars);
+            if (sample.stars < settings.min_stars)
+            {
+                sample.hfd = 0;
+            }
+            result.samples.push_back(std::move(sample));
+        }
+        if (!error.empty())
+        {
+            return finish(error);
+        }
+
+        if (!fitCurve(result.samples, settings.model, result.fit))
+        {
+            return finish("unable to fit focus curve");
+        }
+        result.best_position = static_cast<int>(std::lround(result.fit.position));
+
+        if (settings.move_to_best)
+        {
+            if ((settings.backlash > 0 && !m_devices.moveTo(result.best_position - settings.backlash)) ||
+                !m_devices.moveTo(result.best_position))
+            {
+                return finish("failed to move focuser to best position");
+            }
+        }
+        result.success = true;
+        return finish(fmt::format("best position {} HFD {:.2f} ({}, R² {:.3f})", result.best_position, result.fit.hfd,
+                                  ModelName(settings.model), result.fit.r_squared));
+    }
+
+    nlohmann::json AutoFocus::toJson(const AutoFocusResult &result)
+    {
+        nlohmann::json samples = nlohmann::json::array();
+        for (const auto &sample : result.samples)
+        {
+            samples.push_back({{"position", sample.position}, {"hfd", sample.hfd}, {"stars", sample.stars}, {"filename", sample.filename}});
+        }
+        return {{"success", result.success},
+                {"message", result.message},
+                {"best_position", result.best_position},
+                {"best_hfd", result.fit.hfd},
+                {"model", ModelName(result.fit.model)},
+                {"r_squared", result.fit.r_squared},
+                {"temperature", std::isnan(result.temperature) ? nlohmann::json(nullptr) : nlohmann::json(result.temperature)},
+                {"elapsed", result.elapsed},
+                {"samples", samples}};
+    }
+} // namespace OpenAPT::Focus
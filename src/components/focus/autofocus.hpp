@@ -0,0 +1,164 @@
+/*
+ * autofocus.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-13
+
+Description: Pipelined Autofocus Engine
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+namespace OpenAPT::Focus
+{
+    /**
+     * @brief V 曲线拟合模型
+     */
+    enum class FitModel
+    {
+        Hyperbola, ///< HFD = a * sqrt(1 + ((x - c) / b)^2)，即 HFD² 为 x 的抛物线
+        Parabola   ///< HFD = A * x² + B * x + C
+    };
+
+    /**
+     * @brief 单帧的对焦测量结果
+     */
+    struct FocusSample
+    {
+        int position = 0;     ///< 电调位置
+        double hfd = 0;       ///< 星点 HFD 中位数（像素），无效时为 0
+        int stars = 0;        ///< 参与统计的星点数量
+        std::string filename; ///< 图像文件
+    };
+
+    /**
+     * @brief 曲线拟合结果
+     */
+    struct CurveFit
+    {
+        FitModel model = FitModel::Hyperbola;
+        double position = 0;  ///< 最佳焦点位置
+        double hfd = 0;       ///< 最佳焦点处的预测 HFD
+        double a = 0;         ///< 双曲线：最小 HFD；抛物线：二次项系数
+        double b = 0;         ///< 双曲线：渐近线形状参数；抛物线：一次项系数
+        double c = 0;         ///< 双曲线：焦点位置；抛物线：常数项
+        double r_squared = 0; ///< 拟合优度
+    };
+
+    /**
+     * @brief 自动对焦使用的设备操作，所有回调都是阻塞的
+     *
+     * 以回调形式注入，既可以接 INDIFocuser/INDICamera，也可以在测试中使用模拟设备。
+     */
+    struct AutoFocusDevices
+    {
+        std::function<bool(int)> moveTo;                       ///< 移动到绝对位置，到位后返回
+        std::function<bool(double)> expose;                    ///< 曝光指定秒数，积分结束（快门关闭）后返回
+        std::function<std::string()> readout;                  ///< 读出并保存图像，返回文件路径，失败返回空字符串
+        std::function<FocusSample(const std::string &)> measure; ///< 可选，分析图像，默认使用 MeasureFrame
+        std::function<double()> temperature;                   ///< 可选，读取温度，用于对焦历史
+    };
+
+    /**
+     * @brief 自动对焦参数
+     */
+    struct AutoFocusSettings
+    {
+        int center = 0;                      ///< 扫描中心位置
+        int step_size = 100;                 ///< 相邻采样点间隔（步）
+        int steps = 9;                       ///< 采样点数量
+        double exposure = 2.0;               ///< 每帧曝光时间（秒）
+        int backlash = 0;                    ///< 开始前先越过起点的步数，保证所有移动方向一致
+        FitModel model = FitModel::Hyperbola;
+        size_t workers = 2;                  ///< 图像分析线程数
+        int min_stars = 3;                   ///< 少于该星点数的帧不参与拟合
+        bool move_to_best = true;            ///< 完成后移动到拟合出的最佳位置
+    };
+
+    /**
+     * @brief 自动对焦结果
+     */
+    struct AutoFocusResult
+    {
+        bool success = false;
+        std::string message;
+        int best_position = 0;
+        double temperature;                 ///< 开始时的温度，未知时为 NaN
+        double elapsed = 0;                 ///< 总耗时（秒）
+        CurveFit fit;
+        std::vector<FocusSample> samples;
+    };
+
+    /**
+     * @brief 流水线式自动对焦
+     *
+     * 第 N 帧积分结束后立即开始向第 N+1 个位置移动，同时读出第 N 帧，
+     * 读出完成的图像交给分析线程计算 HFD，主线程继续下一次曝光。
+     * 单帧耗时由 移动 + 曝光 + 读出 + 分析 缩短为 max(移动, 读出) + 曝光。
+     */
+    class AutoFocus
+    {
+    public:
+        explicit AutoFocus(AutoFocusDevices devices);
+
+        /**
+         * @brief 执行一次自动对焦，阻塞直到完成或被中止
+         */
+        AutoFocusResult run(const AutoFocusSettings &settings);
+
+        /**
+         * @brief 中止正在进行的对焦，当前的移动/曝光完成后返回
+         */
+        void abort();
+
+        /**
+         * @brief 拟合 V 曲线
+         *
+         * @param samples 采样点，HFD 为 0 的点被忽略
+         * @param model 拟合模型
+         * @param fit 输出拟合结果
+         * @return 有效点不足、曲线开口向下或最佳点超出采样范围时返回 false
+         */
+        static bool fitCurve(const std::vector<FocusSample> &samples, FitModel model, CurveFit &fit);
+
+        static nlohmann::json toJson(const AutoFocusResult &result);
+
+    private:
+        AutoFocusDevices m_devices;
+        std::atomic_bool m_abort{false};
+    };
+
+    /**
+     * @brief 默认的图像分析：检测星点并取 HFD 中位数
+     */
+    FocusSample MeasureFrame(const std::string &filename);
+} // namespace OpenAPT::Focus
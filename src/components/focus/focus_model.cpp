@@ -0,0 +1,335 @@
+/*
+ * focus_model.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-13
+
+Description: Temperature Compensated Focus Model
+
+**************************************************/
+
+#include "focus_model.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::Focus
+{
+    FocusModel::FocusModel(size_t max_history, double min_temperature_span)
+        : m_max_history(std::max<size_t>(max_history, 1)), m_min_span(min_temperature_span)
+    {
+    }
+
+    void FocusModel::addRecord(const FocusRecord &record)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_history.push_back(record);
+        while (m_history.size() > m_max_history)
+        {
+            m_history.pop_front();
+        }
+        refit();
+    }
+
+    bool FocusModel::addResult(const std::string &filter, const AutoFocusResult &result)
+    {
+        if (!result.success || std::isnan(result.temperature))
+        {
+            return false;
+        }
+        FocusRecord record;
+        record.filter = filter;
+        record.temperature = result.temperature;
+        record.position = result.best_position;
+        record.hfd = result.fit.hfd;
+        record.timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        addRecord(record);
+        return true;
+    }
+
+    void FocusModel::refit()
+    {
+        // 每个滤镜独立去均值后求公共斜率：k = ΣΣ(T - T̄f)(p - p̄f) / ΣΣ(T - T̄f)²
+        struct Stats
+        {
+            double n = 0, t = 0, p = 0;
+            double t_min = INFINITY, t_max = -INFINITY;
+        };
+        std::unordered_map<std::string, Stats> stats;
+        for (const auto &r : m_history)
+        {
+            Stats &s = stats[r.filter];
+            s.n += 1;
+            s.t += r.temperature;
+            s.p += r.position;
+            s.t_min = std::min(s.t_min, r.temperature);
+            s.t_max = std::max(s.t_max, r.temperature);
+        }
+        double span = 0;
+        for (auto &[filter, s] : stats)
+        {
+            s.t /= s.n;
+            s.p /= s.n;
+            span = std::max(span, s.t_max - s.t_min);
+        }
+
+        double sxy = 0, sxx = 0;
+        for (const auto &r : m_history)
+        {
+            const Stats &s = stats[r.filter];
+            sxy += (r.temperature - s.t) * (r.position - s.p);
+            sxx += (r.temperature - s.t) * (r.temperature - s.t);
+        }
+        m_has_slope = span >= m_min_span && sxx > 0;
+        m_slope = m_has_slope ? sxy / sxx : 0.0;
+
+        m_intercepts.clear();
+        for (const auto &[filter, s] : stats)
+        {
+            m_intercepts[filter] = s.p - m_slope * s.t;
+        }
+        spdlog::debug("Focus model: {} records, {} filters, slope {:.2f} steps/C", m_history.size(), m_intercepts.size(), m_slope);
+    }
+
+    std::optional<int> FocusModel::predict(const std::string &filter, double temperature) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_intercepts.find(filter);
+        if (it == m_intercepts.end())
+        {
+            return std::nullopt;
+        }
+        return static_cast<int>(std::lround(it->second + m_slope * temperature));
+    }
+
+    std::optional<double> FocusModel::filterOffset(const std::string &from, const std::string &to) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto a = m_intercepts.find(from);
+        auto b = m_intercepts.find(to);
+        if (a == m_intercepts.end() || b == m_intercepts.end())
+        {
+            return std::nullopt;
+        }
+        return b->second - a->second;
+    }
+
+    double FocusModel::slope() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_slope;
+    }
+
+    bool FocusModel::hasSlope() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_has_slope;
+    }
+
+    bool FocusModel::hasFilter(const std::string &filter) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_intercepts.count(filter) > 0;
+    }
+
+    size_t FocusModel::size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_history.size();
+    }
+
+    void FocusModel::clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_history.clear();
+        refit();
+    }
+
+    nlohmann::json FocusModel::toJson() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        nlohmann::json history = nlohmann::json::array();
+        for (const auto &r : m_history)
+        {
+            history.push_back({{"filter", r.filter},
+                               {"temperature", r.temperature},
+                               {"position", r.position},
+                               {"hfd", r.hfd},
+                               {"timestamp", r.timestamp}});
+        }
+        nlohmann::json intercepts = nlohmann::json::object();
+        for (const auto &[filter, value] : m_intercepts)
+        {
+            intercepts[filter] = value;
+        }
+        return {{"slope", m_slope}, {"has_slope", m_has_slope}, {"intercepts", intercepts}, {"history", history}};
+    }
+
+    bool FocusModel::load(const std::string &path)
+    {
+        std::ifstream ifs(path);
+        if (!ifs.is_open())
+        {
+            spdlog::error("Failed to open focus model file: {}", path);
+            return false;
+        }
+        try
+        {
+            nlohmann::json j = nlohmann::json::parse(ifs);
+            std::deque<FocusRecord> history;
+            for (const auto &item : j.at("history"))
+            {
+                FocusRecord r;
+                r.filter = item.at("filter").get<std::string>();
+                r.temperature = item.at("temperature").get<double>();
+                r.position = item.at("position").get<int>();
+                r.hfd = item.value("hfd", 0.0);
+                r.timestamp = item.value("timestamp", int64_t(0));
+                history.push_back(std::move(r));
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_history = std::move(history);
+            while (m_history.size() > m_max_history)
+            {
+                m_history.pop_front();
+            }
+            refit();
+        }
+        catch (const nlohmann::json::exception &e)
+        {
+            spdlog::error("Failed to parse focus model file: {}, error message: {}", path, e.what());
+            return false;
+        }
+        spdlog::info("Loaded focus model with {} records from {}", size(), path);
+        return true;
+    }
+
+    bool FocusModel::save(const std::string &path) const
+    {
+        // 先写临时文件再重命名，避免写入中断时损坏已有模型
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream ofs(tmp);
+            if (!ofs.is_open())
+            {
+                spdlog::error("Failed to write focus model file: {}", tmp);
+                return false;
+            }
+            ofs << toJson().dump(4);
+            if (!ofs.good())
+            {
+                spdlog::error("Failed to write focus model file: {}", tmp);
+                return false;
+            }
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        {
+            spdlog::error("Failed to rename {} to {}", tmp, path);
+            return false;
+        }
+        return true;
+    }
+
+    FocusCompensator::FocusCompensator(FocusModel &model, std::function<bool(int)> moveTo, double drift_threshold)
+        : m_model(model), m_move(std::move(moveTo)), m_threshold(drift_threshold)
+    {
+    }
+
+    void FocusCompensator::onAutofocus(const std::string &filter, double temperature, int position)
+    {
+        m_valid = true;
+        m_filter = filter;
+        m_ref_position = m_position = position;
+        m_ref_temperature = m_temperature = temperature;
+    }
+
+    bool FocusCompensator::move(int target, const char *reason)
+    {
+        if (target == m_position)
+        {
+            return true;
+        }
+        spdlog::info("Focus compensation ({}): {} -> {}", reason, m_position, target);
+        if (!m_move(target))
+        {
+            spdlog::error("Focus compensation failed to move focuser to {}", target);
+            m_valid = false;
+            return false;
+        }
+        m_position = target;
+        return true;
+    }
+
+    bool FocusCompensator::onFilterChanged(const std::string &filter, double temperature)
+    {
+        if (!m_valid)
+        {
+            return false;
+        }
+        if (filter == m_filter)
+        {
+            onTemperature(temperature);
+            return !needsAutofocus();
+        }
+        auto offset = m_model.filterOffset(m_filter, filter);
+        if (!offset)
+        {
+            spdlog::info("No focus offset known for filter {}, autofocus required", filter);
+            m_valid = false;
+            return false;
+        }
+        const double slope = m_model.hasSlope() ? m_model.slope() : 0.0;
+        const int target = static_cast<int>(std::lround(m_ref_position + *offset + slope * (temperature - m_ref_temperature)));
+        if (!move(target, "filter"))
+        {
+            return false;
+        }
+        // 以换滤镜后的位置作为新的基准
+        m_filter = filter;
+        m_ref_position = target;
+        m_ref_temperature = m_temperature = temperature;
+        return true;
+    }
+
+    bool FocusCompensator::onTemperature(double temperature)
+    {
+        if (!m_valid || std::isnan(temperature) || std::fabs(temperature - m_temperature) < m_threshold)
+        {
+            return false;
+        }
+        if (!m_model.hasSlope())
+        {
+            spdlog::info("Temperature drifted {:.1f}C without a focus slope, autofocus required", temperature - m_ref_temperature);
+            m_valid = false;
+            return false;
+        }
+        const int target = static_cast<int>(std::lround(m_ref_position + m_model.slope() * (temperature - m_ref_temperature)));
+        m_temperature = temperature;
+        return move(target, "temperature");
+    }
+} // namespace OpenAPT::Focus
@@ -0,0 +1,204 @@
+/*
+ * focus_model.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-13
+
+Description: Temperature Compensated Focus Model
+
+**************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "nlohmann/json.hpp"
+
+#include "autofocus.hpp"
+
+namespace OpenAPT::Focus
+{
+    /**
+     * @brief 一次成功的自动对焦记录
+     */
+    struct FocusRecord
+    {
+        std::string filter;    ///< 滤镜名称
+        double temperature;    ///< 对焦时温度（℃）
+        int position;          ///< 最佳焦点位置
+        double hfd = 0;        ///< 最佳 HFD
+        int64_t timestamp = 0; ///< Unix 时间（秒）
+    };
+
+    /**
+     * @brief 焦点模型：position = intercept[filter] + slope * temperature
+     *
+     * 所有滤镜共用一个温度斜率，每个滤镜有自己的截距，滤镜偏移量即截距之差。
+     * 参数由对焦历史按最小二乘闭式求解，历史记录与参数一起保存为 JSON。
+     * 所有接口都是线程安全的。
+     */
+    class FocusModel
+    {
+    public:
+        /**
+         * @param max_history 最多保留的历史记录数，超出时丢弃最旧的记录
+         * @param min_temperature_span 求解斜率所需的最小温度跨度（℃），不足时斜率为 0
+         */
+        explicit FocusModel(size_t max_history = 500, double min_temperature_span = 2.0);
+
+        /**
+         * @brief 添加一条对焦记录并重新求解模型
+         */
+        void addRecord(const FocusRecord &record);
+
+        /**
+         * @brief 从自动对焦结果添加记录，失败或温度未知的结果被忽略
+         *
+         * @return 是否添加成功
+         */
+        bool addResult(const std::string &filter, const AutoFocusResult &result);
+
+        /**
+         * @brief 预测某滤镜在某温度下的焦点位置
+         *
+         * @return 该滤镜没有历史记录时返回空
+         */
+        std::optional<int> predict(const std::string &filter, double temperature) const;
+
+        /**
+         * @brief 两个滤镜之间的焦点偏移（to - from）
+         *
+         * @return 任一滤镜没有历史记录时返回空
+         */
+        std::optional<double> filterOffset(const std::string &from, const std::string &to) const;
+
+        /**
+         * @brief 温度斜率（步/℃）
+         */
+        double slope() const;
+
+        /**
+         * @brief 斜率是否由足够的温度跨度求得
+         */
+        bool hasSlope() const;
+
+        bool hasFilter(const std::string &filter) const;
+
+        size_t size() const;
+
+        void clear();
+
+        /**
+         * @brief 从 JSON 文件加载历史记录并重新求解
+         */
+        bool load(const std::string &path);
+
+        /**
+         * @brief 将模型参数与历史记录保存为 JSON 文件
+         */
+        bool save(const std::string &path) const;
+
+        nlohmann::json toJson() const;
+
+    private:
+        void refit();
+
+        mutable std::mutex m_mutex;
+        size_t m_max_history;
+        double m_min_span;
+        std::deque<FocusRecord> m_history;
+        std::unordered_map<std::string, double> m_intercepts;
+        double m_slope = 0;
+        bool m_has_slope = false;
+    };
+
+    /**
+     * @brief 根据焦点模型在换滤镜或温度漂移时做预测性调焦
+     *
+     * 调整量按当前位置的相对变化计算（滤镜偏移差、斜率 × 温差），
+     * 因此不依赖模型的绝对截距，光路的机械变化不会引入误差。
+     */
+    class FocusCompensator
+    {
+    public:
+        /**
+         * @param model 焦点模型
+         * @param moveTo 移动电调到绝对位置
+         * @param drift_threshold 温度漂移超过该值（℃）时调整焦点
+         */
+        FocusCompensator(FocusModel &model, std::function<bool(int)> moveTo, double drift_threshold = 1.0);
+
+        /**
+         * @brief 记录一次完成的自动对焦，作为之后补偿的基准
+         */
+        void onAutofocus(const std::string &filter, double temperature, int position);
+
+        /**
+         * @brief 换滤镜后调用，按滤镜偏移调整焦点
+         *
+         * @return 模型缺少该滤镜、需要完整对焦时返回 false
+         */
+        bool onFilterChanged(const std::string &filter, double temperature);
+
+        /**
+         * @brief 温度更新时调用，漂移超过阈值时按斜率调整焦点
+         *
+         * @return 是否执行了调整
+         */
+        bool onTemperature(double temperature);
+
+        /**
+         * @brief 当前基准是否无效，需要完整自动对焦
+         */
+        bool needsAutofocus() const
+        {
+            return !m_valid;
+        }
+
+        int position() const
+        {
+            return m_position;
+        }
+
+    private:
+        bool move(int target, const char *reason);
+
+        FocusModel &m_model;
+        std::function<bool(int)> m_move;
+        double m_threshold;
+
+        bool m_valid = false;
+        std::string m_filter;
+        int m_ref_position = 0;       ///< 基准位置（最近一次对焦或换滤镜后）
+        double m_ref_temperature = 0; ///< 基准温度
+        double m_temperature = 0;     ///< 最近一次调整时的温度
+        int m_position = 0;
+    };
+} // namespace OpenAPT::Focus
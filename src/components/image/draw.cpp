@@ -26,6 +26,7 @@
 #include <set>
 #include <array>
 #include <vector>
+#include <algorithm>
 #include <gsl/gsl_blas.h>
 #include <gsl/gsl_multifit_nlin.h>
 #include <spdlog/spdlog.h>
@@ -893,4 +894,115 @@ namespace OpenAPT
 		rgbResized.save_bmp("out.bmp");
 		return 0;
 	}
+	bool StarDetect(const std::string &filename, std::vector<StarPoint> &outStars, int &outWidth, int &outHeight,
+					const size_t maxStars, const unsigned int outerHfdDiameter)
+	{
+		StarInfoListT starInfos;
+		CImg<float> img;
+		int bitPix = 0;
+		if (!readFile(img, filename, &bitPix))
+		{
+			spdlog::error("Failed to read {} for star detection", filename);
+			return false;
+		}
+		outWidth = img.width();
+		outHeight = img.height();
+		// Same noise reduction as StarDrawing, but without the visualization and gaussian fitting
+		CImg<float> &aiImg = img.blur_anisotropic(30.0f, 0.5f, 0.3f, 0.6f, 1.1f, 0.8f, 30, 2, 0, false);
+		CImg<float> binImg;
+		thresholdOtsu(aiImg, bitPix, &binImg);
+		clusterStars(binImg, &starInfos);
+		spdlog::debug("Recognized {} star candidates in {}", starInfos.size(), filename);
+		outStars.clear();
+		outStars.reserve(starInfos.size());
+		const size_t hfdRectDist = floor(outerHfdDiameter / 2.0);
+		for (auto &starInfo : starInfos)
+		{
+			FrameT squareFrame = rectify(starInfo.clusterFrame);
+			PixSubPosT &cogCentroid = starInfo.cogCentroid;
+			calcCentroid(aiImg, squareFrame, &cogCentroid);
+			float cogX = std::get<0>(cogCentroid) + std::get<0>(squareFrame);
+			float cogY = std::get<1>(cogCentroid) + std::get<1>(squareFrame);
+			// Refine the centroid on the 3x3 neighbourhood around the rounded COG
+			int xi = floor(cogX + 0.5);
+			int yi = floor(cogY + 0.5);
+			float subX = cogX, subY = cogY;
+			if (xi >= 1 && yi >= 1 && xi < aiImg.width() - 1 && yi < aiImg.height() - 1)
+			{
+				CImg<float> img3x3 = aiImg.get_crop(xi - 1, yi - 1, xi + 1, yi + 1);
+				subX = 0;
+				subY = 0;
+				calcSubPixelCenter(img3x3, &subX, &subY, 10);
+				subX += xi - 1;
+				subY += yi - 1;
+			}
+			CImg<float> hfdSubImg = aiImg.get_crop(cogX - hfdRectDist, cogY - hfdRectDist, cogX + hfdRectDist, cogY + hfdRectDist);
+			double mean = hfdSubImg.mean();
+			float flux = 0;
+			cimg_forXY(hfdSubImg, x, y)
+			{
+				hfdSubImg(x, y) = (hfdSubImg(x, y) < mean ? 0 : hfdSubImg(x, y) - mean);
+				flux += hfdSubImg(x, y);
+			}
+			if (flux <= 0)
+			{
+				continue;
+			}
+			StarPoint star;
+			// readFile flips the image vertically, convert back to 1-based FITS pixel coordinates
+			star.x = subX + 1.0f;
+			star.y = outHeight - subY;
+			star.flux = flux;
+			star.hfd = calcHfd(hfdSubImg, outerHfdDiameter);
+			outStars.push_back(star);
+		}
+		std::sort(outStars.begin(), outStars.end(), [](const StarPoint &a, const StarPoint &b)
+				  { return a.flux > b.flux; });
+		if (maxStars > 0 && outStars.size() > maxStars)
+		{
+			outStars.resize(maxStars);
+		}
+		spdlog::debug("Kept {} stars from {}", outStars.size(), filename);
+		return true;
+	}
+	bool SaveStarList(const std::string &filename, const std::vector<StarPoint> &stars, const int width, const int height)
+	{
+		int status = 0;
+		fitsfile *fptr;
+		// A leading '!' tells CFITSIO to overwrite an existing file
+		const std::string path = "!" + filename;
+		fits_create_file(&fptr, path.c_str(), &status);
+		if (status != 0)
+		{
+			spdlog::error("Error creating star list: {}", filename);
+			return false;
+		}
+		char *ttype[] = {const_cast<char *>("X"), const_cast<char *>("Y"), const_cast<char *>("FLUX")};
+		char *tform[] = {const_cast<char *>("1E"), const_cast<char *>("1E"), const_cast<char *>("1E")};
+		char *tunit[] = {const_cast<char *>("pix"), const_cast<char *>("pix"), const_cast<char *>("")};
+		fits_create_tbl(fptr, BINARY_TBL, stars.size(), 3, ttype, tform, tunit, "SOURCES", &status);
+		long imageW = width, imageH = height;
+		fits_write_key(fptr, TLONG, "IMAGEW", &imageW, "Image width in pixels", &status);
+		fits_write_key(fptr, TLONG, "IMAGEH", &imageH, "Image height in pixels", &status);
+		if (!stars.empty())
+		{
+			std::vector<float> xs(stars.size()), ys(stars.size()), fluxes(stars.size());
+			for (size_t i = 0; i < stars.size(); ++i)
+			{
+				xs[i] = stars[i].x;
+				ys[i] = stars[i].y;
+				fluxes[i] = stars[i].flux;
+			}
+			fits_write_col(fptr, TFLOAT, 1, 1, 1, stars.size(), xs.data(), &status);
+			fits_write_col(fptr, TFLOAT, 2, 1, 1, stars.size(), ys.data(), &status);
+			fits_write_col(fptr, TFLOAT, 3, 1, 1, stars.size(), fluxes.data(), &status);
+		}
+		fits_close_file(fptr, &status);
+		if (status != 0)
+		{
+			spdlog::error("Error writing star list: {}", filename);
+			return false;
+		}
+		return true;
+	}
 }
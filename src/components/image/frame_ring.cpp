@@ -0,0 +1,322 @@
+/*
+ * frame_ring.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-14
+
+Description: Preallocated Frame Ring Buffer
+
+**************************************************/
+
+#include "frame_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::Image
+{
+    FrameRing::FrameRing(size_t slots, size_t slot_capacity)
+    {
+        m_slots.reserve(std::max<size_t>(slots, 1));
+        for (size_t i = 0; i < std::max<size_t>(slots, 1); ++i)
+        {
+            auto slot = std::make_unique<Slot>();
+            slot->buffer.resize(slot_capacity);
+            m_slots.push_back(std::move(slot));
+        }
+    }
+
+    FrameRing::~FrameRing()
+    {
+        close();
+        for (auto &slot : m_slots)
+        {
+            if (slot->release)
+            {
+                slot->release();
+            }
+        }
+    }
+
+    void FrameRing::preallocate(size_t slot_capacity)
+    {
+        std::vector<Slot *> idle;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto &slot : m_slots)
+            {
+                if (!slot->valid && !slot->writing && slot->readers.load(std::memory_order_acquire) == 0 &&
+                    slot->buffer.size() < slot_capacity)
+                {
+                    slot->writing = true;
+                    idle.push_back(slot.get());
+                }
+            }
+        }
+        if (idle.empty())
+        {
+            return;
+        }
+        spdlog::debug("Preallocating {} frame slots of {} bytes", idle.size(), slot_capacity);
+        for (Slot *slot : idle)
+        {
+            slot->buffer.resize(slot_capacity);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Slot *slot : idle)
+        {
+            slot->writing = false;
+        }
+    }
+
+    FrameRing::Slot *FrameRing::acquireSlot()
+    {
+        // 调用方持有 m_mutex；优先使用空槽位，否则覆盖未被引用的最旧帧
+        Slot *best = nullptr;
+        for (auto &slot : m_slots)
+        {
+            if (slot->writing || slot->readers.load(std::memory_order_acquire) != 0)
+            {
+                continue;
+            }
+            if (!slot->valid)
+            {
+                best = slot.get();
+                break;
+            }
+            if (!best || slot->frame.meta.sequence < best->frame.meta.sequence)
+            {
+                best = slot.get();
+            }
+        }
+        if (best)
+        {
+            best->valid = false;
+            best->writing = true;
+        }
+        return best;
+    }
+
+    void FrameRing::recycle(Slot &slot)
+    {
+        if (slot.release)
+        {
+            auto release = std::move(slot.release);
+            slot.release = nullptr;
+            release();
+        }
+        slot.frame.data = nullptr;
+        slot.frame.size = 0;
+    }
+
+    void FrameRing::commit(Slot &slot, FrameMeta &&meta)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            meta.sequence = ++m_sequence;
+            slot.frame.meta = std::move(meta);
+            slot.valid = true;
+            slot.writing = false;
+        }
+        m_published.fetch_add(1, std::memory_order_relaxed);
+        m_cv.notify_all();
+    }
+
+    bool FrameRing::publishCopy(const void *data, size_t size, FrameMeta meta)
+    {
+        Slot *slot;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot = acquireSlot();
+        }
+        if (!slot)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            spdlog::warn("Frame ring is full, dropped frame from {}", meta.device);
+            return false;
+        }
+        // 槽位已被独占，复制时不持有锁
+        recycle(*slot);
+        if (slot->buffer.size() < size)
+        {
+            spdlog::debug("Growing frame slot from {} to {} bytes", slot->buffer.size(), size);
+            slot->buffer.resize(size);
+        }
+        std::memcpy(slot->buffer.data(), data, size);
+        slot->frame.data = slot->buffer.data();
+        slot->frame.size = size;
+        commit(*slot, std::move(meta));
+        return true;
+    }
+
+    bool FrameRing::publishExternal(const void *data, size_t size, FrameMeta meta, std::function<void()> release)
+    {
+        Slot *slot;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot = acquireSlot();
+        }
+        if (!slot)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            spdlog::warn("Frame ring is full, dropped frame from {}", meta.device);
+            if (release)
+            {
+                release();
+            }
+            return false;
+        }
+        recycle(*slot);
+        slot->frame.data = static_cast<const uint8_t *>(data);
+        slot->frame.size = size;
+        slot->release = std::move(release);
+        commit(*slot, std::move(meta));
+        return true;
+    }
+
+    FrameRing::Reservation FrameRing::reserve(size_t capacity)
+    {
+        Reservation reservation;
+        Slot *slot;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot = acquireSlot();
+        }
+        if (!slot)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            spdlog::warn("Frame ring is full, no slot to reserve");
+            return reservation;
+        }
+        recycle(*slot);
+        if (slot->buffer.size() < capacity)
+        {
+            spdlog::debug("Growing frame slot from {} to {} bytes", slot->buffer.size(), capacity);
+            slot->buffer.resize(capacity);
+        }
+        reservation.m_slot = slot;
+        reservation.m_data = slot->buffer.data();
+        reservation.m_capacity = slot->buffer.size();
+        return reservation;
+    }
+
+    bool FrameRing::commit(Reservation &reservation, size_t size, FrameMeta meta)
+    {
+        if (!reservation || size > reservation.m_capacity)
+        {
+            cancel(reservation);
+            return false;
+        }
+        Slot &slot = *reservation.m_slot;
+        slot.frame.data = slot.buffer.data();
+        slot.frame.size = size;
+        commit(slot, std::move(meta));
+        reservation = Reservation();
+        return true;
+    }
+
+    void FrameRing::cancel(Reservation &reservation)
+    {
+        if (reservation)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            reservation.m_slot->writing = false;
+        }
+        reservation = Reservation();
+    }
+
+    FrameRef FrameRing::makeRef(Slot &slot)
+    {
+        // 调用方持有 m_mutex，引用计数归零后槽位才能被生产者复用
+        slot.readers.fetch_add(1, std::memory_order_acq_rel);
+        Slot *ptr = &slot;
+        return FrameRef(&slot.frame, [ptr](const Frame *)
+                        { ptr->readers.fetch_sub(1, std::memory_order_acq_rel); });
+    }
+
+    FrameRef FrameRing::latest()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Slot *newest = nullptr;
+        for (auto &slot : m_slots)
+        {
+            if (slot->valid && (!newest || slot->frame.meta.sequence > newest->frame.meta.sequence))
+            {
+                newest = slot.get();
+            }
+        }
+        return newest ? makeRef(*newest) : nullptr;
+    }
+
+    FrameRef FrameRing::waitNext(uint64_t after, std::chrono::milliseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            Slot *next = nullptr;
+            for (auto &slot : m_slots)
+            {
+                if (slot->valid && slot->frame.meta.sequence > after &&
+                    (!next || slot->frame.meta.sequence < next->frame.meta.sequence))
+                {
+                    next = slot.get();
+                }
+            }
+            if (next)
+            {
+                return makeRef(*next);
+            }
+            if (m_closed || m_cv.wait_until(lock, deadline) == std::cv_status::timeout)
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    void FrameRing::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_cv.notify_all();
+    }
+
+    void FrameRing::reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &slot : m_slots)
+        {
+            if (slot->valid && slot->readers.load(std::memory_order_acquire) == 0)
+            {
+                slot->valid = false;
+                recycle(*slot);
+            }
+        }
+        m_closed = false;
+    }
+} // namespace OpenAPT::Image
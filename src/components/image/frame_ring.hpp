@@ -0,0 +1,227 @@
+/*
+ * frame_ring.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-14
+
+Description: Preallocated Frame Ring Buffer
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OpenAPT::Image
+{
+    /**
+     * @brief 帧的元数据
+     */
+    struct FrameMeta
+    {
+        uint64_t sequence = 0;   ///< 发布序号，由 FrameRing 分配，从 1 开始
+        std::string device;      ///< 相机名称
+        std::string format;      ///< 数据格式，如 ".fits"
+        double exposure = 0;     ///< 曝光时间（秒）
+        int width = 0;
+        int height = 0;
+        int bit_depth = 0;
+        int binning = 1;
+        bool video = false;      ///< 是否来自视频流
+        std::chrono::system_clock::time_point timestamp; ///< 接收时间
+    };
+
+    /**
+     * @brief 环形缓冲中的一帧，数据在持有 FrameRef 期间保持有效
+     */
+    struct Frame
+    {
+        FrameMeta meta;
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+    };
+
+    using FrameRef = std::shared_ptr<const Frame>;
+
+    /**
+     * @brief 单生产者、多消费者的预分配帧环形缓冲
+     *
+     * 生产者（INDI 客户端线程）写入空闲槽位后发布，并唤醒所有等待的消费者。
+     * 被消费者引用的槽位不会被覆盖，若所有槽位都被占用则丢弃新帧，生产者永不阻塞在消费者上。
+     * 消费者按序号读取，落后太多时会跳过已被覆盖的帧（可由序号不连续发现）。
+     */
+    class FrameRing
+    {
+        struct Slot;
+
+    public:
+        /**
+         * @brief 生产者预留的可写槽位，提交或取消前不会被消费者看到
+         */
+        class Reservation
+        {
+        public:
+            uint8_t *data() const
+            {
+                return m_data;
+            }
+
+            size_t capacity() const
+            {
+                return m_capacity;
+            }
+
+            explicit operator bool() const
+            {
+                return m_slot != nullptr;
+            }
+
+        private:
+            friend class FrameRing;
+            Slot *m_slot = nullptr;
+            uint8_t *m_data = nullptr;
+            size_t m_capacity = 0;
+        };
+
+        /**
+         * @param slots 槽位数量
+         * @param slot_capacity 每个槽位预分配的字节数，不足时在写入时扩容
+         */
+        FrameRing(size_t slots, size_t slot_capacity);
+        ~FrameRing();
+
+        FrameRing(const FrameRing &) = delete;
+        FrameRing &operator=(const FrameRing &) = delete;
+
+        /**
+         * @brief 把空闲槽位扩容到至少 slot_capacity 字节，如连接后按相机的最大画幅分配
+         *
+         * 扩容在锁外进行，期间这些槽位暂不可用；正在写入或保存着帧的槽位不变，之后写入时再按需扩容。
+         */
+        void preallocate(size_t slot_capacity);
+
+        /**
+         * @brief 将数据复制到预分配的槽位并发布
+         *
+         * @return 没有空闲槽位时丢弃该帧并返回 false
+         */
+        bool publishCopy(const void *data, size_t size, FrameMeta meta);
+
+        /**
+         * @brief 零拷贝发布外部缓冲区，槽位被复用或缓冲销毁时调用 release 释放
+         *
+         * @return 没有空闲槽位时立即调用 release 并返回 false
+         */
+        bool publishExternal(const void *data, size_t size, FrameMeta meta, std::function<void()> release);
+
+        /**
+         * @brief 预留至少 capacity 字节的槽位，生产者直接写入后提交，如边接收边解码的 BLOB
+         *
+         * @return 没有空闲槽位时计为丢帧并返回空的预留
+         */
+        Reservation reserve(size_t capacity);
+
+        /**
+         * @brief 发布预留槽位中的前 size 字节
+         */
+        bool commit(Reservation &reservation, size_t size, FrameMeta meta);
+
+        /**
+         * @brief 放弃预留的槽位，如传输中断或数据损坏
+         */
+        void cancel(Reservation &reservation);
+
+        /**
+         * @brief 获取最新的一帧
+         */
+        FrameRef latest();
+
+        /**
+         * @brief 等待序号大于 after 的最早一帧
+         *
+         * @param after 已处理的最后一帧序号，0 表示从当前最早的帧开始
+         * @param timeout 等待超时
+         * @return 超时或缓冲关闭时返回空
+         */
+        FrameRef waitNext(uint64_t after, std::chrono::milliseconds timeout);
+
+        /**
+         * @brief 关闭缓冲，唤醒所有等待的消费者
+         */
+        void close();
+
+        /**
+         * @brief 清空所有未被引用的帧并重新打开缓冲
+         */
+        void reset();
+
+        uint64_t published() const
+        {
+            return m_published.load(std::memory_order_relaxed);
+        }
+
+        uint64_t dropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        size_t slots() const
+        {
+            return m_slots.size();
+        }
+
+    private:
+        struct Slot
+        {
+            Frame frame;
+            std::vector<uint8_t> buffer;
+            std::function<void()> release; ///< 外部缓冲的释放函数
+            std::atomic_int readers{0};
+            bool valid = false;   ///< 对消费者可见
+            bool writing = false; ///< 正在被生产者写入
+        };
+
+        Slot *acquireSlot();
+        void recycle(Slot &slot);
+        void commit(Slot &slot, FrameMeta &&meta);
+        FrameRef makeRef(Slot &slot);
+
+        std::vector<std::unique_ptr<Slot>> m_slots;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        uint64_t m_sequence = 0;
+        bool m_closed = false;
+
+        std::atomic_uint64_t m_published{0};
+        std::atomic_uint64_t m_dropped{0};
+    };
+} // namespace OpenAPT::Image
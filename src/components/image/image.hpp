@@ -29,7 +29,48 @@ Description: Image Processing
 
 **************************************************/
 
+#pragma once
+
+#include <string>
+#include <vector>
+
 namespace OpenAPT
 {
+    /**
+     * @brief 检测到的星点信息，坐标为 FITS 约定（1 起始，Y 轴向上）
+     */
+    struct StarPoint
+    {
+        float x;    ///< 亚像素 X 坐标
+        float y;    ///< 亚像素 Y 坐标
+        float flux; ///< 扣除背景后的总流量
+        float hfd;  ///< 半通量直径
+    };
+
     int StarDrawing(const std::string &filename, const unsigned int outerHfdDiameter = 50);
+
+    /**
+     * @brief 检测图像中的星点，按流量从亮到暗排序
+     *
+     * @param filename FITS 文件路径
+     * @param outStars 输出星点列表
+     * @param outWidth 输出图像宽度
+     * @param outHeight 输出图像高度
+     * @param maxStars 最多保留的星点数量，0 表示全部保留
+     * @param outerHfdDiameter 计算 HFD 时的外径
+     * @return 成功返回 true，失败返回 false
+     */
+    bool StarDetect(const std::string &filename, std::vector<StarPoint> &outStars, int &outWidth, int &outHeight,
+                    const size_t maxStars = 0, const unsigned int outerHfdDiameter = 50);
+
+    /**
+     * @brief 将星点列表保存为 Astrometry.net 可读的 XYLS（FITS 二进制表）文件
+     *
+     * @param filename 输出文件路径
+     * @param stars 星点列表
+     * @param width 图像宽度
+     * @param height 图像高度
+     * @return 成功返回 true，失败返回 false
+     */
+    bool SaveStarList(const std::string &filename, const std::vector<StarPoint> &stars, const int width, const int height);
 } // namespace OpenAPT
@@ -0,0 +1,511 @@
+/*
+ * live_view.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-15
+
+Description: Live View Streaming Pipeline
+
+**************************************************/
+
+#include "live_view.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::Image
+{
+    namespace
+    {
+        // 帧率的指数滑动平均
+        void UpdateFps(std::atomic<double> &fps, std::chrono::steady_clock::time_point &last)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if (last.time_since_epoch().count() != 0)
+            {
+                const double dt = std::chrono::duration<double>(now - last).count();
+                if (dt > 0)
+                {
+                    const double current = fps.load(std::memory_order_relaxed);
+                    fps.store(current == 0 ? 1.0 / dt : current * 0.9 + 0.1 / dt, std::memory_order_relaxed);
+                }
+            }
+            last = now;
+        }
+
+        /**
+         * @brief 解码后的像素布局，像素不复制，直接从帧数据读取
+         */
+        struct PixelLayout
+        {
+            const uint8_t *data = nullptr;
+            int width = 0;
+            int height = 0;
+            int bytes = 1;         ///< 每个样本字节数
+            int channels = 1;      ///< 通道数
+            bool planar = false;   ///< FITS 彩色为平面存储，原始 RGB 为交错存储
+            bool big_endian = false;
+            bool flip_sign = false; ///< FITS BITPIX=16 且 BZERO=32768 时翻转符号位得到无符号值
+            bool clamp_signed = false;
+
+            uint32_t sample(size_t index) const
+            {
+                if (bytes == 1)
+                {
+                    return data[index];
+                }
+                const uint8_t *p = data + index * 2;
+                uint32_t v = big_endian ? (p[0] << 8 | p[1]) : (p[1] << 8 | p[0]);
+                if (flip_sign)
+                {
+                    v ^= 0x8000;
+                }
+                else if (clamp_signed && (v & 0x8000))
+                {
+                    v = 0;
+                }
+                return v;
+            }
+
+            uint32_t luminance(int x, int y) const
+            {
+                const size_t pixel = static_cast<size_t>(y) * width + x;
+                if (channels == 1)
+                {
+                    return sample(pixel);
+                }
+                if (planar)
+                {
+                    const size_t plane = static_cast<size_t>(width) * height;
+                    return (sample(pixel) + 2 * sample(pixel + plane) + sample(pixel + 2 * plane)) / 4;
+                }
+                return (sample(pixel * 3) + 2 * sample(pixel * 3 + 1) + sample(pixel * 3 + 2)) / 4;
+            }
+        };
+
+        bool ParseFits(const Frame &frame, PixelLayout &layout)
+        {
+            constexpr size_t kBlock = 2880;
+            constexpr size_t kCard = 80;
+            int bitpix = 0, naxis = 0, naxis1 = 0, naxis2 = 0, naxis3 = 1;
+            double bzero = 0;
+            size_t offset = 0;
+            bool end = false;
+            while (!end && offset + kCard <= frame.size)
+            {
+                const char *card = reinterpret_cast<const char *>(frame.data + offset);
+                offset += kCard;
+                auto keyword = [card](const char *name)
+                {
+                    const size_t len = std::strlen(name);
+                    return std::strncmp(card, name, len) == 0 && (card[len] == ' ' || card[len] == '=');
+                };
+                auto value = [card]()
+                {
+                    return std::strtod(card + 10, nullptr);
+                };
+                if (keyword("END"))
+                    end = true;
+                else if (keyword("BITPIX"))
+                    bitpix = static_cast<int>(value());
+                else if (keyword("NAXIS"))
+                    naxis = static_cast<int>(value());
+                else if (keyword("NAXIS1"))
+                    naxis1 = static_cast<int>(value());
+                else if (keyword("NAXIS2"))
+                    naxis2 = static_cast<int>(value());
+                else if (keyword("NAXIS3"))
+                    naxis3 = static_cast<int>(value());
+                else if (keyword("BZERO"))
+                    bzero = value();
+            }
+            const size_t data_offset = (offset + kBlock - 1) / kBlock * kBlock;
+            if (!end || naxis < 2 || (bitpix != 8 && bitpix != 16) || naxis1 <= 0 || naxis2 <= 0 || (naxis3 != 1 && naxis3 != 3))
+            {
+                return false;
+            }
+            layout.width = naxis1;
+            layout.height = naxis2;
+            layout.bytes = bitpix / 8;
+            layout.channels = naxis3;
+            layout.planar = true;
+            layout.big_endian = true;
+            layout.flip_sign = bitpix == 16 && bzero == 32768;
+            layout.clamp_signed = bitpix == 16 && bzero != 32768;
+            layout.data = frame.data + data_offset;
+            return data_offset + static_cast<size_t>(naxis1) * naxis2 * naxis3 * layout.bytes <= frame.size;
+        }
+
+        bool ParseRaw(const Frame &frame, PixelLayout &layout)
+        {
+            const size_t pixels = static_cast<size_t>(frame.meta.width) * frame.meta.height;
+            if (pixels == 0 || frame.size % pixels != 0)
+            {
+                return false;
+            }
+            const size_t bpp = frame.size / pixels;
+            layout.width = frame.meta.width;
+            layout.height = frame.meta.height;
+            layout.data = frame.data;
+            switch (bpp)
+            {
+            case 1:
+                break;
+            case 2:
+                layout.bytes = 2;
+                break;
+            case 3:
+                layout.channels = 3;
+                break;
+            case 6:
+                layout.bytes = 2;
+                layout.channels = 3;
+                break;
+            default:
+                return false;
+            }
+            return true;
+        }
+    }
+
+    PreviewRef LiveView::encode(const Frame &frame, const LiveViewSettings &settings)
+    {
+        PixelLayout layout;
+        const bool fits = frame.meta.format.rfind(".fits", 0) == 0 && frame.meta.format.size() == 5;
+        if (!(fits ? ParseFits(frame, layout) : ParseRaw(frame, layout)))
+        {
+            return nullptr;
+        }
+
+        // 整数倍盒式缩小
+        const int factor = std::max(1, (layout.width + settings.max_width - 1) / std::max(settings.max_width, 1));
+        const int width = layout.width / factor;
+        const int height = layout.height / factor;
+        if (width == 0 || height == 0)
+        {
+            return nullptr;
+        }
+        const uint32_t area = static_cast<uint32_t>(factor * factor);
+        const uint32_t levels = layout.bytes == 1 ? 256 : 65536;
+        std::vector<uint16_t> scaled(static_cast<size_t>(width) * height);
+        std::vector<uint32_t> histogram(levels, 0);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                uint32_t sum = 0;
+                for (int dy = 0; dy < factor; ++dy)
+                    for (int dx = 0; dx < factor; ++dx)
+                        sum += layout.luminance(x * factor + dx, y * factor + dy);
+                const uint16_t v = static_cast<uint16_t>(sum / area);
+                scaled[static_cast<size_t>(y) * width + x] = v;
+                ++histogram[v];
+            }
+        }
+
+        // 按百分位拉伸到 8 位
+        const size_t total = scaled.size();
+        const size_t black_count = static_cast<size_t>(total * std::clamp(settings.black_percentile, 0.0, 1.0));
+        const size_t white_count = static_cast<size_t>(total * std::clamp(settings.white_percentile, 0.0, 1.0));
+        uint32_t black = 0, white = levels - 1;
+        size_t cumulative = 0;
+        bool found_black = false;
+        for (uint32_t i = 0; i < levels; ++i)
+        {
+            cumulative += histogram[i];
+            if (!found_black && cumulative > black_count)
+            {
+                black = i;
+                found_black = true;
+            }
+            if (cumulative >= white_count)
+            {
+                white = i;
+                break;
+            }
+        }
+        if (white <= black)
+        {
+            white = std::min(black + 1, levels - 1);
+            black = white - 1;
+        }
+        std::vector<uint8_t> lut(levels);
+        const double scale = 255.0 / (white - black);
+        for (uint32_t i = 0; i < levels; ++i)
+        {
+            lut[i] = i <= black ? 0 : i >= white ? 255 : static_cast<uint8_t>((i - black) * scale + 0.5);
+        }
+
+        auto preview = std::make_shared<PreviewFrame>();
+        preview->sequence = frame.meta.sequence;
+        preview->width = width;
+        preview->height = height;
+        preview->timestamp = frame.meta.timestamp;
+        preview->pixels.resize(total);
+        for (size_t i = 0; i < total; ++i)
+        {
+            preview->pixels[i] = lut[scaled[i]];
+        }
+        return preview;
+    }
+
+    LiveView::LiveView(const LiveViewSettings &settings)
+        : m_settings(settings), m_input(std::max<size_t>(settings.queue_depth, 1))
+    {
+    }
+
+    LiveView::~LiveView()
+    {
+        stop();
+    }
+
+    void LiveView::start()
+    {
+        if (m_running.exchange(true))
+        {
+            return;
+        }
+        m_input_fps = 0;
+        m_output_fps = 0;
+        m_last_input = {};
+        m_last_output = {};
+        m_encoder = std::thread(&LiveView::encodeLoop, this);
+        spdlog::info("Live view started");
+    }
+
+    void LiveView::stop()
+    {
+        if (!m_running.exchange(false))
+        {
+            return;
+        }
+        m_signal.fetch_add(1, std::memory_order_release);
+        m_signal.notify_all();
+        if (m_encoder.joinable())
+        {
+            m_encoder.join();
+        }
+        while (m_input.tryPop())
+        {
+        }
+
+        std::vector<std::shared_ptr<Client>> clients;
+        {
+            std::lock_guard<std::mutex> lock(m_clients_mutex);
+            clients.swap(m_clients);
+        }
+        for (auto &client : clients)
+        {
+            stopClient(*client);
+        }
+        spdlog::info("Live view stopped, {} frames encoded, {} dropped", m_encoded.load(), m_input_dropped.load());
+    }
+
+    void LiveView::push(FrameRef frame)
+    {
+        if (!m_running.load(std::memory_order_acquire) || !frame)
+        {
+            return;
+        }
+        m_received.fetch_add(1, std::memory_order_relaxed);
+        UpdateFps(m_input_fps, m_last_input);
+        const size_t dropped = m_input.pushDropOldest(std::move(frame));
+        if (dropped)
+        {
+            m_input_dropped.fetch_add(dropped, std::memory_order_relaxed);
+        }
+        m_signal.fetch_add(1, std::memory_order_release);
+        m_signal.notify_one();
+    }
+
+    void LiveView::encodeLoop()
+    {
+        while (m_running.load(std::memory_order_acquire))
+        {
+            const uint32_t observed = m_signal.load(std::memory_order_acquire);
+            auto frame = m_input.tryPop();
+            if (!frame)
+            {
+                m_signal.wait(observed, std::memory_order_acquire);
+                continue;
+            }
+            // 编码前只保留最新的一帧
+            while (auto newer = m_input.tryPop())
+            {
+                frame = std::move(newer);
+                m_input_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            PreviewRef preview = encode(**frame, m_settings);
+            frame->reset(); // 尽早归还帧缓冲槽位
+            if (!preview)
+            {
+                if (m_unsupported.fetch_add(1, std::memory_order_relaxed) == 0)
+                {
+                    spdlog::warn("Live view cannot decode frame format, frames will be skipped");
+                }
+                continue;
+            }
+            m_encoded.fetch_add(1, std::memory_order_relaxed);
+            UpdateFps(m_output_fps, m_last_output);
+            {
+                std::lock_guard<std::mutex> lock(m_latest_mutex);
+                m_latest = preview;
+            }
+
+            std::lock_guard<std::mutex> lock(m_clients_mutex);
+            for (auto &client : m_clients)
+            {
+                if (!client->active.load(std::memory_order_acquire))
+                {
+                    continue;
+                }
+                const size_t dropped = client->queue.pushDropOldest(preview);
+                if (dropped)
+                {
+                    client->dropped.fetch_add(dropped, std::memory_order_relaxed);
+                }
+                client->signal.fetch_add(1, std::memory_order_release);
+                client->signal.notify_one();
+            }
+        }
+    }
+
+    void LiveView::sendLoop(Client &client)
+    {
+        while (client.active.load(std::memory_order_acquire))
+        {
+            const uint32_t observed = client.signal.load(std::memory_order_acquire);
+            auto preview = client.queue.tryPop();
+            if (!preview)
+            {
+                client.signal.wait(observed, std::memory_order_acquire);
+                continue;
+            }
+            bool ok = false;
+            try
+            {
+                ok = client.sender(**preview);
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::error("Live view client {} failed: {}", client.name, e.what());
+            }
+            if (!ok)
+            {
+                spdlog::warn("Live view client {} disconnected", client.name);
+                client.active.store(false, std::memory_order_release);
+                break;
+            }
+            client.sent.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void LiveView::stopClient(Client &client)
+    {
+        client.active.store(false, std::memory_order_release);
+        client.signal.fetch_add(1, std::memory_order_release);
+        client.signal.notify_all();
+        if (client.thread.joinable())
+        {
+            client.thread.join();
+        }
+    }
+
+    int LiveView::addClient(const std::string &name, PreviewSender sender)
+    {
+        std::vector<std::shared_ptr<Client>> finished;
+        std::shared_ptr<Client> client;
+        {
+            std::lock_guard<std::mutex> lock(m_clients_mutex);
+            // 顺便回收发送失败的客户端
+            auto it = std::stable_partition(m_clients.begin(), m_clients.end(), [](const auto &c)
+                                            { return c->active.load(std::memory_order_acquire); });
+            finished.assign(it, m_clients.end());
+            m_clients.erase(it, m_clients.end());
+
+            client = std::make_shared<Client>(m_next_id++, name, std::move(sender), std::max<size_t>(m_settings.client_queue_depth, 1));
+            client->thread = std::thread(&LiveView::sendLoop, this, std::ref(*client));
+            m_clients.push_back(client);
+        }
+        for (auto &c : finished)
+        {
+            stopClient(*c);
+        }
+        spdlog::debug("Live view client {} added as {}", name, client->id);
+        return client->id;
+    }
+
+    void LiveView::removeClient(int id)
+    {
+        std::shared_ptr<Client> client;
+        {
+            std::lock_guard<std::mutex> lock(m_clients_mutex);
+            auto it = std::find_if(m_clients.begin(), m_clients.end(), [id](const auto &c)
+                                   { return c->id == id; });
+            if (it == m_clients.end())
+            {
+                return;
+            }
+            client = *it;
+            m_clients.erase(it);
+        }
+        stopClient(*client);
+    }
+
+    PreviewRef LiveView::latest() const
+    {
+        std::lock_guard<std::mutex> lock(m_latest_mutex);
+        return m_latest;
+    }
+
+    nlohmann::json LiveView::stats() const
+    {
+        nlohmann::json clients = nlohmann::json::array();
+        {
+            std::lock_guard<std::mutex> lock(m_clients_mutex);
+            for (const auto &client : m_clients)
+            {
+                clients.push_back({{"id", client->id},
+                                   {"name", client->name},
+                                   {"active", client->active.load()},
+                                   {"sent", client->sent.load()},
+                                   {"dropped", client->dropped.load()},
+                                   {"queued", client->queue.sizeApprox()}});
+            }
+        }
+        return {{"running", isRunning()},
+                {"input_fps", m_input_fps.load()},
+                {"output_fps", m_output_fps.load()},
+                {"received", m_received.load()},
+                {"encoded", m_encoded.load()},
+                {"dropped", m_input_dropped.load()},
+                {"unsupported", m_unsupported.load()},
+                {"clients", clients}};
+    }
+} // namespace OpenAPT::Image
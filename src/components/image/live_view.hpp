@@ -0,0 +1,183 @@
+/*
+ * live_view.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-15
+
+Description: Live View Streaming Pipeline
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "frame_ring.hpp"
+#include "thread/bounded_queue.hpp"
+
+namespace OpenAPT::Image
+{
+    /**
+     * @brief 编码后的预览帧：缩小并拉伸后的 8 位灰度图
+     */
+    struct PreviewFrame
+    {
+        uint64_t sequence = 0;
+        int width = 0;
+        int height = 0;
+        std::chrono::system_clock::time_point timestamp;
+        std::vector<uint8_t> pixels; ///< 行优先，width * height 字节
+    };
+
+    using PreviewRef = std::shared_ptr<const PreviewFrame>;
+
+    /**
+     * @brief 预览发送函数，在客户端自己的发送线程中调用，返回 false 时移除该客户端
+     */
+    using PreviewSender = std::function<bool(const PreviewFrame &)>;
+
+    struct LiveViewSettings
+    {
+        int max_width = 1280;            ///< 预览最大宽度，超出时按整数倍缩小
+        size_t queue_depth = 2;          ///< 输入队列深度，应小于帧缓冲槽位数
+        size_t client_queue_depth = 2;   ///< 每个客户端的发送队列深度
+        double black_percentile = 0.005; ///< 拉伸黑点（像素比例）
+        double white_percentile = 0.999; ///< 拉伸白点（像素比例）
+    };
+
+    /**
+     * @brief 实时预览流水线
+     *
+     * 相机帧 -> 有界无锁输入队列 -> 编码线程（解码、缩小、拉伸）-> 每个客户端的有界无锁发送队列 -> 发送线程。
+     * 所有队列在满时丢弃最旧的帧，相机线程的 push 只做一次无锁入队，慢客户端只会丢帧，
+     * 既不会阻塞编码线程，也不会影响其他客户端。
+     */
+    class LiveView
+    {
+    public:
+        explicit LiveView(const LiveViewSettings &settings = {});
+        ~LiveView();
+
+        LiveView(const LiveView &) = delete;
+        LiveView &operator=(const LiveView &) = delete;
+
+        /**
+         * @brief 启动编码线程
+         */
+        void start();
+
+        /**
+         * @brief 停止编码线程和所有客户端的发送线程
+         */
+        void stop();
+
+        bool isRunning() const
+        {
+            return m_running.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief 提交一帧，无锁且不会阻塞；未启动时忽略
+         */
+        void push(FrameRef frame);
+
+        /**
+         * @brief 添加客户端
+         *
+         * @return 客户端 ID
+         */
+        int addClient(const std::string &name, PreviewSender sender);
+
+        void removeClient(int id);
+
+        /**
+         * @brief 最近一次编码的预览帧
+         */
+        PreviewRef latest() const;
+
+        /**
+         * @brief 统计信息：输入/输出帧率，各阶段丢帧数，客户端状态
+         */
+        nlohmann::json stats() const;
+
+        /**
+         * @brief 将相机帧解码、缩小并拉伸为预览帧
+         *
+         * 支持原始 8/16 位灰度与 RGB 视频帧（.stream）以及 8/16 位 FITS，不支持的格式返回空。
+         */
+        static PreviewRef encode(const Frame &frame, const LiveViewSettings &settings);
+
+    private:
+        struct Client
+        {
+            int id;
+            std::string name;
+            PreviewSender sender;
+            Thread::BoundedQueue<PreviewRef> queue;
+            std::atomic_uint32_t signal{0};
+            std::atomic_bool active{true};
+            std::atomic_uint64_t sent{0};
+            std::atomic_uint64_t dropped{0};
+            std::thread thread;
+
+            Client(int id, const std::string &name, PreviewSender sender, size_t depth)
+                : id(id), name(name), sender(std::move(sender)), queue(depth) {}
+        };
+
+        void encodeLoop();
+        void sendLoop(Client &client);
+        void stopClient(Client &client);
+
+        LiveViewSettings m_settings;
+        Thread::BoundedQueue<FrameRef> m_input;
+        std::atomic_uint32_t m_signal{0};
+        std::atomic_bool m_running{false};
+        std::thread m_encoder;
+
+        mutable std::mutex m_clients_mutex;
+        std::vector<std::shared_ptr<Client>> m_clients;
+        int m_next_id = 1;
+
+        mutable std::mutex m_latest_mutex;
+        PreviewRef m_latest;
+
+        std::atomic_uint64_t m_received{0};
+        std::atomic_uint64_t m_encoded{0};
+        std::atomic_uint64_t m_input_dropped{0};
+        std::atomic_uint64_t m_unsupported{0};
+        std::atomic<double> m_input_fps{0};
+        std::atomic<double> m_output_fps{0};
+        std::chrono::steady_clock::time_point m_last_input;
+        std::chrono::steady_clock::time_point m_last_output;
+    };
+} // namespace OpenAPT::Image
@@ -0,0 +1,520 @@
+/*
+ * lucky_ranker.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-16
+
+Description: Lucky Imaging Frame Ranking
+
+**************************************************/
+
+#include "lucky_ranker.hpp"
+
+#include "thread/threadpool.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::Image
+{
+    namespace
+    {
+        // 每行按固定宽度的独立累加器求和，编译器可以直接向量化
+        constexpr int kLanes = 8;
+
+        double Mean(const ScoreImage &image)
+        {
+            const float *p = image.pixels.data();
+            const size_t n = image.pixels.size();
+            float acc[kLanes] = {};
+            size_t i = 0;
+            for (; i + kLanes <= n; i += kLanes)
+                for (int k = 0; k < kLanes; ++k)
+                    acc[k] += p[i + k];
+            double sum = 0;
+            for (; i < n; ++i)
+                sum += p[i];
+            for (int k = 0; k < kLanes; ++k)
+                sum += acc[k];
+            return n ? sum / n : 0;
+        }
+
+        const char *MetricName(SharpnessMetric metric)
+        {
+            switch (metric)
+            {
+            case SharpnessMetric::LaplacianVariance:
+                return "laplacian";
+            case SharpnessMetric::GradientEnergy:
+                return "gradient";
+            case SharpnessMetric::PsfWidth:
+                return "psf";
+            }
+            return "unknown";
+        }
+    }
+
+    bool ExtractRoi(const Frame &frame, const Roi &roi, ScoreImage &out)
+    {
+        const int width = frame.meta.width;
+        const int height = frame.meta.height;
+        const size_t pixels = static_cast<size_t>(width) * height;
+        if (frame.meta.format.rfind(".fits", 0) == 0 || pixels == 0 || frame.size % pixels != 0)
+        {
+            return false;
+        }
+        const size_t bpp = frame.size / pixels;
+        if (bpp != 1 && bpp != 2 && bpp != 3 && bpp != 6)
+        {
+            return false;
+        }
+        const int bytes = bpp % 2 == 0 ? 2 : 1;
+        const int channels = static_cast<int>(bpp) / bytes;
+
+        const bool full = roi.width <= 0 || roi.height <= 0;
+        const int x0 = full ? 0 : std::clamp(roi.x, 0, width);
+        const int y0 = full ? 0 : std::clamp(roi.y, 0, height);
+        const int x1 = full ? width : std::min(width, roi.x + roi.width);
+        const int y1 = full ? height : std::min(height, roi.y + roi.height);
+        if (x1 - x0 < 3 || y1 - y0 < 3)
+        {
+            return false;
+        }
+        out.width = x1 - x0;
+        out.height = y1 - y0;
+        out.pixels.resize(static_cast<size_t>(out.width) * out.height);
+
+        for (int y = y0; y < y1; ++y)
+        {
+            float *dst = out.pixels.data() + static_cast<size_t>(y - y0) * out.width;
+            const uint8_t *row = frame.data + (static_cast<size_t>(y) * width + x0) * bpp;
+            if (bytes == 1 && channels == 1)
+            {
+                for (int x = 0; x < out.width; ++x)
+                    dst[x] = row[x];
+            }
+            else if (bytes == 2 && channels == 1)
+            {
+                // 视频流为小端 16 位
+                for (int x = 0; x < out.width; ++x)
+                    dst[x] = static_cast<float>(row[2 * x] | row[2 * x + 1] << 8);
+            }
+            else
+            {
+                for (int x = 0; x < out.width; ++x)
+                {
+                    float sum = 0;
+                    for (int c = 0; c < channels; ++c)
+                    {
+                        const uint8_t *p = row + (static_cast<size_t>(x) * channels + c) * bytes;
+                        sum += bytes == 1 ? p[0] : static_cast<float>(p[0] | p[1] << 8);
+                    }
+                    dst[x] = sum / channels;
+                }
+            }
+        }
+        return true;
+    }
+
+    double LaplacianVariance(const ScoreImage &image)
+    {
+        const int w = image.width;
+        const int h = image.height;
+        if (w < 3 || h < 3)
+        {
+            return 0;
+        }
+        double sum = 0, sumsq = 0;
+        for (int y = 1; y < h - 1; ++y)
+        {
+            const float *up = image.pixels.data() + static_cast<size_t>(y - 1) * w;
+            const float *row = up + w;
+            const float *down = row + w;
+            float s[kLanes] = {}, s2[kLanes] = {};
+            int x = 1;
+            for (; x + kLanes <= w - 1; x += kLanes)
+            {
+                for (int k = 0; k < kLanes; ++k)
+                {
+                    const float l = 4 * row[x + k] - row[x + k - 1] - row[x + k + 1] - up[x + k] - down[x + k];
+                    s[k] += l;
+                    s2[k] += l * l;
+                }
+            }
+            for (; x < w - 1; ++x)
+            {
+                const float l = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+                s[0] += l;
+                s2[0] += l * l;
+            }
+            for (int k = 0; k < kLanes; ++k)
+            {
+                sum += s[k];
+                sumsq += s2[k];
+            }
+        }
+        const double n = static_cast<double>(w - 2) * (h - 2);
+        const double mean = Mean(image);
+        const double variance = sumsq / n - (sum / n) * (sum / n);
+        return mean > 0 ? variance / (mean * mean) : 0;
+    }
+
+    double GradientEnergy(const ScoreImage &image)
+    {
+        const int w = image.width;
+        const int h = image.height;
+        if (w < 3 || h < 3)
+        {
+            return 0;
+        }
+        double energy = 0;
+        for (int y = 1; y < h - 1; ++y)
+        {
+            const float *up = image.pixels.data() + static_cast<size_t>(y - 1) * w;
+            const float *row = up + w;
+            const float *down = row + w;
+            float e[kLanes] = {};
+            int x = 1;
+            for (; x + kLanes <= w - 1; x += kLanes)
+            {
+                for (int k = 0; k < kLanes; ++k)
+                {
+                    const float gx = row[x + k + 1] - row[x + k - 1];
+                    const float gy = down[x + k] - up[x + k];
+                    e[k] += gx * gx + gy * gy;
+                }
+            }
+            for (; x < w - 1; ++x)
+            {
+                const float gx = row[x + 1] - row[x - 1];
+                const float gy = down[x] - up[x];
+                e[0] += gx * gx + gy * gy;
+            }
+            for (int k = 0; k < kLanes; ++k)
+                energy += e[k];
+        }
+        const double n = static_cast<double>(w - 2) * (h - 2);
+        const double mean = Mean(image);
+        return mean > 0 ? energy / n / (mean * mean) : 0;
+    }
+
+    bool MeasurePsf(const ScoreImage &image, float outerDiameter, float &x, float &y, float &hfd)
+    {
+        const int w = image.width;
+        const int h = image.height;
+        const float *p = image.pixels.data();
+
+        // 背景取 ROI 边框像素的平均值
+        double border = 0;
+        for (int i = 0; i < w; ++i)
+            border += p[i] + p[static_cast<size_t>(h - 1) * w + i];
+        for (int j = 1; j < h - 1; ++j)
+            border += p[static_cast<size_t>(j) * w] + p[static_cast<size_t>(j) * w + w - 1];
+        const float background = static_cast<float>(border / (2 * w + 2 * (h - 2)));
+
+        const auto peak = std::max_element(image.pixels.begin(), image.pixels.end());
+        if (*peak <= background)
+        {
+            return false;
+        }
+        const size_t index = static_cast<size_t>(peak - image.pixels.begin());
+        x = static_cast<float>(index % w);
+        y = static_cast<float>(index / w);
+
+        const float radius = outerDiameter / 2;
+        const float radius2 = radius * radius;
+        float sum = 0, sum_dist = 0;
+        // 两次亮度加权质心，第二次以第一次的结果为中心，最后一次同时累计 HFD
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            const int xmin = std::max(0, static_cast<int>(std::floor(x - radius)));
+            const int xmax = std::min(w - 1, static_cast<int>(std::ceil(x + radius)));
+            const int ymin = std::max(0, static_cast<int>(std::floor(y - radius)));
+            const int ymax = std::min(h - 1, static_cast<int>(std::ceil(y + radius)));
+            float sx = 0, sy = 0;
+            sum = 0;
+            sum_dist = 0;
+            for (int j = ymin; j <= ymax; ++j)
+            {
+                const float *row = p + static_cast<size_t>(j) * w;
+                const float dy = j - y;
+                for (int i = xmin; i <= xmax; ++i)
+                {
+                    const float dx = i - x;
+                    const float d2 = dx * dx + dy * dy;
+                    if (d2 > radius2)
+                        continue;
+                    const float v = std::max(row[i] - background, 0.0f);
+                    sum += v;
+                    sx += v * i;
+                    sy += v * j;
+                    sum_dist += v * std::sqrt(d2);
+                }
+            }
+            if (sum <= 0)
+            {
+                return false;
+            }
+            if (pass == 0)
+            {
+                x = sx / sum;
+                y = sy / sum;
+            }
+        }
+        hfd = 2 * sum_dist / sum;
+        return true;
+    }
+
+    LuckyRanker::LuckyRanker(FrameRing &ring) : m_ring(ring)
+    {
+    }
+
+    LuckyRanker::~LuckyRanker()
+    {
+        stop();
+    }
+
+    FrameScore LuckyRanker::score(const ScoreImage &image, const LuckySettings &settings)
+    {
+        FrameScore result;
+        switch (settings.metric)
+        {
+        case SharpnessMetric::LaplacianVariance:
+            result.score = LaplacianVariance(image);
+            break;
+        case SharpnessMetric::GradientEnergy:
+            result.score = GradientEnergy(image);
+            break;
+        case SharpnessMetric::PsfWidth:
+            if (MeasurePsf(image, settings.outer_diameter, result.star_x, result.star_y, result.hfd) && result.hfd > 0)
+            {
+                result.score = 1.0 / result.hfd;
+            }
+            break;
+        }
+        return result;
+    }
+
+    bool LuckyRanker::start(const LuckySettings &settings, ScoreCallback callback)
+    {
+        if (m_running.load())
+        {
+            spdlog::error("Lucky imaging ranking is already running");
+            return false;
+        }
+        m_settings = settings;
+        m_settings.keep_fraction = std::clamp(settings.keep_fraction, 0.0, 1.0);
+        m_settings.window = std::max<size_t>(settings.window, 1);
+        m_settings.max_pending = std::max<size_t>(settings.max_pending, 1);
+        m_callback = std::move(callback);
+        {
+            std::lock_guard<std::mutex> lock(m_scores_mutex);
+            m_scores.clear();
+            m_window.clear();
+            m_window_sorted.clear();
+        }
+        m_scored = 0;
+        m_kept = 0;
+        m_skipped = 0;
+        m_rejected = 0;
+        m_busy_ns = 0;
+        m_started = std::chrono::steady_clock::now();
+
+        m_pool = std::make_unique<Thread::ThreadPool>(std::max<size_t>(settings.workers, 1));
+        m_running = true;
+        m_dispatcher = std::thread(&LuckyRanker::dispatchLoop, this);
+        spdlog::info("Lucky imaging ranking started, keeping best {:.0f}% by {}", m_settings.keep_fraction * 100,
+                     MetricName(m_settings.metric));
+        return true;
+    }
+
+    void LuckyRanker::stop()
+    {
+        if (!m_running.exchange(false))
+        {
+            return;
+        }
+        if (m_dispatcher.joinable())
+        {
+            m_dispatcher.join();
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_pending_mutex);
+            m_pending_cv.wait(lock, [this]
+                              { return m_pending == 0; });
+        }
+        m_pool.reset();
+        spdlog::info("Lucky imaging ranking stopped: {} scored, {} kept, {} skipped", m_scored.load(), m_kept.load(),
+                     m_skipped.load());
+    }
+
+    void LuckyRanker::dispatchLoop()
+    {
+        uint64_t last = m_ring.published();
+        while (m_running.load(std::memory_order_acquire))
+        {
+            auto frame = m_ring.waitNext(last, std::chrono::milliseconds(200));
+            if (!frame)
+            {
+                continue;
+            }
+            if (frame->meta.sequence > last + 1)
+            {
+                m_skipped.fetch_add(frame->meta.sequence - last - 1, std::memory_order_relaxed);
+            }
+            last = frame->meta.sequence;
+            if (!frame->meta.video)
+            {
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_pending_mutex);
+                if (m_pending >= m_settings.max_pending)
+                {
+                    m_skipped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                ++m_pending;
+            }
+
+            // 只复制 ROI，随后立即释放帧缓冲槽位
+            auto image = std::make_shared<ScoreImage>();
+            const bool ok = ExtractRoi(*frame, m_settings.roi, *image);
+            const uint64_t sequence = frame->meta.sequence;
+            const auto timestamp = frame->meta.timestamp;
+            frame.reset();
+            if (!ok)
+            {
+                m_rejected.fetch_add(1, std::memory_order_relaxed);
+                {
+                    std::lock_guard<std::mutex> lock(m_pending_mutex);
+                    --m_pending;
+                }
+                m_pending_cv.notify_all();
+                continue;
+            }
+
+            m_pool->enqueue([this, image, sequence, timestamp]
+                            {
+                const auto begin = std::chrono::steady_clock::now();
+                FrameScore result = score(*image, m_settings);
+                result.sequence = sequence;
+                result.timestamp = timestamp;
+                m_busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count(),
+                                    std::memory_order_relaxed);
+                finishScore(result);
+                {
+                    std::lock_guard<std::mutex> lock(m_pending_mutex);
+                    --m_pending;
+                }
+                m_pending_cv.notify_all(); });
+        }
+    }
+
+    void LuckyRanker::finishScore(FrameScore result)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_scores_mutex);
+            // 维护最近 window 帧的有序分数，阈值为其中的 (1 - keep_fraction) 分位数
+            if (m_window.size() == m_settings.window)
+            {
+                const double oldest = m_window.front();
+                m_window.pop_front();
+                m_window_sorted.erase(std::lower_bound(m_window_sorted.begin(), m_window_sorted.end(), oldest));
+            }
+            m_window.push_back(result.score);
+            m_window_sorted.insert(std::upper_bound(m_window_sorted.begin(), m_window_sorted.end(), result.score), result.score);
+            const size_t n = m_window_sorted.size();
+            const auto rank = static_cast<size_t>(std::floor((1.0 - m_settings.keep_fraction) * (n - 1)));
+            // 至少要有 1 / keep_fraction 帧，前 keep_fraction 才至少包含一帧之外的参照
+            const size_t warmup = m_settings.keep_fraction > 0
+                                      ? std::min(m_settings.window, static_cast<size_t>(std::ceil(1.0 / m_settings.keep_fraction - 1e-9)))
+                                      : 0;
+            result.keep = m_settings.keep_fraction > 0 && n >= warmup && result.score >= m_window_sorted[rank];
+            m_scores.push_back(result);
+        }
+        m_scored.fetch_add(1, std::memory_order_relaxed);
+        if (result.keep)
+        {
+            m_kept.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (m_callback)
+        {
+            m_callback(result);
+        }
+    }
+
+    std::vector<FrameScore> LuckyRanker::best(double fraction) const
+    {
+        std::vector<FrameScore> result;
+        {
+            std::lock_guard<std::mutex> lock(m_scores_mutex);
+            result = m_scores;
+        }
+        const auto count = static_cast<size_t>(std::ceil(result.size() * std::clamp(fraction, 0.0, 1.0)));
+        std::partial_sort(result.begin(), result.begin() + count, result.end(), [](const FrameScore &a, const FrameScore &b)
+                          { return a.score > b.score; });
+        result.resize(count);
+        return result;
+    }
+
+    std::vector<FrameScore> LuckyRanker::scores() const
+    {
+        std::vector<FrameScore> result;
+        {
+            std::lock_guard<std::mutex> lock(m_scores_mutex);
+            result = m_scores;
+        }
+        std::sort(result.begin(), result.end(), [](const FrameScore &a, const FrameScore &b)
+                  { return a.sequence < b.sequence; });
+        return result;
+    }
+
+    nlohmann::json LuckyRanker::stats() const
+    {
+        const uint64_t scored = m_scored.load();
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+        double threshold = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_scores_mutex);
+            if (!m_window_sorted.empty())
+            {
+                const size_t n = m_window_sorted.size();
+                threshold = m_window_sorted[static_cast<size_t>(std::floor((1.0 - m_settings.keep_fraction) * (n - 1)))];
+            }
+        }
+        return {{"running", isRunning()},
+                {"metric", MetricName(m_settings.metric)},
+                {"keep_fraction", m_settings.keep_fraction},
+                {"threshold", threshold},
+                {"scored", scored},
+                {"kept", m_kept.load()},
+                {"skipped", m_skipped.load()},
+                {"rejected", m_rejected.load()},
+                {"fps", elapsed > 0 ? scored / elapsed : 0.0},
+                {"score_ms", scored ? m_busy_ns.load() / 1e6 / scored : 0.0}};
+    }
+} // namespace OpenAPT::Image
@@ -0,0 +1,216 @@
+/*
+ * lucky_ranker.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-16
+
+Description: Lucky Imaging Frame Ranking
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "frame_ring.hpp"
+
+namespace OpenAPT::Thread
+{
+    class ThreadPool;
+}
+
+namespace OpenAPT::Image
+{
+    /**
+     * @brief 清晰度评价方法
+     */
+    enum class SharpnessMetric
+    {
+        LaplacianVariance, ///< 拉普拉斯响应的方差，适合行星表面细节
+        GradientEnergy,    ///< 梯度能量，对噪声较不敏感
+        PsfWidth           ///< 导星星点的半通量直径，适合有恒星的视场
+    };
+
+    /**
+     * @brief 评分区域，宽或高为 0 时使用整帧
+     */
+    struct Roi
+    {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    /**
+     * @brief 单帧评分，score 越大越清晰
+     */
+    struct FrameScore
+    {
+        uint64_t sequence = 0;
+        std::chrono::system_clock::time_point timestamp;
+        double score = 0;
+        float star_x = 0; ///< PsfWidth 时的星点位置（ROI 内坐标）
+        float star_y = 0;
+        float hfd = 0;    ///< PsfWidth 时的半通量直径
+        bool keep = false;
+    };
+
+    /**
+     * @brief 按行优先存放的浮点灰度图，评分函数只读取这块内存
+     */
+    struct ScoreImage
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<float> pixels;
+    };
+
+    /**
+     * @brief 从原始 8/16 位灰度帧中复制 ROI 并转换为浮点
+     *
+     * @return 帧格式不支持或 ROI 超出范围时返回 false
+     */
+    bool ExtractRoi(const Frame &frame, const Roi &roi, ScoreImage &out);
+
+    /**
+     * @brief 拉普拉斯方差，按平均亮度的平方归一化，不受透明度变化影响
+     */
+    double LaplacianVariance(const ScoreImage &image);
+
+    /**
+     * @brief 梯度能量（中心差分的平方和），按平均亮度的平方归一化
+     */
+    double GradientEnergy(const ScoreImage &image);
+
+    /**
+     * @brief 测量最亮星点的亚像素位置和半通量直径
+     *
+     * 与 draw.cpp 的 calcHfd 相同的定义（2 * Σ(I·r) / ΣI），但以亮度加权质心为中心并使用亚像素距离。
+     *
+     * @param outerDiameter 计算 HFD 的外径
+     * @return 没有高于背景的星点时返回 false
+     */
+    bool MeasurePsf(const ScoreImage &image, float outerDiameter, float &x, float &y, float &hfd);
+
+    struct LuckySettings
+    {
+        SharpnessMetric metric = SharpnessMetric::LaplacianVariance;
+        Roi roi;
+        double keep_fraction = 0.1;  ///< 保留最清晰的比例
+        size_t window = 500;         ///< 实时阈值参考的最近帧数
+        size_t workers = 2;          ///< 评分线程数，独立于录制线程
+        size_t max_pending = 8;      ///< 等待评分的帧数上限，超出时跳过新帧
+        float outer_diameter = 20;   ///< PsfWidth 的外径
+    };
+
+    /**
+     * @brief 评分完成回调，在评分线程中调用
+     */
+    using ScoreCallback = std::function<void(const FrameScore &)>;
+
+    /**
+     * @brief 幸运成像的实时帧评分
+     *
+     * 调度线程从 FrameRing 读取视频帧，只复制 ROI 后立即释放槽位，不与录制争用帧缓冲；
+     * ROI 在独立的线程池中评分。每帧与最近 window 帧的分数比较，位于前 keep_fraction 时标记为保留。
+     * 参考的帧数少于 1 / keep_fraction 时阈值没有意义，这些帧（包括第一帧）不标记为保留，可以事后用 best() 挑选。
+     * 评分跟不上时跳过新帧并计数，而不是拖慢采集。
+     */
+    class LuckyRanker
+    {
+    public:
+        explicit LuckyRanker(FrameRing &ring);
+        ~LuckyRanker();
+
+        LuckyRanker(const LuckyRanker &) = delete;
+        LuckyRanker &operator=(const LuckyRanker &) = delete;
+
+        bool start(const LuckySettings &settings, ScoreCallback callback = nullptr);
+
+        /**
+         * @brief 停止读取新帧并等待已提交的帧评分完成
+         */
+        void stop();
+
+        bool isRunning() const
+        {
+            return m_running.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief 对单个 ROI 评分，不涉及线程
+         */
+        static FrameScore score(const ScoreImage &image, const LuckySettings &settings);
+
+        /**
+         * @brief 本次运行中所有帧按分数排序后的前 fraction
+         */
+        std::vector<FrameScore> best(double fraction) const;
+
+        /**
+         * @brief 本次运行中所有帧的分数，按帧序号排序
+         */
+        std::vector<FrameScore> scores() const;
+
+        nlohmann::json stats() const;
+
+    private:
+        void dispatchLoop();
+        void finishScore(FrameScore result);
+
+        FrameRing &m_ring;
+        LuckySettings m_settings;
+        ScoreCallback m_callback;
+        std::unique_ptr<Thread::ThreadPool> m_pool;
+        std::thread m_dispatcher;
+        std::atomic_bool m_running{false};
+
+        std::mutex m_pending_mutex;
+        std::condition_variable m_pending_cv;
+        size_t m_pending = 0;
+
+        mutable std::mutex m_scores_mutex;
+        std::vector<FrameScore> m_scores;
+        std::deque<double> m_window;
+        std::vector<double> m_window_sorted;
+
+        std::atomic_uint64_t m_scored{0};
+        std::atomic_uint64_t m_kept{0};
+        std::atomic_uint64_t m_skipped{0};
+        std::atomic_uint64_t m_rejected{0};
+        std::atomic_uint64_t m_busy_ns{0};
+        std::chrono::steady_clock::time_point m_started;
+    };
+} // namespace OpenAPT::Image
@@ -0,0 +1,472 @@
+/*
+ * ser_recorder.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-16
+
+Description: SER Video Recorder
+
+**************************************************/
+
+#include "ser_recorder.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::Image
+{
+    namespace
+    {
+        constexpr size_t kHeaderSize = 178;
+        // 0001-01-01 到 1970-01-01 之间的 100ns 刻度数
+        constexpr int64_t kUnixEpochTicks = 621355968000000000LL;
+
+        int64_t ToSerTicks(std::chrono::system_clock::time_point time)
+        {
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+            return kUnixEpochTicks + us * 10;
+        }
+
+        void PutLE32(uint8_t *p, int32_t value)
+        {
+            const auto v = static_cast<uint32_t>(value);
+            for (int i = 0; i < 4; ++i)
+                p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+
+        void PutLE64(uint8_t *p, int64_t value)
+        {
+            const auto v = static_cast<uint64_t>(value);
+            for (int i = 0; i < 8; ++i)
+                p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+
+        void PutString(uint8_t *p, const std::string &value, size_t size)
+        {
+            std::memset(p, 0, size);
+            std::memcpy(p, value.data(), std::min(value.size(), size));
+        }
+
+        bool WriteAll(int fd, const uint8_t *data, size_t size, uint64_t offset)
+        {
+            while (size > 0)
+            {
+                const ssize_t n = pwrite(fd, data, size, static_cast<off_t>(offset));
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return false;
+                }
+                data += n;
+                size -= static_cast<size_t>(n);
+                offset += static_cast<uint64_t>(n);
+            }
+            return true;
+        }
+
+        size_t AlignUp(size_t value, size_t align)
+        {
+            return (value + align - 1) / align * align;
+        }
+    }
+
+    SerRecorder::SerRecorder(FrameRing &ring) : m_ring(ring)
+    {
+    }
+
+    SerRecorder::~SerRecorder()
+    {
+        stop();
+    }
+
+    bool SerRecorder::start(const SerSettings &settings)
+    {
+        if (m_active.load() && isRecording())
+        {
+            spdlog::error("SER recorder is already recording {}", m_settings.filename);
+            return false;
+        }
+        // 上一次录制可能已因达到帧数上限自行结束，回收它的线程
+        stop();
+        if (settings.filename.empty())
+        {
+            spdlog::error("SER recorder requires a file name");
+            return false;
+        }
+        m_settings = settings;
+        m_settings.buffer_size = std::max(AlignUp(settings.buffer_size, m_align), m_align);
+        m_settings.buffers = std::max<size_t>(settings.buffers, 2);
+
+        m_direct = false;
+#ifdef O_DIRECT
+        if (m_settings.direct_io)
+        {
+            m_fd = open(m_settings.filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+            m_direct = m_fd >= 0;
+        }
+#endif
+        if (m_fd < 0)
+        {
+            // 部分文件系统（如 tmpfs）不支持 O_DIRECT
+            m_fd = open(m_settings.filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        if (m_fd < 0)
+        {
+            spdlog::error("Failed to create SER file {}: {}", m_settings.filename, std::strerror(errno));
+            return false;
+        }
+
+        m_storage.clear();
+        m_buffers.assign(m_settings.buffers, Buffer{});
+        m_free.clear();
+        m_full.clear();
+        for (auto &buffer : m_buffers)
+        {
+            void *memory = nullptr;
+            if (posix_memalign(&memory, m_align, m_settings.buffer_size) != 0)
+            {
+                spdlog::error("Failed to allocate SER write buffers");
+                close(m_fd);
+                m_fd = -1;
+                return false;
+            }
+            m_storage.emplace_back(static_cast<uint8_t *>(memory), std::free);
+            buffer.data = static_cast<uint8_t *>(memory);
+            m_free.push_back(&buffer);
+        }
+
+        // 数据流从文件头开始，文件头先占位，结束时回填
+        m_current = m_free.front();
+        m_free.pop_front();
+        m_current->offset = 0;
+        m_current->used = kHeaderSize;
+        m_current->last = false;
+        std::memset(m_current->data, 0, kHeaderSize);
+        m_stream_offset = kHeaderSize;
+
+        m_width = m_height = m_depth = 0;
+        m_frame_bytes = 0;
+        m_timestamps.clear();
+        m_timestamps.reserve(m_settings.preallocate_frames);
+        m_frames = 0;
+        m_skipped = 0;
+        m_rejected = 0;
+        m_written = 0;
+        m_ring_dropped = 0;
+        m_ring_dropped_start = m_ring.dropped();
+        m_elapsed = 0;
+        m_failed = false;
+        m_finished_ok = false;
+        m_started = std::chrono::steady_clock::now();
+
+        m_active = true;
+        m_recording = true;
+        m_writer = std::thread(&SerRecorder::writeLoop, this);
+        m_capture = std::thread(&SerRecorder::captureLoop, this);
+        spdlog::info("Recording SER video to {}{}", m_settings.filename, m_direct ? " (direct I/O)" : "");
+        return true;
+    }
+
+    bool SerRecorder::stop()
+    {
+        if (!m_active.exchange(false))
+        {
+            return false;
+        }
+        m_recording = false;
+        // 采集线程负责等待写线程并完成文件
+        if (m_capture.joinable())
+        {
+            m_capture.join();
+        }
+        return m_finished_ok.load();
+    }
+
+    bool SerRecorder::acceptFrame(const Frame &frame)
+    {
+        const size_t pixels = static_cast<size_t>(frame.meta.width) * frame.meta.height;
+        if (frame.meta.format != ".stream" || pixels == 0 || frame.size % pixels != 0)
+        {
+            return false;
+        }
+        if (m_frame_bytes != 0)
+        {
+            return frame.size == m_frame_bytes && frame.meta.width == m_width && frame.meta.height == m_height;
+        }
+
+        const size_t bpp = frame.size / pixels;
+        if (bpp != 1 && bpp != 2 && bpp != 3 && bpp != 6)
+        {
+            return false;
+        }
+        const size_t bytes = bpp % 2 == 0 ? 2 : 1;
+        m_width = frame.meta.width;
+        m_height = frame.meta.height;
+        m_depth = bytes == 1 ? 8 : (frame.meta.bit_depth > 8 && frame.meta.bit_depth <= 16 ? frame.meta.bit_depth : 16);
+        m_color = bpp / bytes == 3 ? SerColor::RGB : m_settings.color;
+        m_frame_bytes = frame.size;
+
+        // 预分配数据区和时间戳尾部，避免录制中分配磁盘块
+        const size_t frames = m_settings.max_frames ? m_settings.max_frames : m_settings.preallocate_frames;
+        const off_t total = static_cast<off_t>(kHeaderSize + frames * (m_frame_bytes + sizeof(int64_t)));
+        if (frames > 0)
+        {
+#ifdef __linux__
+            const int err = fallocate(m_fd, 0, 0, total) == 0 ? 0 : errno;
+#else
+            const int err = posix_fallocate(m_fd, 0, total);
+#endif
+            if (err != 0)
+            {
+                spdlog::warn("Failed to preallocate {} MB for {}: {}", total >> 20, m_settings.filename, std::strerror(err));
+            }
+        }
+        spdlog::debug("SER recording {}x{} {} bit, {} bytes per frame", m_width, m_height, m_depth, m_frame_bytes);
+        return true;
+    }
+
+    SerRecorder::Buffer *SerRecorder::takeFree()
+    {
+        // 写线程出错后仍会回收缓冲，这里不会永久等待
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]
+                  { return !m_free.empty(); });
+        Buffer *buffer = m_free.front();
+        m_free.pop_front();
+        return buffer;
+    }
+
+    void SerRecorder::submit(Buffer *buffer)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_full.push_back(buffer);
+        }
+        m_cv.notify_all();
+    }
+
+    bool SerRecorder::appendBytes(const uint8_t *data, size_t size)
+    {
+        const size_t capacity = m_settings.buffer_size;
+        while (size > 0)
+        {
+            const size_t n = std::min(size, capacity - m_current->used);
+            std::memcpy(m_current->data + m_current->used, data, n);
+            m_current->used += n;
+            m_stream_offset += n;
+            data += n;
+            size -= n;
+            if (m_current->used == capacity)
+            {
+                const uint64_t next = m_current->offset + capacity;
+                submit(m_current);
+                m_current = takeFree();
+                m_current->offset = next;
+                m_current->used = 0;
+                m_current->last = false;
+            }
+        }
+        return !m_failed.load(std::memory_order_acquire);
+    }
+
+    void SerRecorder::captureLoop()
+    {
+        uint64_t last = m_ring.published();
+        while (m_recording.load(std::memory_order_acquire))
+        {
+            auto frame = m_ring.waitNext(last, std::chrono::milliseconds(200));
+            m_ring_dropped = m_ring.dropped() - m_ring_dropped_start;
+            if (!frame)
+            {
+                continue;
+            }
+            if (frame->meta.sequence > last + 1)
+            {
+                m_skipped.fetch_add(frame->meta.sequence - last - 1, std::memory_order_relaxed);
+            }
+            last = frame->meta.sequence;
+            if (!frame->meta.video)
+            {
+                continue;
+            }
+            if (!acceptFrame(*frame))
+            {
+                m_rejected.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            const int64_t timestamp = ToSerTicks(frame->meta.timestamp);
+            const bool ok = appendBytes(frame->data, frame->size);
+            frame.reset(); // 复制完成后立即归还槽位
+            if (!ok)
+            {
+                break;
+            }
+            m_timestamps.push_back(timestamp);
+            const uint64_t frames = m_frames.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (m_settings.max_frames && frames >= m_settings.max_frames)
+            {
+                break;
+            }
+        }
+        m_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+        m_recording = false;
+        m_current->last = true;
+        submit(m_current);
+        m_current = nullptr;
+
+        // 无论是 stop()、达到 max_frames 还是写入失败，都在这里写入尾部和文件头，文件总是完整的
+        m_writer.join();
+        m_finished_ok = finish() && !m_failed.load();
+        spdlog::info("SER recording {} finished: {} frames in {:.1f}s, {} skipped, {} dropped by ring",
+                     m_settings.filename, m_frames.load(), m_elapsed.load(), m_skipped.load(), m_ring_dropped.load());
+    }
+
+    void SerRecorder::writeLoop()
+    {
+        while (true)
+        {
+            Buffer *buffer;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]
+                          { return !m_full.empty(); });
+                buffer = m_full.front();
+                m_full.pop_front();
+            }
+            const bool last = buffer->last;
+            if (!m_failed.load(std::memory_order_acquire) && buffer->used > 0)
+            {
+                // 最后一块补齐到对齐长度，多出的部分在结束时截断
+                size_t length = buffer->used;
+                if (last && m_direct)
+                {
+                    length = AlignUp(buffer->used, m_align);
+                    std::memset(buffer->data + buffer->used, 0, length - buffer->used);
+                }
+                if (WriteAll(m_fd, buffer->data, length, buffer->offset))
+                {
+                    m_written.fetch_add(buffer->used, std::memory_order_relaxed);
+                }
+                else
+                {
+                    spdlog::error("Failed to write SER file {}: {}", m_settings.filename, std::strerror(errno));
+                    m_failed = true;
+                    m_recording = false;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_free.push_back(buffer);
+            }
+            m_cv.notify_all();
+            if (last)
+            {
+                break;
+            }
+        }
+    }
+
+    bool SerRecorder::finish()
+    {
+        if (m_fd < 0)
+        {
+            return false;
+        }
+        bool ok = ftruncate(m_fd, static_cast<off_t>(m_stream_offset)) == 0;
+#ifdef O_DIRECT
+        if (m_direct)
+        {
+            // 文件头和尾部很小且不对齐，关闭 O_DIRECT 后普通写入
+            fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+        }
+#endif
+        const auto frames = static_cast<int32_t>(m_frames.load());
+
+        std::vector<uint8_t> trailer(m_timestamps.size() * sizeof(int64_t));
+        for (size_t i = 0; i < m_timestamps.size(); ++i)
+        {
+            PutLE64(trailer.data() + i * sizeof(int64_t), m_timestamps[i]);
+        }
+        ok = ok && WriteAll(m_fd, trailer.data(), trailer.size(), m_stream_offset);
+
+        const auto now = std::chrono::system_clock::now();
+        const std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+        std::tm local{};
+        localtime_r(&seconds, &local);
+        uint8_t header[kHeaderSize];
+        std::memcpy(header, "LUCAM-RECORDER", 14);
+        PutLE32(header + 14, 0);
+        PutLE32(header + 18, static_cast<int32_t>(m_color));
+        // 规范中 1 表示小端，但 FireCapture、AutoStakkert 等常用软件都按 0 表示小端读取
+        PutLE32(header + 22, 0);
+        PutLE32(header + 26, m_width);
+        PutLE32(header + 30, m_height);
+        PutLE32(header + 34, m_depth);
+        PutLE32(header + 38, frames);
+        PutString(header + 42, m_settings.observer, 40);
+        PutString(header + 82, m_settings.instrument, 40);
+        PutString(header + 122, m_settings.telescope, 40);
+        PutLE64(header + 162, ToSerTicks(now) + static_cast<int64_t>(local.tm_gmtoff) * 10000000);
+        PutLE64(header + 170, ToSerTicks(now));
+        ok = ok && WriteAll(m_fd, header, kHeaderSize, 0);
+        ok = ok && fdatasync(m_fd) == 0;
+        if (!ok)
+        {
+            spdlog::error("Failed to finalize SER file {}: {}", m_settings.filename, std::strerror(errno));
+        }
+        close(m_fd);
+        m_fd = -1;
+        return ok;
+    }
+
+    nlohmann::json SerRecorder::stats() const
+    {
+        const double elapsed = isRecording()
+                                   ? std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count()
+                                   : m_elapsed.load();
+        const uint64_t frames = m_frames.load();
+        const uint64_t written = m_written.load();
+        return {{"recording", isRecording()},
+                {"filename", m_settings.filename},
+                {"direct_io", m_direct},
+                {"frames", frames},
+                {"skipped", m_skipped.load()},
+                {"ring_dropped", m_ring_dropped.load()},
+                {"rejected", m_rejected.load()},
+                {"bytes", written},
+                {"elapsed", elapsed},
+                {"fps", elapsed > 0 ? frames / elapsed : 0.0},
+                {"mb_per_second", elapsed > 0 ? written / elapsed / (1 << 20) : 0.0},
+                {"failed", m_failed.load()}};
+    }
+} // namespace OpenAPT::Image
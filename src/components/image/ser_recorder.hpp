@@ -0,0 +1,177 @@
+/*
+ * ser_recorder.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-16
+
+Description: SER Video Recorder
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "frame_ring.hpp"
+
+namespace OpenAPT::Image
+{
+    /**
+     * @brief SER 文件的颜色类型
+     */
+    enum class SerColor : int32_t
+    {
+        Mono = 0,
+        BayerRGGB = 8,
+        BayerGRBG = 9,
+        BayerGBRG = 10,
+        BayerBGGR = 11,
+        RGB = 100,
+        BGR = 101
+    };
+
+    struct SerSettings
+    {
+        std::string filename;
+        SerColor color = SerColor::Mono; ///< 单通道帧的颜色类型，三通道帧总是 RGB
+        std::string observer;
+        std::string instrument;
+        std::string telescope;
+        size_t max_frames = 0;             ///< 录制帧数上限，0 表示直到 stop
+        size_t preallocate_frames = 10000; ///< 按帧数预分配文件空间
+        size_t buffer_size = 8 << 20;      ///< 每个写缓冲的大小，向上取整到对齐大小
+        size_t buffers = 4;                ///< 写缓冲数量
+        bool direct_io = true;             ///< 尽量使用 O_DIRECT 绕过页缓存
+    };
+
+    /**
+     * @brief SER 视频录制
+     *
+     * 采集线程从 FrameRing 按序号读取视频帧，复制到对齐的大缓冲后立即释放槽位；
+     * 写线程把写满的缓冲以对齐的偏移和长度整块写入（可用时使用 O_DIRECT），
+     * 文件在收到第一帧后按帧大小用 fallocate 预分配。结束时写入时间戳尾部并回填文件头中的帧数。
+     * 写入跟不上时采集线程等待空闲缓冲，FrameRing 因此丢弃的帧和序号不连续的帧都会被统计。
+     * 达到 max_frames 时采集线程自行结束并完成文件，不需要等待 stop()。
+     */
+    class SerRecorder
+    {
+    public:
+        explicit SerRecorder(FrameRing &ring);
+        ~SerRecorder();
+
+        SerRecorder(const SerRecorder &) = delete;
+        SerRecorder &operator=(const SerRecorder &) = delete;
+
+        /**
+         * @brief 创建文件并开始录制之后到达的视频帧
+         */
+        bool start(const SerSettings &settings);
+
+        /**
+         * @brief 停止录制，写入剩余数据、时间戳尾部和文件头
+         *
+         * @return 录制过程中出现写入错误时返回 false；已经自行结束时返回当时完成文件的结果
+         */
+        bool stop();
+
+        /**
+         * @brief 是否仍在采集，达到 max_frames 或写入失败后自动变为 false，此时文件已经完成
+         */
+        bool isRecording() const
+        {
+            return m_recording.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief 统计信息：帧数、丢帧数、写入量与速率
+         */
+        nlohmann::json stats() const;
+
+    private:
+        struct Buffer
+        {
+            uint8_t *data = nullptr;
+            size_t used = 0;
+            uint64_t offset = 0; ///< 在文件中的偏移，总是对齐的
+            bool last = false;
+        };
+
+        bool acceptFrame(const Frame &frame);
+        bool appendBytes(const uint8_t *data, size_t size);
+        Buffer *takeFree();
+        void submit(Buffer *buffer);
+        void captureLoop();
+        void writeLoop();
+        bool finish();
+
+        FrameRing &m_ring;
+        SerSettings m_settings;
+        int m_fd = -1;
+        bool m_direct = false;
+        size_t m_align = 4096;
+
+        std::vector<std::unique_ptr<uint8_t, void (*)(void *)>> m_storage;
+        std::vector<Buffer> m_buffers;
+        std::deque<Buffer *> m_free;
+        std::deque<Buffer *> m_full;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        Buffer *m_current = nullptr;
+        uint64_t m_stream_offset = 0;
+
+        // 由第一帧确定
+        int m_width = 0;
+        int m_height = 0;
+        int m_depth = 0;
+        SerColor m_color = SerColor::Mono;
+        size_t m_frame_bytes = 0;
+        std::vector<int64_t> m_timestamps;
+
+        std::thread m_capture;
+        std::thread m_writer;
+        std::atomic_bool m_recording{false};
+        std::atomic_bool m_failed{false};
+        std::atomic_bool m_active{false};
+        std::atomic_bool m_finished_ok{false}; ///< 文件是否完整写入
+
+        std::atomic_uint64_t m_frames{0};
+        std::atomic_uint64_t m_skipped{0};
+        std::atomic_uint64_t m_rejected{0};
+        std::atomic_uint64_t m_written{0};
+        uint64_t m_ring_dropped_start = 0;
+        std::atomic_uint64_t m_ring_dropped{0};
+        std::chrono::steady_clock::time_point m_started;
+        std::atomic<double> m_elapsed{0};
+    };
+} // namespace OpenAPT::Image
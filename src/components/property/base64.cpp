@@ -31,6 +31,9 @@ Description: Base64
 
 #include "base64.hpp"
 
+#include <array>
+#include <cstring>
+
 #ifdef _WIN32
 #include <Windows.h>
 #else
@@ -142,4 +145,200 @@ namespace OpenAPT::Base64
         }
         return ret;
     }
+
+    namespace
+    {
+        constexpr uint8_t kInvalid = 0xff;
+        constexpr uint8_t kSpace = 0xfe;
+        constexpr uint8_t kPad = 0xfd;
+
+        constexpr std::array<uint8_t, 256> MakeDecodeTable()
+        {
+            std::array<uint8_t, 256> table{};
+            for (auto &value : table)
+            {
+                value = kInvalid;
+            }
+            for (int i = 0; i < 26; ++i)
+            {
+                table['A' + i] = static_cast<uint8_t>(i);
+                table['a' + i] = static_cast<uint8_t>(26 + i);
+            }
+            for (int i = 0; i < 10; ++i)
+            {
+                table['0' + i] = static_cast<uint8_t>(52 + i);
+            }
+            table['+'] = 62;
+            table['/'] = 63;
+            table['='] = kPad;
+            table[' '] = table['\n'] = table['\r'] = table['\t'] = kSpace;
+            return table;
+        }
+
+        constexpr std::array<uint8_t, 256> kDecodeTable = MakeDecodeTable();
+
+#if defined(__GNUC__) || defined(__clang__)
+        typedef uint8_t U8x16 __attribute__((vector_size(16)));
+        typedef uint32_t U32x4 __attribute__((vector_size(16)));
+
+        /**
+         * @brief 解码 16 个字符为 12 字节
+         *
+         * @return 含有非 Base64 字符（包括空白和填充）时返回 false，不写出任何数据
+         */
+        inline bool DecodeBlock(const char *input, uint8_t *output)
+        {
+            U8x16 c;
+            std::memcpy(&c, input, sizeof(c));
+            // 比较结果每字节为 0 或 0xff，按字符区间求出 6 位值
+            const U8x16 upper = (U8x16)((U8x16)(c - 'A') < 26);
+            const U8x16 lower = (U8x16)((U8x16)(c - 'a') < 26);
+            const U8x16 digit = (U8x16)((U8x16)(c - '0') < 10);
+            const U8x16 plus = (U8x16)(c == '+');
+            const U8x16 slash = (U8x16)(c == '/');
+            const U8x16 valid = upper | lower | digit | plus | slash;
+            uint64_t lanes[2];
+            std::memcpy(lanes, &valid, sizeof(lanes));
+            if ((lanes[0] & lanes[1]) != ~uint64_t(0))
+            {
+                return false;
+            }
+            const U8x16 value = (upper & (U8x16)(c - 'A')) | (lower & (U8x16)(c - ('a' - 26))) |
+                                (digit & (U8x16)(c + (52 - '0'))) | (plus & 62) | (slash & 63);
+            // 每 4 个 6 位值合并成 24 位，再按大端顺序取出 3 字节
+            const U32x4 word = (U32x4)value;
+            const U32x4 bits = ((word & 0x3f) << 18) | (((word >> 8) & 0x3f) << 12) |
+                               (((word >> 16) & 0x3f) << 6) | ((word >> 24) & 0x3f);
+            const U8x16 bytes = (U8x16)bits;
+            const U8x16 packed = __builtin_shufflevector(bytes, bytes, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, 0, 0, 0, 0);
+            std::memcpy(output, &packed, 12);
+            return true;
+        }
+#else
+        inline bool DecodeBlock(const char *, uint8_t *)
+        {
+            return false;
+        }
+#endif
+    } // namespace
+
+    StreamDecoder::StreamDecoder(uint8_t *output, size_t capacity)
+        : m_output(output), m_capacity(capacity)
+    {
+    }
+
+    bool StreamDecoder::flushQuad()
+    {
+        if (m_written + 3 > m_capacity)
+        {
+            m_failed = true;
+            return false;
+        }
+        m_output[m_written] = static_cast<uint8_t>(m_quad >> 16);
+        m_output[m_written + 1] = static_cast<uint8_t>(m_quad >> 8);
+        m_output[m_written + 2] = static_cast<uint8_t>(m_quad);
+        m_written += 3;
+        m_quad = 0;
+        m_pending = 0;
+        return true;
+    }
+
+    bool StreamDecoder::feed(const char *data, size_t size)
+    {
+        if (m_failed)
+        {
+            return false;
+        }
+        const char *end = data + size;
+        while (data < end && !m_done)
+        {
+            // 整组对齐时走向量路径，INDI 每 72 个字符换行一次，大部分数据都能整组解码
+            while (m_pending == 0 && end - data >= 16 && m_written + 12 <= m_capacity && DecodeBlock(data, m_output + m_written))
+            {
+                data += 16;
+                m_written += 12;
+            }
+            // 逐字符处理，直到越过一个空白字符且重新对齐
+            bool skipped = false;
+            while (data < end)
+            {
+                const uint8_t value = kDecodeTable[static_cast<uint8_t>(*data++)];
+                if (value < 64)
+                {
+                    m_quad = (m_quad << 6) | value;
+                    if (++m_pending == 4)
+                    {
+                        if (!flushQuad())
+                        {
+                            return false;
+                        }
+                        if (skipped)
+                        {
+                            break;
+                        }
+                    }
+                }
+                else if (value == kSpace)
+                {
+                    skipped = true;
+                    if (m_pending == 0)
+                    {
+                        break;
+                    }
+                }
+                else if (value == kPad)
+                {
+                    m_done = true;
+                    break;
+                }
+                else
+                {
+                    m_failed = true;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool StreamDecoder::finish()
+    {
+        if (m_failed)
+        {
+            return false;
+        }
+        // 余下 2 或 3 个字符分别对应 1 或 2 字节
+        if (m_pending == 1)
+        {
+            m_failed = true;
+            return false;
+        }
+        if (m_pending > 1)
+        {
+            const int bytes = m_pending - 1;
+            if (m_written + bytes > m_capacity)
+            {
+                m_failed = true;
+                return false;
+            }
+            const uint32_t quad = m_quad << (6 * (4 - m_pending));
+            for (int i = 0; i < bytes; ++i)
+            {
+                m_output[m_written++] = static_cast<uint8_t>(quad >> (16 - 8 * i));
+            }
+            m_quad = 0;
+            m_pending = 0;
+        }
+        return true;
+    }
+
+    size_t base64DecodeTo(std::string_view encoded, uint8_t *output, size_t capacity)
+    {
+        StreamDecoder decoder(output, capacity);
+        if (!decoder.feed(encoded) || !decoder.finish())
+        {
+            return SIZE_MAX;
+        }
+        return decoder.size();
+    }
 }
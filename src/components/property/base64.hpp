@@ -31,7 +31,10 @@ Description: Base64
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 
@@ -54,4 +57,77 @@ namespace OpenAPT::Base64
      */
     std::vector<unsigned char> base64Decode(const std::string &encoded_string);
 
+    /**
+     * @brief 流式 Base64 解码器
+     *
+     * 输入可以分段到达（如从套接字读取的 BLOB），直接解码到调用者提供的缓冲区，不产生中间字符串。
+     * 跳过换行等空白字符，遇到 '=' 结束。连续 16 个字符一组用 GCC/Clang 向量扩展解码，
+     * 在 ARM 上生成 NEON、在 x86 上生成 SSE 指令；含空白的组和结尾逐字符查表。
+     */
+    class StreamDecoder
+    {
+    public:
+        /**
+         * @param output 输出缓冲区
+         * @param capacity 缓冲区大小，解码结果超出时失败
+         */
+        StreamDecoder(uint8_t *output, size_t capacity);
+
+        /**
+         * @brief 解码一段输入
+         *
+         * @return 遇到非法字符或输出溢出时返回 false，之后的输入全部忽略
+         */
+        bool feed(const char *data, size_t size);
+
+        bool feed(std::string_view data)
+        {
+            return feed(data.data(), data.size());
+        }
+
+        /**
+         * @brief 输入结束，处理不足 4 个字符的尾部
+         */
+        bool finish();
+
+        /**
+         * @brief 已解码的字节数
+         */
+        size_t size() const
+        {
+            return m_written;
+        }
+
+        bool failed() const
+        {
+            return m_failed;
+        }
+
+    private:
+        bool flushQuad();
+
+        uint8_t *m_output;
+        size_t m_capacity;
+        size_t m_written = 0;
+        uint32_t m_quad = 0;   ///< 未凑满 4 个字符的部分
+        int m_pending = 0;     ///< m_quad 中的字符数
+        bool m_done = false;   ///< 已遇到填充字符
+        bool m_failed = false;
+    };
+
+    /**
+     * @brief 解码到预先分配的缓冲区
+     *
+     * @return 解码的字节数，出错时返回 SIZE_MAX
+     */
+    size_t base64DecodeTo(std::string_view encoded, uint8_t *output, size_t capacity);
+
+    /**
+     * @brief 编码长度为 size 的数据解码后的最大字节数
+     */
+    constexpr size_t base64DecodedBound(size_t size)
+    {
+        return size / 4 * 3 + 3;
+    }
+
 }
@@ -1,7 +1,8 @@
 #include "imessage.hpp"
+#include "message_writer.hpp"
 #include "uuid.hpp"
 
-#include <random>
+#include <iterator>
 
 namespace OpenAPT::Property
 {
@@ -11,67 +12,63 @@ namespace OpenAPT::Property
         message_uuid = generator.generateUUIDWithFormat();
     }
 
-    std::string IMessage::toJson() const
+    namespace
     {
-        std::stringstream ss;
-        ss << "{";
-        ss << "\"device_name\":\"" << device_name << "\",";
-        ss << "\"device_uuid\":\"" << device_uuid << "\",";
-        ss << "\"message_uuid\":\"" << message_uuid << "\",";
-        ss << "\"name\":\"" << name << "\",";
-        ss << "\"value\":";
+        using W = MessageWriter;
 
-        if (value.type() == typeid(int))
-        {
-            ss << std::any_cast<int>(value);
-        }
-        else if (value.type() == typeid(double))
-        {
-            ss << std::any_cast<double>(value);
-        }
-        else if (value.type() == typeid(bool))
+        void WriteJsonHeader(OutputBuffer &out, const IMessage &message)
         {
-            ss << std::boolalpha << std::any_cast<bool>(value);
+            W::Append(out, "{\"device_name\":");
+            W::AppendJsonString(out, message.device_name);
+            W::Append(out, ",\"device_uuid\":");
+            W::AppendJsonString(out, message.device_uuid);
+            W::Append(out, ",\"message_uuid\":");
+            W::AppendJsonString(out, message.message_uuid);
+            W::Append(out, ",\"name\":");
+            W::AppendJsonString(out, message.name);
+            W::Append(out, ",\"value\":");
         }
-        else if (value.type() == typeid(std::string))
+
+        void WriteXmlHeader(OutputBuffer &out, const IMessage &message)
         {
-            ss << "\"" << std::any_cast<std::string>(value) << "\"";
+            W::Append(out, "<message><device_name>");
+            W::AppendXmlText(out, message.device_name);
+            W::Append(out, "</device_name><device_uuid>");
+            W::AppendXmlText(out, message.device_uuid);
+            W::Append(out, "</device_uuid><message_uuid>");
+            W::AppendXmlText(out, message.message_uuid);
+            W::Append(out, "</message_uuid><name>");
+            W::AppendXmlText(out, message.name);
+            W::Append(out, "</name><value>");
         }
+    } // namespace
 
-        ss << "}";
-        return ss.str();
+    std::string IMessage::toJson() const
+    {
+        OutputBuffer out;
+        writeJson(out);
+        return fmt::to_string(out);
     }
 
     std::string IMessage::toXml() const
     {
-        std::stringstream ss;
-        ss << "<message>";
-        ss << "<device_name>" << device_name << "</device_name>";
-        ss << "<device_uuid>" << device_uuid << "</device_uuid>";
-        ss << "<message_uuid>" << message_uuid << "</message_uuid>";
-        ss << "<name>" << name << "</name>";
-        ss << "<value>";
+        OutputBuffer out;
+        writeXml(out);
+        return fmt::to_string(out);
+    }
 
-        if (value.type() == typeid(int))
-        {
-            ss << std::any_cast<int>(value);
-        }
-        else if (value.type() == typeid(double))
-        {
-            ss << std::any_cast<double>(value);
-        }
-        else if (value.type() == typeid(bool))
-        {
-            ss << std::boolalpha << std::any_cast<bool>(value);
-        }
-        else if (value.type() == typeid(std::string))
-        {
-            ss << std::any_cast<std::string>(value);
-        }
+    void IMessage::writeJson(OutputBuffer &out) const
+    {
+        WriteJsonHeader(out, *this);
+        W::AppendJsonValue(out, value);
+        out.push_back('}');
+    }
 
-        ss << "</value>";
-        ss << "</message>";
-        return ss.str();
+    void IMessage::writeXml(OutputBuffer &out) const
+    {
+        WriteXmlHeader(out, *this);
+        W::AppendXmlValue(out, value);
+        W::Append(out, "</value></message>");
     }
 
     const std::string &IMessage::GetMessageUUID() const
@@ -94,59 +91,43 @@ namespace OpenAPT::Property
         device_uuid = uuid;
     }
 
-    std::string IImage::toJson() const
+    void IImage::writeJson(OutputBuffer &out) const
     {
-        std::stringstream ss;
-        ss << "{";
-        ss << "\"device_name\":\"" << device_name << "\",";
-        ss << "\"device_uuid\":\"" << device_uuid << "\",";
-        ss << "\"message_uuid\":\"" << message_uuid << "\",";
-        ss << "\"name\":\"" << name << "\",";
-        ss << "\"value\":{";
-        ss << "\"width\":" << width << ",";
-        ss << "\"height\":" << height << ",";
-        ss << "\"depth\":" << depth << ",";
-        ss << "\"gain\":" << gain << ",";
-        ss << "\"iso\":" << iso << ",";
-        ss << "\"offset\":" << offset << ",";
-        ss << "\"binning\":" << binning << ",";
-        ss << "\"duration\":" << duration << ",";
-        ss << "\"is_color\":" << std::boolalpha << is_color << ",";
-        ss << "\"center_ra\":\"" << center_ra << "\",";
-        ss << "\"center_dec\":\"" << center_dec << "\",";
-        ss << "\"author\":\"" << author << "\",";
-        ss << "\"time\":\"" << time << "\",";
-        ss << "\"software\":\"" << software << "\"";
-        ss << "}";
-        ss << "}";
-        return ss.str();
+        WriteJsonHeader(out, *this);
+        fmt::format_to(std::back_inserter(out),
+                       "{{\"width\":{},\"height\":{},\"depth\":{},\"gain\":{},\"iso\":{},\"offset\":{},\"binning\":{},\"duration\":",
+                       width, height, depth, gain, iso, offset, binning);
+        W::AppendJsonNumber(out, duration);
+        W::Append(out, is_color ? ",\"is_color\":true,\"center_ra\":" : ",\"is_color\":false,\"center_ra\":");
+        W::AppendJsonString(out, center_ra);
+        W::Append(out, ",\"center_dec\":");
+        W::AppendJsonString(out, center_dec);
+        W::Append(out, ",\"author\":");
+        W::AppendJsonString(out, author);
+        W::Append(out, ",\"time\":");
+        W::AppendJsonString(out, time);
+        W::Append(out, ",\"software\":");
+        W::AppendJsonString(out, software);
+        W::Append(out, "}}");
     }
 
-    std::string IImage::toXml() const
+    void IImage::writeXml(OutputBuffer &out) const
     {
-        std::stringstream ss;
-        ss << "<message>";
-        ss << "<device_name>" << device_name << "</device_name>";
-        ss << "<device_uuid>" << device_uuid << "</device_uuid>";
-        ss << "<message_uuid>" << message_uuid << "</message_uuid>";
-        ss << "<name>" << name << "</name>";
-        ss << "<value>";
-        ss << "<width>" << width << "</width>";
-        ss << "<height>" << height << "</height>";
-        ss << "<depth>" << depth << "</depth>";
-        ss << "<gain>" << gain << "</gain>";
-        ss << "<iso>" << iso << "</iso>";
-        ss << "<offset>" << offset << "</offset>";
-        ss << "<binning>" << binning << "</binning>";
-        ss << "<duration>" << duration << "</duration>";
-        ss << "<is_color>" << std::boolalpha << is_color << "</is_color>";
-        ss << "<center_ra>" << center_ra << "</center_ra>";
-        ss << "<center_dec>" << center_dec << "</center_dec>";
-        ss << "<author>" << author << "</author>";
-        ss << "<time>" << time << "</time>";
-        ss << "<software>" << software << "</software>";
-        ss << "</value>";
-        ss << "</message>";
-        return ss.str();
+        WriteXmlHeader(out, *this);
+        fmt::format_to(std::back_inserter(out),
+                       "<width>{}</width><height>{}</height><depth>{}</depth><gain>{}</gain><iso>{}</iso>"
+                       "<offset>{}</offset><binning>{}</binning><duration>{}</duration><is_color>{}</is_color>",
+                       width, height, depth, gain, iso, offset, binning, duration, is_color);
+        W::Append(out, "<center_ra>");
+        W::AppendXmlText(out, center_ra);
+        W::Append(out, "</center_ra><center_dec>");
+        W::AppendXmlText(out, center_dec);
+        W::Append(out, "</center_dec><author>");
+        W::AppendXmlText(out, author);
+        W::Append(out, "</author><time>");
+        W::AppendXmlText(out, time);
+        W::Append(out, "</time><software>");
+        W::AppendXmlText(out, software);
+        W::Append(out, "</software></value></message>");
     }
 } // namespace OpenAPT::Property
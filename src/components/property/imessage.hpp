@@ -1,11 +1,24 @@
-#include <iostream>
+#pragma once
+
+#include <stdexcept>
 #include <string>
-#include <sstream>
-#include <any>
+#include <variant>
 #include <vector>
 
+#include <fmt/format.h>
+
 namespace OpenAPT::Property
 {
+    /**
+     * @brief 消息的值，只允许可以直接序列化的类型
+     */
+    using MessageValue = std::variant<std::monostate, bool, int, double, std::string>;
+
+    /**
+     * @brief 序列化输出缓冲区，可以跨消息复用
+     */
+    using OutputBuffer = fmt::memory_buffer;
+
     class IMessage
     {
     public:
@@ -17,8 +30,14 @@ namespace OpenAPT::Property
             return name;
         }
 
-        virtual std::string toJson() const;
-        virtual std::string toXml() const;
+        std::string toJson() const;
+        std::string toXml() const;
+
+        /**
+         * @brief 把消息追加到缓冲区末尾，不清空缓冲区
+         */
+        virtual void writeJson(OutputBuffer &out) const;
+        virtual void writeXml(OutputBuffer &out) const;
 
         const std::string &GetMessageUUID() const;
         void SetMessageUUID(const std::string &uuid);
@@ -38,20 +57,17 @@ namespace OpenAPT::Property
         std::string message_uuid;
         std::string name;
 
-        std::any value;
+        MessageValue value;
     };
 
     template <typename T>
     T IMessage::getValue() const
     {
-        try
-        {
-            return std::any_cast<T>(value);
-        }
-        catch (const std::bad_any_cast &)
+        if (const T *result = std::get_if<T>(&value))
         {
-            throw std::runtime_error("Failed to get value from the message.");
+            return *result;
         }
+        throw std::runtime_error("Failed to get value from the message.");
     }
 
     template <typename T>
@@ -63,18 +79,18 @@ namespace OpenAPT::Property
     class IImage : public IMessage
     {
     public:
-        int width;
-        int height;
-        int depth;
+        int width = 0;
+        int height = 0;
+        int depth = 0;
 
-        int gain;
-        int iso;
-        int offset;
-        int binning;
+        int gain = 0;
+        int iso = 0;
+        int offset = 0;
+        int binning = 1;
 
-        double duration;
+        double duration = 0;
 
-        bool is_color;
+        bool is_color = false;
 
         std::string center_ra;
         std::string center_dec;
@@ -83,9 +99,7 @@ namespace OpenAPT::Property
         std::string time;
         std::string software = "OpenAPT-Server";
 
-        std::string toJson() const override;
-        std::string toXml() const override;
+        void writeJson(OutputBuffer &out) const override;
+        void writeXml(OutputBuffer &out) const override;
     };
-
-    
 }
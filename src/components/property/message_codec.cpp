@@ -0,0 +1,371 @@
+/*
+ * message_codec.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Compact Binary Message Codec
+
+**************************************************/
+
+#include "message_codec.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+namespace OpenAPT::Property
+{
+    namespace
+    {
+        // 值类型
+        enum ValueTag : uint8_t
+        {
+            kNone = 0,
+            kFalse = 1,
+            kTrue = 2,
+            kInt = 3,
+            kDouble = 4,
+            kString = 5,
+            kIntegralDouble = 6, ///< 整数值的 double（例如调焦器位置），按 zigzag varint 发送
+        };
+
+        // Image 记录中 is_color 保存在值类型字节的最高位
+        constexpr uint8_t kColorFlag = 0x80;
+
+        void PutVarint(std::vector<uint8_t> &out, uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back(static_cast<uint8_t>(value) | 0x80);
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        void PutSigned(std::vector<uint8_t> &out, int64_t value)
+        {
+            PutVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+        }
+
+        void PutDouble(std::vector<uint8_t> &out, double value)
+        {
+            // 按小端主机直接复制
+            uint8_t bytes[sizeof(double)];
+            std::memcpy(bytes, &value, sizeof(double));
+            out.insert(out.end(), bytes, bytes + sizeof(double));
+        }
+
+        void PutString(std::vector<uint8_t> &out, std::string_view text)
+        {
+            PutVarint(out, text.size());
+            out.insert(out.end(), text.begin(), text.end());
+        }
+
+        uint8_t TagOf(const MessageValue &value)
+        {
+            switch (value.index())
+            {
+            case 1:
+                return std::get<bool>(value) ? kTrue : kFalse;
+            case 2:
+                return kInt;
+            case 3:
+            {
+                const double v = std::get<double>(value);
+                return v == std::trunc(v) && std::fabs(v) < 1e15 && !(v == 0 && std::signbit(v)) ? kIntegralDouble : kDouble;
+            }
+            case 4:
+                return kString;
+            default:
+                return kNone;
+            }
+        }
+
+        void PutValue(std::vector<uint8_t> &out, uint8_t tag, const MessageValue &value)
+        {
+            switch (tag)
+            {
+            case kInt:
+                PutSigned(out, std::get<int>(value));
+                break;
+            case kIntegralDouble:
+                PutSigned(out, static_cast<int64_t>(std::get<double>(value)));
+                break;
+            case kDouble:
+                PutDouble(out, std::get<double>(value));
+                break;
+            case kString:
+                PutString(out, std::get<std::string>(value));
+                break;
+            default:
+                break;
+            }
+        }
+
+        /**
+         * @brief 带边界检查的读取游标，越界后 ok 变为 false 且不再读取
+         */
+        struct Reader
+        {
+            const uint8_t *cursor;
+            const uint8_t *end;
+            bool ok = true;
+            bool corrupt = false; ///< 数据本身非法，而不是不完整
+
+            uint64_t varint()
+            {
+                uint64_t value = 0;
+                for (int shift = 0; shift < 64; shift += 7)
+                {
+                    if (cursor == end)
+                    {
+                        ok = false;
+                        return 0;
+                    }
+                    const uint8_t byte = *cursor++;
+                    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                    {
+                        return value;
+                    }
+                }
+                // 超过 10 字节的 varint 不可能是合法数据，等待更多数据也无法解码
+                ok = false;
+                corrupt = true;
+                cursor = end;
+                return 0;
+            }
+
+            int64_t signedVarint()
+            {
+                const uint64_t value = varint();
+                return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+            }
+
+            double float64()
+            {
+                double value = 0;
+                if (static_cast<size_t>(end - cursor) < sizeof(double))
+                {
+                    ok = false;
+                    cursor = end;
+                    return 0;
+                }
+                std::memcpy(&value, cursor, sizeof(double));
+                cursor += sizeof(double);
+                return value;
+            }
+
+            void string(std::string &text)
+            {
+                const uint64_t size = varint();
+                if (!ok || size > static_cast<size_t>(end - cursor))
+                {
+                    ok = false;
+                    cursor = end;
+                    return;
+                }
+                text.assign(reinterpret_cast<const char *>(cursor), size);
+                cursor += size;
+            }
+        };
+
+        // 值类型非法时返回 false
+        bool ReadValue(Reader &reader, uint8_t tag, MessageValue &value)
+        {
+            switch (tag)
+            {
+            case kNone:
+                value = std::monostate();
+                return true;
+            case kFalse:
+            case kTrue:
+                value = tag == kTrue;
+                return true;
+            case kInt:
+                value = static_cast<int>(reader.signedVarint());
+                return true;
+            case kIntegralDouble:
+                value = static_cast<double>(reader.signedVarint());
+                return true;
+            case kDouble:
+                value = reader.float64();
+                return true;
+            case kString:
+                // 已经是字符串时复用它的内存
+                if (!std::holds_alternative<std::string>(value))
+                {
+                    value = std::string();
+                }
+                reader.string(std::get<std::string>(value));
+                return true;
+            default:
+                return false;
+            }
+        }
+    } // namespace
+
+    uint32_t BinaryEncoder::intern(const IMessage &message, std::vector<uint8_t> &out)
+    {
+        m_key.clear();
+        for (const std::string *field : {&message.device_uuid, &message.device_name, &message.name})
+        {
+            m_key.append(*field);
+            m_key.push_back('\0');
+        }
+        auto it = m_ids.find(m_key);
+        if (it != m_ids.end())
+        {
+            return it->second;
+        }
+        const auto id = static_cast<uint32_t>(m_ids.size());
+        m_ids.emplace(m_key, id);
+        out.push_back(static_cast<uint8_t>(BinaryRecord::Define));
+        out.push_back(kNone);
+        PutVarint(out, id);
+        PutString(out, message.device_name);
+        PutString(out, message.device_uuid);
+        PutString(out, message.name);
+        return id;
+    }
+
+    void BinaryEncoder::encode(const IMessage &message, std::vector<uint8_t> &out)
+    {
+        const uint32_t id = intern(message, out);
+        const auto *image = dynamic_cast<const IImage *>(&message);
+        const uint8_t tag = TagOf(message.value);
+        out.push_back(static_cast<uint8_t>(image ? BinaryRecord::Image : BinaryRecord::Message));
+        out.push_back(image && image->is_color ? tag | kColorFlag : tag);
+        PutVarint(out, id);
+        PutValue(out, tag, message.value);
+        if (image)
+        {
+            for (const int field : {image->width, image->height, image->depth, image->gain, image->iso, image->offset, image->binning})
+            {
+                PutSigned(out, field);
+            }
+            PutDouble(out, image->duration);
+            for (const std::string *field : {&image->center_ra, &image->center_dec, &image->author, &image->time, &image->software})
+            {
+                PutString(out, *field);
+            }
+        }
+    }
+
+    void BinaryEncoder::reset()
+    {
+        m_ids.clear();
+    }
+
+    BinaryDecoder::Result BinaryDecoder::next(const uint8_t *data, size_t size, size_t &consumed)
+    {
+        if (size < 2)
+        {
+            return Result::Incomplete;
+        }
+        Reader reader{data + 2, data + size};
+        const auto record = static_cast<BinaryRecord>(data[0]);
+        const uint64_t id = reader.varint();
+        if (reader.corrupt)
+        {
+            return Result::Error;
+        }
+
+        if (record == BinaryRecord::Define)
+        {
+            if (reader.ok && id > m_properties.size())
+            {
+                return Result::Error;
+            }
+            Definition definition;
+            reader.string(definition.device_name);
+            reader.string(definition.device_uuid);
+            reader.string(definition.name);
+            if (!reader.ok)
+            {
+                return reader.corrupt ? Result::Error : Result::Incomplete;
+            }
+            if (id == m_properties.size())
+            {
+                if (m_properties.size() >= kMaxProperties)
+                {
+                    return Result::Error;
+                }
+                m_properties.push_back(std::move(definition));
+            }
+            else
+            {
+                m_properties[id] = std::move(definition);
+            }
+            consumed = reader.cursor - data;
+            return Result::Definition;
+        }
+        if (record != BinaryRecord::Message && record != BinaryRecord::Image)
+        {
+            return Result::Error;
+        }
+        if (reader.ok && id >= m_properties.size())
+        {
+            return Result::Error;
+        }
+
+        const bool is_image = record == BinaryRecord::Image;
+        IMessage &message = is_image ? static_cast<IMessage &>(m_image) : m_message;
+        if (!ReadValue(reader, data[1] & ~kColorFlag, message.value))
+        {
+            return Result::Error;
+        }
+        if (is_image)
+        {
+            for (int *field : {&m_image.width, &m_image.height, &m_image.depth, &m_image.gain, &m_image.iso, &m_image.offset, &m_image.binning})
+            {
+                *field = static_cast<int>(reader.signedVarint());
+            }
+            m_image.duration = reader.float64();
+            m_image.is_color = data[1] & kColorFlag;
+            for (std::string *field : {&m_image.center_ra, &m_image.center_dec, &m_image.author, &m_image.time, &m_image.software})
+            {
+                reader.string(*field);
+            }
+        }
+        if (!reader.ok)
+        {
+            return reader.corrupt ? Result::Error : Result::Incomplete;
+        }
+
+        const Definition &definition = m_properties[id];
+        message.device_name = definition.device_name;
+        message.device_uuid = definition.device_uuid;
+        message.name = definition.name;
+        message.message_uuid.clear();
+        consumed = reader.cursor - data;
+        return is_image ? Result::Image : Result::Message;
+    }
+
+    void BinaryDecoder::reset()
+    {
+        m_properties.clear();
+    }
+} // namespace OpenAPT::Property
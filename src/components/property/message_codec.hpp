@@ -0,0 +1,152 @@
+/*
+ * message_codec.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Compact Binary Message Codec
+
+**************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "imessage.hpp"
+
+namespace OpenAPT::Property
+{
+    /*
+     * 二进制消息格式，每条记录以两个字节的固定头开始：
+     *
+     *   [记录类型 u8][值类型 u8][...]
+     *
+     * Define  (0x01): varint 属性 ID，随后是 device_name、device_uuid、name 三个字符串
+     * Message (0x02): varint 属性 ID，随后是值
+     * Image   (0x03): varint 属性 ID，随后是值和 IImage 的字段
+     *
+     * 字符串为 varint 长度加内容；有符号整数使用 zigzag varint；double 为 8 字节小端。
+     * 设备和消息名、UUID 只在第一次出现时通过 Define 记录发送一次，此后只发送属性 ID，
+     * 因此编码器和解码器都是有状态的，对应同一个连接的两端，连接重建时双方都要 reset()。
+     * 属性按 (device_uuid, device_name, name) 定义；message_uuid 是每个 IMessage 对象随机生成的，
+     * 驱动每次更新都会新建消息，因此不发送，解码出的消息 message_uuid 为空。
+     * varint 最长 10 字节，更长的视为数据损坏。
+     */
+
+    /**
+     * @brief 记录类型
+     */
+    enum class BinaryRecord : uint8_t
+    {
+        Define = 0x01,
+        Message = 0x02,
+        Image = 0x03,
+    };
+
+    class BinaryEncoder
+    {
+    public:
+        /**
+         * @brief 把消息追加到 out 末尾，属性第一次出现时先追加一条 Define 记录
+         */
+        void encode(const IMessage &message, std::vector<uint8_t> &out);
+
+        /**
+         * @brief 忘记已经定义的属性，下一条消息会重新发送 Define
+         */
+        void reset();
+
+        size_t dictionarySize() const
+        {
+            return m_ids.size();
+        }
+
+    private:
+        uint32_t intern(const IMessage &message, std::vector<uint8_t> &out);
+
+        std::unordered_map<std::string, uint32_t> m_ids;
+        std::string m_key; ///< 复用的查找键，避免每条消息分配内存
+    };
+
+    class BinaryDecoder
+    {
+    public:
+        enum class Result
+        {
+            Message,    ///< message() 有效
+            Image,      ///< image() 有效
+            Definition, ///< 只更新了字典
+            Incomplete, ///< 数据不足一条记录，等待更多数据
+            Error,      ///< 数据损坏，应断开连接
+        };
+
+        /**
+         * @brief 解码 data 开头的一条记录
+         *
+         * @param consumed 成功时写入记录的长度
+         */
+        Result next(const uint8_t *data, size_t size, size_t &consumed);
+
+        /**
+         * @brief 最近一次解码出的消息，下一次调用 next() 时被覆盖
+         */
+        const IMessage &message() const
+        {
+            return m_message;
+        }
+
+        const IImage &image() const
+        {
+            return m_image;
+        }
+
+        void reset();
+
+        size_t dictionarySize() const
+        {
+            return m_properties.size();
+        }
+
+        /**
+         * @brief 字典的上限，超过时视为数据损坏
+         */
+        static constexpr size_t kMaxProperties = 1 << 16;
+
+    private:
+        struct Definition
+        {
+            std::string device_name;
+            std::string device_uuid;
+            std::string name;
+        };
+
+        std::vector<Definition> m_properties;
+        IMessage m_message;
+        IImage m_image;
+    };
+} // namespace OpenAPT::Property
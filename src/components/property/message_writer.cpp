@@ -0,0 +1,182 @@
+/*
+ * message_writer.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: JSON / XML Message Writer
+
+**************************************************/
+
+#include "message_writer.hpp"
+
+#include <cmath>
+#include <iterator>
+
+namespace OpenAPT::Property
+{
+    namespace
+    {
+        template <typename... Ts>
+        struct Overloaded : Ts...
+        {
+            using Ts::operator()...;
+        };
+        template <typename... Ts>
+        Overloaded(Ts...) -> Overloaded<Ts...>;
+    } // namespace
+
+    std::string_view MessageWriter::json(const IMessage &message)
+    {
+        m_buffer.clear();
+        message.writeJson(m_buffer);
+        return view();
+    }
+
+    std::string_view MessageWriter::xml(const IMessage &message)
+    {
+        m_buffer.clear();
+        message.writeXml(m_buffer);
+        return view();
+    }
+
+    void MessageWriter::AppendJsonString(OutputBuffer &out, std::string_view text)
+    {
+        static constexpr char kHex[] = "0123456789abcdef";
+        out.push_back('"');
+        // 不需要转义的连续字符整段复制
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            const auto c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+            {
+                continue;
+            }
+            out.append(text.data() + start, text.data() + i);
+            start = i + 1;
+            switch (c)
+            {
+            case '"':
+                Append(out, "\\\"");
+                break;
+            case '\\':
+                Append(out, "\\\\");
+                break;
+            case '\n':
+                Append(out, "\\n");
+                break;
+            case '\r':
+                Append(out, "\\r");
+                break;
+            case '\t':
+                Append(out, "\\t");
+                break;
+            default:
+                Append(out, "\\u00");
+                out.push_back(kHex[c >> 4]);
+                out.push_back(kHex[c & 0xF]);
+            }
+        }
+        out.append(text.data() + start, text.data() + text.size());
+        out.push_back('"');
+    }
+
+    void MessageWriter::AppendXmlText(OutputBuffer &out, std::string_view text)
+    {
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            std::string_view entity;
+            switch (text[i])
+            {
+            case '&':
+                entity = "&amp;";
+                break;
+            case '<':
+                entity = "&lt;";
+                break;
+            case '>':
+                entity = "&gt;";
+                break;
+            case '"':
+                entity = "&quot;";
+                break;
+            case '\'':
+                entity = "&apos;";
+                break;
+            default:
+                continue;
+            }
+            out.append(text.data() + start, text.data() + i);
+            Append(out, entity);
+            start = i + 1;
+        }
+        out.append(text.data() + start, text.data() + text.size());
+    }
+
+    void MessageWriter::AppendJsonNumber(OutputBuffer &out, double value)
+    {
+        // JSON 没有 NaN 和无穷大
+        if (!std::isfinite(value))
+        {
+            Append(out, "null");
+            return;
+        }
+        fmt::format_to(std::back_inserter(out), "{}", value);
+    }
+
+    void MessageWriter::AppendJsonValue(OutputBuffer &out, const MessageValue &value)
+    {
+        std::visit(Overloaded{
+                       [&](std::monostate)
+                       { Append(out, "null"); },
+                       [&](bool v)
+                       { Append(out, v ? "true" : "false"); },
+                       [&](int v)
+                       { fmt::format_to(std::back_inserter(out), "{}", v); },
+                       [&](double v)
+                       { AppendJsonNumber(out, v); },
+                       [&](const std::string &v)
+                       { AppendJsonString(out, v); },
+                   },
+                   value);
+    }
+
+    void MessageWriter::AppendXmlValue(OutputBuffer &out, const MessageValue &value)
+    {
+        std::visit(Overloaded{
+                       [](std::monostate) {},
+                       [&](bool v)
+                       { Append(out, v ? "true" : "false"); },
+                       [&](int v)
+                       { fmt::format_to(std::back_inserter(out), "{}", v); },
+                       [&](double v)
+                       { fmt::format_to(std::back_inserter(out), "{}", v); },
+                       [&](const std::string &v)
+                       { AppendXmlText(out, v); },
+                   },
+                   value);
+    }
+} // namespace OpenAPT::Property
@@ -0,0 +1,92 @@
+/*
+ * message_writer.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: JSON / XML Message Writer
+
+**************************************************/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "imessage.hpp"
+
+namespace OpenAPT::Property
+{
+    /**
+     * @brief 把消息序列化到可复用的缓冲区
+     *
+     * 热路径（例如遥测推送）持有一个 MessageWriter，每次序列化只清空缓冲区而不释放内存，
+     * 返回的 string_view 在下一次序列化之前有效。
+     */
+    class MessageWriter
+    {
+    public:
+        std::string_view json(const IMessage &message);
+        std::string_view xml(const IMessage &message);
+
+        std::string_view view() const
+        {
+            return std::string_view(m_buffer.data(), m_buffer.size());
+        }
+
+        std::string str() const
+        {
+            return std::string(view());
+        }
+
+        /**
+         * @brief 追加字面量，不做转义
+         */
+        static void Append(OutputBuffer &out, std::string_view text)
+        {
+            out.append(text.data(), text.data() + text.size());
+        }
+
+        /**
+         * @brief 追加带引号并转义的 JSON 字符串
+         */
+        static void AppendJsonString(OutputBuffer &out, std::string_view text);
+
+        /**
+         * @brief 追加转义后的 XML 文本
+         */
+        static void AppendXmlText(OutputBuffer &out, std::string_view text);
+
+        static void AppendJsonNumber(OutputBuffer &out, double value);
+
+        /**
+         * @brief 追加消息的值，std::monostate 写为 null / 空元素
+         */
+        static void AppendJsonValue(OutputBuffer &out, const MessageValue &value);
+        static void AppendXmlValue(OutputBuffer &out, const MessageValue &value);
+
+    private:
+        OutputBuffer m_buffer;
+    };
+} // namespace OpenAPT::Property
@@ -40,18 +40,16 @@ bool CommandDispatcher::HasHandler(const std::string &name)
     return handlers_.find(Djb2Hash(name.c_str())) != handlers_.end();
 }
 
-void CommandDispatcher::Dispatch(const std::string &name, const json &data)
+json CommandDispatcher::Dispatch(const std::string &name, const json &data)
 {
     auto it = handlers_.find(Djb2Hash(name.c_str()));
     if (it != handlers_.end())
     {
         spdlog::debug("Find command : {}", name);
-        it->second(data);
-    }
-    else
-    {
-        spdlog::error("Error: Unknown command {}", name);
+        return it->second(data);
     }
+    spdlog::error("Error: Unknown command {}", name);
+    return json();
 }
 
 std::size_t CommandDispatcher::Djb2Hash(const char *str)
@@ -47,9 +47,9 @@ public:
     /**
      * @brief HandlerFunc 是用于处理命令的函数类型。
      *
-     * 该函数应该接受一个 `json` 类型的参数，表示命令所携带的数据。
+     * 该函数应该接受一个 `json` 类型的参数，表示命令所携带的数据，返回的数据随回复发送，没有数据时为 null。
      */
-    using HandlerFunc = std::function<void(const json &)>;
+    using HandlerFunc = std::function<json(const json &)>;
 
     /**
      * @brief RegisterHandler 函数用于将一个命令处理程序注册到 `CommandDispatcher` 中。
@@ -61,6 +61,20 @@ public:
      */
     template <typename ClassType>
     void RegisterHandler(const std::string &name, void (ClassType::*handler)(const json &), ClassType *instance)
+    {
+        auto hash_value = Djb2Hash(name.c_str());
+        handlers_[hash_value] = [handler, instance](const json &data)
+        {
+            (instance->*handler)(data);
+            return json();
+        };
+    }
+
+    /**
+     * @brief 注册一个返回数据的命令处理程序，返回值随回复发送给客户端。
+     */
+    template <typename ClassType>
+    void RegisterHandler(const std::string &name, json (ClassType::*handler)(const json &), ClassType *instance)
     {
         auto hash_value = Djb2Hash(name.c_str());
         handlers_[hash_value] = std::bind(handler, instance, std::placeholders::_1);
@@ -79,8 +93,9 @@ public:
      *
      * @param name 要派发的命令的名称。
      * @param data 命令所携带的数据。
+     * @return 处理程序返回的数据，未知命令或没有数据时为 null。
      */
-    void Dispatch(const std::string &name, const json &data);
+    json Dispatch(const std::string &name, const json &data);
 
 private:
     /**
@@ -31,10 +31,15 @@ Description: Websockcet Server
 
 #include "wsserver.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
 namespace OpenAPT
 {
-    WebSocketServer::WebSocketServer(int max_connections = 0)
-        : running_(false), max_connections_(max_connections), active_connections_(0)
+    WebSocketServer::WebSocketServer(int max_connections, size_t worker_threads, size_t max_pending, size_t max_per_connection)
+        : running_(false), max_connections_(max_connections), active_connections_(0),
+          executor_(std::make_unique<Thread::StrandExecutor>(worker_threads, max_pending, max_per_connection))
     {
         // 设置 WebSocket 服务器的回调函数
         server_.set_open_handler(bind(&WebSocketServer::onOpen, this, std::placeholders::_1));
@@ -46,7 +51,12 @@ namespace OpenAPT
         server_.set_fail_handler([](websocketpp::connection_hdl) {});
         server_.set_http_handler([](websocketpp::connection_hdl) {});
 
+        // init_asio 只能调用一次，放在构造函数中，监听失败后 run() 可以重试
+        server_.init_asio();
         server_.set_reuse_addr(true);
+        server_.set_max_http_body_size(1024 * 1024); // 1MB
+        // 逐帧的访问日志会在每条消息上争用同一把日志锁，多线程时成为瓶颈
+        server_.clear_access_channels(websocketpp::log::alevel::frame_header | websocketpp::log::alevel::frame_payload);
         // 获取保存客户端信息的文件路径
         client_file_path_ = "clients.json";
 
@@ -54,25 +64,56 @@ namespace OpenAPT
 
         APTRegisterFunc("RunDeviceTask", &WebSocketServer::RunDeviceTask, this);
         APTRegisterFunc("GetDeviceInfo", &WebSocketServer::GetDeviceInfo, this);
+        APTRegisterFunc("GetTelemetry", &WebSocketServer::GetTelemetry, this);
     }
 
-    void WebSocketServer::run(int port)
+    void WebSocketServer::run(int port, size_t io_threads)
     {
-        if (running_)
+        if (running_.exchange(true))
         {
             return;
         }
+        io_threads = std::max<size_t>(1, io_threads);
 
-        // 初始化 Websocket 服务器配置
-        server_.init_asio();
-        server_.set_reuse_addr(true);
-        server_.set_max_http_body_size(1024 * 1024); // 1MB
-        server_.listen(port);
-        server_.start_accept();
+        try
+        {
+            server_.listen(port);
+            server_.start_accept();
+        }
+        catch (...)
+        {
+            // 端口被占用等情况下不留下“正在运行”的状态
+            websocketpp::lib::error_code ec;
+            if (server_.is_listening())
+            {
+                server_.stop_listening(ec);
+            }
+            running_ = false;
+            throw;
+        }
 
-        running_ = true;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            io_threads_ = io_threads;
+        }
 
-        // 运行 WebSocket 服务器
+        // 运行 WebSocket 服务器，调用线程也是其中一个 I/O 线程
+        std::vector<std::thread> threads;
+        threads.reserve(io_threads - 1);
+        for (size_t i = 1; i < io_threads; ++i)
+        {
+            threads.emplace_back([this]()
+                                 { runLoop(); });
+        }
+        runLoop();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    void WebSocketServer::runLoop()
+    {
         while (running_)
         {
             try
@@ -94,8 +135,9 @@ namespace OpenAPT
         }
         try
         {
-            server_.stop();
+            // 先清除标志，事件循环返回后不再重新进入
             running_ = false;
+            server_.stop();
         }
         catch (const std::exception &e)
         {
@@ -115,39 +157,73 @@ namespace OpenAPT
         } // Check JSON syntax
     }
 
-    void WebSocketServer::onOpen(websocketpp::connection_hdl hdl)
+    void WebSocketServer::setTelemetryStore(std::shared_ptr<TelemetryStore> store)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        telemetry_ = std::move(store);
+    }
+
+    json WebSocketServer::getStats() const
     {
+        const auto stats = executor_->stats();
         std::lock_guard<std::mutex> guard(lock_);
+        return {
+            {"connections", active_connections_},
+            {"io_threads", io_threads_},
+            {"pending", stats.pending},
+            {"max_pending", stats.max_pending},
+            {"running", stats.running},
+            {"executed", stats.executed},
+            {"failed", stats.failed},
+            {"rejected_overloaded", stats.rejected_overloaded},
+            {"rejected_connection", stats.rejected_strand},
+            {"mean_wait_us", stats.mean_wait_us},
+            {"max_wait_us", stats.max_wait.count()},
+        };
+    }
 
-        if (max_connections_ > 0 && active_connections_ >= max_connections_)
+    void WebSocketServer::onOpen(websocketpp::connection_hdl hdl)
+    {
         {
-            // spdlog::warn("WebSocketServer::onOpen(): exceed max connections, refuse incoming connection");
-            return;
+            std::lock_guard<std::mutex> guard(lock_);
+
+            if (max_connections_ > 0 && active_connections_ >= max_connections_)
+            {
+                // spdlog::warn("WebSocketServer::onOpen(): exceed max connections, refuse incoming connection");
+                return;
+            }
+
+            strands_[hdl] = executor_->makeStrand();
+            active_connections_++;
         }
 
         // 获取客户端信息
+        websocketpp::lib::asio::error_code ec;
         auto conn = server_.get_con_from_hdl(hdl);
-        auto client_ip = conn->get_socket().remote_endpoint().address().to_string();
-        auto client_port = conn->get_socket().remote_endpoint().port();
-        // //spdlog::info("New client connected: {} : {}", client_ip, client_port);
-
-        // 记录客户端信息到 JSON 文件中
-        saveClientInfo(client_ip, client_port);
+        auto endpoint = conn->get_socket().remote_endpoint(ec);
+        if (ec)
+        {
+            return;
+        }
+        // //spdlog::info("New client connected: {} : {}", endpoint.address().to_string(), endpoint.port());
 
-        active_connections_++;
+        // 记录客户端信息到 JSON 文件中，文件读写不占用连接表的锁，避免阻塞其他 I/O 线程
+        saveClientInfo(endpoint.address().to_string(), endpoint.port());
     }
 
     void WebSocketServer::onClose(websocketpp::connection_hdl hdl)
     {
         std::lock_guard<std::mutex> guard(lock_);
 
-        // 获取客户端信息
-        auto conn = server_.get_con_from_hdl(hdl);
-        auto client_ip = conn->get_socket().remote_endpoint().address().to_string();
-        auto client_port = conn->get_socket().remote_endpoint().port();
-        // //spdlog::info("Client disconnected: {} : {}", client_ip, client_port);
-
-        active_connections_--;
+        // 被拒绝的连接没有 strand，也没有计入活跃连接
+        auto it = strands_.find(hdl);
+        if (it != strands_.end())
+        {
+            // 丢弃还没有执行的命令，已经在执行的命令发送回复时会失败
+            executor_->close(it->second);
+            strands_.erase(it);
+            active_connections_--;
+        }
     }
 
     void WebSocketServer::onMessage(websocketpp::connection_hdl hdl, server<websocketpp::config::asio>::message_ptr msg)
@@ -158,46 +234,48 @@ namespace OpenAPT
             // spdlog::error("WebSocketServer::onMessage(): null message received");
             return;
         }
-        auto conn = server_.get_con_from_hdl(hdl);
-        auto client_ip = conn->get_socket().remote_endpoint().address().to_string();
-        auto client_port = conn->get_socket().remote_endpoint().port();
-
-        if (msg->get_opcode() == websocketpp::frame::opcode::text)
+        if (msg->get_opcode() != websocketpp::frame::opcode::text)
         {
-            // 检查 JSON 语法
-            if (!json::accept(msg->get_payload()))
-            {
-                // //spdlog::error("WebSocketServer::onMessage() invalid JSON syntax: {}", msg->get_payload());
-                return;
-            }
+            // spdlog::error("WebSocketServer::onMessage() unexpected message type received");
+            return;
+        }
 
-            // 解析 JSON 数据
-            try
-            {
-                json data = json::parse(msg->get_payload());
+        // 一次解析同时完成语法检查，失败时返回 discarded 而不是抛出异常
+        json data = json::parse(msg->get_payload(), nullptr, false);
+        if (data.is_discarded())
+        {
+            // //spdlog::error("WebSocketServer::onMessage() invalid JSON syntax: {}", msg->get_payload());
+            sendMessage(hdl, R"({"error":"Invalid JSON"})");
+            return;
+        }
 
-                std::thread process_thread(&WebSocketServer::processMessage, this, conn, msg->get_payload(), data);
-                process_thread.detach();
-            }
-            catch (const std::exception &e)
+        std::shared_ptr<Thread::StrandExecutor::Strand> strand;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            auto it = strands_.find(hdl);
+            if (it != strands_.end())
             {
-                // spdlog::error("WebSocketServer::onMessage() parse json failed: {}", e.what());
+                strand = it->second;
             }
         }
-        else
+        if (!strand)
         {
-            // spdlog::error("WebSocketServer::onMessage() unexpected message type received");
+            sendMessage(hdl, R"({"error":"Connection not accepted"})");
+            return;
         }
-    }
 
-    void WebSocketServer::processMessage(websocketpp::connection_hdl hdl, const std::string &payload, const json &data)
-    {
-        if (payload.empty())
+        // 准入控制：队列满时立即回复，而不是让命令无限排队
+        const auto admission = executor_->post(strand, [this, hdl, data = std::move(data)]()
+                                               { processMessage(hdl, data); });
+        if (admission != Thread::StrandExecutor::Admission::Accepted)
         {
-            // spdlog::error("WebSocketServer::processMessage() payload is empty");
-            return;
+            json reply_data = {{"error", "Server busy"}, {"reason", Thread::StrandExecutor::AdmissionName(admission)}};
+            sendMessage(hdl, reply_data.dump());
         }
+    }
 
+    void WebSocketServer::processMessage(websocketpp::connection_hdl hdl, const json &data)
+    {
         if (data.empty())
         {
             // spdlog::error("WebSocketServer::processMessage() data is empty");
@@ -225,13 +303,18 @@ namespace OpenAPT
             // TODO：在此处添加更多参数检查和处理逻辑。
 
             // 执行命令。
+            json result;
             if (m_CommandDispatcher->HasHandler(name))
             {
-                m_CommandDispatcher->Dispatch(name, {});
+                result = m_CommandDispatcher->Dispatch(name, params);
             }
 
-            // 发送回复。
+            // 发送回复，命令返回的数据放在 data 中。
             json reply_data = {{"reply", "OK"}};
+            if (!result.is_null())
+            {
+                reply_data["data"] = std::move(result);
+            }
             sendMessage(hdl, reply_data.dump()); // 将 JSON 对象转换为字符串
         }
         catch (const std::exception &e)
@@ -244,6 +327,7 @@ namespace OpenAPT
 
     void WebSocketServer::saveClientInfo(const std::string &ip, uint16_t port)
     {
+        std::lock_guard<std::mutex> guard(client_file_lock_);
         // 读取已有的客户端信息列表
         try
         {
@@ -314,4 +398,42 @@ namespace OpenAPT
         std::cout << "GetDeviceInfo() is called!" << std::endl;
     }
 
+    json WebSocketServer::GetTelemetry(const json &m_params)
+    {
+        std::shared_ptr<TelemetryStore> store;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            store = telemetry_;
+        }
+        if (!store)
+        {
+            throw std::runtime_error("Telemetry is not available");
+        }
+        if (!m_params.contains("channel"))
+        {
+            return {{"channels", store->channels()}};
+        }
+
+        const std::string channel = m_params["channel"].get<std::string>();
+        const size_t max_points = m_params.value("max_points", size_t(500));
+        TelemetrySeries series;
+        if (m_params.contains("from"))
+        {
+            using Clock = TelemetryStore::Clock;
+            const auto from = Clock::time_point(std::chrono::milliseconds(m_params["from"].get<int64_t>()));
+            const auto to = m_params.contains("to") ? Clock::time_point(std::chrono::milliseconds(m_params["to"].get<int64_t>())) : Clock::now();
+            series = store->query(channel, from, to, max_points);
+        }
+        else
+        {
+            const double duration = m_params.value("duration", 3600.0);
+            if (!(duration > 0))
+            {
+                throw std::invalid_argument("duration must be positive");
+            }
+            series = store->recent(channel, std::chrono::milliseconds(static_cast<int64_t>(duration * 1000)), max_points);
+        }
+        return series.toJson();
+    }
+
 }
@@ -34,12 +34,17 @@ Description: Websockcet Server
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
 #include <nlohmann/json.hpp>
+#include <atomic>
 #include <memory>
+#include <map>
 #include <fstream>
 #include <chrono>
 #include <iostream>
+#include <thread>
 
 #include "commander.hpp"
+#include "device/telemetry_store.hpp"
+#include "thread/strand_executor.hpp"
 
 using json = nlohmann::json;
 using websocketpp::server;
@@ -56,15 +61,25 @@ namespace OpenAPT
          * @brief 构造函数。
          *
          * @param max_connections 服务器最大连接数。
+         * @param worker_threads 执行命令的线程数。
+         * @param max_pending 全局排队命令数上限，超过时拒绝新命令。
+         * @param max_per_connection 单个连接排队命令数上限。
          */
-        WebSocketServer(int max_connections);
+        WebSocketServer(int max_connections, size_t worker_threads = std::thread::hardware_concurrency(),
+                        size_t max_pending = 1024, size_t max_per_connection = 64);
 
         /**
-         * @brief 启动 WebSocket 服务器。
+         * @brief 启动 WebSocket 服务器，阻塞到 stop() 被调用。
+         *
+         * 调用线程和另外 io_threads - 1 个线程一起运行同一个 io_context。同一连接的回调由
+         * websocketpp 的 strand 串行化，不同连接的握手和收发帧在多个线程上并行。
+         *
+         * 监听失败时抛出异常并恢复到未运行状态，可以换一个端口再次调用。
          *
          * @param port 服务器监听的端口号。
+         * @param io_threads 运行事件循环的线程数。
          */
-        void run(int port);
+        void run(int port, size_t io_threads = 1);
 
         /**
          * @brief 停止 WebSocket 服务器。
@@ -79,6 +94,16 @@ namespace OpenAPT
          */
         void sendMessage(websocketpp::connection_hdl hdl, const std::string &message);
 
+        /**
+         * @brief 命令执行器的队列深度和准入统计。
+         */
+        json getStats() const;
+
+        /**
+         * @brief 设置 GetTelemetry 命令查询的遥测存储，通常为 DeviceManager::telemetryStore()。
+         */
+        void setTelemetryStore(std::shared_ptr<TelemetryStore> store);
+
     private:
         /**
          * @brief 当有新连接建立时的回调函数。
@@ -106,10 +131,14 @@ namespace OpenAPT
          * @brief 处理客户端发送的命令。
          *
          * @param hdl 发送命令的客户端连接句柄。
-         * @param payload 收到的命令负载。
-         * @param data 命令携带的数据。
+         * @param data 已解析的命令。
          */
-        void processMessage(websocketpp::connection_hdl hdl, const std::string &payload, const json &data);
+        void processMessage(websocketpp::connection_hdl hdl, const json &data);
+
+        /**
+         * @brief 单个 I/O 线程的事件循环，异常后重新进入，直到服务器停止。
+         */
+        void runLoop();
 
         /**
          * @brief 将客户端 IP 和端口号记录到文件中。
@@ -120,18 +149,28 @@ namespace OpenAPT
         void saveClientInfo(const std::string &ip, uint16_t port);
 
     private:
-        bool running_;                                          ///< WebSocket 服务器是否正在运行。
+        std::atomic_bool running_;                              ///< WebSocket 服务器是否正在运行。
         int max_connections_;                                   ///< WebSocket 服务器最大连接数。
-        int active_connections_;                                ///< WebSocket 服务器活跃连接数。
+        int active_connections_;                                ///< WebSocket 服务器活跃连接数，由 lock_ 保护。
+        size_t io_threads_ = 0;                                 ///< 运行事件循环的线程数，由 lock_ 保护。
         websocketpp::server<websocketpp::config::asio> server_; ///< WebSocket 服务器实例。
-        std::mutex lock_;                                       ///< WebSocket 服务器线程锁。
+        mutable std::mutex lock_;                               ///< 保护连接计数和 strands_。
+        std::mutex client_file_lock_;                           ///< 串行化客户端信息文件的读写。
         std::string client_file_path_;                          ///< 客户端信息保存文件路径。
 
+        // 每个连接一个 strand：同一连接的命令按顺序执行，不同连接并行，由 lock_ 保护
+        std::map<websocketpp::connection_hdl, std::shared_ptr<Thread::StrandExecutor::Strand>, std::owner_less<websocketpp::connection_hdl>> strands_;
+
+        std::shared_ptr<TelemetryStore> telemetry_; ///< GetTelemetry 查询的遥测存储，由 lock_ 保护。
+
         std::unique_ptr<CommandDispatcher> m_CommandDispatcher; ///< 命令派发器实例。
 
+        // 在派发器之后声明，析构时先执行完排队的命令
+        std::unique_ptr<Thread::StrandExecutor> executor_; ///< 有界的命令执行器。
+
     private:
-        template <typename ClassType>
-        void APTRegisterFunc(const std::string &name, void (ClassType::*handler)(const json &), ClassType *instance)
+        template <typename ClassType, typename Result>
+        void APTRegisterFunc(const std::string &name, Result (ClassType::*handler)(const json &), ClassType *instance)
         {
             m_CommandDispatcher->RegisterHandler(name, handler, instance);
         }
@@ -160,6 +199,17 @@ namespace OpenAPT
          * @param m_params 获取设备信息参数。
          */
         void GetDeviceInfo(const json &m_params);
+
+        /**
+         * @brief 查询遥测数据。
+         *
+         * 没有 channel 时返回全部通道名；否则返回该通道的列式时间序列（TelemetrySeries::toJson()）。
+         * 时间范围为 from/to（毫秒级 Unix 时间），或最近 duration 秒（默认 3600），点数不超过 max_points（默认 500）。
+         *
+         * @param m_params 查询参数。
+         * @return 查询结果。
+         */
+        json GetTelemetry(const json &m_params);
     };
 
 } // namespace OpenAPT
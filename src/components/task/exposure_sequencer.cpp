@@ -0,0 +1,208 @@
+/*
+ * exposure_sequencer.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-14
+
+Description: Pipelined Exposure Sequencer
+
+**************************************************/
+
+#include "exposure_sequencer.hpp"
+
+#include "thread/threadpool.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT
+{
+    namespace
+    {
+        double ToMilliseconds(SequenceFrame::Clock::time_point time)
+        {
+            return std::chrono::duration<double, std::milli>(time.time_since_epoch()).count();
+        }
+
+        double Seconds(SequenceFrame::Clock::time_point from, SequenceFrame::Clock::time_point to)
+        {
+            return std::chrono::duration<double>(to - from).count();
+        }
+    }
+
+    ExposureSequencer::ExposureSequencer(Image::FrameRing &ring, std::function<bool(double)> startExposure)
+        : m_ring(ring), m_start(std::move(startExposure))
+    {
+    }
+
+    void ExposureSequencer::addHandler(FrameHandler handler)
+    {
+        m_handlers.push_back(std::move(handler));
+    }
+
+    void ExposureSequencer::abort()
+    {
+        m_abort = true;
+    }
+
+    std::vector<SequenceFrame> ExposureSequencer::run(const SequenceSettings &settings)
+    {
+        std::vector<SequenceFrame> records(settings.count);
+        if (settings.count == 0 || !m_start)
+        {
+            return {};
+        }
+        m_abort = false;
+        const size_t max_pending = std::max<size_t>(settings.max_pending, 1);
+        const auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::duration<double>(settings.exposure) + settings.readout_timeout);
+
+        Thread::ThreadPool pool(std::max<size_t>(settings.workers, 1));
+        uint64_t last = m_ring.published();
+        size_t captured = 0;
+
+        records[0].started = SequenceFrame::Clock::now();
+        if (!m_start(settings.exposure))
+        {
+            spdlog::error("Sequence: failed to start exposure 1");
+            return {};
+        }
+
+        for (size_t i = 0; i < settings.count; ++i)
+        {
+            Image::FrameRef frame;
+            do
+            {
+                frame = m_ring.waitNext(last, timeout);
+                if (frame)
+                {
+                    last = frame->meta.sequence;
+                }
+            } while (frame && frame->meta.video);
+            if (!frame)
+            {
+                spdlog::error("Sequence: timed out waiting for frame {}", i + 1);
+                break;
+            }
+
+            SequenceFrame &record = records[i];
+            record.index = i;
+            record.sequence = frame->meta.sequence;
+            record.exposure = settings.exposure;
+            record.received = frame->meta.timestamp;
+            ++captured;
+
+            // 读出完成后立即开始下一帧，保存与分析和下一次曝光并行
+            bool next = i + 1 < settings.count && !m_abort;
+            if (next)
+            {
+                records[i + 1].started = SequenceFrame::Clock::now();
+                if (!m_start(settings.exposure))
+                {
+                    spdlog::error("Sequence: failed to start exposure {}", i + 2);
+                    next = false;
+                }
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [&]
+                          { return m_pending < max_pending; });
+                ++m_pending;
+            }
+            pool.enqueue([this, frame, &record]
+                         {
+                bool ok = true;
+                for (const auto &handler : m_handlers)
+                {
+                    try
+                    {
+                        if (!handler(*frame, record))
+                        {
+                            ok = false;
+                            break;
+                        }
+                    }
+                    catch (const std::exception &e)
+                    {
+                        spdlog::error("Sequence: handler failed on frame {}: {}", record.index + 1, e.what());
+                        ok = false;
+                        break;
+                    }
+                }
+                record.ok = ok;
+                record.finished = SequenceFrame::Clock::now();
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    --m_pending;
+                }
+                m_cv.notify_all(); });
+
+            if (!next)
+            {
+                break;
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]
+                      { return m_pending == 0; });
+        }
+        records.resize(captured);
+        if (captured > 0)
+        {
+            spdlog::info("Sequence: {} of {} frames in {:.1f}s", captured, settings.count,
+                         Seconds(records.front().started, records.back().finished));
+        }
+        return records;
+    }
+
+    nlohmann::json ExposureSequencer::toJson(const std::vector<SequenceFrame> &frames)
+    {
+        nlohmann::json result = nlohmann::json::array();
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            const SequenceFrame &frame = frames[i];
+            nlohmann::json item = {{"index", frame.index},
+                                   {"sequence", frame.sequence},
+                                   {"exposure", frame.exposure},
+                                   {"started", ToMilliseconds(frame.started)},
+                                   {"received", ToMilliseconds(frame.received)},
+                                   {"finished", ToMilliseconds(frame.finished)},
+                                   {"processing", Seconds(frame.received, frame.finished)},
+                                   {"filename", frame.filename},
+                                   {"analysis", frame.analysis},
+                                   {"ok", frame.ok}};
+            // 空闲时间：本帧读出完成到下一帧开始曝光
+            if (i + 1 < frames.size())
+            {
+                item["idle"] = Seconds(frame.received, frames[i + 1].started);
+            }
+            result.push_back(std::move(item));
+        }
+        return result;
+    }
+} // namespace OpenAPT
@@ -0,0 +1,132 @@
+/*
+ * exposure_sequencer.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-14
+
+Description: Pipelined Exposure Sequencer
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "image/frame_ring.hpp"
+
+namespace OpenAPT
+{
+    /**
+     * @brief 序列中单帧的时间线与处理结果
+     */
+    struct SequenceFrame
+    {
+        using Clock = std::chrono::system_clock;
+
+        size_t index = 0;           ///< 帧在序列中的下标
+        uint64_t sequence = 0;      ///< 帧缓冲中的序号
+        double exposure = 0;        ///< 曝光时间（秒）
+        Clock::time_point started;  ///< 发出曝光命令的时间
+        Clock::time_point received; ///< 读出完成（BLOB 到达）的时间
+        Clock::time_point finished; ///< 保存与分析完成的时间
+        std::string filename;       ///< 保存的文件，由处理函数填写
+        nlohmann::json analysis;    ///< 分析结果，由处理函数填写
+        bool ok = false;
+    };
+
+    /**
+     * @brief 帧处理函数，在工作线程中调用；frame 只在调用期间有效
+     */
+    using FrameHandler = std::function<bool(const Image::Frame &frame, SequenceFrame &record)>;
+
+    /**
+     * @brief 序列参数
+     */
+    struct SequenceSettings
+    {
+        size_t count = 1;                 ///< 帧数
+        double exposure = 1.0;            ///< 曝光时间（秒）
+        size_t workers = 2;               ///< 处理线程数
+        size_t max_pending = 2;           ///< 最多同时在处理中的帧数，超出时暂缓提交
+        std::chrono::seconds readout_timeout{60}; ///< 曝光结束后等待读出的最长时间
+    };
+
+    /**
+     * @brief 流水线式曝光序列
+     *
+     * 第 N 帧读出完成（帧到达 FrameRing）后立即发出第 N+1 帧的曝光，
+     * 第 N 帧的保存、校准与分析在工作线程中与第 N+1 帧的曝光并行执行。
+     * 处理中的帧数受 max_pending 限制，处理跟不上时暂缓提交而不是无限堆积；
+     * max_pending 应小于帧缓冲的槽位数，否则被处理线程占用的槽位会使新帧被丢弃。
+     */
+    class ExposureSequencer
+    {
+    public:
+        /**
+         * @param ring 相机的帧缓冲
+         * @param startExposure 发出曝光命令（不等待曝光完成）
+         */
+        ExposureSequencer(Image::FrameRing &ring, std::function<bool(double)> startExposure);
+
+        /**
+         * @brief 按顺序添加处理函数，如保存、校准、分析，任一返回 false 时该帧标记为失败
+         */
+        void addHandler(FrameHandler handler);
+
+        /**
+         * @brief 执行序列，阻塞直到所有帧处理完成或被中止
+         *
+         * @return 每帧的时间线，顺序与拍摄顺序一致
+         */
+        std::vector<SequenceFrame> run(const SequenceSettings &settings);
+
+        /**
+         * @brief 中止序列，当前曝光完成后停止
+         */
+        void abort();
+
+        /**
+         * @brief 生成时间线的 JSON，包含每帧曝光之间的空闲时间
+         */
+        static nlohmann::json toJson(const std::vector<SequenceFrame> &frames);
+
+    private:
+        Image::FrameRing &m_ring;
+        std::function<bool(double)> m_start;
+        std::vector<FrameHandler> m_handlers;
+        std::atomic_bool m_abort{false};
+
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        size_t m_pending = 0;
+    };
+} // namespace OpenAPT
@@ -0,0 +1,192 @@
+/*
+ * bounded_queue.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-15
+
+Description: Bounded Lock-free Queue
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace OpenAPT::Thread
+{
+    /**
+     * @brief 有界无锁多生产者多消费者队列（Vyukov 算法）
+     *
+     * 每个槽位带有序号，生产者与消费者只通过 CAS 竞争队头/队尾下标，不使用互斥锁。
+     * 容量向上取整为 2 的幂。pushDropOldest 在队列满时弹出最旧的元素，适用于实时预览等
+     * 只关心最新数据、生产者不能被阻塞的场景。
+     */
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+            m_mask = size - 1;
+            m_cells = std::make_unique<Cell[]>(size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        /**
+         * @brief 尝试入队
+         *
+         * @return 队列已满时返回 false
+         */
+        bool tryPush(T value)
+        {
+            return pushImpl(value);
+        }
+
+        /**
+         * @brief 尝试出队
+         *
+         * @return 队列为空时返回空
+         */
+        std::optional<T> tryPop()
+        {
+            size_t pos = m_head.load(std::memory_order_relaxed);
+            Cell *cell;
+            while (true)
+            {
+                cell = &m_cells[pos & m_mask];
+                const size_t seq = cell->sequence.load(std::memory_order_acquire);
+                const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0)
+                {
+                    if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {
+                    return std::nullopt;
+                }
+                else
+                {
+                    pos = m_head.load(std::memory_order_relaxed);
+                }
+            }
+            std::optional<T> value(std::move(cell->value));
+            cell->value = T();
+            cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+            return value;
+        }
+
+        /**
+         * @brief 入队，队列满时丢弃最旧的元素
+         *
+         * @return 被丢弃的元素数量
+         */
+        size_t pushDropOldest(T value)
+        {
+            size_t dropped = 0;
+            while (!pushImpl(value))
+            {
+                if (tryPop())
+                {
+                    ++dropped;
+                }
+            }
+            return dropped;
+        }
+
+        size_t capacity() const
+        {
+            return m_mask + 1;
+        }
+
+        /**
+         * @brief 近似元素数量，仅用于统计
+         */
+        size_t sizeApprox() const
+        {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+
+    private:
+        // 只有入队成功时才移动 value，失败时调用方仍持有它
+        bool pushImpl(T &value)
+        {
+            size_t pos = m_tail.load(std::memory_order_relaxed);
+            Cell *cell;
+            while (true)
+            {
+                cell = &m_cells[pos & m_mask];
+                const size_t seq = cell->sequence.load(std::memory_order_acquire);
+                const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0)
+                {
+                    if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+            cell->value = std::move(value);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        struct Cell
+        {
+            std::atomic_size_t sequence{0};
+            T value{};
+        };
+
+        static constexpr size_t kCacheLine = 64;
+
+        std::unique_ptr<Cell[]> m_cells;
+        size_t m_mask = 0;
+        alignas(kCacheLine) std::atomic_size_t m_head{0};
+        alignas(kCacheLine) std::atomic_size_t m_tail{0};
+    };
+} // namespace OpenAPT::Thread
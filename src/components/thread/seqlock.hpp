@@ -0,0 +1,150 @@
+/*
+ * seqlock.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-17
+
+Description: Sequence Lock Snapshot
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace OpenAPT::Thread
+{
+    /**
+     * @brief 顺序锁保护的快照
+     *
+     * 写者之间用互斥锁串行化；读者从不加锁，读到写入中途的数据时按序号重试。
+     * 数据按 64 位字以原子方式存放，读写都不存在数据竞争。T 必须可平凡复制。
+     */
+    template <typename T>
+    class SeqLock
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "SeqLock requires a trivially copyable type");
+
+    public:
+        SeqLock()
+        {
+            store(T{});
+        }
+
+        explicit SeqLock(const T &value)
+        {
+            store(value);
+        }
+
+        SeqLock(const SeqLock &) = delete;
+        SeqLock &operator=(const SeqLock &) = delete;
+
+        /**
+         * @brief 读取一致的快照，不会阻塞
+         */
+        T load() const
+        {
+            Words words;
+            while (true)
+            {
+                const uint64_t before = m_sequence.load(std::memory_order_acquire);
+                if (before & 1)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t i = 0; i < kWords; ++i)
+                {
+                    words[i] = m_words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_sequence.load(std::memory_order_relaxed) == before)
+                {
+                    break;
+                }
+            }
+            T value;
+            std::memcpy(&value, words, sizeof(T));
+            return value;
+        }
+
+        /**
+         * @brief 整体替换
+         */
+        void store(const T &value)
+        {
+            std::lock_guard<std::mutex> lock(m_writer);
+            publish(value);
+        }
+
+        /**
+         * @brief 在当前值的副本上修改后发布，读者看到修改前或修改后的完整状态
+         */
+        template <typename F>
+        void update(F &&modify)
+        {
+            std::lock_guard<std::mutex> lock(m_writer);
+            T value = m_shadow;
+            modify(value);
+            publish(value);
+        }
+
+        /**
+         * @brief 写入次数，可用于判断状态是否变化
+         */
+        uint64_t version() const
+        {
+            return m_sequence.load(std::memory_order_acquire) >> 1;
+        }
+
+    private:
+        static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        using Words = uint64_t[kWords];
+
+        void publish(const T &value)
+        {
+            Words words = {};
+            std::memcpy(words, &value, sizeof(T));
+            const uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+            m_sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < kWords; ++i)
+            {
+                m_words[i].store(words[i], std::memory_order_relaxed);
+            }
+            m_sequence.store(sequence + 2, std::memory_order_release);
+            m_shadow = value;
+        }
+
+        std::atomic<uint64_t> m_sequence{0};
+        std::atomic<uint64_t> m_words[kWords];
+        std::mutex m_writer;
+        T m_shadow{}; ///< 写者持有的副本，只在 m_writer 下访问
+    };
+} // namespace OpenAPT::Thread
@@ -0,0 +1,197 @@
+/*
+ * strand_executor.cpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Bounded Executor with Strands
+
+**************************************************/
+
+#include "strand_executor.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace OpenAPT::Thread
+{
+    namespace
+    {
+        // 一个 strand 每次占用线程最多执行的任务数
+        constexpr size_t kBatch = 8;
+
+        void UpdateMax(std::atomic_size_t &max, size_t value)
+        {
+            size_t current = max.load(std::memory_order_relaxed);
+            while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+            {
+            }
+        }
+    } // namespace
+
+    StrandExecutor::StrandExecutor(size_t threads, size_t max_pending, size_t max_per_strand)
+        : m_max_pending(max_pending), m_max_per_strand(max_per_strand), m_pool(std::max<size_t>(1, threads))
+    {
+    }
+
+    StrandExecutor::~StrandExecutor() = default;
+
+    std::shared_ptr<StrandExecutor::Strand> StrandExecutor::makeStrand()
+    {
+        return std::make_shared<Strand>();
+    }
+
+    StrandExecutor::Admission StrandExecutor::post(const std::shared_ptr<Strand> &strand, std::function<void()> task)
+    {
+        // 先占一个全局名额，超过上限时退回
+        const size_t pending = m_pending.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (pending > m_max_pending)
+        {
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            m_rejected_overloaded.fetch_add(1, std::memory_order_relaxed);
+            return Admission::Overloaded;
+        }
+        {
+            std::lock_guard<std::mutex> lock(strand->mutex);
+            const Admission admission = strand->closed                           ? Admission::Closed
+                                        : strand->tasks.size() >= m_max_per_strand ? Admission::StrandFull
+                                                                                   : Admission::Accepted;
+            if (admission != Admission::Accepted)
+            {
+                m_pending.fetch_sub(1, std::memory_order_relaxed);
+                if (admission == Admission::StrandFull)
+                {
+                    m_rejected_strand.fetch_add(1, std::memory_order_relaxed);
+                }
+                return admission;
+            }
+            strand->tasks.push_back({std::move(task), std::chrono::steady_clock::now()});
+        }
+        UpdateMax(m_max_seen, pending);
+        schedule(strand);
+        return Admission::Accepted;
+    }
+
+    void StrandExecutor::close(const std::shared_ptr<Strand> &strand)
+    {
+        std::deque<Task> dropped;
+        {
+            std::lock_guard<std::mutex> lock(strand->mutex);
+            strand->closed = true;
+            dropped.swap(strand->tasks);
+        }
+        m_pending.fetch_sub(dropped.size(), std::memory_order_relaxed);
+    }
+
+    void StrandExecutor::schedule(const std::shared_ptr<Strand> &strand)
+    {
+        {
+            std::lock_guard<std::mutex> lock(strand->mutex);
+            if (strand->scheduled || strand->tasks.empty())
+            {
+                return;
+            }
+            strand->scheduled = true;
+        }
+        m_pool.enqueue([this, strand]()
+                       { drain(strand); });
+    }
+
+    void StrandExecutor::drain(const std::shared_ptr<Strand> &strand)
+    {
+        for (size_t i = 0; i < kBatch; ++i)
+        {
+            Task task;
+            {
+                std::lock_guard<std::mutex> lock(strand->mutex);
+                if (strand->tasks.empty())
+                {
+                    break;
+                }
+                task = std::move(strand->tasks.front());
+                strand->tasks.pop_front();
+            }
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+
+            const auto wait = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - task.posted).count();
+            m_wait_total_us.fetch_add(wait, std::memory_order_relaxed);
+            uint64_t max_wait = m_wait_max_us.load(std::memory_order_relaxed);
+            while (static_cast<uint64_t>(wait) > max_wait &&
+                   !m_wait_max_us.compare_exchange_weak(max_wait, wait, std::memory_order_relaxed))
+            {
+            }
+
+            m_running.fetch_add(1, std::memory_order_relaxed);
+            try
+            {
+                task.run();
+            }
+            catch (const std::exception &e)
+            {
+                m_failed.fetch_add(1, std::memory_order_relaxed);
+                spdlog::error("StrandExecutor task failed: {}", e.what());
+            }
+            m_running.fetch_sub(1, std::memory_order_relaxed);
+            m_executed.fetch_add(1, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(strand->mutex);
+            strand->scheduled = false;
+        }
+        // 还有任务时重新排到队尾，让其他 strand 有机会执行
+        schedule(strand);
+    }
+
+    StrandExecutor::Stats StrandExecutor::stats() const
+    {
+        Stats stats;
+        stats.pending = m_pending.load(std::memory_order_relaxed);
+        stats.max_pending = m_max_seen.load(std::memory_order_relaxed);
+        stats.running = m_running.load(std::memory_order_relaxed);
+        stats.executed = m_executed.load(std::memory_order_relaxed);
+        stats.rejected_overloaded = m_rejected_overloaded.load(std::memory_order_relaxed);
+        stats.rejected_strand = m_rejected_strand.load(std::memory_order_relaxed);
+        stats.failed = m_failed.load(std::memory_order_relaxed);
+        stats.max_wait = std::chrono::microseconds(m_wait_max_us.load(std::memory_order_relaxed));
+        stats.mean_wait_us = stats.executed ? static_cast<double>(m_wait_total_us.load(std::memory_order_relaxed)) / stats.executed : 0;
+        return stats;
+    }
+
+    const char *StrandExecutor::AdmissionName(Admission admission)
+    {
+        switch (admission)
+        {
+        case Admission::Accepted:
+            return "accepted";
+        case Admission::StrandFull:
+            return "connection queue full";
+        case Admission::Overloaded:
+            return "server overloaded";
+        case Admission::Closed:
+            return "connection closed";
+        }
+        return "unknown";
+    }
+} // namespace OpenAPT::Thread
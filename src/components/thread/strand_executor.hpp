@@ -0,0 +1,148 @@
+/*
+ * strand_executor.hpp
+ *
+ * Copyright (C) 2023 Max Qian <lightapt.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*************************************************
+
+Copyright: 2023 Max Qian. All rights reserved
+
+Author: Max Qian
+
+E-mail: astro_air@126.com
+
+Date: 2023-7-20
+
+Description: Bounded Executor with Strands
+
+**************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "threadpool.hpp"
+
+namespace OpenAPT::Thread
+{
+    /**
+     * @brief 有界的执行器，同一 strand 上的任务按提交顺序串行执行
+     *
+     * 任务在固定数量的线程上运行。每个 strand（例如一个 WebSocket 连接）有自己的先进先出队列，
+     * 任何时刻最多有一个线程在执行它的任务，不同 strand 之间并行。一个 strand 连续执行一小批任务后
+     * 让出线程，避免一个繁忙的连接饿死其他连接。
+     *
+     * 提交时做准入控制：全局排队任务数和单个 strand 的队列长度都有上限，超过时立即拒绝，
+     * 调用方可以马上回复"忙"，而不是让延迟无限增长。
+     */
+    class StrandExecutor
+    {
+    public:
+        enum class Admission
+        {
+            Accepted,
+            StrandFull, ///< 该 strand 排队的任务太多
+            Overloaded, ///< 全局排队的任务太多
+            Closed,     ///< strand 已关闭
+        };
+
+        class Strand;
+
+        struct Stats
+        {
+            size_t pending = 0;      ///< 当前排队的任务数
+            size_t max_pending = 0;  ///< 出现过的最大排队数
+            size_t running = 0;      ///< 正在执行的任务数
+            uint64_t executed = 0;
+            uint64_t rejected_overloaded = 0;
+            uint64_t rejected_strand = 0;
+            uint64_t failed = 0;               ///< 抛出异常的任务
+            std::chrono::microseconds max_wait{0}; ///< 任务从提交到开始执行的最长等待
+            double mean_wait_us = 0;
+        };
+
+        /**
+         * @param threads 工作线程数
+         * @param max_pending 全局排队任务的上限
+         * @param max_per_strand 单个 strand 排队任务的上限
+         */
+        explicit StrandExecutor(size_t threads, size_t max_pending = 1024, size_t max_per_strand = 64);
+
+        /**
+         * @brief 等待已接受的任务执行完后返回
+         */
+        ~StrandExecutor();
+
+        std::shared_ptr<Strand> makeStrand();
+
+        Admission post(const std::shared_ptr<Strand> &strand, std::function<void()> task);
+
+        /**
+         * @brief 关闭 strand，丢弃还没有执行的任务，之后的提交返回 Closed
+         */
+        void close(const std::shared_ptr<Strand> &strand);
+
+        size_t pending() const
+        {
+            return m_pending.load(std::memory_order_relaxed);
+        }
+
+        Stats stats() const;
+
+        static const char *AdmissionName(Admission admission);
+
+    private:
+        struct Task
+        {
+            std::function<void()> run;
+            std::chrono::steady_clock::time_point posted;
+        };
+
+        void schedule(const std::shared_ptr<Strand> &strand);
+        void drain(const std::shared_ptr<Strand> &strand);
+
+        const size_t m_max_pending;
+        const size_t m_max_per_strand;
+
+        std::atomic_size_t m_pending{0};
+        std::atomic_size_t m_max_seen{0};
+        std::atomic_size_t m_running{0};
+        std::atomic_uint64_t m_executed{0};
+        std::atomic_uint64_t m_rejected_overloaded{0};
+        std::atomic_uint64_t m_rejected_strand{0};
+        std::atomic_uint64_t m_failed{0};
+        std::atomic_uint64_t m_wait_total_us{0};
+        std::atomic_uint64_t m_wait_max_us{0};
+
+        // 最后声明、最先析构：析构时先执行完已接受的任务
+        ThreadPool m_pool;
+    };
+
+    class StrandExecutor::Strand
+    {
+        friend class StrandExecutor;
+
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        bool scheduled = false;
+        bool closed = false;
+    };
+} // namespace OpenAPT::Thread
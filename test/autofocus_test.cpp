@@ -0,0 +1,76 @@
+#include "../src/components/focus/autofocus.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace OpenAPT::Focus;
+
+int main()
+{
+    // 模拟设备：最佳焦点 10230，移动 100 ms、曝光 200 ms、读出 100 ms、分析 150 ms
+    const double true_focus = 10230;
+    std::mutex mutex;
+    int position = 0;
+    int exposed = 0;
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, 0.05);
+
+    AutoFocusDevices devices;
+    devices.moveTo = [&](int target)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::lock_guard<std::mutex> lock(mutex);
+        position = target;
+        return true;
+    };
+    devices.expose = [&](double)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::lock_guard<std::mutex> lock(mutex);
+        exposed = position;
+        return true;
+    };
+    devices.readout = [&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::to_string(exposed);
+    };
+    devices.measure = [&](const std::string &filename)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        const double x = std::stod(filename);
+        FocusSample sample;
+        std::lock_guard<std::mutex> lock(mutex);
+        sample.hfd = 2.0 * std::sqrt(1 + std::pow((x - true_focus) / 120.0, 2)) + noise(rng);
+        sample.stars = 20;
+        return sample;
+    };
+    devices.temperature = []()
+    { return 12.5; };
+
+    AutoFocusSettings settings;
+    settings.center = 10000;
+    settings.step_size = 100;
+    settings.steps = 9;
+    settings.backlash = 50;
+
+    AutoFocus autofocus(devices);
+    for (auto model : {FitModel::Hyperbola, FitModel::Parabola})
+    {
+        settings.model = model;
+        AutoFocusResult result = autofocus.run(settings);
+        std::cout << AutoFocus::toJson(result).dump(2) << std::endl;
+        std::cout << "Error: " << result.best_position - true_focus << " steps, serial time would be "
+                  << settings.steps * 0.55 << "s" << std::endl;
+        if (!result.success)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "../src/components/astro/catalog.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+using namespace OpenAPT::Astro;
+
+int main()
+{
+    {
+        std::ofstream csv("catalog_test.csv");
+        csv << "# name,ra,dec,mag,type\n";
+        csv << "M31;NGC224;Andromeda Galaxy,10.6847,41.2687,3.4,Gx\n";
+        csv << "M32;NGC221,10.6743,40.8652,8.1,Gx\n";
+        csv << "M110;NGC205,10.0921,41.6853,8.5,Gx\n";
+        csv << "M42;NGC1976,83.8221,-5.3911,4.0,EN\n";
+        csv << "M13;NGC6205,250.4235,36.4613,5.8,GC\n";
+        csv << "M45,56.75,24.1167,1.6,OC\n";
+        csv << "IC434,85.2475,-2.4583,7.3,EN\n";
+        // 相距约 0.005 度的两个天体，检验小半径的锥形检索
+        csv << "Close A,120.0,10.0,9.0,OC\n";
+        csv << "Close B,120.0,10.005,9.0,OC\n";
+        csv << "broken line\n";
+    }
+
+    if (!Catalog::build("catalog_test.csv", "catalog_test.bin"))
+    {
+        std::cerr << "Failed to build catalog" << std::endl;
+        return 1;
+    }
+
+    Catalog catalog;
+    if (!catalog.open("catalog_test.bin"))
+    {
+        std::cerr << "Failed to open catalog" << std::endl;
+        return 1;
+    }
+    std::cout << "Objects: " << catalog.size() << std::endl;
+
+    for (const char *name : {"M31", "ngc 224", "Andromeda Galaxy", "ic434", "M1"})
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto object = catalog.find(name);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        if (object)
+        {
+            std::cout << name << " -> " << object->name << " ra=" << object->ra << " dec=" << object->dec
+                      << " (" << elapsed.count() << " ns)" << std::endl;
+        }
+        else
+        {
+            std::cout << name << " -> not found" << std::endl;
+        }
+    }
+
+    std::cout << "Within 1 degree of M31:" << std::endl;
+    for (const auto &object : catalog.coneSearch(10.6847, 41.2687, 1.0))
+    {
+        std::cout << "  " << object.name << " mag=" << object.mag << std::endl;
+    }
+
+    std::cout << "Within 1 degree of M31 brighter than 8.3:" << std::endl;
+    for (const auto &object : catalog.coneSearch(10.6847, 41.2687, 1.0, 8.3f))
+    {
+        std::cout << "  " << object.name << " mag=" << object.mag << std::endl;
+    }
+
+    // 半径小于 0.1 度时 float 的夹角余弦分辨不出差别，结果必须仍然精确
+    for (double radius : {0.001, 0.004, 0.006, 0.1})
+    {
+        const size_t expected = radius < 0.005 ? 1 : 2;
+        if (catalog.coneSearch(120.0, 10.0, radius).size() != expected)
+        {
+            std::cerr << "Cone search of radius " << radius << " is wrong" << std::endl;
+            return 1;
+        }
+    }
+    if (!catalog.coneSearch(120.0, 10.0025, 0.001).empty() || catalog.coneSearch(120.0, 10.0025, 0.003).size() != 2)
+    {
+        std::cerr << "Cone search between close objects is wrong" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Brightest 3:" << std::endl;
+    for (const auto &object : catalog.brightest(99.0f, 3))
+    {
+        std::cout << "  " << object.name << " mag=" << object.mag << std::endl;
+    }
+
+    return 0;
+}
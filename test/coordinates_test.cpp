@@ -0,0 +1,81 @@
+#include "../src/components/astro/coordinates.hpp"
+
+#include <cmath>
+#include <iostream>
+
+using namespace OpenAPT::Astro;
+
+int main()
+{
+    int failures = 0;
+
+    // 四舍五入进位：赤经在 24h 处回绕，赤纬进位到下一度
+    const struct
+    {
+        double ra_hours;
+        double dec;
+        const char *ra;
+        const char *dec_text;
+    } rounding[] = {
+        {23.0 + 59.0 / 60 + 59.96 / 3600, 45.0 + 59.0 / 60 + 59.6 / 3600, "00:00:00.0", "+46:00:00"},
+        {12.0 + 59.0 / 60 + 59.97 / 3600, -(10.0 + 59.0 / 60 + 59.7 / 3600), "13:00:00.0", "-11:00:00"},
+        {0.0, -0.5, "00:00:00.0", "-00:30:00"},
+        {5.5, 89.99999, "05:30:00.0", "+90:00:00"},
+    };
+    for (const auto &expected : rounding)
+    {
+        const Equatorial position = Equatorial::fromHours(expected.ra_hours, expected.dec);
+        if (position.raString() != expected.ra || position.decString() != expected.dec_text)
+        {
+            std::cerr << expected.ra_hours << "h " << expected.dec << "° formatted as " << position.raString() << " "
+                      << position.decString() << std::endl;
+            ++failures;
+        }
+    }
+
+    // 格式化再解析回到原值，误差不超过显示精度的一半
+    for (int i = 0; i < 10000; ++i)
+    {
+        const double ra_hours = std::fmod(i * 0.0123457, 24.0);
+        const double dec = -90.0 + std::fmod(i * 0.0317, 180.0);
+        const Equatorial position = Equatorial::fromHours(ra_hours, dec);
+        const auto parsed = Equatorial::parse(position.raString(), position.decString());
+        if (!parsed)
+        {
+            std::cerr << "could not parse " << position.raString() << " " << position.decString() << std::endl;
+            ++failures;
+            break;
+        }
+        double ra_error = std::fabs(parsed->raHours() - ra_hours);
+        ra_error = std::min(ra_error, 24.0 - ra_error);
+        if (ra_error * 3600 > 0.05 + 1e-9 || std::fabs(parsed->dec - dec) * 3600 > 0.5 + 1e-9)
+        {
+            std::cerr << ra_hours << "h " << dec << "° round-tripped as " << parsed->raHours() << "h " << parsed->dec << "°"
+                      << std::endl;
+            ++failures;
+            break;
+        }
+    }
+
+    // 解析接受的写法和拒绝的输入
+    const auto parsed = Equatorial::parse("5h35m17.3s", "-05 23 28");
+    if (!parsed || std::fabs(parsed->raHours() - (5 + 35.0 / 60 + 17.3 / 3600)) > 1e-9 ||
+        std::fabs(parsed->dec + (5 + 23.0 / 60 + 28.0 / 3600)) > 1e-9)
+    {
+        ++failures;
+    }
+    const auto wrapped = Equatorial::parse("24.5", "10");
+    if (!wrapped || std::fabs(wrapped->raHours() - 0.5) > 1e-9)
+    {
+        ++failures;
+    }
+    if (Equatorial::parse("12:00:00", "91:00:00") || Equatorial::parse("abc", "10") || Equatorial::parse("", "10") ||
+        Equatorial::parse("12:00:00x", "10"))
+    {
+        std::cerr << "invalid input was accepted" << std::endl;
+        ++failures;
+    }
+
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
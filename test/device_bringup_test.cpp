@@ -0,0 +1,147 @@
+#include "../src/components/device/device_bringup.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+using namespace OpenAPT;
+
+// 模拟 INDI 驱动：connect() 阻塞 connect_ms，驱动线程再过 ready_ms 报告已连接
+class FakeDevice : public Device
+{
+public:
+    FakeDevice(const std::string &name, int connect_ms, int ready_ms, bool ok = true)
+        : Device(name), m_connect_ms(connect_ms), m_ready_ms(ready_ms), m_ok(ok)
+    {
+        _name = name;
+        IAInsertMessage(IACreateMessage("CONNECTION", false), nullptr);
+    }
+
+    ~FakeDevice() override
+    {
+        if (m_driver.joinable())
+        {
+            m_driver.join();
+        }
+    }
+
+    bool connect(std::string) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_connect_ms));
+        if (!m_ok)
+        {
+            return false;
+        }
+        m_driver = std::thread([this]()
+                               {
+            const auto ready = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_ready_ms);
+            while (std::chrono::steady_clock::now() < ready)
+            {
+                if (m_stop)
+                {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            is_connected = true;
+            // 连接后驱动继续定义属性，与编排器采集快照同时进行
+            for (int i = 0; i < 50; ++i)
+            {
+                IAInsertMessage(IACreateMessage("PROPERTY_" + std::to_string(i), i), nullptr);
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            } });
+        return true;
+    }
+
+    bool disconnect() override
+    {
+        m_stop = true;
+        if (m_driver.joinable())
+        {
+            m_driver.join();
+        }
+        is_connected = false;
+        ++disconnects;
+        return true;
+    }
+
+    std::atomic_int disconnects{0};
+
+    bool reconnect() override { return true; }
+    bool scanForAvailableDevices() override { return true; }
+    bool getSettings() override { return true; }
+    bool saveSettings() override { return true; }
+    bool getParameter(const std::string &) override { return true; }
+    bool setParameter(const std::string &, const std::string &) override { return true; }
+    std::shared_ptr<SimpleTask> getSimpleTask(const std::string &, const nlohmann::json &) override { return nullptr; }
+    std::shared_ptr<ConditionalTask> getCondtionalTask(const std::string &, const nlohmann::json &) override { return nullptr; }
+    std::shared_ptr<LoopTask> getLoopTask(const std::string &, const nlohmann::json &) override { return nullptr; }
+    std::string getName() const override { return _name; }
+    void setName(const std::string &name) override { _name = name; }
+    std::string getDeviceName() override { return device_name; }
+    void setDeviceName(const std::string &name) override { device_name = name; }
+    void setId(int) override {}
+
+private:
+    int m_connect_ms;
+    int m_ready_ms;
+    bool m_ok;
+    std::atomic_bool m_stop{false};
+    std::thread m_driver;
+};
+
+int main()
+{
+    int failures = 0;
+    DeviceBringup bringup;
+    bringup.add(std::make_shared<FakeDevice>("Camera", 300, 400), "CCD Simulator", std::chrono::seconds(2));
+    bringup.add(std::make_shared<FakeDevice>("Mount", 200, 300), "Telescope Simulator", std::chrono::seconds(2));
+    bringup.add(std::make_shared<FakeDevice>("Focuser", 100, 200), "Focuser Simulator", std::chrono::seconds(2));
+    bringup.add(std::make_shared<FakeDevice>("FilterWheel", 100, 100), "Filter Simulator", std::chrono::seconds(2));
+    bringup.add(std::make_shared<FakeDevice>("Guider", 50, 0, false), "Guide Simulator", std::chrono::seconds(2));
+    auto rotator = std::make_shared<FakeDevice>("Rotator", 1500, 0);
+    bringup.add(rotator, "Rotator Simulator", std::chrono::milliseconds(1000));
+    // connect() 及时返回，但驱动在超时之后才报告连接
+    auto dome = std::make_shared<FakeDevice>("Dome", 50, 2000);
+    bringup.add(dome, "Dome Simulator", std::chrono::milliseconds(800));
+
+    const bool all_ready = bringup.run();
+    std::cout << bringup.timeline().dump(2) << std::endl;
+
+    // 串行连接需要 0.3+0.4+0.2+0.3+0.1+0.2+0.1+0.1+0.05+1.0 秒，并行时受限于超时的那台
+    const auto &reports = bringup.reports();
+    if (all_ready || reports[0].status != DeviceBringup::Status::Ready || reports[4].status != DeviceBringup::Status::Failed ||
+        reports[5].status != DeviceBringup::Status::TimedOut || reports[6].status != DeviceBringup::Status::TimedOut ||
+        reports[0].properties.empty())
+    {
+        ++failures;
+    }
+    if (reports[0].ready > std::chrono::milliseconds(900) || bringup.elapsed() > std::chrono::milliseconds(1300))
+    {
+        std::cerr << "bring-up was not parallel" << std::endl;
+        ++failures;
+    }
+
+    // 分离的 connect() 线程结束后才退出；超时后建立的连接都被断开，时间线中标记为 discarded
+    std::this_thread::sleep_for(std::chrono::milliseconds(700));
+    size_t discarded = 0;
+    const auto timeline = bringup.timeline();
+    for (const auto &entry : timeline["devices"])
+    {
+        if (entry.value("discarded", false))
+        {
+            ++discarded;
+            if (entry["device"] == "Rotator" && entry.value("late_connect_ms", 0) < 1500)
+            {
+                ++failures;
+            }
+        }
+    }
+    if (rotator->is_connected || rotator->disconnects != 1 || dome->is_connected || dome->disconnects != 1 || discarded != 2)
+    {
+        std::cerr << "late connections were not discarded: " << discarded << " discarded" << std::endl;
+        ++failures;
+    }
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+#include "../src/components/device/device_manager.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace OpenAPT;
+
+class FakeDevice : public Device
+{
+public:
+    explicit FakeDevice(const std::string &name) : Device(name) {}
+
+    bool connect(std::string) override { return true; }
+    bool disconnect() override { return true; }
+    bool reconnect() override { return true; }
+    bool scanForAvailableDevices() override { return true; }
+    bool getSettings() override { return true; }
+    bool saveSettings() override { return true; }
+    bool getParameter(const std::string &) override { return true; }
+    bool setParameter(const std::string &, const std::string &) override { return true; }
+    std::shared_ptr<SimpleTask> getSimpleTask(const std::string &, const nlohmann::json &) override { return nullptr; }
+    std::shared_ptr<ConditionalTask> getCondtionalTask(const std::string &, const nlohmann::json &) override { return nullptr; }
+    std::shared_ptr<LoopTask> getLoopTask(const std::string &, const nlohmann::json &) override { return nullptr; }
+    std::string getName() const override { return _name; }
+    void setName(const std::string &name) override { _name = name; }
+    std::string getDeviceName() override { return device_name; }
+    void setDeviceName(const std::string &name) override { device_name = name; }
+    void setId(int) override {}
+};
+
+static DeviceType TypeOf(int i)
+{
+    return static_cast<DeviceType>(i % static_cast<int>(DeviceType::NumDeviceTypes));
+}
+
+int main()
+{
+    int failures = 0;
+    DeviceManager manager;
+
+    // 预先构造全部设备，读者可以按名称和 UUID 查询任意一台
+    constexpr int kDevices = 64;
+    std::vector<std::shared_ptr<FakeDevice>> devices;
+    for (int i = 0; i < kDevices; ++i)
+    {
+        devices.push_back(std::make_shared<FakeDevice>("Device " + std::to_string(i)));
+    }
+
+    // 读者：每次查到的设备在两个索引中必须是同一台，名称、UUID 和类型一致
+    std::atomic_bool stop{false};
+    std::atomic_bool inconsistent{false};
+    std::atomic_uint64_t lookups{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r)
+    {
+        readers.emplace_back([&, r]()
+                             {
+            for (int n = r; !stop; ++n)
+            {
+                const int i = n % kDevices;
+                const auto &expected = devices[i];
+                if (auto device = manager.getDevice(TypeOf(i), expected->getName()); device && device != expected)
+                {
+                    inconsistent = true;
+                }
+                if (auto device = manager.findDeviceById(expected->getId()); device && device != expected)
+                {
+                    inconsistent = true;
+                }
+                if (auto device = manager.findDeviceByName(expected->getName()); device && device != expected)
+                {
+                    inconsistent = true;
+                }
+                // 类型不符时查不到
+                if (manager.getDevice(TypeOf(i + 1), expected->getName()))
+                {
+                    inconsistent = true;
+                }
+                ++lookups;
+            } });
+    }
+
+    // 写者：反复添加和删除，两种删除方式交替使用
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; ++w)
+    {
+        writers.emplace_back([&, w]()
+                             {
+            for (int round = 0; round < 200; ++round)
+            {
+                for (int i = w; i < kDevices; i += 2)
+                {
+                    manager.addDevice(TypeOf(i), devices[i]);
+                }
+                for (int i = w; i < kDevices; i += 4)
+                {
+                    if (round % 2)
+                    {
+                        manager.removeDevicesByName(devices[i]->getName());
+                    }
+                    else
+                    {
+                        manager.removeDevice(TypeOf(i), devices[i]->getName());
+                    }
+                }
+            } });
+    }
+    for (auto &thread : writers)
+    {
+        thread.join();
+    }
+    stop = true;
+    for (auto &thread : readers)
+    {
+        thread.join();
+    }
+    if (inconsistent)
+    {
+        std::cerr << "a lookup returned the wrong device" << std::endl;
+        ++failures;
+    }
+
+    // 结束后：每台设备要么同时在两个索引和列表中，要么都不在；删除的设备不再引用遥测存储
+    size_t listed = 0;
+    for (int type = 0; type < static_cast<int>(DeviceType::NumDeviceTypes); ++type)
+    {
+        listed += manager.getDeviceList(static_cast<DeviceType>(type)).size();
+    }
+    size_t present = 0;
+    for (int i = 0; i < kDevices; ++i)
+    {
+        const auto &device = devices[i];
+        const bool by_name = manager.findDeviceByName(device->getName()) == device;
+        const bool by_id = manager.findDeviceById(device->getId()) == device;
+        const bool removed = i % 4 < 2;
+        if (by_name != by_id || by_name == removed || (device->telemetry.load() != nullptr) != by_name)
+        {
+            std::cerr << device->getName() << ": by name " << by_name << ", by id " << by_id << std::endl;
+            ++failures;
+        }
+        present += by_name;
+    }
+    if (present != listed || present != kDevices / 2)
+    {
+        std::cerr << present << " devices indexed, " << listed << " listed" << std::endl;
+        ++failures;
+    }
+
+    // 同名设备和空设备不能添加
+    if (manager.addDevice(DeviceType::Camera, devices[2]) || manager.addDevice(DeviceType::Camera, std::shared_ptr<Device>()))
+    {
+        ++failures;
+    }
+
+    std::cout << lookups << " lookups during 400 add/remove rounds" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
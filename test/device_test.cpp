@@ -168,7 +168,7 @@ int main()
 {
     std::shared_ptr<Camera> camera = std::make_shared<Camera>("myCamera");
 
-    camera->observers.push_back(MyObserver);
+    camera->IAAddObserver(MyObserver);
 
     bool connectResult = camera->connect("myCamera");
     if (connectResult)
@@ -0,0 +1,135 @@
+#include "../src/components/device/event_bus.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+using namespace OpenAPT;
+
+static Property::IMessage MakeMessage(const std::string &name, int value)
+{
+    Property::IMessage message;
+    message.name = name;
+    message.value = value;
+    return message;
+}
+
+int main()
+{
+    int failures = 0;
+    DeviceEventBus bus(1024, std::chrono::milliseconds(10));
+
+    // 慢订阅者（模拟 WebSocket 发送）：每批耗时 50 ms，只应看到合并后的最新值
+    std::mutex mutex;
+    int last_temperature = -1;
+    bool old_after_new = false;
+    size_t slow_events = 0;
+    bus.subscribe([&](std::span<const DeviceEvent> events)
+                  {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &event : events)
+        {
+            if (event.key == "temperature")
+            {
+                // 旧值是订阅者上次看到的值，不会比新值更新
+                if (event.old_value->getValue<int>() > event.value->getValue<int>())
+                {
+                    old_after_new = true;
+                }
+                last_temperature = event.value->getValue<int>();
+            }
+            ++slow_events;
+        } });
+
+    // 快订阅者：在发布线程之外运行，每批按消息去重
+    std::atomic_size_t fast_events{0};
+    std::atomic_bool duplicated{false};
+    bus.subscribe([&](std::span<const DeviceEvent> events)
+                  {
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            for (size_t j = i + 1; j < events.size(); ++j)
+            {
+                if (events[i].key == events[j].key)
+                {
+                    duplicated = true;
+                }
+            }
+        }
+        fast_events += events.size(); });
+
+    constexpr int kUpdates = 200000;
+    bus.publish(DeviceEvent::Kind::Inserted, MakeMessage("temperature", 0));
+    Property::IMessage messages[2] = {MakeMessage("focuser", 0), MakeMessage("temperature", 0)};
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= kUpdates; ++i)
+    {
+        messages[i % 2].value = i;
+        bus.publish(DeviceEvent::Kind::Updated, messages[i % 2]);
+    }
+    const double publish_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kUpdates;
+
+    bus.publish(DeviceEvent::Kind::Updated, MakeMessage("temperature", kUpdates + 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    bus.flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (last_temperature != kUpdates + 1 || old_after_new)
+        {
+            std::cerr << "slow subscriber saw " << last_temperature << std::endl;
+            ++failures;
+        }
+        if (slow_events >= static_cast<size_t>(kUpdates) / 10)
+        {
+            std::cerr << "slow subscriber was not coalesced: " << slow_events << " events" << std::endl;
+            ++failures;
+        }
+    }
+    if (duplicated)
+    {
+        std::cerr << "batch contained the same key twice" << std::endl;
+        ++failures;
+    }
+    if (bus.published() != kUpdates + 2 || bus.coalesced() == 0)
+    {
+        ++failures;
+    }
+
+    // 容量很小时，一个消息的大量更新不能挤掉其他消息的最新值
+    {
+        DeviceEventBus small(64, std::chrono::milliseconds(10));
+        std::mutex seen_mutex;
+        std::unordered_map<std::string, int> seen;
+        small.subscribe([&](std::span<const DeviceEvent> events)
+                        {
+            std::lock_guard<std::mutex> lock(seen_mutex);
+            for (const auto &event : events)
+            {
+                seen[event.key] = event.value->getValue<int>();
+            } });
+        small.publish(DeviceEvent::Kind::Updated, MakeMessage("A", 1));
+        for (int i = 1; i <= 200; ++i)
+        {
+            small.publish(DeviceEvent::Kind::Updated, MakeMessage("B", i));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        small.flush();
+        std::lock_guard<std::mutex> lock(seen_mutex);
+        if (!seen.count("A") || seen["A"] != 1 || !seen.count("B") || seen["B"] != 200)
+        {
+            std::cerr << "small bus lost the latest value of A or B" << std::endl;
+            ++failures;
+        }
+    }
+
+    std::cout << "publish " << publish_ns << " ns/update, " << bus.stats().dump() << ", fast subscriber " << fast_events
+              << " events, slow subscriber " << slow_events << " events" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+#include "../src/components/task/exposure_sequencer.hpp"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace OpenAPT;
+
+int main()
+{
+    int failures = 0;
+    Image::FrameRing ring(4, 1024);
+    std::vector<uint8_t> image(1024);
+
+    // 模拟相机：曝光结束后帧到达帧缓冲，同时有视频流的帧混入
+    std::vector<std::thread> exposures;
+    auto start_exposure = [&](double seconds)
+    {
+        exposures.emplace_back([&, seconds]()
+                               {
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+            Image::FrameMeta meta;
+            meta.device = "simulator";
+            meta.format = ".fits";
+            meta.exposure = seconds;
+            meta.timestamp = std::chrono::system_clock::now();
+            ring.publishCopy(image.data(), image.size(), std::move(meta)); });
+        return true;
+    };
+    std::atomic_bool streaming{true};
+    std::thread video([&]()
+                      {
+        while (streaming)
+        {
+            Image::FrameMeta meta;
+            meta.device = "simulator";
+            meta.format = ".stream";
+            meta.video = true;
+            ring.publishCopy(image.data(), 16, std::move(meta));
+            std::this_thread::sleep_for(std::chrono::milliseconds(7));
+        } });
+
+    constexpr size_t kCount = 10;
+    constexpr auto kProcessing = std::chrono::milliseconds(50);
+    ExposureSequencer sequencer(ring, start_exposure);
+    std::atomic_int video_frames{0};
+    sequencer.addHandler([&](const Image::Frame &frame, SequenceFrame &record)
+                         {
+        if (frame.meta.video)
+        {
+            ++video_frames;
+        }
+        std::this_thread::sleep_for(kProcessing);
+        record.filename = "frame_" + std::to_string(record.index + 1) + frame.meta.format;
+        return true; });
+
+    SequenceSettings settings;
+    settings.count = kCount;
+    settings.exposure = 0.05;
+    settings.max_pending = 2;
+    const auto begin = std::chrono::steady_clock::now();
+    const auto frames = sequencer.run(settings);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if (frames.size() != kCount || video_frames != 0)
+    {
+        std::cerr << frames.size() << " frames, " << video_frames << " video frames processed" << std::endl;
+        ++failures;
+    }
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        // 按拍摄顺序记录，下一帧的曝光在本帧读出之后才开始
+        if (frames[i].index != i || !frames[i].ok || frames[i].finished < frames[i].received ||
+            (i > 0 && (frames[i].sequence <= frames[i - 1].sequence || frames[i].started < frames[i - 1].received)))
+        {
+            std::cerr << "frame " << i << " is out of order" << std::endl;
+            ++failures;
+            break;
+        }
+    }
+    // 处理与下一次曝光并行，总时间明显少于逐帧曝光再处理
+    const double serial = kCount * (settings.exposure + std::chrono::duration<double>(kProcessing).count());
+    if (elapsed > serial * 0.8)
+    {
+        std::cerr << "sequence took " << elapsed << "s, serial would take " << serial << "s" << std::endl;
+        ++failures;
+    }
+
+    // 中止后当前帧完成即停止
+    ExposureSequencer aborting(ring, start_exposure);
+    aborting.addHandler([&](const Image::Frame &, SequenceFrame &record)
+                        {
+        if (record.index == 2)
+        {
+            aborting.abort();
+        }
+        return true; });
+    const auto aborted = aborting.run(settings);
+    if (aborted.size() < 3 || aborted.size() >= kCount)
+    {
+        std::cerr << "aborted sequence captured " << aborted.size() << " frames" << std::endl;
+        ++failures;
+    }
+
+    streaming = false;
+    video.join();
+    for (auto &thread : exposures)
+    {
+        thread.join();
+    }
+
+    std::cout << ExposureSequencer::toJson(frames)[1].dump() << std::endl;
+    std::cout << kCount << " frames in " << elapsed << "s (serial " << serial << "s)" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+#include "../src/components/image/frame_ring.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace OpenAPT::Image;
+
+int main()
+{
+    constexpr size_t kFrameSize = 4 * 1024 * 1024;
+    constexpr int kFrames = 200;
+    FrameRing ring(4, kFrameSize);
+    std::vector<uint8_t> image(kFrameSize);
+
+    // 快速消费者（预览）和慢速消费者（保存），慢速消费者会跳过被覆盖的帧
+    std::atomic_int fast_count{0}, slow_count{0}, corrupted{0};
+    auto consumer = [&](std::atomic_int &count, std::chrono::milliseconds work)
+    {
+        uint64_t last = 0;
+        while (auto frame = ring.waitNext(last, std::chrono::milliseconds(500)))
+        {
+            last = frame->meta.sequence;
+            if (frame->size != kFrameSize || frame->data[0] != static_cast<uint8_t>(frame->meta.exposure))
+            {
+                ++corrupted;
+            }
+            std::this_thread::sleep_for(work);
+            ++count;
+        }
+    };
+    std::thread fast(consumer, std::ref(fast_count), std::chrono::milliseconds(0));
+    std::thread slow(consumer, std::ref(slow_count), std::chrono::milliseconds(5));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kFrames; ++i)
+    {
+        std::fill(image.begin(), image.begin() + 64, static_cast<uint8_t>(i));
+        FrameMeta meta;
+        meta.device = "simulator";
+        meta.exposure = static_cast<uint8_t>(i);
+        ring.publishCopy(image.data(), image.size(), std::move(meta));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ring.close();
+    fast.join();
+    slow.join();
+
+    // 预留槽位：取消的预留不可见，提交后按序号发布
+    FrameRing direct(2, 0);
+    auto reservation = direct.reserve(1024);
+    direct.cancel(reservation);
+    reservation = direct.reserve(1024);
+    reservation.data()[0] = 42;
+    FrameMeta meta;
+    meta.device = "simulator";
+    const bool committed = reservation && direct.commit(reservation, 1, std::move(meta));
+    auto frame = direct.latest();
+    if (!committed || !frame || frame->meta.sequence != 1 || frame->size != 1 || frame->data[0] != 42)
+    {
+        ++corrupted;
+    }
+
+    // 按画幅预分配后，预留不再需要扩容
+    FrameRing sized(2, 0);
+    sized.preallocate(4096);
+    auto first = sized.reserve(1);
+    auto second = sized.reserve(1);
+    if (!first || !second || first.capacity() < 4096 || second.capacity() < 4096)
+    {
+        ++corrupted;
+    }
+    sized.cancel(first);
+    sized.cancel(second);
+
+    std::cout << "Published " << ring.published() << " dropped " << ring.dropped() << " in " << elapsed << " ms" << std::endl;
+    std::cout << "Fast consumer " << fast_count << " slow consumer " << slow_count << " corrupted " << corrupted << std::endl;
+    return corrupted == 0 ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+#include "../src/components/driver/indi/indi_simulator.hpp"
+#include "../src/components/driver/indi/indicamera.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace OpenAPT;
+
+// 模拟器运行在子进程中，父进程的 CPU 时间只包含驱动本身
+// 父进程通过管道发送命令：storm <rate> / quit
+
+static double CpuSeconds()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static void RunSimulator(const IndiSimulatorSettings &settings, int port_fd, int command_fd)
+{
+    IndiSimulator simulator(settings);
+    const int port = simulator.start() ? simulator.port() : 0;
+    write(port_fd, &port, sizeof(port));
+    FILE *commands = fdopen(command_fd, "r");
+    char line[64];
+    while (port && fgets(line, sizeof(line), commands))
+    {
+        if (std::strncmp(line, "storm ", 6) == 0)
+        {
+            simulator.setStormRate(std::atof(line + 6));
+        }
+        else if (std::strncmp(line, "quit", 4) == 0)
+        {
+            break;
+        }
+    }
+    std::cerr << "simulator " << simulator.stats().dump() << std::endl;
+    simulator.stop();
+}
+
+static double Percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+int main(int argc, char **argv)
+{
+    // stream（默认）、split 或 shared
+    const std::string mode = argc > 1 ? argv[1] : "stream";
+    const int seconds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    IndiSimulatorSettings settings;
+    settings.width = 2048;
+    settings.height = 1024;
+    settings.video_fps = 30;
+
+    int port_pipe[2], command_pipe[2];
+    if (pipe(port_pipe) != 0 || pipe(command_pipe) != 0)
+    {
+        return 1;
+    }
+    const pid_t child = fork();
+    if (child == 0)
+    {
+        close(command_pipe[1]);
+        RunSimulator(settings, port_pipe[1], command_pipe[0]);
+        _exit(0);
+    }
+    close(command_pipe[0]);
+    int port = 0;
+    read(port_pipe[0], &port, sizeof(port));
+    FILE *commands = fdopen(command_pipe[1], "w");
+    const auto command = [commands](const std::string &text)
+    {
+        std::fprintf(commands, "%s\n", text.c_str());
+        std::fflush(commands);
+    };
+    if (!port)
+    {
+        std::cerr << "simulator failed to start" << std::endl;
+        return 1;
+    }
+
+    INDICamera camera("bench");
+    camera.hostname = "127.0.0.1";
+    camera.port = port;
+    camera.setParameter("blob_connection", mode);
+    camera.connect(settings.camera);
+    for (int i = 0; i < 50 && !camera.getState().connected; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!camera.getState().connected)
+    {
+        std::cerr << "camera did not connect" << std::endl;
+        command("quit");
+        waitpid(child, nullptr, 0);
+        return 1;
+    }
+    std::cout << "connection mode: " << mode << std::endl;
+
+    // 1. BLOB 到帧缓冲的延迟与每帧 CPU：模拟器写入发送时刻，消费者在帧到达后立即取出
+    Image::FrameRing &ring = camera.getFrameRing();
+    std::vector<double> latency_us;
+    const auto collect = [&](int duration)
+    {
+        uint64_t last = ring.published();
+        const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(duration);
+        while (std::chrono::steady_clock::now() < end)
+        {
+            auto frame = ring.waitNext(last, std::chrono::milliseconds(200));
+            if (!frame)
+            {
+                continue;
+            }
+            last = frame->meta.sequence;
+            const uint64_t sent = IndiSimulator::BlobTimestamp(frame->data, frame->size);
+            latency_us.push_back((IndiSimulator::Now() - sent) / 1e3);
+        }
+    };
+
+    const double cpu_before = CpuSeconds();
+    camera.startLiveView();
+    collect(seconds);
+    camera.stopLiveView();
+    const double cpu = CpuSeconds() - cpu_before;
+    std::printf("BLOB -> ring: %zu frames of %d KiB, p50 %.0f us, p99 %.0f us, max %.0f us, dropped %llu\n",
+                latency_us.size(), settings.width * settings.height * settings.bit_depth / 8 / 1024,
+                Percentile(latency_us, 0.5), Percentile(latency_us, 0.99), Percentile(latency_us, 1.0),
+                static_cast<unsigned long long>(ring.dropped()));
+    std::printf("CPU per frame (driver + live view): %.2f ms\n", latency_us.empty() ? 0.0 : cpu * 1e3 / latency_us.size());
+
+    // 2. 属性更新吞吐：风暴在相机和电调的温度之间交替，一半落在相机上，相机状态的版本号即处理的更新数
+    const auto storm = [&](double rate)
+    {
+        const uint64_t before = camera.getStateVersion();
+        command("storm " + std::to_string(rate));
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        command("storm 0");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return (camera.getStateVersion() - before) / static_cast<double>(seconds);
+    };
+    for (const double rate : {2000.0, 20000.0, 100000.0})
+    {
+        const double cpu_start = CpuSeconds();
+        const double handled = storm(rate);
+        std::printf("property storm %6.0f/s: camera handled %8.0f updates/s (offered %6.0f/s), CPU %.2f us/update\n",
+                    rate, handled, rate / 2, handled > 0 ? (CpuSeconds() - cpu_start) * 1e6 / (handled * seconds) : 0.0);
+    }
+
+    // 3. 图像下载时的属性更新：独立连接下温度更新不应被 BLOB 阻塞
+    camera.startLiveView();
+    const double under_load = storm(2000);
+    camera.stopLiveView();
+    std::printf("property storm 2000/s during %.0f fps video: camera handled %.0f updates/s (offered 1000/s)\n",
+                settings.video_fps, under_load);
+
+    camera.disconnect();
+    command("quit");
+    waitpid(child, nullptr, 0);
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "../src/components/api/indistreamclient.hpp"
+#include "../src/components/api/indixmlscanner.hpp"
+#include "../src/components/driver/indi/indi_simulator.hpp"
+#include "../src/components/image/frame_ring.hpp"
+#include "../src/components/property/base64.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+using namespace OpenAPT;
+using namespace OpenAPT::API;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                               \
+    do                                                                            \
+    {                                                                             \
+        if (!(cond))                                                              \
+        {                                                                         \
+            std::cerr << __LINE__ << ": check failed: " #cond << std::endl;      \
+            ++failures;                                                           \
+        }                                                                         \
+    } while (0)
+
+static double CpuSeconds()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// 流式 Base64：随机数据、INDI 的 72 字符换行、任意分段
+static void TestBase64()
+{
+    std::mt19937 rng(7);
+    for (int i = 0; i < 500; ++i)
+    {
+        std::vector<unsigned char> data(rng() % 1000);
+        for (auto &b : data)
+        {
+            b = static_cast<unsigned char>(rng());
+        }
+        const std::string encoded = Base64::base64Encode(data);
+        std::string wrapped;
+        for (size_t pos = 0; pos < encoded.size(); pos += 72)
+        {
+            wrapped.append(encoded, pos, 72).push_back('\n');
+        }
+        std::vector<uint8_t> out(data.size());
+        Base64::StreamDecoder decoder(out.data(), out.size());
+        for (size_t pos = 0; pos < wrapped.size();)
+        {
+            const size_t chunk = std::min<size_t>(1 + rng() % 97, wrapped.size() - pos);
+            decoder.feed(wrapped.data() + pos, chunk);
+            pos += chunk;
+        }
+        CHECK(decoder.finish());
+        CHECK(decoder.size() == data.size());
+        CHECK(std::memcmp(out.data(), data.data(), data.size()) == 0);
+    }
+    uint8_t small[2];
+    CHECK(Base64::base64DecodeTo("QUJD", small, sizeof(small)) == SIZE_MAX);
+    CHECK(Base64::base64DecodeTo("QU*D", small, sizeof(small)) == SIZE_MAX);
+}
+
+// 扫描器：按单字节喂入，标签和文本跨越缓冲区边界
+static void TestScanner()
+{
+    const std::string xml = "<?xml version=\"1.0\"?><!-- c > d -->"
+                            "<setNumberVector device=\"Cam\" name=\"T\" message=\"a &amp; b\">\n"
+                            "  <oneNumber name=\"V\">\n -12:30:00\n</oneNumber>\n"
+                            "</setNumberVector><delProperty device='Cam' name=\"X>Y\"/>";
+    IndiXmlScanner scanner(16);
+    std::vector<std::string> events;
+    std::string text;
+    for (const char c : xml)
+    {
+        auto [data, size] = scanner.prepare(1);
+        data[0] = c;
+        scanner.commit(1);
+        for (auto event = scanner.next(); event != IndiXmlScanner::Event::None; event = scanner.next())
+        {
+            CHECK(event != IndiXmlScanner::Event::Error);
+            if (event == IndiXmlScanner::Event::StartElement)
+            {
+                events.push_back("+" + std::string(scanner.name()));
+                if (scanner.name() == "setNumberVector")
+                {
+                    std::string message;
+                    IndiXmlScanner::Unescape(scanner.attribute("message"), message);
+                    CHECK(message == "a & b");
+                }
+                if (scanner.name() == "delProperty")
+                {
+                    CHECK(scanner.attribute("name") == "X>Y");
+                    CHECK(scanner.attribute("device") == "Cam");
+                }
+            }
+            else if (event == IndiXmlScanner::Event::EndElement)
+            {
+                events.push_back("-" + std::string(scanner.name()));
+            }
+            else if (event == IndiXmlScanner::Event::Text && events.back() == "+oneNumber")
+            {
+                text += scanner.text();
+            }
+        }
+    }
+    const std::vector<std::string> expected = {"+setNumberVector", "+oneNumber", "-oneNumber", "-setNumberVector", "+delProperty", "-delProperty"};
+    CHECK(events == expected);
+    double value = 0;
+    CHECK(IndiStreamClient::ParseNumber(text, value));
+    CHECK(std::abs(value + 12.5) < 1e-9);
+}
+
+// 与模拟器通信：属性定义、BLOB 直接解码到帧缓冲的预留槽位、属性风暴的解析开销
+static void TestSimulator()
+{
+    IndiSimulatorSettings settings;
+    settings.width = 2048;
+    settings.height = 1024;
+    settings.video_fps = 50;
+    IndiSimulator simulator(settings);
+    CHECK(simulator.start());
+
+    Image::FrameRing ring(4, 0);
+    Image::FrameRing::Reservation reservation;
+    std::atomic_int definitions{0}, updates{0}, frames{0}, bad_frames{0};
+    std::vector<double> latency_us;
+    std::mutex mutex;
+
+    IndiStreamClient::Handlers handlers;
+    handlers.vector = [&](const IndiVector &vector)
+    {
+        if (vector.definition)
+        {
+            ++definitions;
+        }
+        else if (vector.name == "CCD_TEMPERATURE" && vector.find("CCD_TEMPERATURE_VALUE"))
+        {
+            ++updates;
+        }
+    };
+    handlers.blob_begin = [&](const IndiBlobInfo &info)
+    {
+        reservation = ring.reserve(info.capacity());
+        return std::span<uint8_t>(reservation.data(), reservation.capacity());
+    };
+    handlers.blob_end = [&](const IndiBlobInfo &info, size_t size, bool ok)
+    {
+        if (!ok || size != info.size)
+        {
+            ring.cancel(reservation);
+            ++bad_frames;
+            return;
+        }
+        const uint64_t sent = IndiSimulator::BlobTimestamp(reservation.data(), size);
+        Image::FrameMeta meta;
+        meta.device = std::string(info.device);
+        meta.format = std::string(info.format);
+        ring.commit(reservation, size, std::move(meta));
+        std::lock_guard<std::mutex> lock(mutex);
+        latency_us.push_back((IndiSimulator::Now() - sent) / 1e3);
+        ++frames;
+    };
+
+    IndiStreamClient client(handlers);
+    CHECK(client.connect("127.0.0.1", simulator.port()));
+    CHECK(client.getProperties(settings.camera));
+    CHECK(client.enableBlob(settings.camera, "CCD1", IndiBlobMode::Also));
+    CHECK(client.sendSwitch(settings.camera, "CONNECTION", "CONNECT"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(definitions > 5);
+
+    double cpu = CpuSeconds();
+    CHECK(client.sendSwitch(settings.camera, "CCD_VIDEO_STREAM", "STREAM_ON"));
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    CHECK(client.sendSwitch(settings.camera, "CCD_VIDEO_STREAM", "STREAM_OFF"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    cpu = CpuSeconds() - cpu;
+    CHECK(frames > 50);
+    CHECK(ring.published() == static_cast<uint64_t>(frames.load()));
+    CHECK(bad_frames == 0);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::sort(latency_us.begin(), latency_us.end());
+        const double mb = frames * settings.width * settings.height * 2 / 1e6;
+        std::cout << frames << " frames, p50 " << (latency_us.empty() ? 0 : latency_us[latency_us.size() / 2])
+                  << " us, client+simulator CPU " << cpu * 1e3 / std::max(mb, 1.0) << " ms/MB" << std::endl;
+    }
+
+    cpu = CpuSeconds();
+    simulator.setStormRate(40000);
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    simulator.setStormRate(0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    cpu = CpuSeconds() - cpu;
+    CHECK(updates > 15000);
+    std::cout << updates << " temperature updates, client+simulator CPU " << cpu * 1e6 / std::max(updates.load(), 1) << " us/update" << std::endl;
+
+    client.disconnect();
+    CHECK(!client.isConnected());
+    simulator.stop();
+}
+
+int main()
+{
+    TestBase64();
+    TestScanner();
+    TestSimulator();
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
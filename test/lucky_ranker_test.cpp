@@ -0,0 +1,134 @@
+#include "../src/components/image/lucky_ranker.hpp"
+
+#include <cmath>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace OpenAPT::Image;
+
+constexpr int kSize = 64;
+
+// 8 位灰度帧：背景上的几颗高斯星点，sigma 越大越模糊，总通量不变
+static std::vector<uint8_t> MakeFrame(double sigma)
+{
+    const double stars[][3] = {{32, 32, 1.0}, {14, 18, 0.6}, {48, 44, 0.5}, {20, 50, 0.4}};
+    std::vector<uint8_t> frame(kSize * kSize);
+    for (int y = 0; y < kSize; ++y)
+    {
+        for (int x = 0; x < kSize; ++x)
+        {
+            double value = 20;
+            for (const auto &star : stars)
+            {
+                const double r2 = (x - star[0]) * (x - star[0]) + (y - star[1]) * (y - star[1]);
+                value += star[2] * 2000 / (sigma * sigma) * std::exp(-r2 / (2 * sigma * sigma));
+            }
+            frame[y * kSize + x] = static_cast<uint8_t>(std::min(255.0, value));
+        }
+    }
+    return frame;
+}
+
+int main()
+{
+    int failures = 0;
+    const auto sharp = MakeFrame(1.2);
+    const auto blurred = MakeFrame(3.0);
+
+    // 每种评价方法都把清晰帧排在模糊帧之前
+    FrameMeta meta;
+    meta.width = kSize;
+    meta.height = kSize;
+    meta.bit_depth = 8;
+    meta.format = ".stream";
+    meta.video = true;
+    ScoreImage sharp_roi;
+    ScoreImage blurred_roi;
+    if (!ExtractRoi(Frame{meta, sharp.data(), sharp.size()}, Roi{}, sharp_roi) ||
+        !ExtractRoi(Frame{meta, blurred.data(), blurred.size()}, Roi{}, blurred_roi))
+    {
+        std::cerr << "could not extract ROI" << std::endl;
+        return 1;
+    }
+    for (auto metric : {SharpnessMetric::LaplacianVariance, SharpnessMetric::GradientEnergy, SharpnessMetric::PsfWidth})
+    {
+        LuckySettings settings;
+        settings.metric = metric;
+        const FrameScore a = LuckyRanker::score(sharp_roi, settings);
+        const FrameScore b = LuckyRanker::score(blurred_roi, settings);
+        if (!(a.score > b.score) || (metric == SharpnessMetric::PsfWidth && !(a.hfd < b.hfd)))
+        {
+            std::cerr << "metric " << static_cast<int>(metric) << ": sharp " << a.score << ", blurred " << b.score << std::endl;
+            ++failures;
+        }
+    }
+
+    // 实时评分：第一帧是模糊帧，之后清晰和模糊交替；单线程评分，按顺序逐帧发布
+    FrameRing ring(4, kSize * kSize);
+    LuckyRanker ranker(ring);
+    LuckySettings settings;
+    settings.keep_fraction = 0.25;
+    settings.window = 100;
+    settings.workers = 1;
+    std::mutex mutex;
+    std::condition_variable scored;
+    std::vector<FrameScore> results;
+    if (!ranker.start(settings, [&](const FrameScore &result)
+                      {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(result);
+        scored.notify_all(); }))
+    {
+        std::cerr << "could not start" << std::endl;
+        return 1;
+    }
+
+    constexpr size_t kFrames = 40;
+    std::vector<bool> is_sharp;
+    for (size_t i = 0; i < kFrames; ++i)
+    {
+        const bool frame_sharp = i % 2 == 1;
+        const auto &data = frame_sharp ? sharp : blurred;
+        is_sharp.push_back(frame_sharp);
+        ring.publishCopy(data.data(), data.size(), meta);
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!scored.wait_for(lock, std::chrono::seconds(2), [&]()
+                             { return results.size() == i + 1; }))
+        {
+            std::cerr << "frame " << i << " was not scored" << std::endl;
+            ++failures;
+            break;
+        }
+    }
+    ranker.stop();
+
+    // 前 1 / keep_fraction 帧只作参照，不论清晰与否都不保留；之后清晰帧保留、模糊帧拒绝
+    const size_t warmup = 4;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const bool expected = i + 1 >= warmup && is_sharp[i];
+        if (results[i].keep != expected)
+        {
+            std::cerr << "frame " << i << (is_sharp[i] ? " (sharp)" : " (blurred)") << " keep " << results[i].keep
+                      << ", expected " << expected << std::endl;
+            ++failures;
+        }
+    }
+    if (results.size() != kFrames || ranker.scores().size() != kFrames)
+    {
+        ++failures;
+    }
+
+    // best() 事后挑选时不受预热影响，最好的一帧是清晰帧
+    const auto best = ranker.best(0.25);
+    if (best.empty() || best.front().score != results[1].score)
+    {
+        ++failures;
+    }
+
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
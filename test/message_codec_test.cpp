@@ -0,0 +1,197 @@
+#include "../src/components/property/message_codec.hpp"
+#include "../src/components/property/message_writer.hpp"
+
+#include <chrono>
+#include <iostream>
+
+using namespace OpenAPT::Property;
+
+static IMessage MakeMessage(const std::string &name, MessageValue value)
+{
+    IMessage message;
+    message.device_name = "CCD Simulator";
+    message.device_uuid = "{2c1b5a4e-8d3f-4a7b-9e61-0f2d3c4b5a69}";
+    message.name = name;
+    message.value = std::move(value);
+    return message;
+}
+
+static bool SameMessage(const IMessage &a, const IMessage &b)
+{
+    return a.device_name == b.device_name && a.device_uuid == b.device_uuid && a.name == b.name && a.value == b.value;
+}
+
+int main()
+{
+    int failures = 0;
+
+    // 各种值类型和图像的往返
+    std::vector<IMessage> messages = {
+        MakeMessage("CCD_TEMPERATURE", -10.25),
+        MakeMessage("ABS_FOCUS_POSITION", 35120.0),
+        MakeMessage("GUIDE_RA", -3),
+        MakeMessage("CONNECTION", true),
+        MakeMessage("DRIVER_INFO", std::string("indi_simulator_ccd")),
+        MakeMessage("EMPTY", std::monostate()),
+    };
+    IImage image;
+    image.device_name = "CCD Simulator";
+    image.name = "CCD1";
+    image.width = 4144;
+    image.height = 2822;
+    image.depth = 16;
+    image.gain = 120;
+    image.duration = 30;
+    image.is_color = true;
+    image.author = "OpenAPT";
+    image.value = std::string("/data/light_0001.fits");
+
+    BinaryEncoder encoder;
+    BinaryDecoder decoder;
+    std::vector<uint8_t> buffer;
+    for (const auto &message : messages)
+    {
+        encoder.encode(message, buffer);
+    }
+    encoder.encode(image, buffer);
+
+    size_t offset = 0;
+    size_t decoded = 0;
+    while (offset < buffer.size())
+    {
+        size_t consumed = 0;
+        // 截断的记录只会报告数据不足
+        if (decoder.next(buffer.data() + offset, 1, consumed) != BinaryDecoder::Result::Incomplete)
+        {
+            ++failures;
+        }
+        const auto result = decoder.next(buffer.data() + offset, buffer.size() - offset, consumed);
+        if (result == BinaryDecoder::Result::Message)
+        {
+            failures += !SameMessage(decoder.message(), messages[decoded++]);
+        }
+        else if (result == BinaryDecoder::Result::Image)
+        {
+            const IImage &out = decoder.image();
+            failures += !SameMessage(out, image) || out.width != image.width || out.height != image.height ||
+                        out.duration != image.duration || !out.is_color || out.author != image.author;
+        }
+        else if (result != BinaryDecoder::Result::Definition)
+        {
+            std::cerr << "decode failed at " << offset << std::endl;
+            ++failures;
+            break;
+        }
+        offset += consumed;
+    }
+    if (decoded != messages.size() || decoder.dictionarySize() != messages.size() + 1)
+    {
+        ++failures;
+    }
+
+    // 驱动每次更新都新建消息，message_uuid 各不相同，属性只定义一次
+    {
+        BinaryEncoder fresh_encoder;
+        BinaryDecoder fresh_decoder;
+        size_t update_bytes = 0;
+        size_t fresh_ok = 0;
+        constexpr int kFresh = 1000;
+        for (int i = 0; i < kFresh; ++i)
+        {
+            const IMessage message = MakeMessage("CCD_TEMPERATURE", -10.0 + i * 0.01);
+            std::vector<uint8_t> record;
+            fresh_encoder.encode(message, record);
+            if (i > 0)
+            {
+                update_bytes += record.size();
+            }
+            size_t at = 0;
+            while (at < record.size())
+            {
+                size_t consumed = 0;
+                const auto result = fresh_decoder.next(record.data() + at, record.size() - at, consumed);
+                if (result == BinaryDecoder::Result::Message)
+                {
+                    fresh_ok += SameMessage(fresh_decoder.message(), message);
+                }
+                else if (result != BinaryDecoder::Result::Definition)
+                {
+                    break;
+                }
+                at += consumed;
+            }
+        }
+        if (fresh_encoder.dictionarySize() != 1 || fresh_decoder.dictionarySize() != 1 || fresh_ok != kFresh ||
+            update_bytes > (kFresh - 1) * 11)
+        {
+            std::cerr << "fresh messages: dictionary " << fresh_encoder.dictionarySize() << ", "
+                      << static_cast<double>(update_bytes) / (kFresh - 1) << " bytes per update" << std::endl;
+            ++failures;
+        }
+    }
+
+    // 超过 10 字节的 varint 是数据损坏，不是数据不足
+    {
+        std::vector<uint8_t> overlong = {static_cast<uint8_t>(BinaryRecord::Message), 0};
+        overlong.insert(overlong.end(), 11, 0xFF);
+        size_t consumed = 0;
+        BinaryDecoder fresh_decoder;
+        if (fresh_decoder.next(overlong.data(), overlong.size(), consumed) != BinaryDecoder::Result::Error)
+        {
+            std::cerr << "overlong varint was not rejected" << std::endl;
+            ++failures;
+        }
+        // 9 字节未结束的 varint 仍然是数据不足
+        overlong.resize(2 + 9);
+        if (fresh_decoder.next(overlong.data(), overlong.size(), consumed) != BinaryDecoder::Result::Incomplete)
+        {
+            ++failures;
+        }
+    }
+
+    // 热路径：属性已经定义后每条更新的大小和耗时
+    constexpr int kUpdates = 1000000;
+    IMessage &temperature = messages[0];
+    IMessage &focuser = messages[1];
+    std::vector<uint8_t> out;
+    size_t binary_bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kUpdates; ++i)
+    {
+        IMessage &message = i % 2 ? focuser : temperature;
+        message.value = i % 2 ? static_cast<double>(35000 + i % 500) : -10.0 + i * 1e-6;
+        out.clear();
+        encoder.encode(message, out);
+        binary_bytes += out.size();
+    }
+    const double binary_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kUpdates;
+
+    size_t decode_ok = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kUpdates; ++i)
+    {
+        size_t consumed = 0;
+        decode_ok += decoder.next(out.data(), out.size(), consumed) == BinaryDecoder::Result::Message;
+    }
+    const double decode_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kUpdates;
+    if (decode_ok != kUpdates)
+    {
+        ++failures;
+    }
+
+    size_t json_bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kUpdates; ++i)
+    {
+        IMessage &message = i % 2 ? focuser : temperature;
+        message.value = i % 2 ? static_cast<double>(35000 + i % 500) : -10.0 + i * 1e-6;
+        json_bytes += message.toJson().size();
+    }
+    const double json_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kUpdates;
+
+    std::cout << "binary: " << static_cast<double>(binary_bytes) / kUpdates << " bytes, " << binary_ns << " ns encode, "
+              << decode_ns << " ns decode" << std::endl;
+    std::cout << "toJson: " << static_cast<double>(json_bytes) / kUpdates << " bytes, " << json_ns << " ns" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+#include "../src/components/device/message_store.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace OpenAPT;
+
+static Property::IMessage MakeMessage(const std::string &name, int value)
+{
+    Property::IMessage message;
+    message.name = name;
+    message.value = value;
+    return message;
+}
+
+int main()
+{
+    int failures = 0;
+    DeviceMessageStore store;
+
+    // 与 std::map 对照的随机插入、更新、删除，并检查增量查询
+    std::map<std::string, int> reference;
+    std::map<std::string, int> mirror; // 只靠增量查询维护的副本
+    uint64_t seen = 0;
+    std::mt19937 rng(3);
+    for (int step = 0; step < 20000; ++step)
+    {
+        const std::string name = "PROP_" + std::to_string(rng() % 300);
+        const int value = static_cast<int>(rng() % 1000);
+        switch (rng() % 4)
+        {
+        case 0:
+            store.insert({MakeMessage(name, value), nullptr});
+            reference[name] = value;
+            break;
+        case 1:
+        case 2:
+            if (store.update(name, MakeMessage(name, value)))
+            {
+                reference[name] = value;
+            }
+            else if (reference.count(name))
+            {
+                ++failures;
+            }
+            break;
+        default:
+            if (store.remove(name) != (reference.erase(name) == 1))
+            {
+                ++failures;
+            }
+        }
+        if (step % 97 == 0)
+        {
+            const auto delta = store.changedSince(seen);
+            for (const auto *info : delta.changed)
+            {
+                mirror[info->message.name] = info->message.getValue<int>();
+            }
+            for (const auto name : delta.removed)
+            {
+                mirror.erase(std::string(name));
+            }
+            seen = delta.generation;
+            if (mirror != reference)
+            {
+                std::cerr << "delta mirror diverged at step " << step << std::endl;
+                ++failures;
+                mirror = reference;
+            }
+        }
+    }
+    if (store.size() != reference.size())
+    {
+        ++failures;
+    }
+    size_t dumped = 0;
+    store.forEach([&](const DeviceMessageInfo &info)
+                  { dumped += reference.at(info.message.name) == info.message.getValue<int>(); });
+    if (dumped != reference.size())
+    {
+        ++failures;
+    }
+
+    // 按 UUID 查找，以及删除后再插入得到同一个 ID
+    const auto id = store.insert({MakeMessage("CCD_TEMPERATURE", 1), nullptr});
+    const std::string uuid = store.get(id)->message.message_uuid;
+    if (store.find(uuid) != store.get(id) || store.id("CCD_TEMPERATURE") != id)
+    {
+        ++failures;
+    }
+    store.remove(uuid);
+    if (store.find("CCD_TEMPERATURE") || store.find(uuid) || store.insert({MakeMessage("CCD_TEMPERATURE", 2), nullptr}) != id)
+    {
+        ++failures;
+    }
+
+    // 500 个属性时更新和增量查询的开销
+    DeviceMessageStore large;
+    std::vector<std::string> names;
+    std::vector<Property::IMessage> messages;
+    for (int i = 0; i < 500; ++i)
+    {
+        names.push_back("PROPERTY_" + std::to_string(i));
+        messages.push_back(MakeMessage(names.back(), i));
+        large.insert({messages.back(), nullptr});
+    }
+    constexpr size_t kUpdates = 1000000;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kUpdates; ++i)
+    {
+        Property::IMessage &message = messages[(i * 7919) % messages.size()];
+        message.value = static_cast<int>(i);
+        large.update(message.name, message);
+    }
+    const double update_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kUpdates;
+    const uint64_t before = large.generation();
+    large.update(names[42], MakeMessage(names[42], -1));
+    const auto delta = large.changedSince(before);
+    if (delta.changed.size() != 1 || delta.changed[0]->message.name != names[42])
+    {
+        ++failures;
+    }
+
+    std::cout << "update with 500 properties: " << update_ns << " ns" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+#include "../src/components/driver/indi/property_router.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace OpenAPT;
+
+// 模拟驱动：绑定的属性指针和每个处理函数的调用次数
+struct FakeDriver
+{
+    INumberVectorProperty *exposure_prop = nullptr;
+    ISwitchVectorProperty *connection_prop = nullptr;
+    ITextVectorProperty *info_prop = nullptr;
+    int exposure_updates = 0;
+    int connection_updates = 0;
+    int info_updates = 0;
+    int temperature_updates = 0;
+    int frame_defined = 0;
+
+    void onExposure(INumberVectorProperty *) { ++exposure_updates; }
+    void onConnection(ISwitchVectorProperty *) { ++connection_updates; }
+    void onInfo(ITextVectorProperty *) { ++info_updates; }
+    void onTemperature(INumberVectorProperty *) { ++temperature_updates; }
+    void onFrame(INDI::Property *) { ++frame_defined; }
+};
+
+template <typename Vector>
+static Vector MakeVector(const char *name)
+{
+    Vector vector{};
+    std::strncpy(vector.name, name, MAXINDINAME - 1);
+    return vector;
+}
+
+int main()
+{
+    int failures = 0;
+
+    // 哈希表：大量名称的槽位冲突都能找到；哈希相同但名称不同时不会误匹配
+    {
+        PropertyTable<int> table;
+        constexpr int kNames = 2000;
+        for (int i = 0; i < kNames; ++i)
+        {
+            table.insert(PropertyName::runtime("PROPERTY_" + std::to_string(i)), i);
+        }
+        table.insert("PROPERTY_7", -7);
+        int found = 0;
+        for (int i = 0; i < kNames; ++i)
+        {
+            const int *value = table.find("PROPERTY_" + std::to_string(i));
+            found += value && *value == (i == 7 ? -7 : i);
+        }
+        if (found != kNames || table.size() != kNames)
+        {
+            std::cerr << "table found " << found << " of " << kNames << " names" << std::endl;
+            ++failures;
+        }
+        if (table.find("PROPERTY_X", HashPropertyName("PROPERTY_1")) || table.find("PROPERTY_2000") || table.find(""))
+        {
+            std::cerr << "table matched a name by hash only" << std::endl;
+            ++failures;
+        }
+        static_assert(HashPropertyName("CCD_EXPOSURE") == PropertyName("CCD_EXPOSURE").hash);
+    }
+
+    PropertyRouter<FakeDriver> router;
+    router.bind("CCD_EXPOSURE", &FakeDriver::exposure_prop, &FakeDriver::onExposure)
+        .bind("CONNECTION", &FakeDriver::connection_prop, &FakeDriver::onConnection)
+        .bind("DRIVER_INFO", &FakeDriver::info_prop, &FakeDriver::onInfo)
+        .on("CCD_TEMPERATURE", &FakeDriver::onTemperature)
+        .onProperty("CCD_FRAME", INDI_NUMBER, &FakeDriver::onFrame)
+        .ignore("CCD_COMPRESSION", INDI_SWITCH);
+    FakeDriver driver;
+
+    auto exposure = MakeVector<INumberVectorProperty>("CCD_EXPOSURE");
+    auto connection = MakeVector<ISwitchVectorProperty>("CONNECTION");
+    auto info = MakeVector<ITextVectorProperty>("DRIVER_INFO");
+    auto temperature = MakeVector<INumberVectorProperty>("CCD_TEMPERATURE");
+    auto frame = MakeVector<INumberVectorProperty>("CCD_FRAME");
+    auto compression = MakeVector<ISwitchVectorProperty>("CCD_COMPRESSION");
+
+    // newProperty 绑定字段并调用处理函数；onProperty 代替更新处理函数
+    INDI::Property exposure_property(&exposure);
+    INDI::Property connection_property(&connection);
+    INDI::Property info_property(&info);
+    INDI::Property frame_property(&frame);
+    INDI::Property compression_property(&compression);
+    if (!router.dispatchProperty(driver, &exposure_property) || !router.dispatchProperty(driver, &connection_property) ||
+        !router.dispatchProperty(driver, &info_property) || !router.dispatchProperty(driver, &frame_property) ||
+        !router.dispatchProperty(driver, &compression_property))
+    {
+        ++failures;
+    }
+    if (driver.exposure_prop != &exposure || driver.connection_prop != &connection || driver.info_prop != &info ||
+        driver.exposure_updates != 1 || driver.connection_updates != 1 || driver.info_updates != 1 || driver.frame_defined != 1)
+    {
+        std::cerr << "newProperty did not bind and notify" << std::endl;
+        ++failures;
+    }
+
+    // 更新按名称分发到对应类型的处理函数
+    if (!router.dispatch(driver, &exposure) || !router.dispatch(driver, &temperature) || !router.dispatch(driver, &connection) ||
+        driver.exposure_updates != 2 || driver.temperature_updates != 1 || driver.connection_updates != 2)
+    {
+        std::cerr << "update was not dispatched" << std::endl;
+        ++failures;
+    }
+
+    // 未知名称、只忽略的属性和只有 onProperty 的属性都不调用处理函数
+    auto unknown = MakeVector<INumberVectorProperty>("CCD_UNKNOWN");
+    INDI::Property unknown_property(&unknown);
+    if (router.dispatch(driver, &unknown) || router.dispatchProperty(driver, &unknown_property) ||
+        router.dispatch(driver, &compression) || router.dispatch(driver, &frame))
+    {
+        std::cerr << "unknown or ignored property was dispatched" << std::endl;
+        ++failures;
+    }
+
+    // 类型不匹配：同名但类型不同的属性既不绑定也不分发
+    {
+        FakeDriver other;
+        auto exposure_switch = MakeVector<ISwitchVectorProperty>("CCD_EXPOSURE");
+        auto connection_number = MakeVector<INumberVectorProperty>("CONNECTION");
+        INDI::Property mismatched(&exposure_switch);
+        if (router.dispatchProperty(other, &mismatched) || router.dispatch(other, &exposure_switch) ||
+            router.dispatch(other, &connection_number) || other.exposure_prop || other.connection_prop ||
+            other.exposure_updates || other.connection_updates)
+        {
+            std::cerr << "type mismatch was dispatched" << std::endl;
+            ++failures;
+        }
+    }
+
+    // 断开时清空所有绑定的指针
+    router.clear(driver);
+    if (driver.exposure_prop || driver.connection_prop || driver.info_prop)
+    {
+        ++failures;
+    }
+
+    // 分发耗时：一次哈希加一次探测，与注册的属性数量无关
+    constexpr int kUpdates = 1000000;
+    INumberVectorProperty *vectors[2] = {&exposure, &temperature};
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kUpdates; ++i)
+    {
+        router.dispatch(driver, vectors[i & 1]);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kUpdates;
+    if (driver.exposure_updates + driver.temperature_updates != 3 + kUpdates)
+    {
+        ++failures;
+    }
+
+    std::cout << "dispatch: " << ns << " ns/update with " << router.size() << " routes" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
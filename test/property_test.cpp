@@ -1,4 +1,10 @@
-#include "../src/property/imessage.hpp"
+#include "../src/components/property/imessage.hpp"
+#include "../src/components/property/message_writer.hpp"
+
+#include "nlohmann/json.hpp"
+
+#include <chrono>
+#include <iostream>
 
 using namespace OpenAPT::Property;
 
@@ -8,6 +14,7 @@ int main()
     image.width = 800;
     image.height = 600;
     image.duration = 10.5;
+    image.author = "M \"42\" <Orion>\n";
     image.setValue("aaaaa");
 
     std::cout << "JSON: " << image.toJson() << std::endl;
@@ -15,13 +22,45 @@ int main()
 
     try
     {
-        bool value = image.getValue<std::string>();
+        std::string value = image.getValue<std::string>();
         std::cout << "Value: " << value << std::endl;
+        image.getValue<int>();
     }
     catch (const std::exception &ex)
     {
         std::cout << ex.what() << std::endl;
     }
 
-    return 0;
-}
\ No newline at end of file
+    // 转义后的输出必须能被标准解析器还原
+    int failures = 0;
+    const auto parsed = nlohmann::json::parse(image.toJson());
+    if (parsed["value"]["author"] != image.author || parsed["value"]["duration"] != 10.5)
+    {
+        ++failures;
+    }
+
+    // 遥测消息：复用缓冲区的序列化
+    IMessage message;
+    message.device_name = "CCD Simulator";
+    message.name = "CCD_TEMPERATURE";
+    message.value = -10.25;
+    MessageWriter writer;
+    if (nlohmann::json::parse(writer.json(message))["value"] != -10.25)
+    {
+        ++failures;
+    }
+
+    constexpr int kMessages = 1000000;
+    size_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kMessages; ++i)
+    {
+        message.value = i * 0.01;
+        bytes += writer.json(message).size();
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kMessages;
+    std::cout << "telemetry JSON: " << ns << " ns/message, " << bytes / kMessages << " bytes" << std::endl;
+
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
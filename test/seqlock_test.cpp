@@ -0,0 +1,139 @@
+#include "../src/components/device/camera_state.hpp"
+#include "../src/components/thread/seqlock.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace OpenAPT;
+
+// 写者把所有字段都设成同一个计数的函数，读者由任意字段反推计数并检查其余字段
+static void Fill(CameraState &state, uint64_t k)
+{
+    const auto n = static_cast<int>(k);
+    state.connected = k & 1;
+    state.exposure.current = k;
+    state.exposure.duration = k * 0.5;
+    state.exposure.exposing = !(k & 1);
+    state.exposure.binning_x = n;
+    state.exposure.binning_y = -n;
+    state.frame.x = n + 1;
+    state.frame.height = n + 2;
+    state.frame.max_frame_y = n + 3;
+    state.temperature.current = -static_cast<double>(k);
+    state.video.avgfps = k * 2.0;
+    state.network.port.assign(std::string(100, static_cast<char>('a' + k % 26)) + std::to_string(k));
+    state.limits.maxfps = k + 0.25;
+    state.driver.name.assign("camera " + std::to_string(k));
+    state.driver.interfaces.assign(std::to_string(k * 7));
+}
+
+static bool Consistent(const CameraState &state, uint64_t &k)
+{
+    k = static_cast<uint64_t>(state.exposure.current);
+    CameraState expected;
+    Fill(expected, k);
+    return state.connected == expected.connected && state.exposure.duration == expected.exposure.duration &&
+           state.exposure.exposing == expected.exposure.exposing && state.exposure.binning_x == expected.exposure.binning_x &&
+           state.exposure.binning_y == expected.exposure.binning_y && state.frame.x == expected.frame.x &&
+           state.frame.height == expected.frame.height && state.frame.max_frame_y == expected.frame.max_frame_y &&
+           state.temperature.current == expected.temperature.current && state.video.avgfps == expected.video.avgfps &&
+           state.network.port.view() == expected.network.port.view() && state.limits.maxfps == expected.limits.maxfps &&
+           state.driver.name.view() == expected.driver.name.view() &&
+           state.driver.interfaces.view() == expected.driver.interfaces.view();
+}
+
+int main()
+{
+    int failures = 0;
+    CameraState initial;
+    Fill(initial, 0);
+    Thread::SeqLock<CameraState> lock(initial);
+
+    // 两个写者交替用 update() 递增计数，读者不停读取，检查每个快照完整且计数不回退
+    constexpr uint64_t kWritesPerWriter = 200000;
+    std::atomic_bool done{false};
+    std::atomic_uint64_t torn{0};
+    std::atomic_uint64_t backwards{0};
+    std::atomic_uint64_t reads{0};
+    std::atomic_uint64_t changed{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r)
+    {
+        readers.emplace_back([&]()
+                             {
+            uint64_t last = 0;
+            while (!done.load(std::memory_order_acquire))
+            {
+                const CameraState state = lock.load();
+                uint64_t k = 0;
+                if (!Consistent(state, k))
+                {
+                    ++torn;
+                }
+                else if (k < last)
+                {
+                    ++backwards;
+                }
+                changed += k != last;
+                last = k;
+                ++reads;
+            } });
+    }
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; ++w)
+    {
+        writers.emplace_back([&]()
+                             {
+            for (uint64_t i = 0; i < kWritesPerWriter; ++i)
+            {
+                lock.update([](CameraState &state)
+                            { Fill(state, static_cast<uint64_t>(state.exposure.current) + 1); });
+            } });
+    }
+    for (auto &thread : writers)
+    {
+        thread.join();
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &thread : readers)
+    {
+        thread.join();
+    }
+
+    if (torn || backwards)
+    {
+        std::cerr << torn << " torn and " << backwards << " out-of-order snapshots" << std::endl;
+        ++failures;
+    }
+    // 读者必须看到写入的进展，否则没有与写者并发
+    if (changed == 0)
+    {
+        std::cerr << "readers never observed a write" << std::endl;
+        ++failures;
+    }
+
+    // 写入全部可见：计数等于写入次数，version 计入构造时的一次写入
+    uint64_t final_count = 0;
+    if (!Consistent(lock.load(), final_count) || final_count != 2 * kWritesPerWriter || lock.version() != 2 * kWritesPerWriter + 1)
+    {
+        std::cerr << "final count " << final_count << ", version " << lock.version() << std::endl;
+        ++failures;
+    }
+
+    // store() 整体替换
+    CameraState replaced;
+    Fill(replaced, 12345);
+    lock.store(replaced);
+    uint64_t k = 0;
+    if (!Consistent(lock.load(), k) || k != 12345)
+    {
+        ++failures;
+    }
+
+    std::cout << reads << " reads, " << changed << " saw a new state during " << 2 * kWritesPerWriter << " writes" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
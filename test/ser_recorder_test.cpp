@@ -0,0 +1,74 @@
+#include "../src/components/image/ser_recorder.hpp"
+
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace OpenAPT::Image;
+
+static int ReadLE32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24;
+}
+
+int main()
+{
+    int failures = 0;
+    FrameRing ring(4, 0);
+    SerRecorder recorder(ring);
+
+    // 达到 max_frames 后不调用 stop()，文件也应当完整
+    SerSettings settings;
+    settings.filename = "ser_recorder_test.ser";
+    settings.max_frames = 5;
+    settings.buffer_size = 1 << 16;
+    if (!recorder.start(settings))
+    {
+        std::cerr << "Failed to start recording" << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> image(64 * 32, 7);
+    for (int i = 0; i < 8; ++i)
+    {
+        FrameMeta meta;
+        meta.format = ".stream";
+        meta.video = true;
+        meta.width = 64;
+        meta.height = 32;
+        meta.bit_depth = 8;
+        ring.publishCopy(image.data(), image.size(), std::move(meta));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    for (int i = 0; i < 100 && recorder.isRecording(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uint8_t header[178] = {};
+    long size = 0;
+    if (FILE *file = std::fopen(settings.filename.c_str(), "rb"))
+    {
+        size = static_cast<long>(std::fread(header, 1, sizeof(header), file));
+        std::fseek(file, 0, SEEK_END);
+        size = std::ftell(file);
+        std::fclose(file);
+    }
+    const long expected = 178 + 5 * (64 * 32 + 8);
+    if (recorder.isRecording() || size != expected || ReadLE32(header + 38) != 5 || ReadLE32(header + 26) != 64)
+    {
+        std::cerr << "file is " << size << " bytes with " << ReadLE32(header + 38) << " frames, expected " << expected << std::endl;
+        ++failures;
+    }
+
+    // stop() 返回自行结束时的结果，之后可以开始新的录制
+    if (!recorder.stop() || !recorder.start(settings) || !recorder.stop())
+    {
+        ++failures;
+    }
+    std::remove(settings.filename.c_str());
+
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
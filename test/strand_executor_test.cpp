@@ -0,0 +1,125 @@
+#include "../src/components/thread/strand_executor.hpp"
+
+#include <iostream>
+#include <vector>
+
+using namespace OpenAPT::Thread;
+
+int main()
+{
+    int failures = 0;
+
+    // 同一 strand 内按顺序串行执行，不同 strand 并行
+    {
+        StrandExecutor executor(4, 100000, 100000);
+        constexpr int kStrands = 8;
+        constexpr int kTasks = 5000;
+        std::vector<std::shared_ptr<StrandExecutor::Strand>> strands;
+        std::vector<std::vector<int>> seen(kStrands);
+        std::vector<std::atomic_int> inside(kStrands);
+        std::atomic_bool overlapped{false};
+        for (int s = 0; s < kStrands; ++s)
+        {
+            strands.push_back(executor.makeStrand());
+        }
+        for (int i = 0; i < kTasks; ++i)
+        {
+            for (int s = 0; s < kStrands; ++s)
+            {
+                executor.post(strands[s], [&, s, i]()
+                              {
+                    if (inside[s].fetch_add(1) != 0)
+                    {
+                        overlapped = true;
+                    }
+                    seen[s].push_back(i);
+                    inside[s].fetch_sub(1); });
+            }
+        }
+        while (executor.stats().executed < static_cast<uint64_t>(kStrands * kTasks))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (int s = 0; s < kStrands; ++s)
+        {
+            for (int i = 0; i < kTasks; ++i)
+            {
+                if (seen[s][i] != i)
+                {
+                    std::cerr << "strand " << s << " out of order at " << i << std::endl;
+                    ++failures;
+                    break;
+                }
+            }
+        }
+        if (overlapped)
+        {
+            std::cerr << "two tasks of one strand ran concurrently" << std::endl;
+            ++failures;
+        }
+    }
+
+    // 准入控制：慢连接占满自己的队列和全局队列后被拒绝，关闭后排队的任务被丢弃
+    {
+        StrandExecutor executor(1, 10, 4);
+        auto slow = executor.makeStrand();
+        auto a = executor.makeStrand();
+        auto b = executor.makeStrand();
+        std::atomic_bool release{false};
+        std::atomic_int ran{0};
+        auto blocking = [&]()
+        {
+            while (!release)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            ++ran;
+        };
+        executor.post(slow, blocking);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        int accepted = 0;
+        int strand_full = 0;
+        for (int i = 0; i < 6; ++i)
+        {
+            const auto admission = executor.post(slow, blocking);
+            accepted += admission == StrandExecutor::Admission::Accepted;
+            strand_full += admission == StrandExecutor::Admission::StrandFull;
+        }
+        int overloaded = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            accepted += executor.post(a, blocking) == StrandExecutor::Admission::Accepted;
+        }
+        for (int i = 0; i < 4; ++i)
+        {
+            overloaded += executor.post(b, blocking) == StrandExecutor::Admission::Overloaded;
+        }
+        if (accepted != 8 || strand_full != 2 || overloaded != 2 || executor.pending() != 10)
+        {
+            std::cerr << "admission: " << accepted << " accepted, " << strand_full << " strand full, " << overloaded
+                      << " overloaded, " << executor.pending() << " pending" << std::endl;
+            ++failures;
+        }
+        executor.close(slow);
+        if (executor.post(slow, blocking) != StrandExecutor::Admission::Closed || executor.pending() != 6)
+        {
+            ++failures;
+        }
+        release = true;
+        while (executor.stats().executed < 7)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const auto stats = executor.stats();
+        if (ran != 7 || stats.rejected_overloaded != 2 || stats.rejected_strand != 2 || stats.max_pending != 10)
+        {
+            std::cerr << "stats: ran " << ran << ", overloaded " << stats.rejected_overloaded << ", strand full "
+                      << stats.rejected_strand << ", max pending " << stats.max_pending << std::endl;
+            ++failures;
+        }
+        std::cout << "max wait " << stats.max_wait.count() << " us, mean wait " << stats.mean_wait_us << " us" << std::endl;
+    }
+
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#include "../src/components/device/telemetry_store.hpp"
+
+#include <cmath>
+#include <iostream>
+
+using namespace OpenAPT;
+using namespace std::chrono;
+
+int main()
+{
+    int failures = 0;
+    TelemetryStore store;
+
+    // 一整夜 1 Hz 的制冷温度，从 0 ℃ 每秒降 0.001 ℃
+    const auto start = TelemetryStore::Clock::time_point(seconds(1690000000));
+    constexpr int kSeconds = 24 * 3600;
+    const auto begin = steady_clock::now();
+    for (int i = 0; i < kSeconds; ++i)
+    {
+        store.record("CCD Simulator.temperature", -0.001 * i, start + seconds(i));
+        store.record("Focuser Simulator.position", 30000 + i % 100, start + seconds(i));
+    }
+    const double record_ns = duration<double, std::nano>(steady_clock::now() - begin).count() / (2 * kSeconds);
+    const auto end = start + seconds(kSeconds - 1);
+
+    // 最近 5 分钟：原始样本
+    auto series = store.query("CCD Simulator.temperature", end - minutes(5), end);
+    if (series.resolution != 0 || series.points.size() != 301)
+    {
+        std::cerr << "5 min: resolution " << series.resolution << ", " << series.points.size() << " points" << std::endl;
+        ++failures;
+    }
+
+    // 最近 1 小时，上限 500 点：原始样本仍在，但点数超过上限，改用 10 秒层
+    series = store.query("CCD Simulator.temperature", end - hours(1), end);
+    if (series.resolution != 10000 || series.points.size() > 500 || series.points.size() < 360)
+    {
+        std::cerr << "1 h: resolution " << series.resolution << ", " << series.points.size() << " points" << std::endl;
+        ++failures;
+    }
+    // 10 秒桶的均值是桶内 10 个样本的均值
+    const auto &bucket = series.points[series.points.size() / 2];
+    const double first = -0.001 * duration_cast<seconds>(TelemetryStore::Clock::time_point(milliseconds(bucket.time)) - start).count();
+    if (bucket.count != 10 || std::fabs(bucket.mean - (first - 0.0045)) > 1e-9 || bucket.max != first)
+    {
+        ++failures;
+    }
+
+    // 20 小时以前：原始样本和 10 秒层都已淘汰，只剩 1 分钟层，且合并到上限以内
+    series = store.query("CCD Simulator.temperature", start + hours(1), start + hours(21));
+    if (series.resolution < 60000 || series.points.empty() || series.points.size() > 500)
+    {
+        std::cerr << "20 h: resolution " << series.resolution << ", " << series.points.size() << " points" << std::endl;
+        ++failures;
+    }
+
+    const auto focuser = store.query("Focuser Simulator.position", end - minutes(10), end, 0, TelemetryStore::Resolution::OneMinute);
+    for (const auto &point : focuser.points)
+    {
+        // 每个完整的分钟桶包含 60 个连续的位置
+        if (point.min < 30000 || point.max > 30099 || (point.count == 60 && point.max - point.min < 59))
+        {
+            ++failures;
+            break;
+        }
+    }
+
+    if (store.latest("CCD Simulator.temperature").mean != -0.001 * (kSeconds - 1) || store.channels().size() != 2)
+    {
+        ++failures;
+    }
+
+    std::cout << "record " << record_ns << " ns/sample, memory " << store.memoryUsage() / 1024 << " KiB for "
+              << store.channels().size() << " channels, chart JSON "
+              << store.query("CCD Simulator.temperature", end - hours(12), end).toJson().dump().size() << " bytes" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}
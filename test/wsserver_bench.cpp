@@ -0,0 +1,136 @@
+#include "wsserver.hpp"
+
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace OpenAPT;
+using Client = websocketpp::client<websocketpp::config::asio_client>;
+using Clock = std::chrono::steady_clock;
+
+// 每个连接同时只有一条请求在途：收到回复后立即发送下一条，统计吞吐和往返延迟
+struct Connection
+{
+    websocketpp::connection_hdl hdl;
+    Clock::time_point sent;
+    std::vector<double> latency_us;
+};
+
+static void Bench(size_t io_threads, int port, size_t connections, std::chrono::milliseconds duration)
+{
+    WebSocketServer server(0);
+    std::thread server_thread([&]()
+                              { server.run(port, io_threads); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    const std::string request = R"({"name":"Ping","params":{}})";
+    std::atomic_bool measuring{false};
+    std::atomic_bool stopping{false};
+    std::atomic_size_t opened{0};
+    std::vector<Connection> states(connections);
+
+    Client client;
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.clear_error_channels(websocketpp::log::elevel::all);
+    client.init_asio();
+    client.start_perpetual();
+
+    auto send = [&](Connection &state)
+    {
+        state.sent = Clock::now();
+        websocketpp::lib::error_code ec;
+        client.send(state.hdl, request, websocketpp::frame::opcode::text, ec);
+    };
+
+    for (auto &state : states)
+    {
+        websocketpp::lib::error_code ec;
+        auto con = client.get_connection("ws://127.0.0.1:" + std::to_string(port), ec);
+        if (ec)
+        {
+            std::cerr << "connect: " << ec.message() << std::endl;
+            std::exit(1);
+        }
+        state.hdl = con->get_handle();
+        con->set_open_handler([&](websocketpp::connection_hdl)
+                              {
+            ++opened;
+            send(state); });
+        con->set_message_handler([&](websocketpp::connection_hdl, Client::message_ptr)
+                                 {
+            if (measuring)
+            {
+                state.latency_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - state.sent).count());
+            }
+            if (!stopping)
+            {
+                send(state);
+            } });
+        client.connect(con);
+    }
+
+    // 客户端的线程数固定，只改变服务器的 I/O 线程数
+    std::vector<std::thread> client_threads;
+    for (int i = 0; i < 2; ++i)
+    {
+        client_threads.emplace_back([&]()
+                                    { client.run(); });
+    }
+
+    while (opened < connections)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    measuring = true;
+    std::this_thread::sleep_for(duration);
+    measuring = false;
+    stopping = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    for (auto &state : states)
+    {
+        websocketpp::lib::error_code ec;
+        client.close(state.hdl, websocketpp::close::status::normal, "", ec);
+    }
+    client.stop_perpetual();
+    for (auto &thread : client_threads)
+    {
+        thread.join();
+    }
+    const json stats = server.getStats();
+    server.stop();
+    server_thread.join();
+
+    std::vector<double> latency;
+    for (const auto &state : states)
+    {
+        latency.insert(latency.end(), state.latency_us.begin(), state.latency_us.end());
+    }
+    std::sort(latency.begin(), latency.end());
+    const auto percentile = [&](double p)
+    {
+        return latency.empty() ? 0.0 : latency[std::min(latency.size() - 1, static_cast<size_t>(p * latency.size()))];
+    };
+    std::cout << io_threads << " io threads: " << static_cast<uint64_t>(latency.size() / std::chrono::duration<double>(duration).count())
+              << " msg/s, p50 " << percentile(0.5) << " us, p99 " << percentile(0.99) << " us, rejected "
+              << stats["rejected_overloaded"].get<uint64_t>() + stats["rejected_connection"].get<uint64_t>() << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    // 用法：wsserver_bench [连接数] [每组秒数]
+    const size_t connections = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    const auto duration = std::chrono::milliseconds(argc > 2 ? std::atoi(argv[2]) * 1000 : 2000);
+    std::cout << connections << " connections, " << std::thread::hardware_concurrency() << " cores" << std::endl;
+    int port = 9100;
+    for (size_t threads : {1, 2, 4, 8})
+    {
+        Bench(threads, port++, connections, duration);
+    }
+    return 0;
+}
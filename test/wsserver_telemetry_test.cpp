@@ -0,0 +1,105 @@
+#include "wsserver.hpp"
+
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <queue>
+
+using namespace OpenAPT;
+using Client = websocketpp::client<websocketpp::config::asio_client>;
+
+int main()
+{
+    int failures = 0;
+    constexpr int kPort = 9310;
+
+    // 一小时的 1 Hz 温度读数，客户端一次查询取得降采样后的曲线
+    auto store = std::make_shared<TelemetryStore>();
+    const auto now = TelemetryStore::Clock::now();
+    for (int i = 3600; i > 0; --i)
+    {
+        store->record("CCD Simulator.temperature", -10.0 + (i % 60) * 0.01, now - std::chrono::seconds(i));
+    }
+    store->record("Focuser Simulator.temperature", 12.5, now);
+
+    WebSocketServer server(0);
+    server.setTelemetryStore(store);
+    std::thread server_thread([&]()
+                              { server.run(kPort); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    Client client;
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.clear_error_channels(websocketpp::log::elevel::all);
+    client.init_asio();
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::queue<json> replies;
+    bool opened = false;
+    websocketpp::lib::error_code ec;
+    auto con = client.get_connection("ws://127.0.0.1:" + std::to_string(kPort), ec);
+    con->set_open_handler([&](websocketpp::connection_hdl)
+                          {
+        std::lock_guard<std::mutex> lock(mutex);
+        opened = true;
+        ready.notify_all(); });
+    con->set_message_handler([&](websocketpp::connection_hdl, Client::message_ptr msg)
+                             {
+        std::lock_guard<std::mutex> lock(mutex);
+        replies.push(json::parse(msg->get_payload()));
+        ready.notify_all(); });
+    client.connect(con);
+    std::thread client_thread([&]()
+                              { client.run(); });
+
+    auto request = [&](const json &params)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait_for(lock, std::chrono::seconds(2), [&]()
+                       { return opened; });
+        client.send(con->get_handle(), json{{"name", "GetTelemetry"}, {"params", params}}.dump(), websocketpp::frame::opcode::text, ec);
+        ready.wait_for(lock, std::chrono::seconds(2), [&]()
+                       { return !replies.empty(); });
+        json reply = replies.empty() ? json() : replies.front();
+        if (!replies.empty())
+        {
+            replies.pop();
+        }
+        return reply;
+    };
+
+    const json channels = request(json::object());
+    if (channels["data"]["channels"].size() != 2)
+    {
+        std::cerr << "channels: " << channels.dump() << std::endl;
+        ++failures;
+    }
+
+    const json series = request({{"channel", "CCD Simulator.temperature"}, {"duration", 3600}, {"max_points", 120}});
+    const json &data = series["data"];
+    if (series["reply"] != "OK" || data["channel"] != "CCD Simulator.temperature" || data["time"].empty() ||
+        data["time"].size() > 120 || data["mean"].size() != data["time"].size() || data["min"][0].get<double>() < -10.0 ||
+        data["max"][0].get<double>() > -9.4)
+    {
+        std::cerr << "series: " << series.dump().substr(0, 300) << std::endl;
+        ++failures;
+    }
+
+    const json bad = request({{"channel", "CCD Simulator.temperature"}, {"duration", -1}});
+    if (!bad.contains("error"))
+    {
+        ++failures;
+    }
+
+    client.close(con->get_handle(), websocketpp::close::status::normal, "", ec);
+    client_thread.join();
+    server.stop();
+    server_thread.join();
+
+    std::cout << "GetTelemetry returned " << data["time"].size() << " points at " << data["resolution"] << " ms" << std::endl;
+    std::cout << (failures ? "FAILED" : "OK") << std::endl;
+    return failures ? 1 : 0;
+}